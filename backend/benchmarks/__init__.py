@@ -0,0 +1,3 @@
+"""
+Benchmarks package - load tests and latency benchmarks for the consultation pipeline
+"""
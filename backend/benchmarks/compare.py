@@ -0,0 +1,93 @@
+"""
+Report comparison - catch latency regressions against a baseline
+
+Works on load.py reports and on the browser reports from the /bench page:
+both have an "error_rate" and per-step "p95_ms" values under "steps".
+
+Usage (from backend/):
+    python -m benchmarks.compare report.json baseline.json --max-regression 0.15
+    python -m benchmarks.compare bench.json bench-baseline.json --floor-ms 2
+
+Exits non-zero when a step regressed, so it can gate a deploy.
+"""
+import sys
+import json
+import argparse
+from typing import Dict, List, Optional
+
+
+# p95 changes smaller than this are noise, whatever the percentage
+REGRESSION_FLOOR_MS = 25.0
+
+
+def compare(
+    report: Dict,
+    baseline: Optional[Dict],
+    max_regression: float,
+    max_error_rate: float,
+    floor_ms: float = REGRESSION_FLOOR_MS
+) -> List[str]:
+    """
+    Regressions of a run against a baseline report
+
+    Args:
+        report: This run
+        baseline: Earlier report (e.g. from the last deploy), or None
+        max_regression: Allowed p95 increase per step, as a fraction
+        max_error_rate: Highest acceptable error rate for this run
+        floor_ms: Smallest p95 increase counted as a regression
+
+    Returns:
+        One line per regression (empty if none)
+    """
+    regressions = []
+    if report.get("error_rate", 0) > max_error_rate:
+        regressions.append(f"error rate {report['error_rate']:.2%} above {max_error_rate:.2%}")
+    if not baseline:
+        return regressions
+
+    if baseline.get("benchmark") != report.get("benchmark"):
+        regressions.append(f"baseline is a {baseline.get('benchmark')} report, not {report.get('benchmark')}")
+        return regressions
+    gpu = (report.get("environment") or {}).get("gpu")
+    baseline_gpu = (baseline.get("environment") or {}).get("gpu")
+    if gpu != baseline_gpu:
+        print(f"⚠️ Baseline ran on different hardware ({baseline_gpu} vs {gpu})")
+
+    for step, before in baseline.get("steps", {}).items():
+        after = report.get("steps", {}).get(step)
+        if not after or after.get("p95_ms") is None or before.get("p95_ms") is None:
+            continue
+        allowed = max(before["p95_ms"] * (1 + max_regression), before["p95_ms"] + floor_ms)
+        if after["p95_ms"] > allowed:
+            regressions.append(
+                f"{step} p95 {after['p95_ms']:.1f}ms vs {before['p95_ms']:.1f}ms baseline "
+                f"(+{after['p95_ms'] / max(before['p95_ms'], 0.001) - 1:.0%})"
+            )
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare a benchmark report with a baseline")
+    parser.add_argument("report", help="Report of this run")
+    parser.add_argument("baseline", help="Earlier report")
+    parser.add_argument("--max-regression", type=float, default=0.15, help="Allowed p95 increase (fraction)")
+    parser.add_argument("--max-error-rate", type=float, default=0.01, help="Allowed error rate")
+    parser.add_argument("--floor-ms", type=float, default=REGRESSION_FLOOR_MS, help="Ignore p95 increases below this")
+    args = parser.parse_args()
+
+    with open(args.report, "r", encoding="utf-8") as f:
+        report = json.load(f)
+    with open(args.baseline, "r", encoding="utf-8") as f:
+        baseline = json.load(f)
+
+    regressions = compare(report, baseline, args.max_regression, args.max_error_rate, args.floor_ms)
+    for regression in regressions:
+        print(f"❌ Regression: {regression}")
+    if regressions:
+        sys.exit(1)
+    print("✓ No regressions")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,113 @@
+"""
+Benchmark fixtures - scripted consultations and the patient's recorded audio
+
+Each consultation in fixtures/consultations.json is a patient script: the
+age the webcam would report and, per turn, what the patient says and the
+facial emotion sent with it. The spoken turns are read from
+fixtures/audio/<consultation>-<turn>.mp3 (made by record_fixtures.py);
+turns without a recording use a silent WAV of the same speaking length,
+which the mock STT backend maps back to its transcript.
+"""
+import os
+import json
+import struct
+import hashlib
+from typing import Dict, List, Optional, Tuple
+
+
+FIXTURES_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "fixtures")
+CONSULTATIONS_PATH = os.path.join(FIXTURES_DIR, "consultations.json")
+
+# Placeholder audio: 16 kHz mono PCM, at a typical speaking rate
+PLACEHOLDER_SAMPLE_RATE = 16000
+SECONDS_PER_WORD = 0.4
+
+
+def audio_dir() -> str:
+    """Recorded patient audio (BENCH_AUDIO_DIR, default fixtures/audio)"""
+    return os.getenv("BENCH_AUDIO_DIR", os.path.join(FIXTURES_DIR, "audio"))
+
+
+def load_consultations(path: Optional[str] = None) -> List[Dict]:
+    """
+    Load the patient scripts
+
+    Args:
+        path: consultations.json to read (default: the bundled one)
+
+    Returns:
+        Consultations with id, age, age_category, voice_id and turns
+    """
+    with open(path or CONSULTATIONS_PATH, "r", encoding="utf-8") as f:
+        return json.load(f)["consultations"]
+
+
+def audio_path(consultation_id: str, turn_index: int) -> str:
+    """Where the recording of one patient turn lives"""
+    return os.path.join(audio_dir(), f"{consultation_id}-{turn_index}.mp3")
+
+
+def utterance_audio(consultation: Dict, turn_index: int) -> Tuple[bytes, str, str]:
+    """
+    Audio the client would upload for one patient turn
+
+    Args:
+        consultation: Consultation from load_consultations()
+        turn_index: Index into its turns
+
+    Returns:
+        (audio bytes, file name, content type)
+    """
+    path = audio_path(consultation["id"], turn_index)
+    if os.path.exists(path):
+        with open(path, "rb") as f:
+            return f.read(), os.path.basename(path), "audio/mpeg"
+    text = consultation["turns"][turn_index]["text"]
+    return placeholder_audio(text), f"{consultation['id']}-{turn_index}.wav", "audio/wav"
+
+
+def placeholder_audio(text: str) -> bytes:
+    """
+    Silent WAV as long as the text takes to say
+
+    The transcript goes in an INFO comment chunk, so different lines of
+    the same length still have different bytes (and digests).
+    """
+    seconds = max(1.0, len(text.split()) * SECONDS_PER_WORD)
+    data = bytes(int(seconds * PLACEHOLDER_SAMPLE_RATE) * 2)
+
+    comment = text.encode("utf-8") + b"\x00"
+    if len(comment) % 2:
+        comment += b"\x00"
+    info = b"INFO" + b"ICMT" + struct.pack("<I", len(comment)) + comment
+
+    fmt = struct.pack("<HHIIHH", 1, 1, PLACEHOLDER_SAMPLE_RATE, PLACEHOLDER_SAMPLE_RATE * 2, 2, 16)
+    chunks = (
+        b"fmt " + struct.pack("<I", len(fmt)) + fmt
+        + b"LIST" + struct.pack("<I", len(info)) + info
+        + b"data" + struct.pack("<I", len(data)) + data
+    )
+    return b"RIFF" + struct.pack("<I", 4 + len(chunks)) + b"WAVE" + chunks
+
+
+def audio_digest(audio: bytes) -> str:
+    """Key a recording is looked up by"""
+    return hashlib.sha256(audio).hexdigest()
+
+
+def transcript_index(consultations: Optional[List[Dict]] = None) -> Dict[str, str]:
+    """
+    Transcript of every fixture recording, by audio_digest()
+
+    Args:
+        consultations: Scripts to index (default: load_consultations())
+
+    Returns:
+        {digest: transcript}
+    """
+    index = {}
+    for consultation in consultations if consultations is not None else load_consultations():
+        for turn_index, turn in enumerate(consultation["turns"]):
+            audio, _, _ = utterance_audio(consultation, turn_index)
+            index[audio_digest(audio)] = turn["text"]
+    return index
@@ -0,0 +1,305 @@
+"""
+Load generator - full consultations against a running API
+
+Each virtual patient runs one scripted consultation from the fixtures the
+way the REST client does: per turn it uploads the recorded audio to
+/api/stt, sends the transcript to /api/chat and streams the reply from
+/api/tts; after the last turn (or when the doctor ends the consultation) it
+fetches /api/insights. Consultations run at the given concurrency and the
+latency of every step goes to a JSON report.
+
+With --baseline the run is compared with an earlier report, and the exit
+status is non-zero if a step's p95 regressed by more than --max-regression
+(or the error rate is above --max-error-rate), so it can gate a deploy
+(see compare.py).
+
+Usage (from backend/, with benchmarks.server running):
+    python -m benchmarks.load --concurrency 16 --sessions 64 --output report.json
+    python -m benchmarks.load --concurrency 16 --sessions 64 --baseline baseline.json
+"""
+import sys
+import json
+import math
+import time
+import uuid
+import asyncio
+import argparse
+import platform
+from datetime import datetime, timezone
+from typing import Dict, List, Optional
+
+import httpx
+
+from benchmarks.compare import compare
+from benchmarks.fixtures import load_consultations, utterance_audio
+
+
+# Report steps, in pipeline order
+STEPS = ("stt", "chat", "tts_ttfb", "tts_total", "turn", "insights", "session")
+
+REPORT_VERSION = 1
+
+
+def percentile(ordered: List[float], p: float) -> Optional[float]:
+    """Nearest-rank percentile of sorted values"""
+    if not ordered:
+        return None
+    index = min(len(ordered) - 1, max(0, math.ceil(len(ordered) * p / 100) - 1))
+    return ordered[index]
+
+
+class Results:
+    """Latencies and errors collected during a run"""
+
+    def __init__(self):
+        self.samples: Dict[str, List[float]] = {step: [] for step in STEPS}
+        self.errors: Dict[str, Dict[str, int]] = {step: {} for step in STEPS}
+        self.requests = 0
+        self.turns = 0
+        self.sessions_started = 0
+        self.sessions_completed = 0
+
+    def add(self, step: str, seconds: float):
+        self.samples[step].append(seconds * 1000)
+
+    def fail(self, step: str, reason: str):
+        self.errors[step][reason] = self.errors[step].get(reason, 0) + 1
+
+    def error_count(self) -> int:
+        return sum(sum(reasons.values()) for reasons in self.errors.values())
+
+    def step_summary(self) -> Dict[str, Dict]:
+        summary = {}
+        for step in STEPS:
+            ordered = sorted(self.samples[step])
+            errors = sum(self.errors[step].values())
+            summary[step] = {
+                "count": len(ordered),
+                "errors": errors,
+                "error_rate": round(errors / max(1, len(ordered) + errors), 4),
+                "mean_ms": round(sum(ordered) / len(ordered), 1) if ordered else None,
+                **{f"p{p}_ms": _round(percentile(ordered, p)) for p in (50, 95, 99)},
+                "max_ms": _round(ordered[-1] if ordered else None),
+            }
+        return summary
+
+
+def _round(value: Optional[float]) -> Optional[float]:
+    return round(value, 1) if value is not None else None
+
+
+def _reason(response: httpx.Response) -> str:
+    return f"HTTP {response.status_code}"
+
+
+async def run_consultation(client: httpx.AsyncClient, consultation: Dict, results: Results, args):
+    """One virtual patient: every scripted turn, then the insights"""
+    session_id = f"bench-{uuid.uuid4().hex[:12]}"
+    results.sessions_started += 1
+    started = time.perf_counter()
+
+    for turn_index, turn in enumerate(consultation["turns"]):
+        if turn_index and args.think_time:
+            await asyncio.sleep(args.think_time)
+        turn_started = time.perf_counter()
+        turn_id = uuid.uuid4().hex[:12]
+        headers = {"X-Turn-Id": turn_id}
+
+        audio, filename, content_type = utterance_audio(consultation, turn_index)
+        step_started = time.perf_counter()
+        response = await client.post("/api/stt", files={"audio": (filename, audio, content_type)}, headers=headers)
+        results.requests += 1
+        if response.status_code != 200:
+            results.fail("stt", _reason(response))
+            return
+        results.add("stt", time.perf_counter() - step_started)
+        transcript = response.json()["text"] or turn["text"]
+
+        step_started = time.perf_counter()
+        response = await client.post("/api/chat", json={
+            "message": transcript,
+            "emotion": turn["emotion"],
+            "age": consultation.get("age"),
+            "age_category": consultation.get("age_category"),
+            "session_id": session_id,
+        }, headers=headers)
+        results.requests += 1
+        if response.status_code != 200:
+            results.fail("chat", _reason(response))
+            return
+        results.add("chat", time.perf_counter() - step_started)
+        reply = response.json()
+
+        step_started = time.perf_counter()
+        async with client.stream("POST", "/api/tts", json={
+            "text": reply["response"],
+            "voice_id": consultation.get("voice_id"),
+        }, headers={**headers, "Accept": "audio/mpeg"}) as response:
+            results.requests += 1
+            if response.status_code != 200:
+                results.fail("tts_total", _reason(response))
+                return
+            first = True
+            async for _ in response.aiter_bytes():
+                if first:
+                    first = False
+                    results.add("tts_ttfb", time.perf_counter() - step_started)
+        results.add("tts_total", time.perf_counter() - step_started)
+
+        results.add("turn", time.perf_counter() - turn_started)
+        results.turns += 1
+        if reply.get("should_end_consultation"):
+            break
+
+    step_started = time.perf_counter()
+    response = await client.post("/api/insights", json={"session_id": session_id})
+    results.requests += 1
+    if response.status_code != 200:
+        results.fail("insights", _reason(response))
+        return
+    results.add("insights", time.perf_counter() - step_started)
+
+    results.add("session", time.perf_counter() - started)
+    results.sessions_completed += 1
+
+
+async def run_load(args) -> Dict:
+    """Run the consultations and build the report"""
+    consultations = load_consultations(args.fixtures)
+    results = Results()
+    limits = httpx.Limits(max_connections=args.concurrency * 2, max_keepalive_connections=args.concurrency * 2)
+    timeout = httpx.Timeout(args.timeout, connect=10.0)
+
+    async with httpx.AsyncClient(base_url=args.base_url, limits=limits, timeout=timeout) as client:
+        target = await describe_target(client)
+        next_session = 0
+        deadline = time.perf_counter() + args.duration if args.duration else None
+        started_at = datetime.now(timezone.utc)
+        started = time.perf_counter()
+
+        async def patient(worker: int):
+            nonlocal next_session
+            # Spread the first consultations over the ramp-up
+            await asyncio.sleep(args.ramp_up * worker / args.concurrency)
+            while True:
+                if deadline is not None:
+                    if time.perf_counter() >= deadline:
+                        return
+                elif next_session >= args.sessions:
+                    return
+                consultation = consultations[next_session % len(consultations)]
+                next_session += 1
+                try:
+                    await run_consultation(client, consultation, results, args)
+                except httpx.HTTPError as e:
+                    results.fail("session", type(e).__name__)
+
+        await asyncio.gather(*[patient(worker) for worker in range(args.concurrency)])
+        elapsed = time.perf_counter() - started
+        target["health_after"] = await fetch_json(client, "/health")
+
+    steps = results.step_summary()
+    return {
+        "benchmark": "consultation-load",
+        "version": REPORT_VERSION,
+        "started_at": started_at.isoformat(),
+        "duration_seconds": round(elapsed, 2),
+        "config": {
+            "base_url": args.base_url,
+            "concurrency": args.concurrency,
+            "sessions": args.sessions if not args.duration else None,
+            "duration": args.duration,
+            "ramp_up": args.ramp_up,
+            "think_time": args.think_time,
+            "fixtures": args.fixtures,
+        },
+        "client": {"python": platform.python_version(), "platform": platform.platform()},
+        "target": target,
+        "sessions": {
+            "started": results.sessions_started,
+            "completed": results.sessions_completed,
+            "failed": results.sessions_started - results.sessions_completed,
+        },
+        "throughput": {
+            "sessions_per_second": round(results.sessions_completed / elapsed, 3),
+            "turns_per_second": round(results.turns / elapsed, 3),
+            "requests_per_second": round(results.requests / elapsed, 3),
+        },
+        "error_rate": round(results.error_count() / max(1, results.requests), 4),
+        "steps": steps,
+        "errors": {step: reasons for step, reasons in results.errors.items() if reasons},
+    }
+
+
+async def fetch_json(client: httpx.AsyncClient, path: str) -> Optional[Dict]:
+    """GET a JSON endpoint, None if the server doesn't have it"""
+    try:
+        response = await client.get(path)
+        return response.json() if response.headers.get("content-type", "").startswith("application/json") else None
+    except (httpx.HTTPError, ValueError):
+        return None
+
+
+async def describe_target(client: httpx.AsyncClient) -> Dict:
+    """What the run is measuring: upstream mode and the server's state before it"""
+    health = await fetch_json(client, "/health")
+    if health is None:
+        raise SystemExit(f"❌ No API at {client.base_url}")
+    return {
+        "upstreams": await fetch_json(client, "/bench/upstreams"),
+        "health_before": health,
+    }
+
+
+def print_summary(report: Dict):
+    print(f"\n📊 {report['sessions']['completed']}/{report['sessions']['started']} consultations "
+          f"in {report['duration_seconds']}s at concurrency {report['config']['concurrency']} "
+          f"({report['throughput']['sessions_per_second']} sessions/s, error rate {report['error_rate']:.2%})")
+    print(f"{'step':<10} {'count':>6} {'p50':>8} {'p95':>8} {'p99':>8} {'errors':>7}")
+    for step, stats in report["steps"].items():
+        cells = [f"{stats[key]:.0f}ms" if stats[key] is not None else "-" for key in ("p50_ms", "p95_ms", "p99_ms")]
+        print(f"{step:<10} {stats['count']:>6} {cells[0]:>8} {cells[1]:>8} {cells[2]:>8} {stats['errors']:>7}")
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Drive full consultations against the API")
+    parser.add_argument("--base-url", default="http://127.0.0.1:8000")
+    parser.add_argument("--concurrency", type=int, default=8, help="Consultations in flight")
+    parser.add_argument("--sessions", type=int, default=32, help="Consultations to run")
+    parser.add_argument("--duration", type=float, default=None, help="Run for this many seconds instead")
+    parser.add_argument("--ramp-up", type=float, default=5.0, help="Seconds over which patients join")
+    parser.add_argument("--think-time", type=float, default=0.0, help="Pause between a patient's turns")
+    parser.add_argument("--timeout", type=float, default=60.0, help="Per-request timeout")
+    parser.add_argument("--fixtures", default=None, help="consultations.json to use")
+    parser.add_argument("--output", default="benchmark-report.json", help="Report path")
+    parser.add_argument("--baseline", default=None, help="Earlier report to compare with")
+    parser.add_argument("--max-regression", type=float, default=0.15, help="Allowed p95 increase (fraction)")
+    parser.add_argument("--max-error-rate", type=float, default=0.01, help="Allowed request error rate")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    report = asyncio.run(run_load(args))
+    print_summary(report)
+
+    baseline = None
+    if args.baseline:
+        with open(args.baseline, "r", encoding="utf-8") as f:
+            baseline = json.load(f)
+    regressions = compare(report, baseline, args.max_regression, args.max_error_rate)
+    report["baseline"] = args.baseline
+    report["regressions"] = regressions
+
+    with open(args.output, "w", encoding="utf-8") as f:
+        json.dump(report, f, indent=2)
+    print(f"✓ Report written to {args.output}")
+
+    if regressions:
+        for regression in regressions:
+            print(f"❌ Regression: {regression}")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,53 @@
+"""
+Record fixture audio - speak the patient scripts with ElevenLabs
+
+Writes fixtures/audio/<consultation>-<turn>.mp3 for every scripted patient
+turn, so STT in record/live runs gets real speech instead of the silent
+placeholders. Existing files are kept unless --overwrite is given.
+
+Usage (from backend/, with ELEVENLABS_API_KEY set):
+    python -m benchmarks.record_fixtures --voice <patient voice id>
+"""
+import os
+import asyncio
+import argparse
+
+from dotenv import load_dotenv
+
+
+async def record(voice_id: str, overwrite: bool):
+    from benchmarks.fixtures import audio_dir, audio_path, load_consultations
+    from services.container import container
+
+    os.makedirs(audio_dir(), exist_ok=True)
+    written = 0
+    try:
+        for consultation in load_consultations():
+            for turn_index, turn in enumerate(consultation["turns"]):
+                path = audio_path(consultation["id"], turn_index)
+                if os.path.exists(path) and not overwrite:
+                    continue
+                audio = await container.tts.synthesize(turn["text"], voice_id)
+                with open(path, "wb") as f:
+                    f.write(audio)
+                written += 1
+                print(f"✓ {os.path.basename(path)} ({len(audio) // 1024} KB)")
+    finally:
+        await container.shutdown()
+    print(f"✓ Recorded {written} patient turns to {audio_dir()}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Record the patient fixture audio with ElevenLabs")
+    parser.add_argument("--voice", default=None, help="Patient voice id (BENCH_PATIENT_VOICE_ID)")
+    parser.add_argument("--overwrite", action="store_true", help="Re-record existing files")
+    args = parser.parse_args()
+
+    load_dotenv()
+    # A different voice from the doctor's, so the recordings sound like a patient
+    voice_id = args.voice or os.getenv("BENCH_PATIENT_VOICE_ID", "ErXwobaYiN019PkySvjV")
+    asyncio.run(record(voice_id, args.overwrite))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,71 @@
+"""
+Benchmark server - the API on mock, replayed or recorded upstreams
+
+Runs main:app in one worker with the Gemini and ElevenLabs SDK objects
+swapped for benchmark stand-ins (see upstreams.py), and adds
+GET /bench/upstreams with the stand-ins' counters for load.py's report.
+
+Usage (from backend/):
+    python -m benchmarks.server --upstreams mock --profile default
+    python -m benchmarks.server --upstreams record --cassette benchmarks/cassettes/run.jsonl
+    python -m benchmarks.server --upstreams replay --cassette benchmarks/cassettes/run.jsonl
+"""
+import os
+import argparse
+
+from dotenv import load_dotenv
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Run the API against benchmark upstreams")
+    parser.add_argument("--upstreams", default="mock", help="mock, replay, record or live")
+    parser.add_argument("--profile", default="default", help="Latency profile name or path (mock)")
+    parser.add_argument("--cassette", default=None, help="Cassette to write (record) or read (replay)")
+    parser.add_argument("--replay-speed", type=float, default=1.0, help="Replay playback speed")
+    parser.add_argument("--seed", type=int, default=None, help="Random seed for mock latencies")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8000)
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    load_dotenv()
+    # Start from a cold TTS cache so runs are comparable (still overridable
+    # in the environment)
+    os.environ.setdefault("TTS_PREWARM", "false")
+    os.environ.setdefault("TTS_CACHE_DIR", "")
+
+    import uvicorn
+    from benchmarks.upstreams import install
+    from services.container import container
+
+    used = install(
+        container,
+        args.upstreams,
+        profile=args.profile,
+        cassette=args.cassette,
+        seed=args.seed,
+        replay_speed=args.replay_speed
+    )
+
+    from main import app
+
+    config = {
+        "mode": args.upstreams,
+        "profile": args.profile if args.upstreams == "mock" else None,
+        "cassette": args.cassette,
+        "replay_speed": args.replay_speed if args.upstreams == "replay" else None,
+        "seed": args.seed,
+    }
+
+    @app.get("/bench/upstreams", include_in_schema=False)
+    async def bench_upstreams():
+        """Benchmark upstream configuration and counters"""
+        return {**config, "stats": used.stats() if used is not None else {}}
+
+    uvicorn.run(app, host=args.host, port=args.port, workers=1)
+
+
+if __name__ == "__main__":
+    main()
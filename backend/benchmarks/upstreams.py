@@ -0,0 +1,672 @@
+"""
+Benchmark upstreams - Gemini and ElevenLabs stand-ins for load tests
+
+The stand-ins replace the SDK objects the services call (the Gemini
+GenerativeModels and the AsyncElevenLabs client), so everything above them
+- deadlines, hedging, breakers, the TTS cache, sessions, the speech
+pipeline - runs exactly as in production. Modes:
+
+- mock: responses are generated locally, with time to first chunk and
+  per-character generation time drawn from a latency profile
+  (profiles/*.json), so a worker can be loaded far past the provider quotas
+- record: the real APIs are called and every response is appended, with
+  the time each chunk arrived, to a cassette (JSON lines)
+- replay: responses are served from a cassette at their recorded timing
+  (optionally sped up); requests not in it get another recording of the
+  same call type
+- live: the real APIs, untouched
+
+Every response is a timeline of (seconds after the request, item) pairs
+that the stand-ins play back; mock and replay differ only in where the
+timeline comes from.
+"""
+import os
+import json
+import math
+import time
+import base64
+import random
+import asyncio
+import hashlib
+import itertools
+from types import SimpleNamespace
+from typing import AsyncIterator, Dict, List, Optional, Tuple
+
+from benchmarks.fixtures import audio_digest, transcript_index
+from services.conversation_memory import content_text
+from services.viseme import extract_alignment
+
+
+MODES = ("mock", "replay", "record", "live")
+
+PROFILES_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "profiles")
+
+# (seconds after the request, item) - items are {"text"}, {"audio", "alignment"?},
+# {"voices"} or {"error"}
+Timeline = List[Tuple[float, Dict]]
+
+# Call types without their own latency profile
+LATENCY_OPERATIONS = {
+    "gemini.overview": "gemini.summary",
+    "gemini.recommendations": "gemini.summary",
+    "elevenlabs.tts.stream": "elevenlabs.tts",
+    "elevenlabs.tts.audio": "elevenlabs.tts",
+}
+
+# Streamed text arrives in chunks of about this many characters
+TEXT_CHUNK_CHARS = 24
+SPEECH_CHUNK_CHARS = 40
+
+# Mock speech: characters spoken per second, as a silent 128 kbps MP3
+SPOKEN_CHARS_PER_SECOND = 15
+MP3_FRAME = b"\xff\xfb\x90\xc4" + bytes(413)  # MPEG-1 Layer III, 128 kbps, 44.1 kHz, mono
+MP3_FRAME_SECONDS = 1152 / 44100
+
+MOCK_REPLIES = [
+    "Where exactly do you feel it, and is it a sharp pain or more of a dull ache? Has anything made it better or worse so far?",
+    "How long has this been going on, and did anything change around the time it started, like your sleep, stress or routine?",
+    "That pattern makes sense. Have you noticed any other symptoms alongside it, such as fever, nausea or trouble sleeping?",
+    "This sounds like a muscular strain made worse by posture and stress. Take 400mg ibuprofen every 6 hours with food, use a warm compress for 15 minutes twice a day, and take a short break every half hour. It should ease within a week.",
+]
+MOCK_CLOSING_REPLY = "You're welcome! Take care of yourself and feel better soon. [END_CONSULTATION]"
+MOCK_OVERVIEW = (
+    "Patient presented with a recent onset of symptoms consistent with a benign musculoskeletal or tension-type condition. "
+    "History points to posture, sleep and stress as the main contributing factors, with no red flags reported. "
+    "Prognosis is good with conservative management."
+)
+MOCK_RECOMMENDATIONS = [
+    "Take 400mg ibuprofen every 6 hours with food for up to 5 days",
+    "Apply a warm compress for 15 minutes twice a day",
+    "Take a short movement break every 30 minutes during desk work",
+    "Follow up if symptoms last beyond two weeks or new symptoms appear",
+]
+MOCK_TRANSCRIPT = "I have had a headache since yesterday."
+MOCK_VOICES = [{"voice_id": "21m00Tcm4TlvDq8ikWAM", "name": "Rachel", "category": "premade", "description": None}]
+
+
+class MockUpstreamError(Exception):
+    """A failure injected by the latency profile (or a cassette with no recording)"""
+
+    # Counted by the circuit breakers like a provider outage
+    status_code = 503
+
+
+def load_profile(name_or_path: str) -> Dict:
+    """Latency profile by name (profiles/<name>.json) or path"""
+    path = name_or_path if os.path.exists(name_or_path) else os.path.join(PROFILES_DIR, f"{name_or_path}.json")
+    with open(path, "r", encoding="utf-8") as f:
+        return json.load(f)
+
+
+def prompt_text(contents) -> str:
+    """Text of the newest message in a Gemini request"""
+    if isinstance(contents, str):
+        return contents
+    if isinstance(contents, (list, tuple)) and contents:
+        last = contents[-1]
+        return last if isinstance(last, str) else content_text(last)
+    return ""
+
+
+def request_key(op: str, material: str) -> str:
+    """Cassette key of a request"""
+    return hashlib.sha1(f"{op}\n{material}".encode("utf-8")).hexdigest()
+
+
+def alignment_item(response) -> Optional[Dict]:
+    """Alignment of an ElevenLabs response, as stored in timelines"""
+    return extract_alignment(response)
+
+
+def silent_mp3(seconds: float) -> bytes:
+    """Silent constant-bitrate MP3 of about this duration"""
+    return MP3_FRAME * max(1, math.ceil(seconds / MP3_FRAME_SECONDS))
+
+
+def split_text(text: str, size: int) -> List[str]:
+    """Split text at word boundaries into pieces of about size characters"""
+    pieces, current = [], ""
+    for word in text.split(" "):
+        candidate = f"{current} {word}" if current else word
+        if current and len(candidate) > size:
+            pieces.append(current + " ")
+            current = word
+        else:
+            current = candidate
+    if current:
+        pieces.append(current)
+    return pieces
+
+
+class LatencyModel:
+    """Latency distributions per call type, from a profile"""
+
+    def __init__(self, profile: Dict, seed: Optional[int] = None):
+        """
+        Initialize model
+
+        Args:
+            profile: Parsed profile ({"operations": {op: {"first_ms", "per_char_ms", "error_rate"}}})
+            seed: Random seed, for repeatable runs
+        """
+        self.operations = profile["operations"]
+        self._random = random.Random(seed)
+
+    def _operation(self, op: str) -> Dict:
+        return self.operations[LATENCY_OPERATIONS.get(op, op)]
+
+    def first(self, op: str) -> float:
+        """Seconds to the first chunk: lognormal with the profile's median and p95"""
+        first_ms = self._operation(op)["first_ms"]
+        mu = math.log(first_ms["p50"])
+        sigma = max(0.0, (math.log(first_ms["p95"]) - mu) / 1.645)
+        return self._random.lognormvariate(mu, sigma) / 1000
+
+    def per_char(self, op: str) -> float:
+        """Seconds to generate each further character"""
+        return self._operation(op).get("per_char_ms", 0.0) / 1000
+
+    def fails(self, op: str) -> bool:
+        """Whether this call should fail"""
+        return self._random.random() < self._operation(op).get("error_rate", 0.0)
+
+
+class MockSource:
+    """Timelines generated locally from a latency profile"""
+
+    def __init__(self, latency: LatencyModel, transcripts: Optional[Dict[str, str]] = None):
+        """
+        Initialize source
+
+        Args:
+            latency: Latency distributions
+            transcripts: Transcript per fixture audio digest, for mock STT
+        """
+        self.latency = latency
+        self.transcripts = transcripts if transcripts is not None else transcript_index()
+        self.calls: Dict[str, int] = {}
+
+    def timeline(self, op: str, material: str) -> Timeline:
+        """
+        Response to one request
+
+        Args:
+            op: Call type, e.g. "gemini.chat" or "elevenlabs.tts.stream"
+            material: Prompt, text to speak, or audio digest for STT
+
+        Returns:
+            Timeline to play back
+        """
+        self.calls[op] = self.calls.get(op, 0) + 1
+        first = self.latency.first(op)
+        if self.latency.fails(op):
+            return [(first, {"error": f"{op} failed (injected)"})]
+
+        if op.startswith("gemini."):
+            return self._chunks(op, first, split_text(self._gemini_text(op, material), TEXT_CHUNK_CHARS), speech=False)
+        if op == "elevenlabs.tts":
+            text = material
+            return [(first + len(text) * self.latency.per_char(op), self._speech_item(text, 0.0))]
+        if op in ("elevenlabs.tts.stream", "elevenlabs.tts.audio"):
+            return self._chunks(op, first, split_text(material, SPEECH_CHUNK_CHARS), speech=True)
+        if op == "elevenlabs.stt":
+            text = self.transcripts.get(material, MOCK_TRANSCRIPT)
+            return [(first + len(text) * self.latency.per_char(op), {"text": text})]
+        if op == "elevenlabs.voices":
+            return [(first, {"voices": MOCK_VOICES})]
+        raise ValueError(f"Unknown upstream call {op}")
+
+    def stats(self) -> Dict[str, any]:
+        return {"calls": dict(self.calls)}
+
+    def _gemini_text(self, op: str, prompt: str) -> str:
+        if op == "gemini.summary":
+            return json.dumps({"overview": MOCK_OVERVIEW, "recommendations": MOCK_RECOMMENDATIONS})
+        if op == "gemini.overview":
+            return MOCK_OVERVIEW
+        if op == "gemini.recommendations":
+            return "\n".join(MOCK_RECOMMENDATIONS)
+        if "thank" in prompt.lower():
+            return MOCK_CLOSING_REPLY
+        digest = int(hashlib.sha1(prompt.encode("utf-8")).hexdigest(), 16)
+        return MOCK_REPLIES[digest % len(MOCK_REPLIES)]
+
+    def _chunks(self, op: str, first: float, pieces: List[str], speech: bool) -> Timeline:
+        timeline = []
+        offset = first
+        spoken = 0.0
+        for index, piece in enumerate(pieces):
+            if index:
+                offset += len(piece) * self.latency.per_char(op)
+            if speech:
+                item = self._speech_item(piece, spoken, alignment=op != "elevenlabs.tts.audio")
+                spoken += len(piece) / SPOKEN_CHARS_PER_SECOND
+            else:
+                item = {"text": piece}
+            timeline.append((offset, item))
+        return timeline
+
+    def _speech_item(self, text: str, start: float, alignment: bool = True) -> Dict:
+        seconds = len(text) / SPOKEN_CHARS_PER_SECOND
+        item = {"audio": base64.b64encode(silent_mp3(seconds)).decode("ascii")}
+        if alignment:
+            step = seconds / max(1, len(text))
+            item["alignment"] = {
+                "characters": list(text),
+                "start_times": [start + i * step for i in range(len(text))],
+                "end_times": [start + (i + 1) * step for i in range(len(text))],
+            }
+        return item
+
+
+class ReplaySource:
+    """Timelines served from a recorded cassette"""
+
+    def __init__(self, path: str, speed: float = 1.0):
+        """
+        Load a cassette
+
+        Args:
+            path: Cassette written in record mode
+            speed: Playback speed (2 halves every recorded latency)
+        """
+        self.speed = speed
+        self._recordings: Dict[str, Timeline] = {}
+        self._by_op: Dict[str, List[Timeline]] = {}
+        with open(path, "r", encoding="utf-8") as f:
+            for line in f:
+                if not line.strip():
+                    continue
+                entry = json.loads(line)
+                timeline = [(offset, item) for offset, item in entry["items"]]
+                self._recordings[entry["key"]] = timeline
+                self._by_op.setdefault(entry["op"], []).append(timeline)
+        self._cycles = {op: itertools.cycle(timelines) for op, timelines in self._by_op.items()}
+        self.hits = 0
+        self.misses = 0
+        print(f"📼 Loaded {len(self._recordings)} recorded responses from {path}")
+
+    def timeline(self, op: str, material: str) -> Timeline:
+        """Recording of this request, else the next recording of the same call type"""
+        timeline = self._recordings.get(request_key(op, material))
+        if timeline is not None:
+            self.hits += 1
+        elif op in self._cycles:
+            self.misses += 1
+            timeline = next(self._cycles[op])
+        else:
+            self.misses += 1
+            return [(0.0, {"error": f"No recording of {op} in the cassette"})]
+        return [(offset / self.speed, item) for offset, item in timeline]
+
+    def stats(self) -> Dict[str, any]:
+        return {"recordings": len(self._recordings), "hits": self.hits, "misses": self.misses}
+
+
+async def play(timeline: Timeline) -> AsyncIterator[Dict]:
+    """Yield a timeline's items at their offsets from now"""
+    loop = asyncio.get_running_loop()
+    started = loop.time()
+    for offset, item in timeline:
+        delay = started + offset - loop.time()
+        if delay > 0:
+            await asyncio.sleep(delay)
+        if "error" in item:
+            raise MockUpstreamError(item["error"])
+        yield item
+
+
+async def collect(timeline: Timeline) -> List[Dict]:
+    """All of a timeline's items, once the last has arrived"""
+    return [item async for item in play(timeline)]
+
+
+# ============= Stand-ins (mock and replay) =============
+
+class FakeStream:
+    """Streamed Gemini response"""
+
+    def __init__(self, timeline: Timeline):
+        self.timeline = timeline
+        self.on_complete = None  # Called with the full text (chat history)
+
+    def __aiter__(self):
+        return self._chunks()
+
+    async def _chunks(self):
+        parts = []
+        async for item in play(self.timeline):
+            parts.append(item["text"])
+            yield SimpleNamespace(text=item["text"], candidates=[])
+        if self.on_complete is not None:
+            self.on_complete("".join(parts))
+
+
+class FakeGenerativeModel:
+    """Stands in for a google.generativeai GenerativeModel"""
+
+    def __init__(self, op: str, source):
+        """
+        Args:
+            op: Call type the model's requests are, e.g. "gemini.chat"
+            source: MockSource or ReplaySource
+        """
+        self.op = op
+        self.source = source
+
+    async def generate_content_async(self, contents, stream: bool = False, **kwargs):
+        timeline = self.source.timeline(self.op, prompt_text(contents))
+        if stream:
+            return FakeStream(timeline)
+        items = await collect(timeline)
+        return SimpleNamespace(text="".join(item["text"] for item in items), candidates=[])
+
+    def start_chat(self, history: Optional[List] = None):
+        return FakeChatSession(self, history)
+
+
+class FakeChatSession:
+    """Stands in for a ChatSession (history is plain role/parts dicts)"""
+
+    def __init__(self, model: FakeGenerativeModel, history: Optional[List] = None):
+        self.model = model
+        self.history = list(history or [])
+
+    async def send_message_async(self, content, stream: bool = False, **kwargs):
+        request = [*self.history, {"role": "user", "parts": [content]}]
+        response = await self.model.generate_content_async(request, stream=stream)
+        if not stream:
+            self._append(request, response.text)
+            return response
+        response.on_complete = lambda text: self._append(request, text)
+        return response
+
+    def _append(self, request: List, text: str):
+        self.history = [*request, {"role": "model", "parts": [text]}]
+
+
+def speech_response(item: Dict) -> SimpleNamespace:
+    """ElevenLabs timestamped response (or stream chunk) from a timeline item"""
+    alignment = item.get("alignment")
+    return SimpleNamespace(
+        audio_base_64=item.get("audio"),
+        alignment=SimpleNamespace(
+            characters=alignment["characters"],
+            character_start_times_seconds=alignment["start_times"],
+            character_end_times_seconds=alignment["end_times"],
+        ) if alignment else None,
+        normalized_alignment=None,
+    )
+
+
+class FakeTextToSpeech:
+    def __init__(self, source):
+        self.source = source
+
+    async def convert_with_timestamps(self, voice_id: str, text: str, **kwargs):
+        items = await collect(self.source.timeline("elevenlabs.tts", text))
+        return speech_response(items[-1])
+
+    async def stream_with_timestamps(self, voice_id: str, text: str, **kwargs):
+        async for item in play(self.source.timeline("elevenlabs.tts.stream", text)):
+            yield speech_response(item)
+
+    async def convert(self, voice_id: str, text: str, **kwargs):
+        async for item in play(self.source.timeline("elevenlabs.tts.audio", text)):
+            yield base64.b64decode(item["audio"])
+
+
+class FakeSpeechToText:
+    def __init__(self, source):
+        self.source = source
+
+    async def convert(self, file, model_id: str = None, **kwargs):
+        items = await collect(self.source.timeline("elevenlabs.stt", audio_digest(file.getvalue())))
+        return SimpleNamespace(text=items[-1]["text"])
+
+
+class FakeVoices:
+    def __init__(self, source):
+        self.source = source
+
+    async def get_all(self, **kwargs):
+        items = await collect(self.source.timeline("elevenlabs.voices", ""))
+        return SimpleNamespace(voices=[SimpleNamespace(**voice) for voice in items[-1]["voices"]])
+
+
+class FakeElevenLabs:
+    """Stands in for the AsyncElevenLabs client"""
+
+    def __init__(self, source):
+        self.text_to_speech = FakeTextToSpeech(source)
+        self.speech_to_text = FakeSpeechToText(source)
+        self.voices = FakeVoices(source)
+
+
+# ============= Recorders =============
+
+class Cassette:
+    """Recorded responses, appended as JSON lines"""
+
+    def __init__(self, path: str):
+        directory = os.path.dirname(os.path.abspath(path))
+        os.makedirs(directory, exist_ok=True)
+        self.path = path
+        self._file = open(path, "a", encoding="utf-8")
+        self.recorded = 0
+
+    def write(self, op: str, material: str, items: Timeline):
+        """Append one response"""
+        self._file.write(json.dumps({
+            "op": op,
+            "key": request_key(op, material),
+            "items": [[round(offset, 4), item] for offset, item in items],
+        }) + "\n")
+        self._file.flush()
+        self.recorded += 1
+
+    def stats(self) -> Dict[str, any]:
+        return {"cassette": self.path, "recorded": self.recorded}
+
+
+def _gemini_text(chunk) -> str:
+    try:
+        return chunk.text
+    except (IndexError, AttributeError, ValueError):
+        return ""
+
+
+class RecordingStream:
+    """Relays a streamed response, recording when each chunk arrived"""
+
+    def __init__(self, response, started: float, record):
+        self.response = response
+        self.started = started
+        self.record = record
+
+    def __getattr__(self, name):
+        return getattr(self.response, name)
+
+    def __aiter__(self):
+        return self._chunks()
+
+    async def _chunks(self):
+        items = []
+        async for chunk in self.response:
+            items.append((time.monotonic() - self.started, {"text": _gemini_text(chunk)}))
+            yield chunk
+        self.record(items)
+
+
+class RecordingModel:
+    """Wraps a real GenerativeModel, recording its responses"""
+
+    def __init__(self, model, op: str, cassette: Cassette):
+        self.model = model
+        self.op = op
+        self.cassette = cassette
+
+    def __getattr__(self, name):
+        return getattr(self.model, name)
+
+    async def generate_content_async(self, contents, stream: bool = False, **kwargs):
+        return await self._record(
+            prompt_text(contents),
+            lambda: self.model.generate_content_async(contents, stream=stream, **kwargs),
+            stream
+        )
+
+    def start_chat(self, history: Optional[List] = None):
+        return RecordingChatSession(self.model.start_chat(history=history or []), self)
+
+    async def _record(self, prompt: str, send, stream: bool):
+        started = time.monotonic()
+        response = await send()
+        record = lambda items: self.cassette.write(self.op, prompt, items)
+        if stream:
+            return RecordingStream(response, started, record)
+        record([(time.monotonic() - started, {"text": _gemini_text(response)})])
+        return response
+
+
+class RecordingChatSession:
+    """Wraps a real ChatSession, recording its responses"""
+
+    def __init__(self, chat_session, model: RecordingModel):
+        self.chat_session = chat_session
+        self.model = model
+
+    @property
+    def history(self):
+        return self.chat_session.history
+
+    @history.setter
+    def history(self, history):
+        self.chat_session.history = history
+
+    async def send_message_async(self, content, stream: bool = False, **kwargs):
+        return await self.model._record(
+            prompt_text(content),
+            lambda: self.chat_session.send_message_async(content, stream=stream, **kwargs),
+            stream
+        )
+
+
+class RecordingTextToSpeech:
+    def __init__(self, text_to_speech, cassette: Cassette):
+        self.text_to_speech = text_to_speech
+        self.cassette = cassette
+
+    async def convert_with_timestamps(self, text: str, **kwargs):
+        started = time.monotonic()
+        response = await self.text_to_speech.convert_with_timestamps(text=text, **kwargs)
+        self.cassette.write("elevenlabs.tts", text, [(time.monotonic() - started, {
+            "audio": response.audio_base_64,
+            "alignment": alignment_item(response),
+        })])
+        return response
+
+    async def stream_with_timestamps(self, text: str, **kwargs):
+        started = time.monotonic()
+        items = []
+        async for response in self.text_to_speech.stream_with_timestamps(text=text, **kwargs):
+            items.append((time.monotonic() - started, {
+                "audio": response.audio_base_64,
+                "alignment": alignment_item(response),
+            }))
+            yield response
+        self.cassette.write("elevenlabs.tts.stream", text, items)
+
+    async def convert(self, text: str, **kwargs):
+        started = time.monotonic()
+        items = []
+        async for chunk in self.text_to_speech.convert(text=text, **kwargs):
+            items.append((time.monotonic() - started, {"audio": base64.b64encode(chunk).decode("ascii")}))
+            yield chunk
+        self.cassette.write("elevenlabs.tts.audio", text, items)
+
+
+class RecordingSpeechToText:
+    def __init__(self, speech_to_text, cassette: Cassette):
+        self.speech_to_text = speech_to_text
+        self.cassette = cassette
+
+    async def convert(self, file, **kwargs):
+        digest = audio_digest(file.getvalue())
+        started = time.monotonic()
+        transcription = await self.speech_to_text.convert(file=file, **kwargs)
+        self.cassette.write("elevenlabs.stt", digest, [(time.monotonic() - started, {
+            "text": getattr(transcription, "text", str(transcription)),
+        })])
+        return transcription
+
+
+class RecordingElevenLabs:
+    """Wraps the real AsyncElevenLabs client, recording its responses"""
+
+    def __init__(self, client, cassette: Cassette):
+        self.text_to_speech = RecordingTextToSpeech(client.text_to_speech, cassette)
+        self.speech_to_text = RecordingSpeechToText(client.speech_to_text, cassette)
+        self.voices = client.voices
+
+
+def install(
+    container,
+    mode: str,
+    profile: str = "default",
+    cassette: Optional[str] = None,
+    seed: Optional[int] = None,
+    replay_speed: float = 1.0
+):
+    """
+    Swap the container's upstream SDK objects for benchmark stand-ins
+
+    Call before the server takes requests (it builds the Gemini and
+    ElevenLabs services).
+
+    Args:
+        container: services.container.container
+        mode: One of MODES
+        profile: Latency profile name or path (mock)
+        cassette: Cassette path (record, replay)
+        seed: Random seed for mock latencies and failures
+        replay_speed: Playback speed for replay
+
+    Returns:
+        The source or cassette in use (its stats() describes the run), or
+        None for live
+    """
+    if mode not in MODES:
+        raise ValueError(f"Unknown upstream mode {mode} (expected one of {', '.join(MODES)})")
+    if mode == "live":
+        return None
+    if mode in ("record", "replay") and not cassette:
+        raise ValueError(f"--cassette is required for {mode}")
+
+    if mode == "record":
+        recorder = Cassette(cassette)
+        wrap = lambda model, op: RecordingModel(model, op, recorder)
+        client = RecordingElevenLabs(container.tts.client, recorder)
+        used = recorder
+    else:
+        # The services refuse to start without keys, though none are used
+        os.environ.setdefault("GEMINI_API_KEY", "benchmark")
+        os.environ.setdefault("ELEVENLABS_API_KEY", "benchmark")
+        if mode == "mock":
+            used = MockSource(LatencyModel(load_profile(profile), seed))
+        else:
+            used = ReplaySource(cassette, replay_speed)
+        wrap = lambda model, op: FakeGenerativeModel(op, used)
+        client = FakeElevenLabs(used)
+
+    gemini = container.gemini
+    gemini.model = wrap(gemini.model, "gemini.chat")
+    if gemini.hedge_model is not None:
+        gemini.hedge_model = wrap(gemini.hedge_model, "gemini.hedge")
+    gemini.structured_summary_model = wrap(gemini.structured_summary_model, "gemini.summary")
+    gemini.overview_model = wrap(gemini.overview_model, "gemini.overview")
+    gemini.recommendations_model = wrap(gemini.recommendations_model, "gemini.recommendations")
+    container.tts._client = client
+
+    print(f"🧪 Benchmark upstreams: {mode}")
+    return used
@@ -1,6 +1,8 @@
 """
 FastAPI main application entry point
 """
+import os
+from contextlib import asynccontextmanager
 from dotenv import load_dotenv
 
 # Load environment variables from .env file BEFORE importing routers
@@ -8,12 +10,66 @@ load_dotenv()
 
 from fastapi import FastAPI
 from fastapi.middleware.cors import CORSMiddleware
-from routers import conversation, tts, insights
+from fastapi.responses import JSONResponse, Response
+from routers import conversation, tts, insights, call, metrics
+from services.container import container
+from services.metrics import render_metrics
+from services.resilience import upstream_stats
+from services.gemini_service import (
+    FALLBACK_RESPONSES,
+    ERROR_FALLBACK_RESPONSE,
+    GREETING_FALLBACK_RESPONSE,
+)
+
+# Phrases spoken word for word; prewarmed in the TTS cache for every voice.
+# The greeting and preview lines must match CallInterface.tsx and SetupPage.tsx.
+PREWARM_PHRASES = [
+    "Hello! I'm your AI Doctor. How are you feeling today?",
+    "Hey! I am your personalized AI Doctor",
+    "You're welcome! Anything else I can help with today?",
+    ERROR_FALLBACK_RESPONSE,
+    GREETING_FALLBACK_RESPONSE,
+    *FALLBACK_RESPONSES,
+]
+
+# Voices offered in SetupPage.tsx
+DEFAULT_PREWARM_VOICES = (
+    "Sq93GQT4X1lKDXsQcixO,IKne3meq5aSn9XLyUdCD,TX3LPaxmHKxFdv7VOQHJ,"
+    "XrExE9yKIg1WjnnlVkGX,pFZP5JQG7iQjIQuC4Bku,cgSgspJ2msm6clMCkdW9,"
+    "29vD33N1CtxCmqQRPOHJ,2EiwWnXFnvU5JabPnv8n"
+)
+
+
+def prewarm_tts_cache():
+    """Synthesize fixed phrases in the background so they play from the cache"""
+    if os.getenv("TTS_PREWARM", "true").lower() in ("0", "false", "no"):
+        return
+    voice_ids = [v.strip() for v in os.getenv("TTS_PREWARM_VOICES", DEFAULT_PREWARM_VOICES).split(",") if v.strip()]
+    phrases = list(dict.fromkeys(PREWARM_PHRASES))  # De-duplicate, keep order
+    # Don't hold up startup - the server accepts traffic while this runs
+    container.run_in_background("tts_prewarm", container.tts.prewarm(phrases, voice_ids))
+
+
+@asynccontextmanager
+async def lifespan(app: FastAPI):
+    """Services are created on first use; shut them down with the worker"""
+    app.state.services = container
+    if int(os.getenv("WEB_CONCURRENCY", "1")) > 1 and os.getenv("SESSION_STORE", "memory") == "memory":
+        print("⚠️ Several workers with SESSION_STORE=memory - consultations break when requests switch workers")
+    try:
+        prewarm_tts_cache()
+    except ValueError as e:
+        # Missing API key - /health reports it
+        print(f"⚠️ Skipping TTS prewarm: {e}")
+    yield
+    await container.shutdown()
+
 
 app = FastAPI(
     title="AI Doctor API",
     description="Backend API for AI Doctor video consultation app",
-    version="1.0.0"
+    version="1.0.0",
+    lifespan=lifespan
 )
 
 # CORS configuration for Next.js frontend
@@ -34,6 +90,8 @@ app.add_middleware(
 app.include_router(conversation.router, prefix="/api", tags=["conversation"])
 app.include_router(tts.router, prefix="/api", tags=["tts"])
 app.include_router(insights.router, prefix="/api", tags=["insights"])
+app.include_router(call.router, prefix="/api", tags=["call"])
+app.include_router(metrics.router, prefix="/api", tags=["metrics"])
 
 
 @app.get("/")
@@ -44,12 +102,32 @@ async def root():
 
 @app.get("/health")
 async def health_check():
-    """Detailed health check"""
-    return {
-        "status": "healthy",
-        "services": {
-            "gemini": "configured",
-            "elevenlabs": "configured"
+    """
+    Detailed health check (readiness)
+    
+    Returns 503 while a service can't serve requests, e.g. a missing API key.
+    Services not used yet are reported as "idle" - they are built on demand.
+    "upstreams" has call counters, latency percentiles and circuit state per
+    Gemini/ElevenLabs call type.
+    """
+    readiness = container.readiness()
+    return JSONResponse(
+        status_code=200 if readiness["ready"] else 503,
+        content={
+            "status": "healthy" if readiness["ready"] else "unavailable",
+            "services": readiness["services"],
+            "upstreams": upstream_stats()
         }
-    }
+    )
+
 
+@app.get("/metrics")
+async def prometheus_metrics():
+    """
+    Prometheus metrics
+    
+    Per-stage turn latency histograms (auralis_turn_stage_seconds) and the
+    client beacon's milestones and frame times.
+    """
+    body, content_type = render_metrics()
+    return Response(content=body, media_type=content_type)
@@ -14,6 +14,12 @@ class ChatRequest(BaseModel):
     emotion: str = Field(..., description="Detected emotion from face-api.js")
     age: Optional[int] = Field(None, description="Detected age from face-api.js")
     age_category: Optional[str] = Field(None, description="Age category (e.g., 'Young Adult', 'Senior')")
+    session_id: Optional[str] = Field(
+        None,
+        max_length=128,
+        description="Consultation session ID (keeps each patient's conversation separate; "
+                    "a new one is started and returned when missing)"
+    )
     
     class Config:
         json_schema_extra = {
@@ -21,7 +27,8 @@ class ChatRequest(BaseModel):
                 "message": "I've been feeling tired lately",
                 "emotion": "sad",
                 "age": 32,
-                "age_category": "Young Adult"
+                "age_category": "Young Adult",
+                "session_id": "3f6c1a9e-5b7d-4c2e-9a54-2f1e8d7b6c01"
             }
         }
 
@@ -37,17 +44,30 @@ class ChatResponse(BaseModel):
         default=False,
         description="Whether AI suggests ending the consultation"
     )
+    session_id: Optional[str] = Field(
+        None,
+        description="Session the turn was added to (send it with the next message)"
+    )
     
     class Config:
         json_schema_extra = {
             "example": {
                 "response": "I understand. How long have you been experiencing this fatigue?",
                 "followup_needed": True,
-                "should_end_consultation": False
+                "should_end_consultation": False,
+                "session_id": "3f6c1a9e-5b7d-4c2e-9a54-2f1e8d7b6c01"
             }
         }
 
 
+class SpeechChatRequest(ChatRequest):
+    """Request model for spoken chat endpoint (reply text and audio streamed together)"""
+    voice_id: Optional[str] = Field(
+        None,
+        description="ElevenLabs voice ID (uses default if not provided)"
+    )
+
+
 # ============= TTS Schemas =============
 
 class TTSRequest(BaseModel):
@@ -97,24 +117,49 @@ class ConversationMessage(BaseModel):
     emotion: Optional[str] = Field(None, description="Detected emotion")
 
 
+class EmotionBucket(BaseModel):
+    """Time bucket of webcam emotion samples"""
+    t: float = Field(..., description="Bucket start (epoch ms)")
+    n: int = Field(..., ge=1, description="Samples in the bucket")
+    p: List[int] = Field(..., description="Mean probability per label, quantized to 0-255")
+
+
+class EmotionTelemetrySnapshot(BaseModel):
+    """Pre-aggregated emotion telemetry (deltas in a batch, the whole call in an insights request)"""
+    labels: List[str] = Field(..., description="Label order of counts, transitions and probabilities")
+    buckets: List[EmotionBucket] = Field(default_factory=list, max_length=240, description="Closed buckets, in time order")
+    counts: List[int] = Field(..., description="Samples per label")
+    transitions: List[List[int]] = Field(..., description="[from][to] transition counts")
+
+
 class InsightsRequest(BaseModel):
     """Request model for insights endpoint"""
+    session_id: Optional[str] = Field(
+        None,
+        max_length=128,
+        description="Consultation session ID (uses the summary and emotion stats kept during the call)"
+    )
     conversation: List[ConversationMessage] = Field(
-        ...,
-        description="Full conversation history"
+        default_factory=list,
+        description="Full conversation history (only needed without a live session)"
     )
     emotions: List[str] = Field(
-        ...,
+        default_factory=list,
         description="List of detected emotions throughout conversation"
     )
     timestamps: List[str] = Field(
-        ...,
+        default_factory=list,
         description="Timestamps for emotion detections"
     )
+    emotion_telemetry: Optional[EmotionTelemetrySnapshot] = Field(
+        None,
+        description="Whole-call webcam telemetry (used instead of emotions without a live session)"
+    )
     
     class Config:
         json_schema_extra = {
             "example": {
+                "session_id": "3f6c1a9e-5b7d-4c2e-9a54-2f1e8d7b6c01",
                 "conversation": [
                     {
                         "role": "user",
@@ -133,6 +178,10 @@ class EmotionChartData(BaseModel):
     """Emotion data point for charting"""
     timestamp: str = Field(..., description="ISO format timestamp")
     emotion: str = Field(..., description="Detected emotion")
+    probabilities: Optional[Dict[str, float]] = Field(
+        None,
+        description="Mean probability per emotion over the time bucket (telemetry only)"
+    )
 
 
 class EmotionStats(BaseModel):
@@ -141,6 +190,98 @@ class EmotionStats(BaseModel):
     emotion_counts: Dict[str, int] = Field(..., description="Count per emotion")
     emotion_percentages: Dict[str, float] = Field(..., description="Percentage per emotion")
     dominant_emotion: str = Field(..., description="Most frequent emotion")
+    transitions: Optional[Dict[str, Dict[str, int]]] = Field(
+        None,
+        description="Consecutive-sample transition counts as {from: {to: count}}"
+    )
+
+
+class EmotionTelemetryBatch(EmotionTelemetrySnapshot):
+    """Batch of pre-aggregated emotion telemetry sent during a call (deltas since the last batch)"""
+    session_id: str = Field(..., max_length=128, description="Consultation session ID")
+
+
+class ClientMetricsBeacon(BaseModel):
+    """Client-side latency of one turn, plus frame-time samples since the last beacon"""
+    turn_id: Optional[str] = Field(None, max_length=64, description="Turn id also sent to the backend as X-Turn-Id")
+    transport: str = Field("rest", description="\"rest\" or \"call\"")
+    stages: Dict[str, float] = Field(
+        default_factory=dict,
+        description="Milliseconds from end of speech to each milestone (recording_end, transcript, first_text, first_audio, playback_start) and first-chunk decode time (decode)"
+    )
+    samples: Dict[str, List[float]] = Field(
+        default_factory=dict,
+        description="Frame times in milliseconds by kind (face_detection, avatar_frame)"
+    )
+
+
+class SessionEmotionInput(BaseModel):
+    """One session for batch emotion analytics"""
+    session_id: Optional[str] = Field(
+        None,
+        max_length=128,
+        description="Session ID; a live session's telemetry is used when no emotions are given"
+    )
+    emotions: List[str] = Field(default_factory=list, description="Detected emotion per sample")
+    timestamps: List[str] = Field(default_factory=list, description="ISO timestamp per sample")
+
+
+class EmotionAnalyticsRequest(BaseModel):
+    """Request model for batch emotion analytics"""
+    sessions: List[SessionEmotionInput] = Field(..., min_length=1, max_length=5000)
+    window_seconds: float = Field(60.0, gt=0, description="Width of windowed distributions")
+    shift_threshold: float = Field(
+        0.5,
+        gt=0,
+        le=1,
+        description="Distance between consecutive windows reported as a significant shift"
+    )
+
+
+class EmotionWindow(BaseModel):
+    """Emotion distribution over one time window"""
+    start_seconds: float = Field(..., description="Window start, seconds from the session's first sample")
+    distribution: List[float] = Field(..., description="Share per label")
+
+
+class EmotionShift(BaseModel):
+    """Significant change between consecutive windows"""
+    at_seconds: float = Field(..., description="Start of the window the shift lands in")
+    from_emotion: str = Field(..., alias="from", description="Dominant emotion before")
+    to_emotion: str = Field(..., alias="to", description="Dominant emotion after")
+    distance: float = Field(..., description="Total variation distance between the windows")
+    negative_rise: float = Field(..., description="Change in the share of negative emotions")
+
+    class Config:
+        populate_by_name = True
+
+
+class EmotionAnalytics(BaseModel):
+    """Emotion analytics for one session (label-indexed lists follow the response's labels)"""
+    session_id: str
+    total_samples: int
+    distribution: List[float]
+    transitions: List[List[int]] = Field(..., description="[from][to] counts between consecutive samples")
+    mean_dwell_seconds: List[float] = Field(..., description="Mean time per stretch of each emotion")
+    windows: List[EmotionWindow]
+    shifts: List[EmotionShift]
+
+
+class EmotionAnalyticsOverall(BaseModel):
+    """Emotion analytics across every session in the request"""
+    sessions: int
+    total_samples: int
+    distribution: List[float]
+    transitions: List[List[int]]
+    mean_dwell_seconds: List[float]
+    sessions_with_shifts: int
+
+
+class EmotionAnalyticsResponse(BaseModel):
+    """Response model for batch emotion analytics"""
+    labels: List[str] = Field(..., description="Label order of every per-label list")
+    sessions: List[EmotionAnalytics]
+    overall: EmotionAnalyticsOverall
 
 
 class SummaryData(BaseModel):
@@ -160,6 +301,10 @@ class InsightsResponse(BaseModel):
         ...,
         description="Emotion statistics"
     )
+    message_sentiment: Optional[List[float]] = Field(
+        None,
+        description="VADER compound score (-1 to 1) of each patient message, in order"
+    )
     
     class Config:
         json_schema_extra = {
@@ -0,0 +1,216 @@
+"""
+Call router - one duplex WebSocket per consultation
+
+Replaces the per-turn round trips (STT upload or socket, then chat, then
+TTS) with a single connection: microphone audio goes up, and transcripts,
+reply text, audio, visemes and control events come down as typed binary
+frames (see services/frames.py). The final transcript feeds straight into
+Gemini and the sentence TTS pipeline without going back to the browser.
+"""
+import os
+import json
+import asyncio
+from typing import Dict, Optional
+from fastapi import APIRouter, WebSocket, WebSocketDisconnect
+from models.schemas import ChatResponse
+from services.container import container
+from services.frames import (
+    encode_frame,
+    FRAME_CONTROL,
+    FRAME_DONE,
+    FRAME_ERROR,
+    FRAME_TRANSCRIPT,
+)
+from services.metrics import SPECULATION_OUTCOMES, TurnTrace, traced_events
+from services.session_store import new_session_id
+from services.speculation import PartialSpeculator, SpeculativeReply
+from services.stt_stream import StreamingTranscription
+
+router = APIRouter()
+
+# Start the reply on a stable partial transcript (see services/speculation.py)
+SPECULATIVE_REPLIES = os.getenv("SPECULATIVE_REPLIES", "true").lower() == "true"
+
+
+@router.websocket("/call")
+async def call_channel(websocket: WebSocket):
+    """
+    Run a consultation over one socket
+
+    Client messages:
+        binary - MediaRecorder chunks of the current utterance
+        {"type": "start", "session_id", "voice_id"?, "age"?, "age_category"?}
+            - once after connecting; answered with a "ready" control frame
+            carrying the session ID in use (a new one if none was sent)
+        {"type": "end", "emotion", "age"?, "age_category"?, "turn_id"?} - the
+            patient stopped speaking; the utterance is transcribed and answered
+        {"type": "cancel"} - discard the current utterance
+        {"type": "barge_in"} - stop the reply in progress; always answered
+            with an "interrupted" control frame, after which no frames of
+            that reply follow
+
+    Server frames, per turn: a final FRAME_TRANSCRIPT (partials while the
+    patient speaks), then the same text/audio/viseme/done frames as
+    /api/chat/speech, an "end_consultation" control if the doctor wrapped
+    up, and a "turn_end" control once all audio has been sent.
+
+    With SPECULATIVE_REPLIES, a reply is started on a partial transcript
+    that stopped changing, using the previous turn's emotion; it is used if
+    the final transcript has the same words, so Gemini's first tokens are
+    often ready by the time the patient stops speaking.
+    """
+    await websocket.accept()
+    send_lock = asyncio.Lock()
+
+    async def send(frame_type: int, payload):
+        # Turn and partial-transcript tasks share the socket
+        async with send_lock:
+            await websocket.send_bytes(encode_frame(frame_type, payload))
+
+    call = {"session_id": new_session_id(), "voice_id": None, "age": None, "age_category": None, "emotion": "neutral"}
+
+    def new_utterance():
+        speculator = PartialSpeculator(container.gemini, container.emotion_analyzer)
+
+        async def send_partial(text: str):
+            await send(FRAME_TRANSCRIPT, {"text": text, "final": False})
+            if SPECULATIVE_REPLIES:
+                # In the background - the final transcript waits for this callback
+                speculator.feed(text, call["session_id"], {
+                    "emotion": call["emotion"],
+                    "age": call["age"],
+                    "age_category": call["age_category"]
+                })
+
+        return StreamingTranscription(container.tts, on_partial=send_partial), speculator
+
+    utterance, speculator = new_utterance()
+    turn: Optional[asyncio.Task] = None
+
+    async def stop_turn():
+        nonlocal turn
+        if turn is not None and not turn.done():
+            turn.cancel()
+            await asyncio.gather(turn, return_exceptions=True)
+        turn = None
+
+    try:
+        while True:
+            message = await websocket.receive()
+            if message["type"] == "websocket.disconnect":
+                break
+
+            if message.get("bytes") is not None:
+                utterance.add_chunk(message["bytes"])
+                continue
+
+            try:
+                control = json.loads(message.get("text") or "{}")
+            except ValueError:
+                control = None
+            if not isinstance(control, dict):
+                # A bad frame shouldn't end the consultation
+                await send(FRAME_ERROR, {"detail": "Malformed control message"})
+                continue
+            kind = control.get("type")
+            if kind == "start":
+                call.update({key: control[key] for key in call if key in control})
+                call["session_id"] = call["session_id"] or new_session_id()
+                await send(FRAME_CONTROL, {"type": "ready", "session_id": call["session_id"]})
+            elif kind == "end":
+                await stop_turn()
+                # The next utterance records into a fresh buffer while this one is answered
+                finished, speculation = utterance, speculator.take()
+                utterance, speculator = new_utterance()
+                call["emotion"] = control.get("emotion") or "neutral"
+                call.update({key: control[key] for key in ("age", "age_category") if key in control})
+                trace = TurnTrace(control.get("turn_id"), transport="call")
+                turn = asyncio.create_task(
+                    _run_turn(send, finished, dict(call), call["emotion"], trace, speculation)
+                )
+            elif kind == "cancel":
+                speculator.cancel()
+                utterance.reset()
+            elif kind == "barge_in":
+                await stop_turn()
+                await send(FRAME_CONTROL, {"type": "interrupted"})
+    except WebSocketDisconnect:
+        pass
+    finally:
+        if turn is not None and not turn.done():
+            turn.cancel()
+        speculator.cancel()
+        utterance.reset()
+
+
+async def _run_turn(
+    send,
+    utterance: StreamingTranscription,
+    call: Dict,
+    emotion: str,
+    trace: TurnTrace,
+    speculation: Optional[SpeculativeReply] = None
+):
+    """Transcribe one utterance and stream the doctor's spoken reply"""
+    try:
+        with trace.stage("stt"):
+            text = await utterance.finish()
+    except BaseException as e:
+        if speculation is not None:
+            speculation.cancel()
+        if not isinstance(e, Exception):
+            raise
+        await send(FRAME_ERROR, {"detail": f"Transcription failed: {str(e)}"})
+        await send(FRAME_CONTROL, {"type": "turn_end"})
+        return
+
+    await send(FRAME_TRANSCRIPT, {"text": text, "final": True})
+    if not text.strip():
+        # Nothing to answer - the client goes back to listening
+        if speculation is not None:
+            speculation.cancel()
+        await send(FRAME_CONTROL, {"type": "turn_end"})
+        return
+
+    should_end = False
+    try:
+        with trace.stage("sentiment"):
+            emotion_context = await container.emotion_analyzer.analyze_mismatch_async(
+                message=text,
+                detected_emotion=emotion
+            )
+        events = traced_events(container.gemini.stream_response(
+            message=text,
+            emotion=emotion,
+            age=call.get("age"),
+            age_category=call.get("age_category"),
+            emotion_context=emotion_context,
+            session_id=call.get("session_id"),
+            speculation=speculation
+        ), trace)
+        pipeline = container.speech_pipeline.run(events, voice_id=call.get("voice_id"), trace=trace)
+        async for frame_type, payload in pipeline:
+            if frame_type == FRAME_DONE:
+                should_end = payload.get("should_end_consultation", False)
+                payload = ChatResponse(
+                    response=payload["text"],
+                    followup_needed=payload.get("followup_needed", False),
+                    should_end_consultation=should_end,
+                    session_id=call.get("session_id")
+                ).model_dump()
+            await send(frame_type, payload)
+    except asyncio.CancelledError:
+        raise
+    except Exception as e:
+        print(f"Call turn failed: {str(e)}")
+        await send(FRAME_ERROR, {"detail": str(e)})
+    finally:
+        # No-op once used; stops it if the turn ended before reaching Gemini
+        if speculation is not None:
+            speculation.cancel()
+            SPECULATION_OUTCOMES.labels(outcome="hit" if speculation.committed else "miss").inc()
+
+    trace.finish()
+    if should_end:
+        await send(FRAME_CONTROL, {"type": "end_consultation"})
+    await send(FRAME_CONTROL, {"type": "turn_end"})
@@ -1,50 +1,175 @@
 """
 Conversation router - handles Gemini chat interactions
 """
-from fastapi import APIRouter, HTTPException
-from models.schemas import ChatRequest, ChatResponse
-from services.gemini_service import GeminiService
-from services.emotion_analyzer import EmotionAnalyzer
+import json
+from typing import Optional
+from fastapi import APIRouter, Header, HTTPException, Response
+from fastapi.responses import StreamingResponse
+from models.schemas import ChatRequest, ChatResponse, SpeechChatRequest
+from services.container import container
+from services.frames import encode_frame, FRAME_DONE, FRAME_MEDIA_TYPE
+from services.metrics import TurnTrace, traced_events
+from services.session_store import new_session_id
 
 router = APIRouter()
 
-# Initialize services
-gemini_service = GeminiService()
-emotion_analyzer = EmotionAnalyzer()
-
 
 @router.post("/chat", response_model=ChatResponse)
-async def chat(request: ChatRequest):
+async def chat(request: ChatRequest, response: Response, x_turn_id: Optional[str] = Header(None)):
     """
     Process user message and return AI doctor response
     
     Args:
-        request: ChatRequest containing message, detected emotion, and age
+        request: ChatRequest containing message, detected emotion, age, and session ID
+        response: Outgoing response (carries X-Turn-Id back)
+        x_turn_id: Client turn id for latency tracing
         
     Returns:
         ChatResponse with AI response and follow-up flag
     """
+    trace = TurnTrace(x_turn_id)
+    response.headers["X-Turn-Id"] = trace.turn_id
+    # Never fold an unnamed request into someone else's consultation
+    session_id = request.session_id or new_session_id()
     try:
         # Analyze emotion mismatch if needed
-        emotion_context = emotion_analyzer.analyze_mismatch(
-            message=request.message,
-            detected_emotion=request.emotion
-        )
+        with trace.stage("sentiment"):
+            emotion_context = await container.emotion_analyzer.analyze_mismatch_async(
+                message=request.message,
+                detected_emotion=request.emotion
+            )
         
         # Get response from Gemini with age context
-        response = await gemini_service.get_response(
-            message=request.message,
-            emotion=request.emotion,
-            age=request.age,
-            age_category=request.age_category,
-            emotion_context=emotion_context
-        )
+        with trace.stage("gemini_total"):
+            reply = await container.gemini.get_response(
+                message=request.message,
+                emotion=request.emotion,
+                age=request.age,
+                age_category=request.age_category,
+                emotion_context=emotion_context,
+                session_id=session_id
+            )
+        trace.finish()
         
         return ChatResponse(
-            response=response["text"],
-            followup_needed=response.get("followup_needed", False),
-            should_end_consultation=response.get("should_end_consultation", False)
+            response=reply["text"],
+            followup_needed=reply.get("followup_needed", False),
+            should_end_consultation=reply.get("should_end_consultation", False),
+            session_id=session_id
         )
     except Exception as e:
         raise HTTPException(status_code=500, detail=str(e))
 
+
+
+@router.post("/chat/stream")
+async def chat_stream(request: ChatRequest, x_turn_id: Optional[str] = Header(None)):
+    """
+    Stream AI doctor response as Server-Sent Events
+    
+    Args:
+        request: ChatRequest containing message, detected emotion, age, and session ID
+        x_turn_id: Client turn id for latency tracing
+        
+    Returns:
+        StreamingResponse of "delta" events ({"text": ...}) followed by one
+        "done" event carrying the ChatResponse fields
+    """
+    trace = TurnTrace(x_turn_id)
+    session_id = request.session_id or new_session_id()
+    with trace.stage("sentiment"):
+        emotion_context = await container.emotion_analyzer.analyze_mismatch_async(
+            message=request.message,
+            detected_emotion=request.emotion
+        )
+
+    events = container.gemini.stream_response(
+        message=request.message,
+        emotion=request.emotion,
+        age=request.age,
+        age_category=request.age_category,
+        emotion_context=emotion_context,
+        session_id=session_id
+    )
+
+    async def event_stream():
+        async for event in traced_events(events, trace):
+            if event["type"] == "done":
+                data = ChatResponse(
+                    response=event["text"],
+                    followup_needed=event.get("followup_needed", False),
+                    should_end_consultation=event.get("should_end_consultation", False),
+                    session_id=session_id
+                ).model_dump()
+            else:
+                data = {"text": event["text"]}
+            yield f"event: {event['type']}\ndata: {json.dumps(data)}\n\n"
+        trace.finish()
+
+    return StreamingResponse(
+        event_stream(),
+        media_type="text/event-stream",
+        headers={
+            "Cache-Control": "no-cache",
+            "X-Accel-Buffering": "no",  # Don't let proxies buffer the stream
+            "X-Turn-Id": trace.turn_id
+        }
+    )
+
+
+@router.post("/chat/speech")
+async def chat_speech(request: SpeechChatRequest, x_turn_id: Optional[str] = Header(None)):
+    """
+    Stream AI doctor response text and speech together
+    
+    The reply is spoken sentence by sentence: each sentence goes to TTS as
+    soon as Gemini finishes it, so audio starts before the reply is complete.
+    
+    Args:
+        request: SpeechChatRequest (ChatRequest plus optional voice ID)
+        x_turn_id: Client turn id for latency tracing
+        
+    Returns:
+        StreamingResponse of binary frames (see services/frames.py): text
+        deltas, one done frame with the ChatResponse fields, and the reply
+        audio as an ordered audio/mpeg stream split across audio frames,
+        with viseme frames for lip sync
+    """
+    trace = TurnTrace(x_turn_id)
+    session_id = request.session_id or new_session_id()
+    with trace.stage("sentiment"):
+        emotion_context = await container.emotion_analyzer.analyze_mismatch_async(
+            message=request.message,
+            detected_emotion=request.emotion
+        )
+
+    events = traced_events(container.gemini.stream_response(
+        message=request.message,
+        emotion=request.emotion,
+        age=request.age,
+        age_category=request.age_category,
+        emotion_context=emotion_context,
+        session_id=session_id
+    ), trace)
+
+    async def frame_stream():
+        async for frame_type, payload in container.speech_pipeline.run(events, voice_id=request.voice_id, trace=trace):
+            if frame_type == FRAME_DONE:
+                payload = ChatResponse(
+                    response=payload["text"],
+                    followup_needed=payload.get("followup_needed", False),
+                    should_end_consultation=payload.get("should_end_consultation", False),
+                    session_id=session_id
+                ).model_dump()
+            yield encode_frame(frame_type, payload)
+        trace.finish()
+
+    return StreamingResponse(
+        frame_stream(),
+        media_type=FRAME_MEDIA_TYPE,
+        headers={
+            "Cache-Control": "no-cache",
+            "X-Accel-Buffering": "no",
+            "X-Turn-Id": trace.turn_id
+        }
+    )
@@ -1,51 +1,180 @@
 """
 Insights router - generates conversation summaries and analytics
 """
+import asyncio
 from fastapi import APIRouter, HTTPException
-from models.schemas import InsightsRequest, InsightsResponse
-from services.gemini_service import GeminiService
-from services.emotion_analyzer import EmotionAnalyzer
+from models.schemas import (
+    InsightsRequest,
+    InsightsResponse,
+    EmotionTelemetryBatch,
+    EmotionAnalyticsRequest,
+    EmotionAnalyticsResponse,
+)
+from services.emotion_analytics import EmotionTable
+from services.emotion_telemetry import EmotionAggregate
+from services.container import container
 
 router = APIRouter()
 
-# Initialize services
-gemini_service = GeminiService()
-emotion_analyzer = EmotionAnalyzer()
-
 
 @router.post("/insights", response_model=InsightsResponse)
 async def generate_insights(request: InsightsRequest):
     """
     Generate conversation summary and emotion analytics
     
+    With a session ID the summary and emotion stats kept during the call
+    are returned, so the client doesn't need to upload the transcript.
+    Without one (or if the session has expired) they are computed from the
+    request body.
+    
     Args:
-        request: InsightsRequest containing conversation history and emotions
+        request: InsightsRequest containing a session ID and/or conversation
+            history and emotions
         
     Returns:
         InsightsResponse with summary and emotion chart data
+        
+    Raises:
+        HTTPException 404 if the session is unknown and no conversation was sent
     """
     try:
-        # Generate conversation summary using Gemini
-        summary = await gemini_service.generate_summary(
-            conversation=request.conversation
-        )
-        
-        # Analyze emotion patterns
-        emotion_chart = emotion_analyzer.generate_emotion_chart(
-            emotions=request.emotions,
-            timestamps=request.timestamps
+        session = await container.gemini.sessions.get(request.session_id) if request.session_id else None
+        summary = await container.gemini.get_session_summary(request.session_id) if session else None
+
+        if summary is not None:
+            patient_messages = [m["content"] for m in session.history() if m["role"] == "user"]
+            scores = await container.emotion_analyzer.score_messages_async(patient_messages)
+            # Pre-aggregated during the consultation: webcam telemetry if the
+            # client sent any, else the emotion sent with each chat turn
+            if session.emotion_telemetry.total_samples:
+                emotion_chart = container.emotion_analyzer.chart_from_aggregate(session.emotion_telemetry)
+                emotion_stats = container.emotion_analyzer.statistics_from_aggregate(session.emotion_telemetry)
+            else:
+                emotion_chart = list(session.emotion_timeline)
+                emotion_stats = container.emotion_analyzer.statistics_from_counts(dict(session.emotion_counts))
+            return InsightsResponse(
+                summary=summary,
+                emotion_chart=emotion_chart,
+                emotion_stats=emotion_stats,
+                message_sentiment=[score["compound"] for score in scores]
+            )
+
+        if not request.conversation:
+            raise HTTPException(status_code=404, detail="Session not found - send the conversation")
+
+        # Webcam telemetry the client kept for the call, else the emotion
+        # sent with each patient message
+        telemetry = EmotionAggregate()
+        if request.emotion_telemetry is not None:
+            try:
+                telemetry.merge(
+                    labels=request.emotion_telemetry.labels,
+                    buckets=[bucket.model_dump() for bucket in request.emotion_telemetry.buckets],
+                    counts=request.emotion_telemetry.counts,
+                    transitions=request.emotion_telemetry.transitions
+                )
+            except ValueError as e:
+                raise HTTPException(status_code=422, detail=str(e))
+
+        # Generate conversation summary using Gemini while the patient's
+        # messages are scored (one batch on the sentiment threads)
+        patient_messages = [m.content for m in request.conversation if m.role == "user"]
+        summary, scores = await asyncio.gather(
+            container.gemini.generate_summary(conversation=request.conversation),
+            container.emotion_analyzer.score_messages_async(patient_messages)
         )
         
-        # Calculate emotion statistics
-        emotion_stats = emotion_analyzer.calculate_statistics(
-            emotions=request.emotions
-        )
+        if telemetry.total_samples:
+            emotion_chart = container.emotion_analyzer.chart_from_aggregate(telemetry)
+            emotion_stats = container.emotion_analyzer.statistics_from_aggregate(telemetry)
+        else:
+            # Analyze emotion patterns
+            emotion_chart = container.emotion_analyzer.generate_emotion_chart(
+                emotions=request.emotions,
+                timestamps=request.timestamps
+            )
+
+            # Calculate emotion statistics
+            emotion_stats = container.emotion_analyzer.calculate_statistics(
+                emotions=request.emotions,
+                timestamps=request.timestamps
+            )
         
         return InsightsResponse(
             summary=summary,
             emotion_chart=emotion_chart,
-            emotion_stats=emotion_stats
+            emotion_stats=emotion_stats,
+            message_sentiment=[score["compound"] for score in scores]
         )
+    except HTTPException:
+        raise
     except Exception as e:
         raise HTTPException(status_code=500, detail=str(e))
 
+
+@router.post("/insights/emotions")
+async def record_emotion_telemetry(batch: EmotionTelemetryBatch):
+    """
+    Add a batch of webcam emotion telemetry to a consultation session
+    
+    Args:
+        batch: Buckets closed and count/transition deltas since the client's
+            previous batch
+        
+    Returns:
+        Samples aggregated for the session so far
+        
+    Raises:
+        HTTPException 422 if the batch doesn't match the expected labels or shape
+    """
+    session = await container.gemini.sessions.get_or_create(batch.session_id)
+    try:
+        session.emotion_telemetry.merge(
+            labels=batch.labels,
+            buckets=[bucket.model_dump() for bucket in batch.buckets],
+            counts=batch.counts,
+            transitions=batch.transitions
+        )
+    except ValueError as e:
+        raise HTTPException(status_code=422, detail=str(e))
+    container.gemini.sessions.save(session, "telemetry")
+
+    return {"status": "ok", "total_samples": session.emotion_telemetry.total_samples}
+
+
+@router.post("/insights/batch", response_model=EmotionAnalyticsResponse)
+async def batch_emotion_analytics(request: EmotionAnalyticsRequest):
+    """
+    Emotion analytics for many sessions in one request (clinician dashboards)
+    
+    Each session is given inline as emotions/timestamps, or by the ID of a
+    live session whose webcam telemetry is used.
+    
+    Args:
+        request: Sessions plus window width and shift threshold
+        
+    Returns:
+        EmotionAnalyticsResponse with per-session and overall results
+        
+    Raises:
+        HTTPException 422 for unparseable timestamps
+    """
+    table = EmotionTable()
+    try:
+        for i, item in enumerate(request.sessions):
+            session_id = item.session_id or f"#{i}"
+            session = await container.gemini.sessions.get(item.session_id) if item.session_id and not item.emotions else None
+            if session is not None:
+                table.add_aggregate(session_id, session.emotion_telemetry)
+            else:
+                table.add_labels(session_id, item.emotions, item.timestamps)
+    except ValueError as e:
+        raise HTTPException(status_code=422, detail=f"Invalid timestamp: {str(e)}")
+
+    # Keep the event loop free while numpy works through the batch
+    return await asyncio.to_thread(
+        container.emotion_analyzer.analyze_sessions,
+        table,
+        request.window_seconds,
+        request.shift_threshold
+    )
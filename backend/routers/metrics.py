@@ -0,0 +1,33 @@
+"""
+Metrics router - client latency beacon (the Prometheus exposition is /metrics in main.py)
+"""
+from fastapi import APIRouter
+from models.schemas import ClientMetricsBeacon
+from services.metrics import record_client_beacon
+
+router = APIRouter()
+
+# Frame-time samples accepted per kind in one beacon
+MAX_SAMPLES_PER_KIND = 500
+
+
+@router.post("/metrics/client")
+async def client_metrics(beacon: ClientMetricsBeacon):
+    """
+    Record a turn's client-side milestones and recent frame times
+    
+    Sent by the frontend after each turn when NEXT_PUBLIC_METRICS_BEACON is
+    enabled. Unknown stage names are ignored.
+    
+    Args:
+        beacon: ClientMetricsBeacon for one turn
+        
+    Returns:
+        Number of values recorded
+    """
+    samples = {kind: values[:MAX_SAMPLES_PER_KIND] for kind, values in beacon.samples.items()}
+    recorded = record_client_beacon(beacon.transport, beacon.stages, samples)
+    if beacon.stages:
+        breakdown = ", ".join(f"{stage} {ms:.0f}ms" for stage, ms in beacon.stages.items())
+        print(f"⏱️ Client turn {beacon.turn_id}: {breakdown}")
+    return {"status": "ok", "recorded": recorded}
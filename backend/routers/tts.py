@@ -1,17 +1,20 @@
 """
 Audio router - handles ElevenLabs STT and TTS
 """
-from fastapi import APIRouter, HTTPException, UploadFile, File
+import json
+from typing import AsyncIterator, Optional
+from fastapi import APIRouter, Header, HTTPException, UploadFile, File, Request, WebSocket, WebSocketDisconnect
 from fastapi.responses import StreamingResponse
 from models.schemas import TTSRequest, TTSResponse
-from services.elevenlabs_service import ElevenLabsService
+from services.container import container
+from services.frames import encode_frame, FRAME_MEDIA_TYPE
+from services.metrics import TurnTrace
+from services.resilience import UpstreamUnavailable
+from services.stt_stream import StreamingTranscription
 from pydantic import BaseModel
 
 router = APIRouter()
 
-# Initialize service
-tts_service = ElevenLabsService()
-
 
 class STTResponse(BaseModel):
     """Response model for speech-to-text"""
@@ -19,38 +22,163 @@ class STTResponse(BaseModel):
 
 
 @router.post("/stt", response_model=STTResponse)
-async def speech_to_text(audio: UploadFile = File(...)):
+async def speech_to_text(audio: UploadFile = File(...), x_turn_id: Optional[str] = Header(None)):
     """
     Convert speech to text using ElevenLabs
     
     Args:
         audio: Audio file upload
+        x_turn_id: Client turn id for latency tracing
         
     Returns:
         STTResponse with transcribed text
     """
     try:
         audio_data = await audio.read()
-        text = await tts_service.speech_to_text(audio_data)
+        with TurnTrace(x_turn_id).stage("stt"):
+            text = await container.tts.speech_to_text(audio_data)
         
         return STTResponse(text=text)
+    except UpstreamUnavailable as e:
+        # Timed out or circuit open - tell the client to retry later
+        raise HTTPException(status_code=503, detail=str(e), headers={"Retry-After": "5"})
     except Exception as e:
         raise HTTPException(status_code=500, detail=str(e))
 
 
-@router.post("/tts", response_model=TTSResponse)
-async def text_to_speech(request: TTSRequest):
+@router.websocket("/stt/stream")
+async def speech_to_text_stream(websocket: WebSocket):
+    """
+    Transcribe speech while it is being recorded
+    
+    The client sends MediaRecorder chunks as binary messages and
+    `{"type": "end"}` when the user stops speaking. The server replies with
+    `{"type": "partial", "text": ...}` while audio arrives and
+    `{"type": "final", "text": ...}` after each end. The socket can be
+    reused for further utterances; `{"type": "cancel"}` discards the current one.
+    The end message may carry the client's "turn_id" for latency tracing.
+    """
+    await websocket.accept()
+
+    async def send_partial(text: str):
+        await websocket.send_json({"type": "partial", "text": text})
+
+    transcription = StreamingTranscription(container.tts, on_partial=send_partial)
+
+    try:
+        while True:
+            message = await websocket.receive()
+            if message["type"] == "websocket.disconnect":
+                break
+
+            if message.get("bytes") is not None:
+                transcription.add_chunk(message["bytes"])
+                continue
+
+            try:
+                control = json.loads(message.get("text") or "{}")
+            except ValueError:
+                control = None
+            if not isinstance(control, dict):
+                await websocket.send_json({"type": "error", "detail": "Malformed control message"})
+                continue
+            if control.get("type") == "end":
+                try:
+                    with TurnTrace(control.get("turn_id")).stage("stt"):
+                        text = await transcription.finish()
+                    await websocket.send_json({"type": "final", "text": text})
+                except Exception as e:
+                    await websocket.send_json({"type": "error", "detail": str(e)})
+            elif control.get("type") == "cancel":
+                transcription.reset()
+    except WebSocketDisconnect:
+        pass
+    finally:
+        transcription.reset()
+
+
+async def _audio_response(audio_stream: AsyncIterator[bytes]) -> StreamingResponse:
+    """
+    Wrap a TTS stream in a streaming audio/mpeg response
+    
+    The first chunk is pulled before the response starts so upstream
+    failures still surface as a 500 (503 when ElevenLabs is unavailable)
+    instead of a truncated body.
+    """
+    try:
+        first_chunk = await audio_stream.__anext__()
+    except StopAsyncIteration:
+        first_chunk = b""
+
+    async def body():
+        yield first_chunk
+        async for chunk in audio_stream:
+            yield chunk
+
+    return StreamingResponse(body(), media_type="audio/mpeg")
+
+
+async def _frame_response(items: AsyncIterator) -> StreamingResponse:
+    """
+    Wrap a timestamped TTS stream in a frames response (visemes + audio)
+    
+    Like _audio_response, the first item is pulled up front so upstream
+    failures surface as a 500.
+    """
+    try:
+        first = await items.__anext__()
+    except StopAsyncIteration:
+        first = None
+
+    async def body():
+        if first is not None:
+            yield encode_frame(*first)
+        async for frame_type, payload in items:
+            yield encode_frame(frame_type, payload)
+
+    return StreamingResponse(body(), media_type=FRAME_MEDIA_TYPE)
+
+
+@router.post(
+    "/tts",
+    response_model=TTSResponse,
+    responses={200: {"content": {"audio/mpeg": {}, FRAME_MEDIA_TYPE: {}}}}
+)
+async def text_to_speech(request: TTSRequest, http_request: Request):
     """
     Convert text to speech using ElevenLabs
     
+    Clients that accept the frames media type get viseme and audio frames
+    (see services/frames.py) for lip sync. Clients that send
+    `Accept: audio/mpeg` get the audio streamed as binary. Other clients get
+    the legacy JSON body with base64 encoded audio.
+    
     Args:
         request: TTSRequest containing text to convert
+        http_request: Incoming request (used for Accept negotiation)
         
     Returns:
-        TTSResponse with audio URL or base64 encoded audio
+        Streaming frames or audio/mpeg, or TTSResponse with base64 encoded audio
     """
     try:
-        audio_result = await tts_service.generate_speech(
+        accept = http_request.headers.get("accept", "")
+        if FRAME_MEDIA_TYPE in accept:
+            return await _frame_response(
+                container.tts.stream_speech_with_visemes(
+                    text=request.text,
+                    voice_id=request.voice_id
+                )
+            )
+
+        if "audio/mpeg" in accept:
+            return await _audio_response(
+                container.tts.generate_speech_stream(
+                    text=request.text,
+                    voice_id=request.voice_id
+                )
+            )
+
+        audio_result = await container.tts.generate_speech(
             text=request.text,
             voice_id=request.voice_id
         )
@@ -59,6 +187,8 @@ async def text_to_speech(request: TTSRequest):
             audio_url=audio_result.get("audio_url"),
             audio_base64=audio_result.get("audio_base64")
         )
+    except UpstreamUnavailable as e:
+        raise HTTPException(status_code=503, detail=str(e), headers={"Retry-After": "5"})
     except Exception as e:
         raise HTTPException(status_code=500, detail=str(e))
 
@@ -75,15 +205,13 @@ async def text_to_speech_stream(request: TTSRequest):
         StreamingResponse with audio data
     """
     try:
-        audio_stream = await tts_service.generate_speech_stream(
-            text=request.text,
-            voice_id=request.voice_id
-        )
-        
-        return StreamingResponse(
-            audio_stream,
-            media_type="audio/mpeg"
+        return await _audio_response(
+            container.tts.generate_speech_stream(
+                text=request.text,
+                voice_id=request.voice_id
+            )
         )
+    except UpstreamUnavailable as e:
+        raise HTTPException(status_code=503, detail=str(e), headers={"Retry-After": "5"})
     except Exception as e:
         raise HTTPException(status_code=500, detail=str(e))
-
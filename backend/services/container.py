@@ -0,0 +1,138 @@
+"""
+Service container - one instance of each service per process, created on first use
+
+Importing the app no longer constructs anything: the Gemini models, the
+ElevenLabs client and the VADER lexicon are built the first time a request
+needs them, so a new worker starts accepting traffic straight away. The
+container also owns the keep-alive HTTP pool the upstream clients share;
+main.py's lifespan shuts it down.
+"""
+import os
+import asyncio
+from typing import Callable, Dict, Optional
+
+import httpx
+
+
+class ServiceContainer:
+    """Lazily created, process-wide services"""
+
+    def __init__(self):
+        """Initialize an empty container (nothing is created until first use)"""
+        self._gemini = None
+        self._tts = None
+        self._emotion_analyzer = None
+        self._speech_pipeline = None
+        self._http: Optional[httpx.AsyncClient] = None
+        # Last construction error per service, reported by readiness()
+        self._errors: Dict[str, str] = {}
+        self._background: Dict[str, asyncio.Task] = {}
+
+    @property
+    def http(self) -> httpx.AsyncClient:
+        """Shared keep-alive connection pool for upstream HTTP APIs"""
+        if self._http is None:
+            self._http = httpx.AsyncClient(
+                limits=httpx.Limits(
+                    max_connections=int(os.getenv("HTTP_MAX_CONNECTIONS", "100")),
+                    max_keepalive_connections=int(os.getenv("HTTP_MAX_KEEPALIVE", "20")),
+                    keepalive_expiry=float(os.getenv("HTTP_KEEPALIVE_SECONDS", "30")),
+                ),
+                timeout=httpx.Timeout(float(os.getenv("HTTP_TIMEOUT_SECONDS", "60")), connect=5.0),
+            )
+        return self._http
+
+    @property
+    def gemini(self):
+        """GeminiService (chat sessions, summaries)"""
+        if self._gemini is None:
+            from services.gemini_service import GeminiService
+            self._gemini = self._create("gemini", GeminiService)
+        return self._gemini
+
+    @property
+    def tts(self):
+        """ElevenLabsService (TTS, STT, TTS cache) on the shared HTTP pool"""
+        if self._tts is None:
+            from services.elevenlabs_service import ElevenLabsService
+            self._tts = self._create("elevenlabs", lambda: ElevenLabsService(http_client=self.http))
+        return self._tts
+
+    @property
+    def emotion_analyzer(self):
+        """EmotionAnalyzer (one VADER lexicon and score cache)"""
+        if self._emotion_analyzer is None:
+            from services.emotion_analyzer import get_emotion_analyzer
+            self._emotion_analyzer = self._create("sentiment", get_emotion_analyzer)
+        return self._emotion_analyzer
+
+    @property
+    def speech_pipeline(self):
+        """SpeechPipeline over the shared TTS service (and its cache)"""
+        if self._speech_pipeline is None:
+            from services.speech_pipeline import SpeechPipeline
+            self._speech_pipeline = SpeechPipeline(self.tts)
+        return self._speech_pipeline
+
+    def _create(self, name: str, factory: Callable):
+        """Build a service, remembering why it failed for readiness()"""
+        try:
+            service = factory()
+        except Exception as e:
+            self._errors[name] = str(e)
+            raise
+        self._errors.pop(name, None)
+        return service
+
+    def run_in_background(self, name: str, coroutine):
+        """Start a task owned by the container (cancelled on shutdown)"""
+        self._background[name] = asyncio.create_task(coroutine)
+
+    def readiness(self) -> Dict[str, any]:
+        """
+        Whether each service can serve requests
+
+        Checked without calling upstream APIs: a service is "ready" once
+        built, "idle" if configured but not needed yet, and "unavailable"
+        when its API key is missing or construction failed.
+
+        Returns:
+            {"ready": bool, "services": {name: {"status", "detail"?}}}
+        """
+        services = {
+            "gemini": self._status("gemini", self._gemini, "GEMINI_API_KEY"),
+            "elevenlabs": self._status("elevenlabs", self._tts, "ELEVENLABS_API_KEY"),
+            "sentiment": self._status("sentiment", self._emotion_analyzer, None),
+        }
+        return {
+            "ready": all(service["status"] != "unavailable" for service in services.values()),
+            "services": services,
+        }
+
+    def _status(self, name: str, instance, api_key_env: Optional[str]) -> Dict[str, str]:
+        if name in self._errors:
+            return {"status": "unavailable", "detail": self._errors[name]}
+        if api_key_env and not os.getenv(api_key_env):
+            return {"status": "unavailable", "detail": f"{api_key_env} not set"}
+        return {"status": "ready" if instance is not None else "idle"}
+
+    async def shutdown(self):
+        """Cancel background work and release threads and connections"""
+        for task in self._background.values():
+            task.cancel()
+        await asyncio.gather(*self._background.values(), return_exceptions=True)
+        self._background.clear()
+
+        if self._gemini is not None:
+            # Write-behind session changes still pending
+            await self._gemini.sessions.close()
+        if self._emotion_analyzer is not None:
+            self._emotion_analyzer.close()
+        if self._http is not None:
+            await self._http.aclose()
+            self._http = None
+
+
+# Process-wide container used by the routers
+container = ServiceContainer()
+
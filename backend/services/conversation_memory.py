@@ -0,0 +1,132 @@
+"""
+Conversation memory - keeps each Gemini chat history within a token budget
+"""
+import os
+from typing import List, Optional
+
+
+# Rough token estimate for English prose (no tokenizer round-trip per turn)
+CHARS_PER_TOKEN = 4
+
+# Cap on the digest of compacted turns (extractive fallback)
+DIGEST_MAX_CHARS = 1200
+
+# Compact down to this share of the budget, so it doesn't happen on every turn
+COMPACT_TARGET = 0.75
+
+DIGEST_ACKNOWLEDGEMENT = "Understood, I'll keep that in mind."
+
+
+def estimate_tokens(text: str) -> int:
+    """Approximate token count of a piece of text"""
+    return len(text) // CHARS_PER_TOKEN + 1
+
+
+def content_text(content) -> str:
+    """Text of a chat history entry (proto Content or dict)"""
+    parts = content.get("parts", []) if isinstance(content, dict) else content.parts
+    return " ".join(part if isinstance(part, str) else getattr(part, "text", "") for part in parts)
+
+
+def content_role(content) -> str:
+    """Role of a chat history entry (proto Content or dict)"""
+    return content.get("role", "") if isinstance(content, dict) else content.role
+
+
+class ConversationMemory:
+    """
+    Memory policy for consultation chats
+
+    The chat history sent with each turn is held to a token budget. When it
+    grows past the budget the oldest exchanges are folded into a short
+    clinical digest, which stays at the front of the history as a single
+    exchange. The cost of a turn therefore stays flat however long the
+    consultation runs.
+    """
+
+    def __init__(
+        self,
+        token_budget: Optional[int] = None,
+        min_recent_exchanges: Optional[int] = None
+    ):
+        """
+        Initialize memory policy
+
+        Args:
+            token_budget: History tokens sent per turn (GEMINI_HISTORY_TOKEN_BUDGET)
+            min_recent_exchanges: Exchanges always kept verbatim (GEMINI_HISTORY_MIN_EXCHANGES)
+        """
+        self.token_budget = token_budget if token_budget is not None else int(os.getenv("GEMINI_HISTORY_TOKEN_BUDGET", "2000"))
+        self.min_recent_exchanges = min_recent_exchanges if min_recent_exchanges is not None else int(os.getenv("GEMINI_HISTORY_MIN_EXCHANGES", "2"))
+
+    def compact(self, session):
+        """
+        Fold the oldest exchanges into the session's digest if the chat
+        history is over budget
+
+        Args:
+            session: ConversationSession whose chat_session was just updated
+        """
+        chat = session.chat_session
+        if chat is None:
+            return
+
+        history = list(chat.history)
+        prefix = 2 if session.history_digest else 0  # Digest exchange
+        recent = history[prefix:]
+
+        costs = [estimate_tokens(content_text(content)) for content in recent]
+        total = sum(costs) + (estimate_tokens(session.history_digest) if session.history_digest else 0)
+        if total <= self.token_budget:
+            return
+
+        # Drop whole exchanges (user + model) from the front
+        target = int(self.token_budget * COMPACT_TARGET)
+        keep_from = 0
+        min_kept = 2 * self.min_recent_exchanges
+        while total > target and len(recent) - keep_from > min_kept:
+            if content_role(recent[keep_from]) != "user" or keep_from + 1 >= len(recent):
+                break
+            total -= costs[keep_from] + costs[keep_from + 1]
+            keep_from += 2
+
+        if keep_from == 0:
+            return
+
+        dropped = recent[:keep_from]
+        kept = recent[keep_from:]
+        session.history_digest = self._digest(session, dropped, len(kept))
+        chat.history = [
+            {"role": "user", "parts": [f"[Earlier in this consultation: {session.history_digest}]"]},
+            {"role": "model", "parts": [DIGEST_ACKNOWLEDGEMENT]},
+            *kept
+        ]
+        print(f"🗜️ Compacted {keep_from // 2} exchanges for {session.session_id}")
+
+    def _digest(self, session, dropped: List, kept_messages: int) -> str:
+        """
+        Clinical digest covering everything before the kept turns
+
+        Uses the rolling insights summary when it already covers the dropped
+        turns (everything not yet summarized is still in the kept window);
+        otherwise extends the previous digest with what the patient said.
+        """
+        summary = session.summary
+        refreshing = session.summary_task is not None and not session.summary_task.done()
+        if summary and not refreshing and len(session.unsummarized) <= kept_messages:
+            return summary["overview"]
+
+        notes = [session.history_digest] if session.history_digest else []
+        for content in dropped:
+            if content_role(content) != "user":
+                continue
+            # First line of a contextual message is 'Patient says: "..."'
+            line = content_text(content).strip().split("\n", 1)[0]
+            if line:
+                notes.append(line)
+
+        digest = " ".join(notes)
+        if len(digest) > DIGEST_MAX_CHARS:
+            # Keep the most recent part
+            digest = "..." + digest[-DIGEST_MAX_CHARS:]
+        return digest
@@ -2,34 +2,112 @@
 ElevenLabs service - handles speech-to-text and text-to-speech conversion
 """
 import os
+import json
+import asyncio
 import base64
-from typing import Dict, Optional, AsyncIterator, List
+from typing import Dict, Optional, AsyncIterator, List, Tuple, Union
 from io import BytesIO
-from elevenlabs import ElevenLabs
+from services.tts_cache import TTSCache
+from services.resilience import CircuitBreaker, Upstream, UpstreamUnavailable
+from services.frames import FRAME_AUDIO, FRAME_VISEMES
+from services.viseme import (
+    alignment_to_visemes,
+    extract_alignment,
+    merge_timelines,
+    mp3_duration_ms,
+)
+
+
+# Chunk size used when replaying cached audio as a stream
+CACHED_CHUNK_SIZE = 16 * 1024
 
 
 class ElevenLabsService:
     """Service for ElevenLabs speech-to-text and text-to-speech API"""
     
-    def __init__(self):
-        """Initialize ElevenLabs service with API key"""
+    def __init__(self, http_client=None):
+        """
+        Initialize ElevenLabs service with API key
+        
+        Args:
+            http_client: Shared httpx.AsyncClient (keep-alive pool) for API calls
+        """
         self.api_key = os.getenv("ELEVENLABS_API_KEY")
         if not self.api_key:
             raise ValueError("ELEVENLABS_API_KEY not found in environment variables")
         
-        # Initialize ElevenLabs client
-        self.client = ElevenLabs(api_key=self.api_key)
+        # Async ElevenLabs client, created on first API call (see client)
+        self.http_client = http_client
+        self._client = None
+
+        # Cap on in-flight ElevenLabs requests per worker; transcriptions have
+        # their own slots so partial transcripts never wait ahead of speech
+        self.max_concurrency = int(os.getenv("ELEVENLABS_MAX_CONCURRENCY", "32"))
+        self._limiter = asyncio.Semaphore(self.max_concurrency)
+        self.stt_max_concurrency = int(os.getenv("ELEVENLABS_STT_MAX_CONCURRENCY", "16"))
+        self._stt_limiter = asyncio.Semaphore(self.stt_max_concurrency)
+        # Streamed TTS responses read ahead of the consumer while holding a slot
+        self.stream_buffer = int(os.getenv("ELEVENLABS_STREAM_BUFFER", "64"))
+
+        # Deadlines and breakers for ElevenLabs calls (see resilience.py); while
+        # the TTS circuit is open only cached audio is served. STT and prewarm
+        # have their own breakers so their failures can't cut off speech.
+        self.breaker = CircuitBreaker("elevenlabs")
+        self.tts_upstream = Upstream(
+            "elevenlabs.tts",
+            self.breaker,
+            timeout_seconds=float(os.getenv("ELEVENLABS_TIMEOUT_SECONDS", "15"))
+        )
+        self.stt_breaker = CircuitBreaker("elevenlabs.stt")
+        self.stt_upstream = Upstream(
+            "elevenlabs.stt",
+            self.stt_breaker,
+            timeout_seconds=float(os.getenv("ELEVENLABS_STT_TIMEOUT_SECONDS", "30"))
+        )
+        self.prewarm_upstream = Upstream(
+            "elevenlabs.prewarm",
+            CircuitBreaker("elevenlabs.prewarm"),
+            timeout_seconds=float(os.getenv("ELEVENLABS_TIMEOUT_SECONDS", "15"))
+        )
         
         # Default voice ID (Rachel - natural, warm voice)
         self.default_voice_id = os.getenv("ELEVENLABS_VOICE_ID", "21m00Tcm4TlvDq8ikWAM")
         
-        # Voice settings for natural doctor voice
+        # TTS model used for all synthesis
+        self.model_id = "eleven_monolingual_v1"
+
+        # Constant-bitrate MP3 so viseme offsets can be derived from byte counts
+        self.output_format = "mp3_44100_128"
+        
+        # Voice settings for natural doctor voice (sent with every synthesis
+        # request and part of the cache key)
         self.voice_settings = {
             "stability": 0.5,
             "similarity_boost": 0.75,
             "style": 0.0,
             "use_speaker_boost": True
         }
+        self._sdk_voice_settings = None
+
+        # Cache for repeated phrases (greetings, fallbacks, closings)
+        self.cache = TTSCache()
+
+    @property
+    def client(self):
+        """Async ElevenLabs client so requests don't block the event loop"""
+        if self._client is None:
+            # Imported here: the SDK is slow to load and cached audio never needs it
+            from elevenlabs import AsyncElevenLabs
+            self._client = AsyncElevenLabs(api_key=self.api_key, httpx_client=self.http_client)
+        return self._client
+
+    @property
+    def sdk_voice_settings(self):
+        """voice_settings as the SDK's VoiceSettings model"""
+        if self._sdk_voice_settings is None:
+            from elevenlabs import VoiceSettings
+            self._sdk_voice_settings = VoiceSettings(**self.voice_settings)
+        return self._sdk_voice_settings
     
     async def generate_speech(
         self,
@@ -47,17 +125,7 @@ class ElevenLabsService:
             Dict containing audio_base64 encoded audio data
         """
         try:
-            voice = self._get_voice_id(voice_id)
-            
-            # Generate audio using ElevenLabs text_to_speech
-            audio_generator = self.client.text_to_speech.convert(
-                voice_id=voice,
-                text=text,
-                model_id="eleven_monolingual_v1"
-            )
-            
-            # Convert generator to bytes
-            audio_bytes = b"".join(audio_generator)
+            audio_bytes = await self.synthesize(text, voice_id)
             
             # Encode to base64 for easy transport
             audio_base64 = base64.b64encode(audio_bytes).decode('utf-8')
@@ -66,9 +134,76 @@ class ElevenLabsService:
                 "audio_url": None,
                 "audio_base64": audio_base64
             }
+        except UpstreamUnavailable:
+            raise
         except Exception as e:
             raise Exception(f"TTS generation failed: {str(e)}")
-    
+
+    async def synthesize(
+        self,
+        text: str,
+        voice_id: Optional[str] = None
+    ) -> bytes:
+        """
+        Get the full audio for text, from the cache when possible
+        
+        Args:
+            text: Text to convert to speech
+            voice_id: Optional voice ID (uses default if not provided)
+            
+        Returns:
+            Audio bytes (audio/mpeg)
+        """
+        audio_bytes, _ = await self.synthesize_with_visemes(text, voice_id)
+        return audio_bytes
+
+    async def synthesize_with_visemes(
+        self,
+        text: str,
+        voice_id: Optional[str] = None,
+        limiter: Optional[asyncio.Semaphore] = None,
+        upstream: Optional[Upstream] = None
+    ) -> Tuple[bytes, Dict]:
+        """
+        Get the full audio for text plus its lip-sync timeline
+        
+        Args:
+            text: Text to convert to speech
+            voice_id: Optional voice ID (uses default if not provided)
+            limiter: Concurrency limiter to hold (the request-path one by default)
+            upstream: Upstream to synthesize through (tts_upstream by default)
+            
+        Returns:
+            (audio bytes, viseme timeline)
+        """
+        voice = self._get_voice_id(voice_id)
+        key = self._cache_key(text, voice)
+
+        cached = await self._cached(text, voice)
+        if cached is not None:
+            return cached
+
+        # Timestamped synthesis returns the audio and character alignment together
+        upstream = upstream or self.tts_upstream
+        async with limiter or self._limiter:
+            response = await upstream.call(
+                lambda: self.client.text_to_speech.convert_with_timestamps(
+                    voice_id=voice,
+                    text=text,
+                    model_id=self.model_id,
+                    voice_settings=self.sdk_voice_settings,
+                    output_format=self.output_format
+                )
+            )
+
+        audio_bytes = base64.b64decode(response.audio_base_64)
+        alignment = extract_alignment(response)
+        visemes = alignment_to_visemes(**alignment) if alignment else {"t": [], "v": []}
+
+        await self.cache.put(key, audio_bytes)
+        await self._store_visemes(text, voice, visemes)
+        return audio_bytes, visemes
+
     async def generate_speech_stream(
         self,
         text: str,
@@ -84,23 +219,202 @@ class ElevenLabsService:
         Yields:
             Audio data chunks
         """
+        # Synthesized with timestamps like every other path, so the cached
+        # entry always has its viseme track and every reader can reuse it
+        async for kind, payload in self.stream_speech_with_visemes(text, voice_id):
+            if kind == FRAME_AUDIO:
+                yield payload
+
+    async def stream_speech_with_visemes(
+        self,
+        text: str,
+        voice_id: Optional[str] = None
+    ) -> AsyncIterator[Tuple[int, Union[bytes, Dict]]]:
+        """
+        Stream audio together with its lip-sync timeline
+        
+        Args:
+            text: Text to convert to speech
+            voice_id: Optional voice ID
+            
+        Yields:
+            (FRAME_VISEMES, timeline) and (FRAME_AUDIO, chunk) tuples. Viseme
+            times are ms from the start of this text's audio.
+        """
         try:
             voice = self._get_voice_id(voice_id)
-            
-            # Generate streaming audio
-            audio_stream = self.client.text_to_speech.convert(
-                voice_id=voice,
-                text=text,
-                model_id="eleven_monolingual_v1"
+            key = self._cache_key(text, voice)
+
+            cached = await self._cached(text, voice)
+            if cached is not None:
+                audio, visemes = cached
+                if visemes["t"]:
+                    yield FRAME_VISEMES, visemes
+                for start in range(0, len(audio), CACHED_CHUNK_SIZE):
+                    yield FRAME_AUDIO, audio[start:start + CACHED_CHUNK_SIZE]
+                return
+
+            chunks = []
+            timelines = []
+            audio_bytes = 0
+            last_end = 0.0
+            stream = self._read_ahead(
+                lambda: self.client.text_to_speech.stream_with_timestamps(
+                    voice_id=voice,
+                    text=text,
+                    model_id=self.model_id,
+                    voice_settings=self.sdk_voice_settings,
+                    output_format=self.output_format
+                )
             )
-            
-            # Yield chunks as they arrive
-            for chunk in audio_stream:
-                yield chunk
-                
+
+            async for response in stream:
+                alignment = extract_alignment(response)
+                if alignment:
+                    # Chunk timestamps may restart at zero - place them
+                    # after the audio already sent
+                    offset_ms = 0.0
+                    if alignment["start_times"][0] + 0.001 < last_end:
+                        offset_ms = mp3_duration_ms(audio_bytes)
+                    timeline = alignment_to_visemes(**alignment, offset_ms=offset_ms)
+                    last_end = alignment["end_times"][-1] + offset_ms / 1000
+                    timelines.append(timeline)
+                    yield FRAME_VISEMES, timeline
+
+                if response.audio_base_64:
+                    chunk = base64.b64decode(response.audio_base_64)
+                    audio_bytes += len(chunk)
+                    chunks.append(chunk)
+                    yield FRAME_AUDIO, chunk
+
+            # Only complete streams are cached
+            await self.cache.put(key, b"".join(chunks))
+            await self._store_visemes(text, voice, merge_timelines(timelines))
+
+        except UpstreamUnavailable:
+            raise
         except Exception as e:
             raise Exception(f"TTS streaming failed: {str(e)}")
-    
+
+    async def _read_ahead(self, open_stream) -> AsyncIterator:
+        """
+        Relay a TTS stream, holding a concurrency slot only while reading it
+
+        A background task reads the upstream into a bounded queue
+        (ELEVENLABS_STREAM_BUFFER responses), so a slow consumer - a client
+        on a poor connection - frees its slot as soon as ElevenLabs has
+        finished sending, rather than when the audio has been relayed.
+
+        Args:
+            open_stream: Opens the upstream stream (see Upstream.stream)
+
+        Yields:
+            Upstream responses in order
+        """
+        queue: asyncio.Queue = asyncio.Queue(maxsize=self.stream_buffer)
+        finished = object()
+
+        async def read():
+            try:
+                async with self._limiter:
+                    async for response in self.tts_upstream.stream(open_stream):
+                        await queue.put(response)
+            except Exception as e:
+                await queue.put(e)  # Raised to the consumer, slot already released
+            else:
+                await queue.put(finished)
+
+        reader = asyncio.create_task(read())
+        try:
+            while True:
+                item = await queue.get()
+                if item is finished:
+                    return
+                if isinstance(item, Exception):
+                    raise item
+                yield item
+        finally:
+            # Consumer stopped early (barge-in, disconnect): stop reading too
+            reader.cancel()
+
+    async def prewarm(self, phrases: List[str], voice_ids: List[str]):
+        """
+        Synthesize fixed phrases ahead of time so they play from the cache
+
+        With a disk tier, one process per deployment does this: the first
+        worker to start claims a lock file next to the cache, and later
+        workers and restarts skip it once it has finished. Phrases already
+        on disk are not synthesized again. Prewarm requests use their own
+        concurrency slots (TTS_PREWARM_CONCURRENCY) and breaker, so they
+        never queue ahead of live speech.
+        
+        Args:
+            phrases: Phrases the doctor says word for word
+            voice_ids: Voices to prepare each phrase for
+        """
+        job = "prewarm-" + TTSCache.make_key(
+            "\n".join(phrases), ",".join(voice_ids), self.model_id, self._key_settings()
+        )[:16]
+        stale_seconds = float(os.getenv("TTS_PREWARM_LOCK_SECONDS", "600"))
+        if not await asyncio.to_thread(self.cache.claim, job, stale_seconds):
+            print("✓ TTS prewarm done or running in another worker")
+            return
+
+        slots = asyncio.Semaphore(int(os.getenv("TTS_PREWARM_CONCURRENCY", "4")))
+        counts = {"synthesized": 0, "cached": 0, "failed": 0}
+
+        async def warm(phrase: str, voice: str):
+            if (
+                await self.cache.contains(self._viseme_key(phrase, voice), kind="json")
+                and await self.cache.contains(self._cache_key(phrase, voice))
+            ):
+                counts["cached"] += 1
+                return
+            try:
+                await self.synthesize_with_visemes(
+                    phrase, voice, limiter=slots, upstream=self.prewarm_upstream
+                )
+                counts["synthesized"] += 1
+            except Exception as e:
+                counts["failed"] += 1
+                print(f"TTS prewarm failed for voice {voice}: {str(e)}")
+
+        try:
+            await asyncio.gather(*[
+                warm(phrase, voice) for voice in voice_ids for phrase in phrases
+            ])
+        except BaseException:
+            self.cache.release(job, done=False)  # Cancelled at shutdown
+            raise
+        # Failed phrases are retried by the next worker to start
+        await asyncio.to_thread(self.cache.release, job, counts["failed"] == 0)
+        print(f"✓ TTS cache prewarmed: {counts}")
+
+    def _cache_key(self, text: str, voice: str) -> str:
+        """Cache key for text spoken with the current model, format and settings"""
+        return TTSCache.make_key(text, voice, self.model_id, self._key_settings())
+
+    def _viseme_key(self, text: str, voice: str) -> str:
+        """Cache key for the viseme timeline stored next to the audio"""
+        return TTSCache.make_key(text, voice, self.model_id, {**self._key_settings(), "track": "visemes"})
+
+    def _key_settings(self) -> Dict:
+        return {**self.voice_settings, "output_format": self.output_format}
+
+    async def _cached(self, text: str, voice: str) -> Optional[Tuple[bytes, Dict]]:
+        """Cached audio and its viseme timeline; None unless both are stored"""
+        data = await self.cache.get(self._viseme_key(text, voice), kind="json")
+        if data is None:
+            return None  # Audio without its timeline is re-synthesized
+        audio = await self.cache.get(self._cache_key(text, voice))
+        if audio is None:
+            return None
+        return audio, json.loads(data)
+
+    async def _store_visemes(self, text: str, voice: str, visemes: Dict):
+        # Stored even when empty (text without alignment) so it still counts as cached
+        await self.cache.put(self._viseme_key(text, voice), json.dumps(visemes).encode("utf-8"), kind="json")
+
     def _get_voice_id(self, voice_id: Optional[str]) -> str:
         """Get voice ID with fallback to default"""
         return voice_id or self.default_voice_id
@@ -124,10 +438,13 @@ class ElevenLabsService:
             audio_file.name = "audio.webm"  # Add name attribute for the API
             
             # Use ElevenLabs speech-to-text API
-            transcription = self.client.speech_to_text.convert(
-                file=audio_file,
-                model_id="scribe_v1",  # Scribe model for transcription
-            )
+            async with self._stt_limiter:
+                transcription = await self.stt_upstream.call(
+                    lambda: self.client.speech_to_text.convert(
+                        file=audio_file,
+                        model_id="scribe_v1",  # Scribe model for transcription
+                    )
+                )
             
             # Extract text from transcription response
             # The response contains the transcribed text
@@ -138,10 +455,16 @@ class ElevenLabsService:
             else:
                 # If response format is different, convert to string
                 return str(transcription)
-                
+
+        except UpstreamUnavailable:
+            raise
         except Exception as e:
             raise Exception(f"STT conversion failed: {str(e)}")
     
+    def stt_busy(self) -> bool:
+        """Whether every transcription slot is taken (optional work should wait)"""
+        return self._stt_limiter.locked()
+
     async def list_voices(self) -> List[Dict]:
         """
         List available voices from ElevenLabs
@@ -150,7 +473,7 @@ class ElevenLabsService:
             List of available voices with their details
         """
         try:
-            voices_response = self.client.voices.get_all()
+            voices_response = await self.client.voices.get_all()
             
             # Convert voice objects to dictionaries
             voices_list = []
@@ -0,0 +1,223 @@
+"""
+Emotion analytics - vectorized statistics over many sessions at once
+
+All sessions in a request are packed into one columnar table (session
+index, time, label, weight) and every statistic is computed with whole-array
+numpy passes over it, so cost grows with the number of samples rather than
+with Python-level work per session.
+"""
+from datetime import datetime
+from typing import Dict, List, Optional, Sequence
+
+import numpy as np
+
+from services.emotion_telemetry import EMOTION_LABELS, EmotionAggregate
+
+
+LABEL_COUNT = len(EMOTION_LABELS)
+LABEL_INDEX = {label: i for i, label in enumerate(EMOTION_LABELS)}
+NEGATIVE_LABELS = np.array([label in ("sad", "angry", "fearful", "disgusted") for label in EMOTION_LABELS])
+
+DEFAULT_WINDOW_SECONDS = 60.0
+# Total variation distance between consecutive windows that counts as a shift
+DEFAULT_SHIFT_THRESHOLD = 0.5
+
+
+def _parse_time(timestamp: str) -> float:
+    """ISO timestamp to epoch seconds (a trailing Z is accepted)"""
+    return datetime.fromisoformat(timestamp.replace("Z", "+00:00")).timestamp()
+
+
+class EmotionTable:
+    """
+    Columnar emotion samples for a batch of sessions
+
+    Rows are sorted by session, then time. weight is the number of webcam
+    samples a row stands for (1 for raw labels, n for a telemetry bucket).
+    """
+
+    def __init__(self):
+        self.session_ids: List[str] = []
+        self._session: List[np.ndarray] = []
+        self._time: List[np.ndarray] = []
+        self._label: List[np.ndarray] = []
+        self._weight: List[np.ndarray] = []
+
+    def add_labels(self, session_id: str, emotions: Sequence[str], timestamps: Optional[Sequence[str]] = None):
+        """
+        Add a session given as parallel label/timestamp lists (unknown labels are skipped)
+
+        Without timestamps the samples are taken as one second apart, in order.
+        """
+        index = len(self.session_ids)
+        self.session_ids.append(session_id)
+
+        count = len(emotions) if timestamps is None else min(len(emotions), len(timestamps))
+        labels = np.fromiter((LABEL_INDEX.get(e.lower(), -1) for e in emotions[:count]), dtype=np.int16, count=count)
+        if timestamps is None:
+            times = np.arange(count, dtype=np.float64)
+        else:
+            times = np.fromiter((_parse_time(t) for t in timestamps[:count]), dtype=np.float64, count=count)
+        keep = labels >= 0
+        self._append(index, times[keep], labels[keep], np.ones(int(keep.sum()), dtype=np.float64))
+
+    def add_aggregate(self, session_id: str, aggregate: EmotionAggregate):
+        """Add a session from its telemetry buckets (dominant label per bucket)"""
+        index = len(self.session_ids)
+        self.session_ids.append(session_id)
+        if not aggregate.buckets:
+            self._append(index, np.empty(0), np.empty(0, dtype=np.int16), np.empty(0))
+            return
+
+        starts, samples, probabilities = zip(*aggregate.buckets)
+        probabilities = np.asarray(probabilities, dtype=np.uint8)
+        self._append(
+            index,
+            np.asarray(starts, dtype=np.float64) / 1000,
+            probabilities.argmax(axis=1).astype(np.int16),
+            np.asarray(samples, dtype=np.float64)
+        )
+
+    def _append(self, index: int, times: np.ndarray, labels: np.ndarray, weights: np.ndarray):
+        order = np.argsort(times, kind="stable")
+        self._session.append(np.full(len(times), index, dtype=np.int32))
+        self._time.append(times[order])
+        self._label.append(labels[order])
+        self._weight.append(weights[order])
+
+    def columns(self):
+        """(session, time, label, weight) arrays for the whole batch"""
+        if not self._session:
+            return np.empty(0, np.int32), np.empty(0), np.empty(0, np.int16), np.empty(0)
+        return (
+            np.concatenate(self._session),
+            np.concatenate(self._time),
+            np.concatenate(self._label),
+            np.concatenate(self._weight),
+        )
+
+
+def analyze_table(
+    table: EmotionTable,
+    window_seconds: float = DEFAULT_WINDOW_SECONDS,
+    shift_threshold: float = DEFAULT_SHIFT_THRESHOLD
+) -> Dict[str, any]:
+    """
+    Distributions, transitions, dwell times, windows and shifts for every session
+
+    Args:
+        table: Sessions to analyze
+        window_seconds: Width of the windowed distributions
+        shift_threshold: Total variation distance between consecutive windows
+            reported as a significant shift
+
+    Returns:
+        {"labels", "sessions": [per-session results], "overall": totals}
+    """
+    session, time, label, weight = table.columns()
+    label = label.astype(np.int64)
+    sessions = len(table.session_ids)
+    L = LABEL_COUNT
+
+    # Weighted label counts per session
+    counts = np.bincount(session * L + label, weights=weight, minlength=sessions * L).reshape(sessions, L)
+    totals = counts.sum(axis=1)
+    with np.errstate(invalid="ignore", divide="ignore"):
+        distribution = np.where(totals[:, None] > 0, counts / totals[:, None], 0.0)
+
+    # Transitions between consecutive rows of the same session
+    same = session[1:] == session[:-1]
+    pair_key = (session[:-1][same] * L + label[:-1][same]) * L + label[1:][same]
+    transitions = np.bincount(pair_key, minlength=sessions * L * L).reshape(sessions, L, L)
+
+    # Runs of one label; a run lasts until the next run (or the session's last row) starts
+    starts_run = np.ones(len(label), dtype=bool)
+    starts_run[1:] = ~same | (label[1:] != label[:-1])
+    run_index = np.flatnonzero(starts_run)
+    run_session = session[run_index]
+    run_label = label[run_index]
+    next_time = np.empty(len(run_index))
+    if len(run_index):
+        next_time[:-1] = time[run_index[1:]]
+        # Runs that end their session stop at the session's last row
+        last_row = np.r_[np.flatnonzero(session[1:] != session[:-1]), len(session) - 1]
+        last_time = np.zeros(sessions)
+        last_time[session[last_row]] = time[last_row]
+        ends_session = np.r_[run_session[1:] != run_session[:-1], True]
+        next_time[ends_session] = last_time[run_session[ends_session]]
+    run_length = next_time - time[run_index]
+    dwell_key = run_session * L + run_label
+    dwell_total = np.bincount(dwell_key, weights=run_length, minlength=sessions * L).reshape(sessions, L)
+    run_count = np.bincount(dwell_key, minlength=sessions * L).reshape(sessions, L)
+    with np.errstate(invalid="ignore", divide="ignore"):
+        dwell_mean = np.where(run_count > 0, dwell_total / run_count, 0.0)
+
+    # Windowed distributions, windows counted from each session's first row
+    first_time = np.full(sessions, np.inf)
+    np.minimum.at(first_time, session, time)
+    window = np.floor((time - first_time[session]) / window_seconds).astype(np.int64) if len(time) else np.empty(0, np.int64)
+    span = window.max(initial=0) + 1
+    unique_windows, window_row = np.unique(session.astype(np.int64) * span + window, return_inverse=True)
+    window_counts = np.zeros((len(unique_windows), L))
+    np.add.at(window_counts, (window_row, label), weight)
+    window_distribution = window_counts / window_counts.sum(axis=1, keepdims=True)
+    window_session = unique_windows // span
+    window_number = unique_windows % span
+
+    # Significant shifts: large distance between consecutive windows of a session
+    consecutive = window_session[1:] == window_session[:-1]
+    distance = 0.5 * np.abs(window_distribution[1:] - window_distribution[:-1]).sum(axis=1)
+    negative_rise = (window_distribution[1:, NEGATIVE_LABELS].sum(axis=1)
+                     - window_distribution[:-1, NEGATIVE_LABELS].sum(axis=1))
+    shift_at = np.flatnonzero(consecutive & (distance >= shift_threshold)) if len(distance) else np.empty(0, np.int64)
+
+    # Both are sorted by session, so each session's rows are one slice
+    ids = np.arange(sessions)
+    window_bounds = np.searchsorted(window_session, np.r_[ids, sessions])
+    shift_session = window_session[shift_at]
+    shift_bounds = np.searchsorted(shift_session, np.r_[ids, sessions])
+
+    results = []
+    for i, session_id in enumerate(table.session_ids):
+        in_session = slice(window_bounds[i], window_bounds[i + 1])
+        session_shifts = shift_at[shift_bounds[i]:shift_bounds[i + 1]]
+        results.append({
+            "session_id": session_id,
+            "total_samples": int(totals[i]),
+            "distribution": distribution[i].round(4).tolist(),
+            "transitions": transitions[i].tolist(),
+            "mean_dwell_seconds": dwell_mean[i].round(2).tolist(),
+            "windows": [
+                {"start_seconds": float(n * window_seconds), "distribution": d.round(4).tolist()}
+                for n, d in zip(window_number[in_session], window_distribution[in_session])
+            ],
+            "shifts": [
+                {
+                    "at_seconds": float(window_number[k + 1] * window_seconds),
+                    "from": EMOTION_LABELS[int(window_distribution[k].argmax())],
+                    "to": EMOTION_LABELS[int(window_distribution[k + 1].argmax())],
+                    "distance": round(float(distance[k]), 4),
+                    "negative_rise": round(float(negative_rise[k]), 4),
+                }
+                for k in session_shifts
+            ],
+        })
+
+    all_counts = counts.sum(axis=0)
+    all_total = all_counts.sum()
+    all_runs = run_count.sum(axis=0)
+    with np.errstate(invalid="ignore", divide="ignore"):
+        overall_dwell = np.where(all_runs > 0, dwell_total.sum(axis=0) / all_runs, 0.0)
+
+    return {
+        "labels": list(EMOTION_LABELS),
+        "sessions": results,
+        "overall": {
+            "sessions": sessions,
+            "total_samples": int(all_total),
+            "distribution": (all_counts / all_total if all_total else all_counts).round(4).tolist(),
+            "transitions": transitions.sum(axis=0).tolist(),
+            "mean_dwell_seconds": overall_dwell.round(2).tolist(),
+            "sessions_with_shifts": int(len(np.unique(shift_session))),
+        },
+    }
@@ -1,9 +1,38 @@
 """
 Emotion analyzer service - detects emotion mismatches and patterns
 """
-from typing import Dict, List, Optional
-from datetime import datetime
+import os
+import re
+import time
+import asyncio
+from concurrent.futures import ThreadPoolExecutor
+from functools import lru_cache
+from typing import Dict, List, Optional, Sequence
+from datetime import datetime, timezone
+import numpy as np
 from vaderSentiment.vaderSentiment import SentimentIntensityAnalyzer
+from services.metrics import SENTIMENT_OVER_BUDGET, SENTIMENT_QUEUE_SECONDS
+from services.emotion_telemetry import EMOTION_LABELS, PROBABILITY_SCALE, EmotionAggregate
+from services.emotion_analytics import (
+    DEFAULT_SHIFT_THRESHOLD,
+    DEFAULT_WINDOW_SECONDS,
+    EmotionTable,
+    analyze_table,
+)
+
+NEGATIVE_EMOTIONS = {"sad", "angry", "fearful", "disgusted"}
+
+_WHITESPACE = re.compile(r"\s+")
+
+
+def normalize_text(text: str) -> str:
+    """
+    Sentiment cache key for a message
+
+    Only whitespace is normalized: VADER scores capitalization and
+    punctuation ("GREAT!!" vs "great"), so those must stay part of the key.
+    """
+    return _WHITESPACE.sub(" ", text).strip()
 
 
 class EmotionAnalyzer:
@@ -11,12 +40,84 @@ class EmotionAnalyzer:
     
     def __init__(self):
         """Initialize emotion analyzer"""
-        self.emotion_categories = [
-            "neutral", "happy", "sad", "angry",
-            "fearful", "disgusted", "surprised"
-        ]
-        # Initialize sentiment analyzer
+        self.emotion_categories = list(EMOTION_LABELS)
+        # Initialize sentiment analyzer (loads the VADER lexicon - share the instance)
         self.sentiment_analyzer = SentimentIntensityAnalyzer()
+
+        # Scores by normalized text; repeated phrases ("yes", "thank you") score once
+        cache_size = int(os.getenv("SENTIMENT_CACHE_SIZE", "4096"))
+        self._cached_scores = lru_cache(maxsize=cache_size)(self.sentiment_analyzer.polarity_scores)
+
+        # Scoring runs here, never on the event loop
+        workers = int(os.getenv("SENTIMENT_WORKERS", "2"))
+        self._executor = ThreadPoolExecutor(max_workers=workers, thread_name_prefix="sentiment")
+        # Start the threads now so the first turns don't pay for it
+        for _ in range(workers):
+            self._executor.submit(self.sentiment_analyzer.polarity_scores, "warm up")
+
+        # How long a chat turn waits for its sentiment before going without.
+        # Scoring itself takes well under a millisecond; the budget is for
+        # the wait behind other turns' scoring (auralis_sentiment_queue_seconds)
+        self.sentiment_budget_seconds = float(os.getenv("SENTIMENT_BUDGET_MS", "250")) / 1000
+        # Over-budget turns are counted; the log line is at most one a minute
+        self._over_budget = 0
+        self._over_budget_logged_at = 0.0
+
+    def close(self):
+        """Stop the sentiment threads (process shutdown)"""
+        self._executor.shutdown(wait=False, cancel_futures=True)
+
+    def score(self, text: str) -> Dict[str, float]:
+        """VADER polarity scores for a message (cached)"""
+        return dict(self._cached_scores(normalize_text(text)))
+
+    def score_messages(self, texts: Sequence[str]) -> List[Dict[str, float]]:
+        """VADER polarity scores for a batch of messages, in order"""
+        return [self.score(text) for text in texts]
+
+    async def score_messages_async(self, texts: Sequence[str]) -> List[Dict[str, float]]:
+        """score_messages on the sentiment threads (one hop for the whole batch)"""
+        loop = asyncio.get_running_loop()
+        return await loop.run_in_executor(self._executor, self.score_messages, list(texts))
+
+    async def analyze_mismatch_async(
+        self,
+        message: str,
+        detected_emotion: str
+    ) -> Optional[Dict[str, any]]:
+        """
+        analyze_mismatch without blocking the event loop
+
+        Scoring runs on the sentiment threads. If it doesn't finish within
+        SENTIMENT_BUDGET_MS (threads backed up under load) the turn goes
+        ahead without mismatch context; the score still lands in the cache.
+        Such turns are counted in auralis_sentiment_over_budget_total.
+
+        Returns:
+            Mismatch analysis, or None if the budget ran out
+        """
+        loop = asyncio.get_running_loop()
+        future = loop.run_in_executor(self._executor, self._score_queued, message, time.monotonic())
+        try:
+            scores = await asyncio.wait_for(asyncio.shield(future), self.sentiment_budget_seconds)
+        except asyncio.TimeoutError:
+            self._record_over_budget()
+            return None
+        return self._mismatch_from_scores(scores, detected_emotion)
+
+    def _score_queued(self, message: str, submitted_at: float) -> Dict[str, float]:
+        """score() on a sentiment thread, recording how long it waited for one"""
+        SENTIMENT_QUEUE_SECONDS.observe(time.monotonic() - submitted_at)
+        return self.score(message)
+
+    def _record_over_budget(self):
+        SENTIMENT_OVER_BUDGET.inc()
+        self._over_budget += 1
+        now = time.monotonic()
+        if now - self._over_budget_logged_at >= 60:
+            print(f"⚠️ Sentiment over budget for {self._over_budget} turn(s) - replying without mismatch context")
+            self._over_budget = 0
+            self._over_budget_logged_at = now
     
     def analyze_mismatch(
         self,
@@ -34,8 +135,14 @@ class EmotionAnalyzer:
             Dict containing mismatch analysis and context
         """
         # Analyze text sentiment using VADER
-        sentiment_scores = self.sentiment_analyzer.polarity_scores(message)
+        return self._mismatch_from_scores(self.score(message), detected_emotion)
 
+    def _mismatch_from_scores(
+        self,
+        sentiment_scores: Dict[str, float],
+        detected_emotion: str
+    ) -> Dict[str, any]:
+        """Mismatch analysis from already computed VADER scores"""
         # Determine text sentiment based on compound score
         compound = sentiment_scores['compound']
         if compound >= 0.05:
@@ -89,49 +196,124 @@ class EmotionAnalyzer:
     ) -> List[Dict]:
         """
         Generate emotion chart data for visualization
-        
+
+        Samples go through the same columnar table as the batch analytics,
+        so unknown labels are dropped and points come out in time order.
+
         Args:
             emotions: List of detected emotions
             timestamps: Corresponding timestamps
-            
+
         Returns:
             Chart data in format suitable for frontend visualization
         """
-        # TODO: Implement chart data generation
-        # - Aggregate emotions over time
-        # - Calculate percentages
-        # - Format for chart library (e.g., Chart.js)
-        
+        table = EmotionTable()
+        table.add_labels("chart", emotions, timestamps)
+        _, times, labels, _ = table.columns()
         return [
             {
-                "timestamp": timestamp,
-                "emotion": emotion
+                "timestamp": datetime.fromtimestamp(t, tz=timezone.utc).isoformat(),
+                "emotion": EMOTION_LABELS[label]
             }
-            for timestamp, emotion in zip(timestamps, emotions)
+            for t, label in zip(times.tolist(), labels.tolist())
         ]
-    
-    def calculate_statistics(self, emotions: List[str]) -> Dict[str, any]:
+
+    def chart_from_aggregate(self, aggregate: EmotionAggregate) -> List[Dict]:
         """
-        Calculate emotion statistics
-        
+        Emotion chart from telemetry buckets (one point per bucket)
+
+        Args:
+            aggregate: Session emotion telemetry
+
+        Returns:
+            Chart data with the bucket's dominant emotion and mean probabilities
+        """
+        chart = []
+        for start_ms, _, quantized in aggregate.buckets:
+            probabilities = {
+                label: round(value / PROBABILITY_SCALE, 3)
+                for label, value in zip(EMOTION_LABELS, quantized)
+            }
+            chart.append({
+                "timestamp": datetime.fromtimestamp(start_ms / 1000, tz=timezone.utc).isoformat(),
+                "emotion": max(probabilities, key=probabilities.get),
+                "probabilities": probabilities
+            })
+        return chart
+
+    def statistics_from_aggregate(self, aggregate: EmotionAggregate) -> Dict[str, any]:
+        """Emotion statistics, including transitions, from session telemetry"""
+        stats = self.statistics_from_counts(aggregate.count_map())
+        stats["transitions"] = aggregate.transition_map()
+        return stats
+
+    def analyze_sessions(
+        self,
+        table: EmotionTable,
+        window_seconds: float = DEFAULT_WINDOW_SECONDS,
+        shift_threshold: float = DEFAULT_SHIFT_THRESHOLD
+    ) -> Dict[str, any]:
+        """
+        Vectorized analytics over many sessions (see services/emotion_analytics.py)
+
+        CPU-bound for large batches - call it off the event loop.
+
+        Args:
+            table: Sessions packed into columns
+            window_seconds: Width of the windowed distributions
+            shift_threshold: Window-to-window distance reported as a shift
+
+        Returns:
+            Per-session and overall distributions, transition matrices,
+            dwell times, windows and significant shifts
+        """
+        return analyze_table(table, window_seconds, shift_threshold)
+
+    def calculate_statistics(
+        self,
+        emotions: List[str],
+        timestamps: Optional[List[str]] = None
+    ) -> Dict[str, any]:
+        """
+        Calculate emotion statistics, including transitions
+
+        Counted with numpy passes over an EmotionTable (transitions from
+        analyze_table) rather than per sample in Python.
+
         Args:
             emotions: List of detected emotions
-            
+            timestamps: Corresponding timestamps (sample order is used without them)
+
         Returns:
             Dict containing emotion statistics
         """
-        # TODO: Implement statistics calculation
-        # - Count emotion frequencies
-        # - Calculate percentages
-        # - Identify dominant emotions
-        # - Detect emotion transitions
-        
-        emotion_counts = {}
-        for emotion in emotions:
-            emotion_counts[emotion] = emotion_counts.get(emotion, 0) + 1
-        
-        total = len(emotions) if emotions else 1
-        
+        table = EmotionTable()
+        table.add_labels("stats", emotions, timestamps or None)
+        _, _, labels, _ = table.columns()
+        result = analyze_table(table)["sessions"][0]
+
+        counts = np.bincount(labels.astype(np.int64), minlength=len(EMOTION_LABELS))
+        emotion_counts = {label: int(count) for label, count in zip(EMOTION_LABELS, counts) if count}
+        stats = self.statistics_from_counts(emotion_counts)
+        stats["transitions"] = {
+            EMOTION_LABELS[i]: {EMOTION_LABELS[j]: value for j, value in enumerate(row) if value}
+            for i, row in enumerate(result["transitions"])
+            if any(row)
+        }
+        return stats
+
+    def statistics_from_counts(self, emotion_counts: Dict[str, int]) -> Dict[str, any]:
+        """
+        Emotion statistics from pre-aggregated counts (e.g. a session's running tally)
+
+        Args:
+            emotion_counts: Number of samples per emotion
+
+        Returns:
+            Dict containing emotion statistics
+        """
+        total = sum(emotion_counts.values()) or 1
+
         return {
             "total_samples": total,
             "emotion_counts": emotion_counts,
@@ -145,26 +327,53 @@ class EmotionAnalyzer:
     def detect_emotion_transition(
         self,
         previous_emotion: str,
-        current_emotion: str
+        current_emotion: str,
+        aggregate: Optional[EmotionAggregate] = None
     ) -> Dict[str, any]:
         """
         Detect significant emotion transitions
         
+        A shift into a negative emotion is concerning; it is more significant
+        the rarer that transition has been for this patient so far.
+        
         Args:
             previous_emotion: Previous emotion state
             current_emotion: Current emotion state
+            aggregate: Session telemetry whose transition matrix gives the
+                patient's usual pattern (optional)
             
         Returns:
             Transition analysis
         """
-        # TODO: Implement transition detection
-        # - Identify significant emotional shifts
-        # - Flag concerning transitions (e.g., happy -> sad)
+        has_transition = previous_emotion != current_emotion
+        significance = "low"
+        share = None
+
+        if aggregate is not None and previous_emotion in EMOTION_LABELS and current_emotion in EMOTION_LABELS:
+            row = aggregate.transitions[EMOTION_LABELS.index(previous_emotion)]
+            outgoing = sum(row)
+            if outgoing:
+                share = row[EMOTION_LABELS.index(current_emotion)] / outgoing
+
+        if has_transition and current_emotion in NEGATIVE_EMOTIONS and previous_emotion not in NEGATIVE_EMOTIONS:
+            # Rare for this patient (or no history to compare with)
+            significance = "high" if share is None or share < 0.1 else "medium"
         
         return {
-            "has_transition": previous_emotion != current_emotion,
+            "has_transition": has_transition,
             "from": previous_emotion,
             "to": current_emotion,
-            "significance": "low"
+            "significance": significance,
+            "observed_share": share
         }
 
+
+_shared_analyzer: Optional[EmotionAnalyzer] = None
+
+
+def get_emotion_analyzer() -> EmotionAnalyzer:
+    """The process-wide EmotionAnalyzer (one VADER lexicon, one score cache)"""
+    global _shared_analyzer
+    if _shared_analyzer is None:
+        _shared_analyzer = EmotionAnalyzer()
+    return _shared_analyzer
@@ -0,0 +1,110 @@
+"""
+Emotion telemetry - per-session aggregate of the client's emotion batches
+
+The frontend (lib/emotionTelemetry.ts) folds every webcam detection into
+running counts, a transition matrix and 5-second buckets of quantized
+probability vectors, and posts the deltas in batches during the call. The
+aggregate here just adds them up, so insights never touch raw samples.
+"""
+from collections import deque
+from typing import Deque, Dict, List, Sequence
+
+
+# face-api.js expression labels; the order is the wire format
+EMOTION_LABELS = ["neutral", "happy", "sad", "angry", "fearful", "disgusted", "surprised"]
+
+# Buckets kept per session (20 minutes at 5 s per bucket)
+MAX_BUCKETS = 240
+
+# Bucket probabilities are quantized to 0-255
+PROBABILITY_SCALE = 255
+
+
+class EmotionAggregate:
+    """Running emotion counts, transitions and bucketed probabilities for one session"""
+
+    def __init__(self, max_buckets: int = MAX_BUCKETS):
+        """
+        Initialize an empty aggregate
+
+        Args:
+            max_buckets: Number of time buckets retained (oldest drop off)
+        """
+        size = len(EMOTION_LABELS)
+        self.counts: List[int] = [0] * size
+        self.transitions: List[List[int]] = [[0] * size for _ in range(size)]
+        # (bucket start epoch ms, samples, quantized probabilities)
+        self.buckets: Deque[tuple] = deque(maxlen=max_buckets)
+
+    @property
+    def total_samples(self) -> int:
+        return sum(self.counts)
+
+    def merge(
+        self,
+        labels: Sequence[str],
+        buckets: Sequence[Dict],
+        counts: Sequence[int],
+        transitions: Sequence[Sequence[int]]
+    ):
+        """
+        Add one batch of client deltas
+
+        Args:
+            labels: Label order the batch was encoded with
+            buckets: Closed buckets ({"t", "n", "p"}) in time order
+            counts: Samples per label since the previous batch
+            transitions: Label-to-label transition counts since the previous batch
+
+        Raises:
+            ValueError: If the batch doesn't match the expected shape
+        """
+        size = len(EMOTION_LABELS)
+        if list(labels) != EMOTION_LABELS:
+            raise ValueError(f"Unexpected emotion labels: {list(labels)}")
+        if len(counts) != size or len(transitions) != size or any(len(row) != size for row in transitions):
+            raise ValueError("Counts and transitions must cover every emotion label")
+        if any(value < 0 for value in counts) or any(value < 0 for row in transitions for value in row):
+            raise ValueError("Counts must not be negative")
+        for bucket in buckets:
+            if len(bucket["p"]) != size or not all(0 <= value <= PROBABILITY_SCALE for value in bucket["p"]):
+                raise ValueError("Bucket probabilities must be one 0-255 value per label")
+
+        for i, value in enumerate(counts):
+            self.counts[i] += value
+        for i, row in enumerate(transitions):
+            target = self.transitions[i]
+            for j, value in enumerate(row):
+                target[j] += value
+        for bucket in buckets:
+            self.buckets.append((bucket["t"], bucket["n"], tuple(bucket["p"])))
+
+    def count_map(self) -> Dict[str, int]:
+        """Sample count per label (labels never seen are left out)"""
+        return {label: count for label, count in zip(EMOTION_LABELS, self.counts) if count}
+
+    def transition_map(self) -> Dict[str, Dict[str, int]]:
+        """Non-zero transitions as {from: {to: count}}"""
+        result = {}
+        for i, row in enumerate(self.transitions):
+            targets = {EMOTION_LABELS[j]: value for j, value in enumerate(row) if value}
+            if targets:
+                result[EMOTION_LABELS[i]] = targets
+        return result
+
+    def to_state(self) -> Dict:
+        """JSON-serializable copy (external session store)"""
+        return {
+            "counts": list(self.counts),
+            "transitions": [list(row) for row in self.transitions],
+            "buckets": [list(bucket) for bucket in self.buckets],
+        }
+
+    @classmethod
+    def from_state(cls, state: Dict, max_buckets: int = MAX_BUCKETS) -> "EmotionAggregate":
+        """Rebuild an aggregate saved with to_state"""
+        aggregate = cls(max_buckets)
+        aggregate.counts = list(state["counts"])
+        aggregate.transitions = [list(row) for row in state["transitions"]]
+        aggregate.buckets.extend((t, n, tuple(p)) for t, n, p in state["buckets"])
+        return aggregate
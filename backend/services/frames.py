@@ -0,0 +1,40 @@
+"""
+Frame codec - typed binary frames for streaming text, audio and control events
+
+Each frame is a 1-byte type, a 4-byte big-endian payload length, then the
+payload. Audio frames carry raw audio bytes; every other frame carries UTF-8
+JSON.
+"""
+import json
+import struct
+from typing import Dict, Union
+
+
+# Media type for HTTP responses made of frames
+FRAME_MEDIA_TYPE = "application/x-auralis-frames"
+
+FRAME_TEXT_DELTA = 0x01   # {"text": ...} partial doctor reply
+FRAME_AUDIO = 0x02        # audio/mpeg bytes, in playback order
+FRAME_DONE = 0x03         # ChatResponse fields, sent when the reply text is complete
+FRAME_VISEMES = 0x04      # {"t": [ms], "v": [viseme id]} lip-sync keys, ms from the start of the audio stream
+FRAME_TRANSCRIPT = 0x05   # {"text": ..., "final": bool} patient speech (call channel)
+FRAME_CONTROL = 0x06      # {"type": ...} call channel events (ready, interrupted, end_consultation, turn_end)
+FRAME_ERROR = 0x7F        # {"detail": ...}, plus "text" when only that sentence has no speech
+
+_HEADER = struct.Struct(">BI")
+
+
+def encode_frame(frame_type: int, payload: Union[bytes, Dict]) -> bytes:
+    """
+    Encode a single frame
+
+    Args:
+        frame_type: One of the FRAME_* constants
+        payload: Raw bytes (audio) or a JSON-serializable dict
+
+    Returns:
+        Encoded frame bytes
+    """
+    if isinstance(payload, dict):
+        payload = json.dumps(payload).encode("utf-8")
+    return _HEADER.pack(frame_type, len(payload)) + payload
@@ -2,8 +2,139 @@
 Gemini AI service - handles Google Gemini API interactions
 """
 import os
-from typing import Dict, List, Optional
-import google.generativeai as genai
+import json
+import asyncio
+import random
+from typing import AsyncIterator, Dict, List, Optional
+from models.schemas import SummaryData
+from services.session_store import SessionStore, ConversationSession
+from services.conversation_memory import ConversationMemory
+from services.speculation import SpeculativeReply, chunk_text
+from services.resilience import CircuitBreaker, Upstream, UpstreamUnavailable
+
+
+END_CONSULTATION_TAG = "[END_CONSULTATION]"
+
+# Replies used when Gemini blocks or returns an empty response
+FALLBACK_RESPONSES = [
+    "I understand. Can you tell me more about that?",
+    "I see. What else have you been experiencing?",
+    "Tell me more about how you've been feeling.",
+    "I see. Could you tell me more about your symptoms?"
+]
+ERROR_FALLBACK_RESPONSE = "I see. Could you tell me more about your symptoms?"
+GREETING_FALLBACK_RESPONSE = "Hello! I'm here to help. What brings you in today?"
+
+# Summary instructions, shared by the structured and the parallel prompts
+SUMMARY_OVERVIEW_INSTRUCTIONS = """Write a professional medical summary (3-4 sentences) that includes:
+1. Patient age/demographics and chief complaint
+2. Your clinical assessment and likely diagnosis (consider age-specific conditions)
+3. Key findings from the consultation
+4. Overall prognosis or expected outcome
+
+IMPORTANT: Pay attention to the patient's age group in the transcript. Tailor your diagnosis to age-appropriate conditions.
+- Teenagers: posture issues, stress, growth-related
+- Young adults: lifestyle, work stress, ergonomics
+- Middle-aged: chronic conditions, preventive care
+- Seniors/Elderly: age-related degeneration, medication considerations
+
+TONE: Professional but clear. Write like you're documenting in a medical chart for another healthcare provider.
+FORMAT: Plain text only. NO markdown, NO asterisks, NO special formatting. Write in complete sentences."""
+
+SUMMARY_RECOMMENDATIONS_INSTRUCTIONS = """Provide 4-5 specific, actionable recommendations that cover:
+- Medications (with dosages and frequency if applicable)
+- Lifestyle modifications or home remedies (age-appropriate)
+- Symptom monitoring or warning signs to watch for
+- Follow-up timeline or when to seek additional care
+- Preventive measures for the future
+
+AGE-SPECIFIC CONSIDERATIONS:
+- Teenagers: Focus on posture correction, stress management, sleep hygiene, screen time
+- Young adults: Ergonomics, work-life balance, exercise routines, hydration
+- Middle-aged: Preventive screening, chronic disease management, stress reduction
+- Seniors/Elderly: Medication safety, fall prevention, mobility aids, regular monitoring
+
+REQUIREMENTS:
+- Be specific and detailed (e.g., "Take 400mg ibuprofen every 6 hours" not just "Take pain medication")
+- Show medical expertise in your recommendations
+- TAILOR recommendations to patient's age group (check transcript for age context)
+- Each recommendation should be practical and immediately actionable
+- Write in plain text, NO markdown, NO asterisks, NO bold text
+- Start each recommendation naturally (e.g., "Take...", "Apply...", "Monitor for...", "Follow up if...")
+- Write with confidence - you're the doctor giving clear instructions"""
+
+# System instructions for the summary models (static, so they form a cacheable prefix)
+OVERVIEW_SYSTEM_INSTRUCTION = f"""You are an experienced physician writing a clinical summary of a patient consultation.
+
+{SUMMARY_OVERVIEW_INSTRUCTIONS}"""
+
+RECOMMENDATIONS_SYSTEM_INSTRUCTION = f"""You are an experienced physician creating a treatment plan based on this consultation.
+
+{SUMMARY_RECOMMENDATIONS_INSTRUCTIONS}
+- Separate each recommendation with a line break"""
+
+STRUCTURED_SUMMARY_SYSTEM_INSTRUCTION = f"""You are an experienced physician documenting a patient consultation. Write a clinical summary and a treatment plan.
+
+"overview": {SUMMARY_OVERVIEW_INSTRUCTIONS}
+
+"recommendations": {SUMMARY_RECOMMENDATIONS_INSTRUCTIONS}
+Put each recommendation in its own array item, without numbering or bullets.
+
+You are given either a full consultation transcript, or the current summary of a consultation still in progress followed by the new exchanges since it. In the second case, update the summary so it covers the whole consultation so far, keeping earlier findings unless the new exchanges change them."""
+
+# Response schema for single-pass summaries (mirrors models.schemas.SummaryData)
+SUMMARY_RESPONSE_SCHEMA = {
+    "type": "OBJECT",
+    "properties": {
+        "overview": {"type": "STRING"},
+        "recommendations": {"type": "ARRAY", "items": {"type": "STRING"}},
+    },
+    "required": ["overview", "recommendations"],
+}
+
+
+class EndConsultationDetector:
+    """
+    Finds the end-of-consultation tag in streamed text
+
+    Text that could be the start of a tag split across chunks is held back
+    until the next chunk shows whether it is the tag or ordinary text.
+    """
+
+    def __init__(self, tag: str = END_CONSULTATION_TAG):
+        self.tag = tag
+        self.detected = False
+        self._pending = ""
+
+    def feed(self, chunk: str) -> str:
+        """
+        Add a streamed chunk
+
+        Args:
+            chunk: Raw text from the model
+
+        Returns:
+            Text that is safe to show (tag removed)
+        """
+        text = self._pending + chunk
+        if self.tag in text:
+            self.detected = True
+            text = text.replace(self.tag, "")
+
+        # Hold back the longest suffix that could still grow into the tag
+        hold = 0
+        for length in range(min(len(self.tag) - 1, len(text)), 0, -1):
+            if text.endswith(self.tag[:length]):
+                hold = length
+                break
+
+        self._pending = text[len(text) - hold:] if hold else ""
+        return text[:len(text) - hold]
+
+    def flush(self) -> str:
+        """Release any held-back text at the end of the stream"""
+        text, self._pending = self._pending, ""
+        return text
 
 
 class GeminiService:
@@ -15,6 +146,10 @@ class GeminiService:
         if not self.api_key:
             raise ValueError("GEMINI_API_KEY environment variable not set")
 
+        # Imported here so loading the app doesn't pay for the SDK (and gRPC);
+        # the models below only open a channel on their first request
+        import google.generativeai as genai
+
         # Configure Gemini API
         genai.configure(api_key=self.api_key)
 
@@ -51,28 +186,37 @@ class GeminiService:
             },
         ]
         
-        self.model = genai.GenerativeModel(
-            self.model_name,
-            generation_config=generation_config,
-            safety_settings=safety_settings
-        )
+        # "structured" (one JSON generation) or "parallel" (two concurrent prompts)
+        self.summary_mode = os.getenv("SUMMARY_MODE", "structured").strip().lower()
+
+        # Rolling per-session summary kept current during the consultation
+        self.summary_precompute = os.getenv("SUMMARY_PRECOMPUTE", "true").lower() not in ("0", "false", "no")
+        self.summary_wait_seconds = float(os.getenv("SUMMARY_WAIT_SECONDS", "10"))
         
-        # Separate model for summaries with higher token limit
-        summary_config = {
-            "temperature": 0.5,
-            "top_p": 0.95,
-            "top_k": 40,
-            "max_output_tokens": 1800,  # Higher limit for detailed summaries
-            "candidate_count": 1,
-        }
-        self.summary_model = genai.GenerativeModel(
-            self.model_name,
-            generation_config=summary_config,
-            safety_settings=safety_settings
+        # Per-consultation chat state, keyed by session id
+        self.sessions = SessionStore()
+        # Keeps each chat's history within a token budget
+        self.memory = ConversationMemory()
+
+        # Cap on in-flight Gemini requests per worker
+        self.max_concurrency = int(os.getenv("GEMINI_MAX_CONCURRENCY", "64"))
+        self._limiter = asyncio.Semaphore(self.max_concurrency)
+
+        # Deadlines and a shared breaker for every Gemini call (see resilience.py);
+        # slow chat replies are hedged on GEMINI_HEDGE_MODEL
+        self.breaker = CircuitBreaker("gemini")
+        self.chat_upstream = Upstream(
+            "gemini.chat",
+            self.breaker,
+            timeout_seconds=float(os.getenv("GEMINI_TIMEOUT_SECONDS", "20")),
+            hedge_after_seconds=float(os.getenv("GEMINI_HEDGE_AFTER_SECONDS", "6"))
         )
-        
-        self.conversation_history = []
-        self.chat_session = None  # Will be initialized on first use
+        self.summary_upstream = Upstream(
+            "gemini.summary",
+            self.breaker,
+            timeout_seconds=float(os.getenv("GEMINI_SUMMARY_TIMEOUT_SECONDS", "45"))
+        )
+        self.hedge_model_name = os.getenv("GEMINI_HEDGE_MODEL", "gemini-2.5-flash-lite").strip()
         self.system_message = """You're an experienced, knowledgeable doctor having a direct conversation with your patient. You have extensive medical training and can diagnose and treat common conditions confidently. Talk naturally but showcase your medical expertise.
 
 CORE IDENTITY:
@@ -158,13 +302,64 @@ You: "Perfect. Feel better soon, and remember those screen breaks! [END_CONSULTA
 
 Remember: You're a confident, knowledgeable doctor. Show your expertise through targeted questions and clear, specific treatment plans."""
 
+        # The static prompts go in as system instructions: they are sent as an
+        # identical prefix on every request (eligible for Gemini's implicit
+        # prompt caching) instead of as extra turns in each chat's history
+        self.model = genai.GenerativeModel(
+            self.model_name,
+            generation_config=generation_config,
+            safety_settings=safety_settings,
+            system_instruction=self.system_message
+        )
+        # Faster model racing slow chat replies (none if GEMINI_HEDGE_MODEL is empty)
+        self.hedge_model = genai.GenerativeModel(
+            self.hedge_model_name,
+            generation_config=generation_config,
+            safety_settings=safety_settings,
+            system_instruction=self.system_message
+        ) if self.hedge_model_name else None
+        
+        # Separate models for summaries with higher token limit
+        summary_config = {
+            "temperature": 0.5,
+            "top_p": 0.95,
+            "top_k": 40,
+            "max_output_tokens": 1800,  # Higher limit for detailed summaries
+            "candidate_count": 1,
+        }
+        self.overview_model = genai.GenerativeModel(
+            self.model_name,
+            generation_config=summary_config,
+            safety_settings=safety_settings,
+            system_instruction=OVERVIEW_SYSTEM_INSTRUCTION
+        )
+        self.recommendations_model = genai.GenerativeModel(
+            self.model_name,
+            generation_config=summary_config,
+            safety_settings=safety_settings,
+            system_instruction=RECOMMENDATIONS_SYSTEM_INSTRUCTION
+        )
+
+        # Same settings, constrained to the SummaryData JSON shape
+        self.structured_summary_model = genai.GenerativeModel(
+            self.model_name,
+            generation_config={
+                **summary_config,
+                "response_mime_type": "application/json",
+                "response_schema": SUMMARY_RESPONSE_SCHEMA,
+            },
+            safety_settings=safety_settings,
+            system_instruction=STRUCTURED_SUMMARY_SYSTEM_INSTRUCTION
+        )
+
     async def get_response(
         self,
         message: str,
         emotion: str,
         age: Optional[int] = None,
         age_category: Optional[str] = None,
-        emotion_context: Optional[Dict] = None
+        emotion_context: Optional[Dict] = None,
+        session_id: Optional[str] = None
     ) -> Dict[str, any]:
         """
         Get AI response based on user message, detected emotion, and age
@@ -175,71 +370,67 @@ Remember: You're a confident, knowledgeable doctor. Show your expertise through
             age: Detected age (e.g., 32)
             age_category: Age category (e.g., "Young Adult", "Senior")
             emotion_context: Additional emotion analysis context
+            session_id: Consultation identifier the message belongs to
 
         Returns:
             Dict containing response text and metadata
         """
+        session = await self.sessions.get_or_create(session_id)
+        async with session.lock:
+            return await self._get_session_response(
+                session, message, emotion, age, age_category, emotion_context
+            )
+
+    async def _get_session_response(
+        self,
+        session: ConversationSession,
+        message: str,
+        emotion: str,
+        age: Optional[int],
+        age_category: Optional[str],
+        emotion_context: Optional[Dict]
+    ) -> Dict[str, any]:
+        """Run one conversation turn against a session (caller holds session.lock)"""
         try:
             # Initialize chat session if not exists
-            if self.chat_session is None:
-                # Start chat with system message as first exchange
-                self.chat_session = self.model.start_chat(history=[
-                    {"role": "user", "parts": [self.system_message]},
-                    {"role": "model", "parts": ["Got it. I'll keep things casual and brief, ask a couple questions to understand what's going on, then give straightforward advice. No formal lists or long explanations, just natural conversation."]}
-                ])
+            self._ensure_chat(session)
 
             # Build context-aware message with emotion, age, and conversation stage
-            contextual_message = self._build_contextual_message(message, emotion, age, age_category, emotion_context)
+            contextual_message = self._build_contextual_message(
+                message, emotion, age, age_category, emotion_context, session.exchange_count
+            )
             
-            # Send message to chat
-            response = self.chat_session.send_message(contextual_message)
+            # Stateless request on a snapshot of the chat, so a hedge can run
+            # alongside it; the winning reply is recorded below
+            history = list(session.chat_session.history)
+            request = [*history, {"role": "user", "parts": [contextual_message]}]
+            hedge = None
+            if self.hedge_model is not None:
+                hedge = lambda: self._generate(self.hedge_model, request)
+            response = await self.chat_upstream.call(lambda: self._generate(self.model, request), hedge=hedge)
 
             # Extract response text safely
             try:
                 response_text = response.text.strip()
                 print(f"✓ Got response from Gemini: {response_text[:80]}...")
-            except (IndexError, AttributeError):
+                session.chat_session.history = [*request, {"role": "model", "parts": [response_text]}]
+            except (IndexError, AttributeError, ValueError):
                 # Response was blocked or empty
                 print(f"Response blocked. Candidates: {response.candidates}")
-                fallback_responses = [
-                    "I understand. Can you tell me more about that?",
-                    "I see. What else have you been experiencing?",
-                    "Tell me more about how you've been feeling.",
-                    "I see. Could you tell me more about your symptoms?"
-                ]
-                import random
-                response_text = random.choice(fallback_responses)
-
-            # Check if AI is signaling end of consultation
-            should_end = "[END_CONSULTATION]" in response_text
-            
-            # Remove the tag from the response text (don't show to user)
-            clean_response = response_text.replace("[END_CONSULTATION]", "").strip()
-
-            # Add to our history for tracking
-            self._add_to_history("user", message)
-            self._add_to_history("assistant", clean_response)
+                response_text = random.choice(FALLBACK_RESPONSES)
+            self.memory.compact(session)
 
-            # Determine if follow-up is needed
-            followup_needed = "?" in clean_response or len(self.conversation_history) < 6
-
-            return {
-                "text": clean_response,
-                "followup_needed": followup_needed,
-                "should_end_consultation": should_end
-            }
+            return self._finish_turn(session, message, response_text, emotion)
 
         except Exception as e:
             # Log error and return fallback response with more details
             import traceback
             print(f"Error calling Gemini API: {str(e)}")
-            print(traceback.format_exc())
+            if not isinstance(e, UpstreamUnavailable):
+                print(traceback.format_exc())
             
             # Return a contextual fallback based on conversation history
-            if len(self.conversation_history) > 0:
-                fallback = "I see. Could you tell me more about your symptoms?"
-            else:
-                fallback = "Hello! I'm here to help. What brings you in today?"
+            fallback = self._error_fallback(session)
             
             return {
                 "text": fallback,
@@ -251,6 +442,12 @@ Remember: You're a confident, knowledgeable doctor. Show your expertise through
         """
         Generate structured conversation summary using Gemini
 
+        In "structured" mode (SUMMARY_MODE, the default) the overview and the
+        recommendations come from one JSON generation validated against
+        SummaryData. "parallel" mode runs the separate overview and
+        recommendations prompts concurrently; it is also the fallback when a
+        structured reply is blocked or fails validation.
+
         Args:
             conversation: List of conversation messages
 
@@ -258,168 +455,473 @@ Remember: You're a confident, knowledgeable doctor. Show your expertise through
             Dict with 'overview' and 'recommendations' keys
         """
         try:
-            # Format conversation for summarization
-            conversation_text = []
-            for msg in conversation:
-                # Handle both dict and object formats
-                role = "Patient" if (msg.get("role") if isinstance(msg, dict) else msg.role) == "user" else "Doctor"
-                content = msg.get("content") if isinstance(msg, dict) else msg.content
-                conversation_text.append(f"{role}: {content}")
+            formatted_conversation = self._format_transcript(conversation)
 
-            formatted_conversation = "\n".join(conversation_text)
+            if self.summary_mode == "structured":
+                summary = await self._generate_structured_summary(formatted_conversation)
+                if summary is not None:
+                    return summary
+                print("⚠️ Structured summary unusable - falling back to parallel prompts")
 
-            # Build summarization prompt for overview
-            overview_prompt = f"""You are an experienced physician writing a clinical summary of a patient consultation.
+            return await self._generate_parallel_summary(formatted_conversation)
 
-Write a professional medical summary (3-4 sentences) that includes:
-1. Patient age/demographics and chief complaint
-2. Your clinical assessment and likely diagnosis (consider age-specific conditions)
-3. Key findings from the consultation
-4. Overall prognosis or expected outcome
+        except Exception as e:
+            import traceback
+            print(f"Error generating summary: {str(e)}")
+            print(traceback.format_exc())
+            return {
+                "overview": "Clinical summary unavailable. Please refer to the consultation transcript for complete details of the assessment and treatment plan provided.",
+                "recommendations": [
+                    "Follow the treatment plan and recommendations discussed during your consultation",
+                    "Monitor your symptoms and track any changes or new developments",
+                    "Maintain proper rest, hydration, and nutrition to support recovery",
+                    "Seek immediate care if you experience severe or worsening symptoms"
+                ]
+            }
 
-IMPORTANT: Pay attention to the patient's age group in the transcript. Tailor your diagnosis to age-appropriate conditions.
-- Teenagers: posture issues, stress, growth-related
-- Young adults: lifestyle, work stress, ergonomics
-- Middle-aged: chronic conditions, preventive care
-- Seniors/Elderly: age-related degeneration, medication considerations
+    async def _generate_structured_summary(
+        self,
+        formatted_conversation: str,
+        previous: Optional[Dict] = None
+    ) -> Optional[Dict[str, any]]:
+        """
+        Overview and recommendations from a single JSON generation
 
-TONE: Professional but clear. Write like you're documenting in a medical chart for another healthcare provider.
-FORMAT: Plain text only. NO markdown, NO asterisks, NO special formatting. Write in complete sentences.
+        Args:
+            formatted_conversation: Transcript to summarize
+            previous: Summary of the consultation before this transcript; the
+                transcript is then only the new exchanges to fold in
 
-Consultation Transcript:
-{formatted_conversation}
+        Returns:
+            Summary dict, or None if the reply was blocked or failed validation
+        """
+        if previous is None:
+            prompt = f"""Consultation Transcript:
+{formatted_conversation}"""
+        else:
+            prompt = f"""Current summary:
+{json.dumps(previous)}
+
+New exchanges since that summary:
+{formatted_conversation}"""
+
+        response = await self.summary_upstream.call(
+            lambda: self._generate(self.structured_summary_model, prompt)
+        )
 
-Clinical Summary:"""
+        try:
+            summary = SummaryData.model_validate_json(response.text)
+        except (IndexError, AttributeError, ValueError) as e:
+            # ValueError covers both blocked replies and pydantic ValidationError
+            print(f"Structured summary rejected: {str(e)[:200]}")
+            return None
+
+        recommendations = [item.strip() for item in summary.recommendations if item.strip()]
+        overview = summary.overview.strip()
+        if not overview or not recommendations:
+            print("Structured summary rejected: empty overview or recommendations")
+            return None
+
+        return {
+            "overview": overview,
+            "recommendations": recommendations
+        }
 
-            # Build prompt for recommendations
-            recommendations_prompt = f"""You are an experienced physician creating a treatment plan based on this consultation.
+    def schedule_summary_refresh(self, session: ConversationSession):
+        """
+        Fold the session's latest exchanges into its rolling summary
 
-Provide 4-5 specific, actionable recommendations that cover:
-- Medications (with dosages and frequency if applicable)
-- Lifestyle modifications or home remedies (age-appropriate)
-- Symptom monitoring or warning signs to watch for
-- Follow-up timeline or when to seek additional care
-- Preventive measures for the future
+        Runs in the background so the reply isn't held up. Only one refresh
+        runs per session; exchanges that arrive meanwhile are picked up by
+        the same task before it finishes.
+        """
+        if not session.unsummarized:
+            return
+        if session.summary_task is not None and not session.summary_task.done():
+            return
+        session.summary_task = asyncio.create_task(self._refresh_summary(session))
+
+    async def _refresh_summary(self, session: ConversationSession):
+        """Background loop behind schedule_summary_refresh"""
+        while session.unsummarized:
+            messages = session.unsummarized
+            session.unsummarized = []
+            session.summarizing = messages
+            try:
+                summary = await self._generate_structured_summary(
+                    self._format_transcript(messages), previous=session.summary
+                )
+            except Exception as e:
+                print(f"Rolling summary failed for {session.session_id}: {str(e)}")
+                summary = None
+            finally:
+                session.summarizing = []
+
+            if summary is None:
+                # Leave the exchanges for the next refresh (or for insights to summarize in full)
+                session.unsummarized = messages + session.unsummarized
+                return
+            session.summary = summary
+            self.sessions.save(session, "summary")
+            print(f"📝 Rolling summary updated for {session.session_id}")
+
+    async def get_session_summary(self, session_id: Optional[str]) -> Optional[Dict[str, any]]:
+        """
+        Up-to-date summary for an ongoing or just-ended consultation
 
-REQUIREMENTS:
-- Be specific and detailed (e.g., "Take 400mg ibuprofen every 6 hours" not just "Take pain medication")
-- Show medical expertise in your recommendations
-- TAILOR recommendations to patient's age group (check transcript for age context)
-- Each recommendation should be practical and immediately actionable
-- Write in plain text, NO markdown, NO asterisks, NO bold text
-- Start each recommendation naturally (e.g., "Take...", "Apply...", "Monitor for...", "Follow up if...")
-- Separate each recommendation with a line break
-- Write with confidence - you're the doctor giving clear instructions
+        Waits for an in-flight refresh (up to SUMMARY_WAIT_SECONDS) and
+        summarizes the session history in full if the rolling summary is
+        missing or behind.
 
-AGE-SPECIFIC CONSIDERATIONS:
-- Teenagers: Focus on posture correction, stress management, sleep hygiene, screen time
-- Young adults: Ergonomics, work-life balance, exercise routines, hydration
-- Middle-aged: Preventive screening, chronic disease management, stress reduction
-- Seniors/Elderly: Medication safety, fall prevention, mobility aids, regular monitoring
+        Returns:
+            Summary dict, or None if the session is unknown or empty
+        """
+        session = await self.sessions.get(session_id)
+        if session is None or not session.conversation_history:
+            return None
 
-Consultation Transcript:
+        task = session.summary_task
+        if task is not None and not task.done():
+            try:
+                await asyncio.wait_for(asyncio.shield(task), self.summary_wait_seconds)
+            except asyncio.TimeoutError:
+                print(f"Rolling summary still running for {session.session_id} - summarizing in full")
+
+        if session.summary is not None and not session.unsummarized:
+            return session.summary
+        return await self.generate_summary(session.history())
+
+    async def _generate_parallel_summary(self, formatted_conversation: str) -> Dict[str, any]:
+        """Overview and recommendations from two plain-text prompts run concurrently"""
+        overview_prompt = f"""Consultation Transcript:
+{formatted_conversation}
+
+Clinical Summary:"""
+
+        recommendations_prompt = f"""Consultation Transcript:
 {formatted_conversation}
 
 Treatment Plan:"""
 
-            # Generate both summaries
-            overview_response = self.summary_model.generate_content(overview_prompt)
-            recommendations_response = self.summary_model.generate_content(recommendations_prompt)
-            
-            # Extract text safely
-            try:
-                overview = overview_response.text.strip()
-            except (IndexError, AttributeError):
-                print(f"Overview generation blocked. Candidates: {overview_response.candidates}")
-                overview = "Patient presented with health concerns that were assessed during this consultation. Clinical evaluation and recommendations were provided based on reported symptoms."
-            
-            try:
-                recommendations_text = recommendations_response.text.strip()
-                # Parse recommendations into list - split by line breaks
-                recommendations = []
-                for line in recommendations_text.split('\n'):
-                    line = line.strip()
-                    # Remove any markdown formatting that might slip through
-                    line = line.replace('**', '').replace('*', '').replace('##', '').replace('#', '')
-                    # Remove numbering/bullets if present
-                    if line and len(line) > 3:  # Ignore very short lines
-                        # Remove common prefixes
-                        for prefix in ['1.', '2.', '3.', '4.', '5.', '-', '•', '●']:
-                            if line.startswith(prefix):
-                                line = line[len(prefix):].strip()
-                        if line:
-                            recommendations.append(line)
-            except (IndexError, AttributeError):
-                print(f"Recommendations generation blocked. Candidates: {recommendations_response.candidates}")
-                recommendations = [
-                    "Follow the treatment plan discussed during your consultation",
-                    "Monitor your symptoms closely and note any changes in severity or new symptoms",
-                    "Maintain adequate hydration, rest, and nutrition to support recovery",
-                    "Contact for follow-up if symptoms worsen or don't improve within the expected timeframe"
-                ]
-            
-            return {
-                "overview": overview,
-                "recommendations": recommendations
-            }
+        # Both prompts share the transcript but not each other's output
+        overview_response, recommendations_response = await asyncio.gather(
+            self._generate_summary_part(self.overview_model, overview_prompt),
+            self._generate_summary_part(self.recommendations_model, recommendations_prompt)
+        )
 
-        except Exception as e:
-            import traceback
-            print(f"Error generating summary: {str(e)}")
-            print(traceback.format_exc())
-            return {
-                "overview": "Clinical summary unavailable. Please refer to the consultation transcript for complete details of the assessment and treatment plan provided.",
-                "recommendations": [
-                    "Follow the treatment plan and recommendations discussed during your consultation",
-                    "Monitor your symptoms and track any changes or new developments",
-                    "Maintain proper rest, hydration, and nutrition to support recovery",
-                    "Seek immediate care if you experience severe or worsening symptoms"
-                ]
-            }
+        # Extract text safely
+        try:
+            overview = overview_response.text.strip()
+        except (IndexError, AttributeError, ValueError):
+            print(f"Overview generation blocked. Candidates: {overview_response.candidates}")
+            overview = "Patient presented with health concerns that were assessed during this consultation. Clinical evaluation and recommendations were provided based on reported symptoms."
 
-    def _build_prompt(
+        try:
+            recommendations = self._parse_recommendations(recommendations_response.text)
+        except (IndexError, AttributeError, ValueError):
+            print(f"Recommendations generation blocked. Candidates: {recommendations_response.candidates}")
+            recommendations = [
+                "Follow the treatment plan discussed during your consultation",
+                "Monitor your symptoms closely and note any changes in severity or new symptoms",
+                "Maintain adequate hydration, rest, and nutrition to support recovery",
+                "Contact for follow-up if symptoms worsen or don't improve within the expected timeframe"
+            ]
+
+        return {
+            "overview": overview,
+            "recommendations": recommendations
+        }
+
+    async def _generate_summary_part(self, model, prompt: str):
+        """One plain-text summary generation (each takes its own limiter slot)"""
+        return await self.summary_upstream.call(lambda: self._generate(model, prompt))
+
+    async def _generate(self, model, contents):
+        """One generate_content call under the concurrency limiter"""
+        async with self._limiter:
+            return await model.generate_content_async(contents)
+
+    def _format_transcript(self, conversation: List[Dict]) -> str:
+        """Render conversation messages as Patient/Doctor lines"""
+        conversation_text = []
+        for msg in conversation:
+            # Handle both dict and object formats
+            role = "Patient" if (msg.get("role") if isinstance(msg, dict) else msg.role) == "user" else "Doctor"
+            content = msg.get("content") if isinstance(msg, dict) else msg.content
+            conversation_text.append(f"{role}: {content}")
+        return "\n".join(conversation_text)
+
+    def _parse_recommendations(self, recommendations_text: str) -> List[str]:
+        """Split a plain-text treatment plan into recommendations"""
+        recommendations = []
+        for line in recommendations_text.strip().split('\n'):
+            line = line.strip()
+            # Remove any markdown formatting that might slip through
+            line = line.replace('**', '').replace('*', '').replace('##', '').replace('#', '')
+            # Remove numbering/bullets if present
+            if line and len(line) > 3:  # Ignore very short lines
+                # Remove common prefixes
+                for prefix in ['1.', '2.', '3.', '4.', '5.', '-', '•', '●']:
+                    if line.startswith(prefix):
+                        line = line[len(prefix):].strip()
+                if line:
+                    recommendations.append(line)
+        return recommendations
+
+    async def stream_response(
         self,
         message: str,
         emotion: str,
-        emotion_context: Optional[Dict] = None
-    ) -> str:
+        age: Optional[int] = None,
+        age_category: Optional[str] = None,
+        emotion_context: Optional[Dict] = None,
+        session_id: Optional[str] = None,
+        speculation: Optional[SpeculativeReply] = None
+    ) -> AsyncIterator[Dict[str, any]]:
+        """
+        Stream AI response as text deltas while Gemini is still generating
+
+        Args:
+            message: User's message text
+            emotion: Detected emotion (e.g., "happy", "sad", "anxious")
+            age: Detected age (e.g., 32)
+            age_category: Age category (e.g., "Young Adult", "Senior")
+            emotion_context: Additional emotion analysis context
+            session_id: Consultation identifier the message belongs to
+            speculation: Reply started early by speculate(); used and
+                committed if it answers this message's words, cancelled otherwise
+
+        Yields:
+            {"type": "delta", "text": ...} events, then one
+            {"type": "done", "text": ..., "followup_needed": ..., "should_end_consultation": ...}
+
+        If the consumer stops early (barge-in), the reply so far is recorded
+        as the doctor's answer, or the message is dropped from the chat if
+        nothing was said yet.
         """
-        Build prompt with emotion context
+        session = await self.sessions.get_or_create(session_id)
+        async with session.lock:
+            detector = EndConsultationDetector()
+            parts = []
+            emitted = False
+
+            if speculation is not None and not speculation.matches(session, message):
+                speculation.cancel()
+                speculation = None
+
+            # Chat history before this turn, to record a partial reply against
+            self._ensure_chat(session)
+            history = list(session.chat_session.history)
+            if speculation is not None:
+                contextual_message = speculation.contextual_message
+            else:
+                contextual_message = self._build_contextual_message(
+                    message, emotion, age, age_category, emotion_context, session.exchange_count
+                )
+
+            try:
+                if speculation is not None:
+                    # Answered with the previous turn's emotion; recorded under this one
+                    print(f"🔮 Speculative reply confirmed (built as {speculation.context['emotion']}, now {emotion})")
+                    chunks = speculation.chunks()
+                else:
+                    chunks = self._send_streaming(session, contextual_message)
+
+                async for text in chunks:
+                    parts.append(text)
+
+                    delta = detector.feed(text)
+                    if not emitted:
+                        delta = delta.lstrip()
+                    if delta:
+                        emitted = True
+                        yield {"type": "delta", "text": delta}
+
+                tail = detector.flush()
+                if tail.strip():
+                    emitted = True
+                    yield {"type": "delta", "text": tail}
+
+                if speculation is not None:
+                    speculation.commit(session, "".join(parts))
+                self.memory.compact(session)
+
+                response_text = "".join(parts).strip()
+                if not response_text:
+                    print("Streamed response was empty or blocked")
+                    response_text = random.choice(FALLBACK_RESPONSES)
+                    emitted = True
+                    yield {"type": "delta", "text": response_text}
+                else:
+                    print(f"✓ Streamed response from Gemini: {response_text[:80]}...")
+
+                result = self._finish_turn(session, message, response_text, emotion)
+
+            except (asyncio.CancelledError, GeneratorExit):
+                # Interrupted - keep what the patient already heard
+                self._record_partial_reply(
+                    session, message, contextual_message, history, "".join(parts) if emitted else "", emotion
+                )
+                raise
+
+            except Exception as e:
+                import traceback
+                print(f"Error streaming from Gemini API: {str(e)}")
+                if not isinstance(e, UpstreamUnavailable):
+                    print(traceback.format_exc())
+
+                # Keep what the patient already saw
+                result = self._record_partial_reply(
+                    session, message, contextual_message, history, "".join(parts) if emitted else "", emotion
+                )
+                if result is None:
+                    fallback = self._error_fallback(session)
+                    yield {"type": "delta", "text": fallback}
+                    result = {
+                        "text": fallback,
+                        "followup_needed": True,
+                        "should_end_consultation": False
+                    }
+                result["error"] = str(e)
+
+            yield {"type": "done", **result}
+
+    async def _send_streaming(
+        self,
+        session: ConversationSession,
+        contextual_message: str
+    ) -> AsyncIterator[str]:
+        """Send one turn to the session's chat and yield the reply text as it streams"""
+        async def stream_chunks():
+            response = await session.chat_session.send_message_async(contextual_message, stream=True)
+            async for chunk in response:
+                yield chunk
+
+        # Deadline on the first chunk and on each gap after it
+        async with self._limiter:
+            async for chunk in self.chat_upstream.stream(stream_chunks):
+                text = chunk_text(chunk)
+                if text:  # Skip empty or blocked chunks
+                    yield text
+
+    async def speculate(
+        self,
+        message: str,
+        context: Dict,
+        emotion_context: Optional[Dict] = None,
+        session_id: Optional[str] = None
+    ) -> Optional[SpeculativeReply]:
+        """
+        Start a reply to a partial transcript without touching the chat history
+
+        Pass the result to stream_response with the final message; it is only
+        committed if it still answers it.
 
         Args:
-            message: User message
-            emotion: Detected emotion
-            emotion_context: Additional context
+            message: Partial transcript
+            context: {"emotion", "age", "age_category"} expected for the turn
+            emotion_context: Mismatch analysis for the partial transcript
+            session_id: Consultation identifier
 
         Returns:
-            Formatted prompt string
+            The speculative reply, or None while the session's previous turn
+            is still running or Gemini's circuit is open
+        """
+        if self.breaker.is_open:
+            return None
+        session = await self.sessions.get_or_create(session_id)
+        if session.lock.locked():
+            return None
+        self._ensure_chat(session)
+
+        contextual_message = self._build_contextual_message(
+            message, context["emotion"], context.get("age"), context.get("age_category"),
+            emotion_context, session.exchange_count
+        )
+        return SpeculativeReply(self.model, self._limiter, self.chat_upstream, session, message, context, contextual_message)
+
+    def _finish_turn(
+        self,
+        session: ConversationSession,
+        message: str,
+        response_text: str,
+        emotion: str
+    ) -> Dict[str, any]:
+        """Strip the end tag, record the exchange and build the turn result"""
+        # Check if AI is signaling end of consultation
+        should_end = END_CONSULTATION_TAG in response_text
+        
+        # Remove the tag from the response text (don't show to user)
+        clean_response = response_text.replace(END_CONSULTATION_TAG, "").strip()
+
+        # Add to our history for tracking
+        session.add_to_history("user", message)
+        session.add_to_history("assistant", clean_response)
+        session.exchange_count += 1
+        session.record_emotion(emotion)
+
+        # Keep the insights summary current while the patient listens
+        if self.summary_precompute:
+            session.unsummarized.append({"role": "user", "content": message})
+            session.unsummarized.append({"role": "assistant", "content": clean_response})
+            self.schedule_summary_refresh(session)
+        self.sessions.save(session, "chat", "emotions", "summary")
+
+        # Determine if follow-up is needed
+        followup_needed = "?" in clean_response or session.exchange_count < 3
+
+        return {
+            "text": clean_response,
+            "followup_needed": followup_needed,
+            "should_end_consultation": should_end
+        }
+
+    def _record_partial_reply(
+        self,
+        session: ConversationSession,
+        message: str,
+        contextual_message: str,
+        history: List[Dict],
+        response_text: str,
+        emotion: str
+    ) -> Optional[Dict[str, any]]:
         """
-        # Start with system prompt
-        prompt_parts = [self.system_prompt]
+        Record a reply that stopped part way (interrupted or failed)
 
-        # Add conversation history if exists
-        if self.conversation_history:
-            prompt_parts.append("\n\nConversation history:")
-            for msg in self.conversation_history[-6:]:  # Keep last 6 messages for context
-                role = "Patient" if msg["role"] == "user" else "Doctor"
-                prompt_parts.append(f"{role}: {msg['content']}")
+        The chat history is rebuilt from its state before the turn, since a
+        broken stream leaves the chat with an unusable last response.
 
-        # Add emotion context
-        prompt_parts.append(f"\n\nCurrent patient emotion detected: {emotion}")
+        Returns:
+            The turn result, or None if nothing was sent yet (the message
+            is then dropped from the chat)
+        """
+        response_text = response_text.strip()
+        if not response_text:
+            session.chat_session.history = history
+            return None
+        session.chat_session.history = [
+            *history,
+            {"role": "user", "parts": [contextual_message]},
+            {"role": "model", "parts": [response_text]}
+        ]
+        self.memory.compact(session)
+        return self._finish_turn(session, message, response_text, emotion)
 
-        # Add emotion mismatch context if present
-        if emotion_context and emotion_context.get("mismatch_detected"):
-            prompt_parts.append(
-                f"Note: There's a mismatch between what the patient is saying and their facial expression. "
-                f"They appear {emotion} but their words suggest {emotion_context.get('text_sentiment', 'different feelings')}. "
-                f"Consider probing gently to understand their true feelings."
-            )
+    def _error_fallback(self, session: ConversationSession) -> str:
+        """Fallback reply when Gemini can't be reached"""
+        if session.exchange_count > 0:
+            return ERROR_FALLBACK_RESPONSE
+        return GREETING_FALLBACK_RESPONSE
 
-        # Add current message
-        prompt_parts.append(f"\n\nPatient: {message}")
-        prompt_parts.append("\nDoctor:")
+    def _start_chat(self, history: Optional[List[Dict]] = None):
+        """Start a Gemini chat (the system message is the model's system instruction)"""
+        return self.model.start_chat(history=history or [])
 
-        return "\n".join(prompt_parts)
+    def _ensure_chat(self, session: ConversationSession):
+        """Start the session's chat, continuing a history loaded from the session store"""
+        if session.chat_session is None:
+            session.chat_session = self._start_chat(session.restored_chat)
+            session.restored_chat = None
 
     def _build_contextual_message(
         self,
@@ -427,7 +929,8 @@ Treatment Plan:"""
         emotion: str,
         age: Optional[int] = None,
         age_category: Optional[str] = None,
-        emotion_context: Optional[Dict] = None
+        emotion_context: Optional[Dict] = None,
+        exchange_count: int = 0
     ) -> str:
         """
         Build a message with emotion and age context for better AI understanding
@@ -438,6 +941,7 @@ Treatment Plan:"""
             age: Detected age
             age_category: Age category (e.g., "Young Adult", "Senior")
             emotion_context: Mismatch analysis from EmotionAnalyzer
+            exchange_count: Exchanges completed so far in this consultation
             
         Returns:
             Contextual message string
@@ -456,7 +960,6 @@ Treatment Plan:"""
         parts.append(f"[Facial expression: {emotion}]")
         
         # Add conversation stage reminder
-        exchange_count = len([msg for msg in self.conversation_history if msg["role"] == "user"])
         if exchange_count >= 2:
             parts.append(f"[This is exchange #{exchange_count + 1}. You should provide assessment and advice now, not just more questions.]")
         
@@ -501,10 +1004,3 @@ Treatment Plan:"""
             "Elderly": "CRITICAL: Age-specific diagnosis required. Most likely causes: multiple chronic conditions, medication interactions, reduced healing capacity, balance issues, cognitive factors. Be extra thorough about medication review and consider caregiver involvement."
         }
         return age_guidance_map.get(age_category, "")
-    
-    def _add_to_history(self, role: str, content: str):
-        """Add message to conversation history"""
-        self.conversation_history.append({
-            "role": role,
-            "content": content
-        })
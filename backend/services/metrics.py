@@ -0,0 +1,202 @@
+"""
+Turn metrics - where each conversation turn's time goes
+
+A TurnTrace is created per turn with the id the client sent (X-Turn-Id
+header, or "turn_id" on the call socket), so a slow turn in the browser
+console or the server log can be matched to the other side. Stage times
+are exported as Prometheus histograms at /metrics; the client's own
+milestones arrive through the /api/metrics/client beacon.
+
+With several workers set PROMETHEUS_MULTIPROC_DIR so /metrics aggregates
+across them.
+"""
+import os
+import re
+import time
+import uuid
+from contextlib import contextmanager
+from typing import AsyncIterator, Dict, List, Optional, Tuple
+
+from prometheus_client import (
+    CONTENT_TYPE_LATEST,
+    REGISTRY,
+    CollectorRegistry,
+    Counter,
+    Histogram,
+    generate_latest,
+)
+
+
+# Server-side stages of a turn (seconds)
+SERVER_STAGES = ("stt", "sentiment", "gemini_ttft", "gemini_total", "tts_ttfb", "tts_total", "turn_total")
+
+# Client milestones, measured from the end of the patient's speech
+CLIENT_STAGES = ("recording_end", "transcript", "first_text", "first_audio", "decode", "playback_start")
+
+# Client frame-time samples
+CLIENT_SAMPLES = ("face_detection", "avatar_frame")
+
+TRANSPORTS = ("rest", "call")
+
+TURN_BUCKETS = (0.025, 0.05, 0.1, 0.25, 0.5, 0.75, 1.0, 1.5, 2.0, 3.0, 5.0, 8.0, 13.0, 20.0, 30.0)
+FRAME_BUCKETS = (0.002, 0.004, 0.008, 0.016, 0.033, 0.05, 0.1, 0.2, 0.5, 1.0)
+
+TURN_STAGE_SECONDS = Histogram(
+    "auralis_turn_stage_seconds",
+    "Server time spent in each stage of a conversation turn",
+    ["stage", "transport"],
+    buckets=TURN_BUCKETS
+)
+CLIENT_STAGE_SECONDS = Histogram(
+    "auralis_client_turn_stage_seconds",
+    "Client time from end of speech to each turn milestone",
+    ["stage", "transport"],
+    buckets=TURN_BUCKETS
+)
+CLIENT_FRAME_SECONDS = Histogram(
+    "auralis_client_frame_seconds",
+    "Client face-detection and avatar frame times",
+    ["kind"],
+    buckets=FRAME_BUCKETS
+)
+
+SENTIMENT_QUEUE_SECONDS = Histogram(
+    "auralis_sentiment_queue_seconds",
+    "Time a message waited for a sentiment thread",
+    buckets=(0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0)
+)
+SENTIMENT_OVER_BUDGET = Counter(
+    "auralis_sentiment_over_budget_total",
+    "Turns that went ahead without mismatch context (SENTIMENT_BUDGET_MS ran out)"
+)
+SPECULATION_OUTCOMES = Counter(
+    "auralis_speculative_replies_total",
+    "Speculative replies handed to a call turn, by whether the turn used them",
+    ["outcome"]
+)
+
+_TURN_ID = re.compile(r"[\w-]{1,64}")
+
+# Client values outside this range are dropped (clock glitches, backgrounded tabs)
+MAX_CLIENT_MS = 120000
+
+
+def clean_turn_id(turn_id: Optional[str]) -> str:
+    """The client's turn id if well-formed, otherwise a new one"""
+    if turn_id and _TURN_ID.fullmatch(turn_id):
+        return turn_id
+    return uuid.uuid4().hex[:12]
+
+
+class TurnTrace:
+    """Stage timings for one turn"""
+
+    def __init__(self, turn_id: Optional[str] = None, transport: str = "rest"):
+        """
+        Start timing a turn
+
+        Args:
+            turn_id: Id from the client (a new one is made if missing)
+            transport: "rest" or "call"
+        """
+        self.turn_id = clean_turn_id(turn_id)
+        self.transport = transport
+        self.started = time.perf_counter()
+        self.stages: Dict[str, float] = {}
+        self._finished = False
+
+    def observe(self, stage: str, seconds: float):
+        """Record a stage (name from SERVER_STAGES)"""
+        self.stages[stage] = seconds
+        TURN_STAGE_SECONDS.labels(stage, self.transport).observe(seconds)
+
+    def elapsed(self) -> float:
+        """Seconds since the trace started"""
+        return time.perf_counter() - self.started
+
+    @contextmanager
+    def stage(self, name: str):
+        """Time the enclosed block as one stage"""
+        started = time.perf_counter()
+        try:
+            yield
+        finally:
+            self.observe(name, time.perf_counter() - started)
+
+    def finish(self):
+        """Record the turn's total and log its breakdown (once)"""
+        if self._finished:
+            return
+        self._finished = True
+        self.observe("turn_total", self.elapsed())
+        breakdown = ", ".join(f"{stage} {seconds * 1000:.0f}ms" for stage, seconds in self.stages.items())
+        print(f"⏱️ Turn {self.turn_id} ({self.transport}): {breakdown}")
+
+
+async def traced_events(events: AsyncIterator[Dict], trace: Optional[TurnTrace]) -> AsyncIterator[Dict]:
+    """
+    Pass GeminiService.stream_response events through, timing Gemini
+
+    Records gemini_ttft at the first text delta and gemini_total at the
+    done event, both from when the events are first requested.
+    """
+    if trace is None:
+        async for event in events:
+            yield event
+        return
+
+    started = time.perf_counter()
+    first = True
+    async for event in events:
+        if event["type"] == "delta" and first:
+            first = False
+            trace.observe("gemini_ttft", time.perf_counter() - started)
+        elif event["type"] == "done":
+            trace.observe("gemini_total", time.perf_counter() - started)
+        yield event
+
+
+def record_client_beacon(
+    transport: str,
+    stages: Dict[str, float],
+    samples: Dict[str, List[float]]
+) -> int:
+    """
+    Add a client beacon to the histograms
+
+    Unknown stage or sample names and out-of-range values are ignored so
+    clients can't grow the label set.
+
+    Args:
+        transport: "rest" or "call"
+        stages: Milliseconds from end of speech, by CLIENT_STAGES name
+        samples: Frame times in milliseconds, by CLIENT_SAMPLES kind
+
+    Returns:
+        Number of values recorded
+    """
+    transport = transport if transport in TRANSPORTS else "rest"
+    recorded = 0
+    for stage, ms in stages.items():
+        if stage in CLIENT_STAGES and 0 <= ms <= MAX_CLIENT_MS:
+            CLIENT_STAGE_SECONDS.labels(stage, transport).observe(ms / 1000)
+            recorded += 1
+    for kind, values in samples.items():
+        if kind not in CLIENT_SAMPLES:
+            continue
+        for ms in values:
+            if 0 <= ms <= MAX_CLIENT_MS:
+                CLIENT_FRAME_SECONDS.labels(kind).observe(ms / 1000)
+                recorded += 1
+    return recorded
+
+
+def render_metrics() -> Tuple[bytes, str]:
+    """Prometheus exposition of this worker (or all workers in multiprocess mode)"""
+    if os.getenv("PROMETHEUS_MULTIPROC_DIR"):
+        from prometheus_client import multiprocess
+
+        registry = CollectorRegistry()
+        multiprocess.MultiProcessCollector(registry)
+        return generate_latest(registry), CONTENT_TYPE_LATEST
+    return generate_latest(REGISTRY), CONTENT_TYPE_LATEST
@@ -0,0 +1,380 @@
+"""
+Upstream resilience - deadlines, hedged requests and circuit breakers
+
+Every Gemini and ElevenLabs request goes through an Upstream:
+
+- Deadline: the call (or, for streams, each chunk) must arrive within the
+  upstream's timeout, otherwise UpstreamTimeout is raised.
+- Hedging: if a call is still running after the upstream's recent
+  percentile latency (or fails outright), a secondary request - e.g. the
+  same prompt on a faster model - is started and the first success wins.
+- Circuit breaker: after consecutive failures the provider is skipped for a
+  cool-down, so callers switch to cached audio or fallback text right away
+  instead of waiting on each request to time out. Only errors that say the
+  provider is unhealthy count (see is_upstream_failure); a request the
+  provider rejected (4xx) does not.
+
+Counters and latency percentiles per upstream are available from
+upstream_stats() (reported by /health).
+"""
+import os
+import time
+import asyncio
+from collections import deque
+from typing import AsyncIterator, Awaitable, Callable, Deque, Dict, List, Optional
+
+
+class UpstreamUnavailable(Exception):
+    """The provider can't answer right now (callers should fall back)"""
+
+
+class UpstreamTimeout(UpstreamUnavailable):
+    """The call missed its deadline"""
+
+
+class CircuitOpenError(UpstreamUnavailable):
+    """The provider's circuit is open - the call was not attempted"""
+
+
+# Statuses that mean the provider, not the request, is at fault
+UPSTREAM_FAILURE_STATUSES = {408, 429}
+
+
+def _status_code(error: BaseException) -> Optional[int]:
+    """HTTP status carried by an SDK error (ElevenLabs, google-api-core, httpx)"""
+    for value in (
+        getattr(error, "status_code", None),
+        getattr(error, "code", None),
+        getattr(getattr(error, "response", None), "status_code", None),
+    ):
+        if isinstance(value, int) and 100 <= value < 600:
+            return value
+    return None
+
+
+def is_upstream_failure(error: BaseException) -> bool:
+    """
+    Whether an error counts toward the provider's circuit breaker
+
+    Timeouts, connection errors, 5xx and 429 do. Other 4xx (bad input, an
+    unknown voice, a blocked prompt) and errors without a status are the
+    request's own problem: the provider answered, so it is healthy.
+
+    Args:
+        error: Exception raised by the request
+
+    Returns:
+        True if the provider should be considered failing
+    """
+    if isinstance(error, (asyncio.TimeoutError, ConnectionError)):
+        return True
+    status = _status_code(error)
+    if status is not None:
+        return status >= 500 or status in UPSTREAM_FAILURE_STATUSES
+    # httpx connect/read/protocol errors, matched by name so httpx isn't imported here
+    return any(cls.__name__ == "TransportError" for cls in type(error).__mro__)
+
+
+class CircuitBreaker:
+    """
+    Consecutive-failure breaker shared by all calls to one provider
+
+    Opens after failure_threshold failures in a row. While open, calls are
+    rejected; every reset_seconds one call is let through as a probe, and
+    its success closes the circuit again.
+    """
+
+    def __init__(
+        self,
+        name: str,
+        failure_threshold: Optional[int] = None,
+        reset_seconds: Optional[float] = None
+    ):
+        """
+        Initialize breaker (closed)
+
+        Args:
+            name: Provider name, used in logs
+            failure_threshold: Failures in a row that open it (UPSTREAM_BREAKER_FAILURES)
+            reset_seconds: Time between probes while open (UPSTREAM_BREAKER_RESET_SECONDS)
+        """
+        self.name = name
+        self.failure_threshold = failure_threshold if failure_threshold is not None else int(os.getenv("UPSTREAM_BREAKER_FAILURES", "5"))
+        self.reset_seconds = reset_seconds if reset_seconds is not None else float(os.getenv("UPSTREAM_BREAKER_RESET_SECONDS", "30"))
+        self.failures = 0
+        self.opened_count = 0
+        self._opened_at: Optional[float] = None
+
+    @property
+    def state(self) -> str:
+        """"closed", "open" or "half_open" (a probe is due)"""
+        if self._opened_at is None:
+            return "closed"
+        if time.monotonic() - self._opened_at >= self.reset_seconds:
+            return "half_open"
+        return "open"
+
+    @property
+    def is_open(self) -> bool:
+        """Whether calls are being rejected right now"""
+        return self.state == "open"
+
+    def allow(self) -> bool:
+        """Whether a call may go ahead (takes the probe slot when half-open)"""
+        state = self.state
+        if state == "half_open":
+            # One probe per reset window; the next one waits for another window
+            self._opened_at = time.monotonic()
+            return True
+        return state == "closed"
+
+    def record_success(self):
+        if self._opened_at is not None:
+            print(f"✓ {self.name} circuit closed")
+        self.failures = 0
+        self._opened_at = None
+
+    def record_failure(self):
+        self.failures += 1
+        probe_failed = self._opened_at is not None
+        if probe_failed or self.failures >= self.failure_threshold:
+            if not probe_failed:
+                self.opened_count += 1
+                print(f"⚠️ {self.name} circuit open after {self.failures} failures")
+            self._opened_at = time.monotonic()
+
+
+class LatencyWindow:
+    """Latencies of the most recent primary requests"""
+
+    def __init__(self, size: int = 256):
+        self._samples: Deque[float] = deque(maxlen=size)
+
+    def add(self, seconds: float):
+        self._samples.append(seconds)
+
+    def percentile(self, p: float) -> Optional[float]:
+        """p-th percentile in seconds (None without samples)"""
+        if not self._samples:
+            return None
+        ordered = sorted(self._samples)
+        index = min(len(ordered) - 1, int(len(ordered) * p / 100))
+        return ordered[index]
+
+    def __len__(self) -> int:
+        return len(self._samples)
+
+
+# Every Upstream created in this process, for upstream_stats()
+_UPSTREAMS: List["Upstream"] = []
+
+
+class Upstream:
+    """One kind of call to a provider (e.g. Gemini chat), with its own deadline and latency stats"""
+
+    def __init__(
+        self,
+        name: str,
+        breaker: CircuitBreaker,
+        timeout_seconds: float,
+        hedge_percentile: Optional[float] = None,
+        hedge_after_seconds: Optional[float] = None,
+        hedge_min_samples: Optional[int] = None
+    ):
+        """
+        Initialize upstream
+
+        Args:
+            name: Metric name, e.g. "gemini.chat"
+            breaker: Provider's circuit breaker (shared between its upstreams)
+            timeout_seconds: Deadline per call, or per chunk for streams
+            hedge_percentile: Start the hedge once a call runs longer than
+                this percentile of recent latencies (UPSTREAM_HEDGE_PERCENTILE)
+            hedge_after_seconds: Hedge delay until enough latencies are known;
+                None hedges only when the primary call fails
+            hedge_min_samples: Latencies needed before the percentile is used
+                (UPSTREAM_HEDGE_MIN_SAMPLES)
+        """
+        self.name = name
+        self.breaker = breaker
+        self.timeout_seconds = timeout_seconds
+        self.hedge_percentile = hedge_percentile if hedge_percentile is not None else float(os.getenv("UPSTREAM_HEDGE_PERCENTILE", "95"))
+        self.hedge_after_seconds = hedge_after_seconds
+        self.hedge_min_samples = hedge_min_samples if hedge_min_samples is not None else int(os.getenv("UPSTREAM_HEDGE_MIN_SAMPLES", "20"))
+        self.latency = LatencyWindow()
+        self.counters = {
+            "calls": 0,
+            "failures": 0,
+            "client_errors": 0,  # Rejected by the provider (4xx) - not counted by the breaker
+            "timeouts": 0,
+            "rejected": 0,  # Short-circuited while the breaker was open
+            "hedges": 0,
+            "hedge_wins": 0,
+        }
+        _UPSTREAMS.append(self)
+
+    def hedge_delay(self) -> Optional[float]:
+        """How long the primary call runs before the hedge starts"""
+        if len(self.latency) < self.hedge_min_samples:
+            return self.hedge_after_seconds
+        return self.latency.percentile(self.hedge_percentile)
+
+    async def call(
+        self,
+        primary: Callable[[], Awaitable],
+        hedge: Optional[Callable[[], Awaitable]] = None,
+        timeout: Optional[float] = None
+    ):
+        """
+        Run a request under the deadline and breaker, hedging if it is slow
+
+        Args:
+            primary: Starts the request
+            hedge: Starts the secondary request (must be safe to run alongside primary)
+            timeout: Deadline override in seconds
+
+        Returns:
+            The first successful result
+
+        Raises:
+            CircuitOpenError, UpstreamTimeout, or the request's own error
+        """
+        self._admit()
+        timeout = timeout if timeout is not None else self.timeout_seconds
+        try:
+            result = await asyncio.wait_for(self._race(primary, hedge), timeout)
+        except asyncio.TimeoutError:
+            self._failed("timeouts")
+            raise UpstreamTimeout(f"{self.name} timed out after {timeout:.1f}s") from None
+        except Exception as e:
+            self._errored(e)
+            raise
+        self._succeeded()
+        return result
+
+    async def stream(
+        self,
+        open_stream: Callable[[], AsyncIterator],
+        timeout: Optional[float] = None
+    ) -> AsyncIterator:
+        """
+        Relay a streamed response under the deadline and breaker
+
+        The deadline applies to the first item and to every gap after it,
+        so a stalled stream fails instead of hanging. Latency is recorded
+        to the first item.
+
+        Args:
+            open_stream: Starts the request and returns its async iterator
+            timeout: Deadline override in seconds
+
+        Yields:
+            The stream's items
+        """
+        self._admit()
+        timeout = timeout if timeout is not None else self.timeout_seconds
+        started = time.monotonic()
+        iterator = open_stream().__aiter__()
+        first = True
+        try:
+            while True:
+                try:
+                    item = await asyncio.wait_for(iterator.__anext__(), timeout)
+                except StopAsyncIteration:
+                    if first:
+                        self._succeeded(time.monotonic() - started)
+                    return
+                except asyncio.TimeoutError:
+                    self._failed("timeouts")
+                    raise UpstreamTimeout(f"{self.name} stalled for {timeout:.1f}s") from None
+                except Exception as e:
+                    self._errored(e)
+                    raise
+                if first:
+                    first = False
+                    self._succeeded(time.monotonic() - started)
+                yield item
+        finally:
+            # Release the upstream connection if the caller stops early
+            close = getattr(iterator, "aclose", None)
+            if close is not None:
+                await close()
+
+    def stats(self) -> Dict[str, any]:
+        """Counters, latency percentiles (ms) and breaker state"""
+        latency_ms = {}
+        for p in (50, 95, 99):
+            value = self.latency.percentile(p)
+            latency_ms[f"p{p}"] = round(value * 1000) if value is not None else None
+        return {
+            **self.counters,
+            "latency_ms": latency_ms,
+            "circuit": self.breaker.state,
+        }
+
+    async def _race(self, primary: Callable[[], Awaitable], hedge: Optional[Callable[[], Awaitable]]):
+        """
+        Primary request, plus the hedge once it is slow or has failed
+
+        Only the primary's latency goes into the window, so hedge wins don't
+        pull the hedge delay down. When the hedge wins, the primary's time so
+        far is recorded: it would have taken at least that long.
+        """
+        started = time.monotonic()
+        first = asyncio.create_task(primary())
+        tasks = {first}
+        hedged = hedge is None
+        delay = self.hedge_delay() if hedge is not None else None
+        error: Optional[BaseException] = None
+        try:
+            while tasks:
+                done, _ = await asyncio.wait(
+                    tasks,
+                    timeout=None if hedged else delay,
+                    return_when=asyncio.FIRST_COMPLETED
+                )
+                for task in done:
+                    tasks.discard(task)
+                    if task.exception() is None:
+                        if task is not first:
+                            self.counters["hedge_wins"] += 1
+                        if task is first or first in tasks:
+                            self.latency.add(time.monotonic() - started)
+                        return task.result()
+                    error = task.exception()
+                if not hedged and (not done or not tasks):
+                    hedged = True
+                    self.counters["hedges"] += 1
+                    tasks.add(asyncio.create_task(hedge()))
+            raise error
+        finally:
+            for task in tasks:
+                task.cancel()
+
+    def _admit(self):
+        if not self.breaker.allow():
+            self.counters["rejected"] += 1
+            raise CircuitOpenError(f"{self.breaker.name} circuit open")
+        self.counters["calls"] += 1
+
+    def _succeeded(self, seconds: Optional[float] = None):
+        if seconds is not None:
+            self.latency.add(seconds)
+        self.breaker.record_success()
+
+    def _failed(self, counter: str):
+        self.counters[counter] += 1
+        self.breaker.record_failure()
+
+    def _errored(self, error: BaseException):
+        if is_upstream_failure(error):
+            self._failed("failures")
+        else:
+            # The provider answered - a probe like this closes the circuit
+            self.counters["client_errors"] += 1
+            self.breaker.record_success()
+
+
+def upstream_stats() -> Dict[str, Dict]:
+    """stats() of every upstream in this process, by name"""
+    return {upstream.name: upstream.stats() for upstream in _UPSTREAMS}
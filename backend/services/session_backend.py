@@ -0,0 +1,106 @@
+"""
+Session backends - external storage for consultation sessions
+
+SessionStore keeps sessions in worker memory. With SESSION_STORE=redis it
+also writes them to Redis, so any worker or replica can pick up a
+consultation (--workers N, several nodes behind a load balancer, no sticky
+sessions).
+
+Each session is one Redis hash: a JSON field per section ("chat",
+"summary", "emotions", "telemetry") and a "version" counter bumped on every
+write. Workers compare versions to tell whether their cached copy is
+current, and only write the sections that changed.
+
+Writes are check-and-set on the version: a write based on an outdated copy
+is refused, and SessionStore reloads the other sections before retrying.
+Consecutive requests for a consultation may hit any worker; if two workers
+change the same section concurrently, the later write wins.
+"""
+import os
+from typing import Dict, Optional
+
+
+class RedisSessionBackend:
+    """Consultation sessions in Redis hashes, expiring with the session TTL"""
+
+    def __init__(self, url: str, ttl_seconds: float, prefix: Optional[str] = None):
+        """
+        Initialize Redis backend (connects on first use)
+
+        Args:
+            url: Redis URL (REDIS_URL)
+            ttl_seconds: Idle time before Redis drops a session
+            prefix: Key prefix (SESSION_KEY_PREFIX)
+        """
+        # Imported here so the in-memory mode doesn't need the package
+        import redis.asyncio as redis
+
+        self.client = redis.from_url(url, decode_responses=True)
+        self.ttl_seconds = int(ttl_seconds)
+        self.prefix = prefix if prefix is not None else os.getenv("SESSION_KEY_PREFIX", "auralis:session:")
+
+    def _key(self, session_id: str) -> str:
+        return f"{self.prefix}{session_id}"
+
+    async def version(self, session_id: str) -> Optional[int]:
+        """Current version of a stored session, or None if it isn't stored"""
+        value = await self.client.hget(self._key(session_id), "version")
+        return int(value) if value is not None else None
+
+    async def load(self, session_id: str) -> Optional[Dict[str, str]]:
+        """All fields of a stored session (sections as JSON plus "version")"""
+        fields = await self.client.hgetall(self._key(session_id))
+        return fields or None
+
+    async def save(self, session_id: str, sections: Dict[str, str], expected_version: int) -> Optional[int]:
+        """
+        Write sections and bump the version, if no other worker wrote first
+
+        Args:
+            session_id: Consultation identifier
+            sections: Section name to JSON
+            expected_version: Version the sections were changed from (0 if not stored yet)
+
+        Returns:
+            The new version, or None if the stored version is not expected_version
+        """
+        from redis.exceptions import WatchError
+
+        key = self._key(session_id)
+        async with self.client.pipeline(transaction=True) as pipe:
+            try:
+                await pipe.watch(key)
+                stored = await pipe.hget(key, "version")
+                if int(stored or 0) != expected_version:
+                    return None
+                pipe.multi()
+                pipe.hset(key, mapping=sections)
+                pipe.hincrby(key, "version", 1)
+                pipe.expire(key, self.ttl_seconds)
+                _, version, _ = await pipe.execute()
+            except WatchError:
+                return None  # Written by another worker between the check and the write
+        return int(version)
+
+    async def delete(self, session_id: str):
+        """Remove a stored session"""
+        await self.client.delete(self._key(session_id))
+
+    async def close(self):
+        """Close the connection pool"""
+        await self.client.aclose()
+
+
+def create_session_backend(ttl_seconds: float) -> Optional[RedisSessionBackend]:
+    """
+    Backend selected by SESSION_STORE ("memory", the default, or "redis")
+
+    Returns:
+        RedisSessionBackend, or None to keep sessions in worker memory only
+    """
+    mode = os.getenv("SESSION_STORE", "memory").strip().lower()
+    if mode == "memory":
+        return None
+    if mode == "redis":
+        return RedisSessionBackend(os.getenv("REDIS_URL", "redis://localhost:6379/0"), ttl_seconds)
+    raise ValueError(f"Unknown SESSION_STORE: {mode}")
@@ -0,0 +1,365 @@
+"""
+Session store - keeps per-consultation conversation state in memory,
+optionally backed by an external store (see session_backend.py)
+"""
+import os
+import json
+import time
+import uuid
+import asyncio
+from collections import OrderedDict, deque
+from datetime import datetime, timezone
+from typing import Collection, Deque, Dict, List, Optional, Set
+from services.emotion_telemetry import EmotionAggregate
+from services.conversation_memory import content_role, content_text
+from services.session_backend import create_session_backend
+
+
+# Parts of a session written to the external store independently
+SESSION_SECTIONS = ("chat", "summary", "emotions", "telemetry")
+
+
+def new_session_id() -> str:
+    """Create an ID for a consultation the client didn't name"""
+    return uuid.uuid4().hex
+
+
+class ConversationSession:
+    """Conversation state for a single consultation"""
+
+    def __init__(self, session_id: str, max_history: int):
+        """
+        Initialize an empty consultation session
+
+        Args:
+            session_id: Client-provided consultation identifier
+            max_history: Maximum number of messages kept in history
+        """
+        self.session_id = session_id
+        self.chat_session = None  # Gemini chat, initialized on first message
+        self.conversation_history: Deque[Dict] = deque(maxlen=max_history)
+        self.exchange_count = 0  # Completed patient/doctor exchanges, including dropped ones
+        self.history_digest: Optional[str] = None  # Compacted older turns (see conversation_memory.py)
+        self.created_at = time.monotonic()
+        self.last_active = self.created_at
+        # Serializes turns so two requests for the same consultation don't interleave
+        self.lock = asyncio.Lock()
+
+        # Rolling clinical summary, refreshed in the background after each exchange
+        self.summary: Optional[Dict] = None
+        self.unsummarized: List[Dict] = []  # Messages the summary doesn't cover yet
+        self.summary_task: Optional[asyncio.Task] = None
+
+        # Facial emotion per patient turn, pre-aggregated for insights
+        self.emotion_timeline: Deque[Dict] = deque(maxlen=max_history)
+        self.emotion_counts: Dict[str, int] = {}
+        # Webcam telemetry batches from the client (every detection, aggregated)
+        self.emotion_telemetry = EmotionAggregate()
+
+        # External store bookkeeping: version this copy reflects, sections
+        # changed since the last write and sections being written now
+        self.version = 0
+        self.dirty: Set[str] = set()
+        self.saving: Set[str] = set()
+        # Messages the running summary refresh is folding in
+        self.summarizing: List[Dict] = []
+        # Gemini chat history loaded from the store; the chat is rebuilt from it
+        self.restored_chat: Optional[List[Dict]] = None
+
+    def touch(self):
+        """Mark the session as active now"""
+        self.last_active = time.monotonic()
+
+    def add_to_history(self, role: str, content: str):
+        """Add message to conversation history (oldest messages drop off)"""
+        self.conversation_history.append({
+            "role": role,
+            "content": content
+        })
+
+    def record_emotion(self, emotion: str):
+        """Count the patient's emotion for this turn and add it to the timeline"""
+        emotion = (emotion or "neutral").lower()
+        self.emotion_counts[emotion] = self.emotion_counts.get(emotion, 0) + 1
+        self.emotion_timeline.append({
+            "timestamp": datetime.now(timezone.utc).isoformat(),
+            "emotion": emotion
+        })
+
+    def history(self) -> List[Dict]:
+        """Snapshot of the conversation history"""
+        return list(self.conversation_history)
+
+    def chat_history(self) -> List[Dict]:
+        """Gemini chat history as plain {"role", "parts"} dicts"""
+        if self.chat_session is None:
+            return list(self.restored_chat or [])
+        return [
+            {"role": content_role(content), "parts": [content_text(content)]}
+            for content in self.chat_session.history
+        ]
+
+    def to_state(self, sections: Collection[str]) -> Dict[str, str]:
+        """
+        Serialize sections for the external store
+
+        Args:
+            sections: Names from SESSION_SECTIONS
+
+        Returns:
+            Section name to JSON
+        """
+        state = {}
+        if "chat" in sections:
+            state["chat"] = json.dumps({
+                "history": list(self.conversation_history),
+                "exchange_count": self.exchange_count,
+                "history_digest": self.history_digest,
+                "chat_history": self.chat_history()
+            })
+        if "summary" in sections:
+            state["summary"] = json.dumps({
+                "summary": self.summary,
+                # Messages under refresh aren't covered until it finishes
+                "unsummarized": self.summarizing + self.unsummarized
+            })
+        if "emotions" in sections:
+            state["emotions"] = json.dumps({
+                "timeline": list(self.emotion_timeline),
+                "counts": self.emotion_counts
+            })
+        if "telemetry" in sections:
+            state["telemetry"] = json.dumps(self.emotion_telemetry.to_state())
+        return state
+
+    def load_state(self, fields: Dict[str, str], skip: Collection[str] = ()):
+        """
+        Replace this copy's sections with stored ones
+
+        Args:
+            fields: Stored hash (section JSON plus "version")
+            skip: Sections with local changes not yet written, kept as they are
+        """
+        if "chat" in fields and "chat" not in skip:
+            chat = json.loads(fields["chat"])
+            self.conversation_history.clear()
+            self.conversation_history.extend(chat["history"])
+            self.exchange_count = chat["exchange_count"]
+            self.history_digest = chat["history_digest"]
+            # Rebuilt from the stored history on the next turn
+            self.chat_session = None
+            self.restored_chat = chat["chat_history"]
+        if "summary" in fields and "summary" not in skip:
+            summary = json.loads(fields["summary"])
+            self.summary = summary["summary"]
+            self.unsummarized = summary["unsummarized"]
+        if "emotions" in fields and "emotions" not in skip:
+            emotions = json.loads(fields["emotions"])
+            self.emotion_timeline.clear()
+            self.emotion_timeline.extend(emotions["timeline"])
+            self.emotion_counts = emotions["counts"]
+        if "telemetry" in fields and "telemetry" not in skip:
+            self.emotion_telemetry = EmotionAggregate.from_state(json.loads(fields["telemetry"]))
+        self.version = int(fields.get("version", 0))
+
+
+class SessionStore:
+    """
+    In-memory registry of consultation sessions
+
+    Sessions are kept in least-recently-used order. Sessions idle for longer
+    than the TTL are evicted on access, and the oldest session is dropped
+    whenever the store grows past its size cap.
+
+    With an external backend (SESSION_STORE=redis) the in-memory sessions
+    become a write-behind cache: changes are written shortly after each
+    save(), and a session is reloaded when another worker has written a
+    newer version, so consecutive requests may land on any worker. Writes
+    are check-and-set on the version (see session_backend.py).
+    """
+
+    def __init__(
+        self,
+        ttl_seconds: Optional[float] = None,
+        max_sessions: Optional[int] = None,
+        max_history: Optional[int] = None
+    ):
+        """
+        Initialize session store
+
+        Args:
+            ttl_seconds: Idle time before a session is evicted (SESSION_TTL_SECONDS)
+            max_sessions: Maximum sessions held per worker (SESSION_MAX_COUNT)
+            max_history: Maximum messages kept per session (SESSION_MAX_HISTORY)
+        """
+        self.ttl_seconds = ttl_seconds if ttl_seconds is not None else float(os.getenv("SESSION_TTL_SECONDS", "1800"))
+        self.max_sessions = max_sessions if max_sessions is not None else int(os.getenv("SESSION_MAX_COUNT", "500"))
+        self.max_history = max_history if max_history is not None else int(os.getenv("SESSION_MAX_HISTORY", "40"))
+        self._sessions: "OrderedDict[str, ConversationSession]" = OrderedDict()
+
+        # External store (None keeps sessions in this worker only)
+        self.backend = create_session_backend(self.ttl_seconds)
+        # Delay before changes are written, so a turn's saves go out together
+        self.write_behind_seconds = float(os.getenv("SESSION_WRITE_BEHIND_MS", "250")) / 1000
+        # Attempts per write when other workers keep writing the same session
+        self.write_attempts = 3
+        self._writes: Dict[str, asyncio.Task] = {}
+
+    async def get_or_create(self, session_id: Optional[str]) -> ConversationSession:
+        """
+        Get an existing session or create a new one
+
+        Args:
+            session_id: Consultation identifier (a new consultation is
+                started under a fresh ID when missing - clients read it
+                back from session.session_id)
+
+        Returns:
+            The session, marked as most recently used
+        """
+        session_id = session_id or new_session_id()
+        self._evict_expired()
+
+        # Another request may have created it while this one waited on the store
+        session = await self._refresh(session_id) or self._sessions.get(session_id)
+        if session is None:
+            session = ConversationSession(session_id, self.max_history)
+            self._sessions[session_id] = session
+            self._enforce_capacity(keep=session_id)
+        else:
+            self._sessions.move_to_end(session_id)
+
+        session.touch()
+        return session
+
+    async def get(self, session_id: Optional[str]) -> Optional[ConversationSession]:
+        """Get a session without creating it (None without a session ID)"""
+        if not session_id:
+            return None
+        self._evict_expired()
+        return await self._refresh(session_id)
+
+    def drop(self, session_id: str):
+        """Remove a session"""
+        self._sessions.pop(session_id, None)
+
+    def save(self, session: ConversationSession, *sections: str):
+        """
+        Queue changed sections for the external store (no-op in memory mode)
+
+        Args:
+            session: Session that changed
+            sections: Names from SESSION_SECTIONS (all of them if none given)
+        """
+        if self.backend is None:
+            return
+        session.dirty.update(sections or SESSION_SECTIONS)
+        task = self._writes.get(session.session_id)
+        if task is None or task.done():
+            self._writes[session.session_id] = asyncio.create_task(self._write_later(session))
+
+    async def close(self):
+        """Finish pending writes and disconnect (worker shutdown)"""
+        if self.backend is None:
+            return
+        await asyncio.gather(*self._writes.values(), return_exceptions=True)
+        self._writes.clear()
+        await self.backend.close()
+
+    async def _refresh(self, session_id: str) -> Optional[ConversationSession]:
+        """This worker's copy of a session, reloaded if the store has a newer one"""
+        session = self._sessions.get(session_id)
+        if self.backend is None:
+            return session
+
+        try:
+            version = await self.backend.version(session_id)
+            if version is None or (session is not None and version == session.version):
+                return session
+            if session is not None and session.lock.locked():
+                # A turn is running on this copy; it is written back when it ends
+                return session
+            fields = await self.backend.load(session_id)
+        except Exception as e:
+            print(f"⚠️ Session store unavailable, using local copy of {session_id}: {str(e)}")
+            return session
+
+        if not fields:
+            return session
+        if session is None:
+            session = ConversationSession(session_id, self.max_history)
+            self._sessions[session_id] = session
+            self._enforce_capacity(keep=session_id)
+        session.load_state(fields, skip=session.dirty | session.saving)
+        return session
+
+    async def _write_later(self, session: ConversationSession):
+        """Write-behind task started by save()"""
+        await asyncio.sleep(self.write_behind_seconds)
+        # Sections saved while a write is in flight go out in the next pass
+        while session.dirty:
+            sections, session.dirty = session.dirty, set()
+            session.saving = sections
+            try:
+                for _ in range(self.write_attempts):
+                    version = await self.backend.save(
+                        session.session_id, session.to_state(sections), session.version
+                    )
+                    if version is not None:
+                        session.version = version
+                        break
+                    # Another worker wrote first - take its other sections, keep ours
+                    await self._merge_stored(session, sections)
+                else:
+                    raise RuntimeError("version conflict")
+            except Exception as e:
+                print(f"⚠️ Session write failed for {session.session_id}: {str(e)}")
+                session.dirty |= sections  # Retried with the next save
+                return
+            finally:
+                session.saving = set()
+
+    async def _merge_stored(self, session: ConversationSession, sections: Set[str]):
+        """Load another worker's write into this copy, except the sections being written"""
+        fields = await self.backend.load(session.session_id) or {"version": "0"}
+        keep = sections | session.dirty
+        if session.lock.locked():
+            keep = keep | {"chat"}  # A turn is using the chat - it is written when it ends
+        session.load_state(fields, skip=keep)
+
+    def __len__(self) -> int:
+        return len(self._sessions)
+
+    def _evict_expired(self):
+        """Drop sessions idle longer than the TTL (oldest first)"""
+        now = time.monotonic()
+        for _ in range(len(self._sessions)):
+            oldest_id, oldest = next(iter(self._sessions.items()))
+            if now - oldest.last_active < self.ttl_seconds:
+                break
+            if oldest.lock.locked():
+                # A turn is still running on it - keep it for now
+                self._sessions.move_to_end(oldest_id)
+                continue
+            self._sessions.popitem(last=False)
+            print(f"Session expired: {oldest_id}")
+
+    def _enforce_capacity(self, keep: str):
+        """
+        Drop least recently used sessions beyond the size cap
+
+        Sessions with a turn running or changes not yet written are skipped,
+        so the store can stay over the cap until they are idle.
+
+        Args:
+            keep: Session being added (never evicted)
+        """
+        excess = len(self._sessions) - self.max_sessions
+        for session_id, session in list(self._sessions.items()):
+            if excess <= 0:
+                break
+            if session_id == keep or session.lock.locked() or session.dirty or session.saving:
+                continue
+            del self._sessions[session_id]
+            excess -= 1
+            print(f"Session evicted (capacity): {session_id}")
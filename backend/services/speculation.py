@@ -0,0 +1,253 @@
+"""
+Speculative replies - start Gemini on a stable partial transcript
+
+While the patient is still speaking, a partial transcript that stops
+changing (the patient paused) is usually the whole utterance. A reply is
+generated for it in the background, outside the chat session: the request
+is built from a snapshot of the chat history, so nothing is recorded until
+the reply is committed. If the final transcript matches, the buffered
+reply is used and committed to the history; otherwise it is cancelled and
+the turn runs normally.
+
+Only the words have to match. The guess is built with the previous turn's
+emotion, which the end-of-speech message usually updates; the reply then
+answers the words with slightly older emotion hints, and the turn is
+recorded under the final emotion. auralis_speculative_replies_total counts
+hits and misses.
+"""
+import os
+import re
+import asyncio
+from typing import AsyncIterator, Dict, List, Optional, Set
+
+
+_NOT_WORD = re.compile(r"[^\w\s']+")
+
+
+def normalize_transcript(text: str) -> str:
+    """Transcript comparison key (case, punctuation and spacing ignored)"""
+    return " ".join(_NOT_WORD.sub(" ", text.lower()).split())
+
+
+def chunk_text(chunk) -> str:
+    """Text of a streamed Gemini chunk ("" for empty or blocked chunks)"""
+    try:
+        return chunk.text
+    except (IndexError, AttributeError, ValueError):
+        return ""
+
+
+class SpeculativeReply:
+    """A reply generated ahead of the final transcript, not yet in the chat history"""
+
+    def __init__(
+        self,
+        model,
+        limiter: asyncio.Semaphore,
+        upstream,
+        session,
+        message: str,
+        context: Dict,
+        contextual_message: str
+    ):
+        """
+        Start generating
+
+        Args:
+            model: Chat GenerativeModel (system instruction included)
+            limiter: Gemini concurrency limiter (held while generating)
+            upstream: Chat Upstream (deadline and breaker, see resilience.py)
+            session: ConversationSession the reply is for
+            message: Partial transcript being answered
+            context: emotion/age/age_category the message was built with
+            contextual_message: Message sent to Gemini
+        """
+        self.model = model
+        self.limiter = limiter
+        self.upstream = upstream
+        self.message = message
+        self.key = normalize_transcript(message)
+        self.context = context
+        self.contextual_message = contextual_message
+        self.committed = False
+
+        # Snapshot the turn this reply continues from
+        self.chat_session = session.chat_session
+        self.history = list(session.chat_session.history)
+        self.exchange_count = session.exchange_count
+
+        self._chunks: List[str] = []
+        self._progress = asyncio.Event()
+        self._task = asyncio.create_task(self._generate())
+        # Failures of discarded guesses are expected - don't log them as unhandled
+        self._task.add_done_callback(lambda task: task.cancelled() or task.exception())
+
+    def matches(self, session, message: str) -> bool:
+        """Whether this reply answers the final message in the session's current state"""
+        return (
+            not (self._task.done() and (self._task.cancelled() or self._task.exception()))
+            and session.chat_session is self.chat_session
+            and session.exchange_count == self.exchange_count
+            and normalize_transcript(message) == self.key
+        )
+
+    async def chunks(self) -> AsyncIterator[str]:
+        """Text generated so far, then the rest as it arrives"""
+        index = 0
+        while True:
+            if index < len(self._chunks):
+                yield self._chunks[index]
+                index += 1
+                continue
+            if self._task.done():
+                break
+            self._progress.clear()
+            await self._progress.wait()
+
+        if self._task.cancelled():
+            raise RuntimeError("Speculative reply was cancelled")
+        error = self._task.exception()
+        if error is not None:
+            raise error
+
+    def commit(self, session, response_text: str):
+        """Record the exchange in the chat history, as send_message would have"""
+        session.chat_session.history = [
+            *self.history,
+            {"role": "user", "parts": [self.contextual_message]},
+            {"role": "model", "parts": [response_text]}
+        ]
+        self.committed = True
+
+    def cancel(self):
+        """Stop generating (the guess is discarded)"""
+        self._task.cancel()
+
+    async def _generate(self):
+        async def stream_chunks():
+            response = await self.model.generate_content_async(
+                [*self.history, {"role": "user", "parts": [self.contextual_message]}],
+                stream=True
+            )
+            async for chunk in response:
+                yield chunk
+
+        try:
+            # Same deadline and breaker as a regular turn
+            async with self.limiter:
+                async for chunk in self.upstream.stream(stream_chunks):
+                    text = chunk_text(chunk)
+                    if text:
+                        self._chunks.append(text)
+                        self._progress.set()
+        finally:
+            self._progress.set()
+
+
+class PartialSpeculator:
+    """
+    Decides when to speculate during one utterance
+
+    A reply is started once two consecutive partial transcripts agree (the
+    patient paused) and have at least SPECULATION_MIN_WORDS words. A later,
+    different stable partial replaces it. Starts are queued one at a time,
+    so a replaced guess is always cancelled.
+    """
+
+    def __init__(self, gemini_service, emotion_analyzer, min_words: Optional[int] = None):
+        """
+        Initialize speculator
+
+        Args:
+            gemini_service: GeminiService that generates the replies
+            emotion_analyzer: EmotionAnalyzer for the mismatch context
+            min_words: Shortest partial worth speculating on (SPECULATION_MIN_WORDS)
+        """
+        self.gemini_service = gemini_service
+        self.emotion_analyzer = emotion_analyzer
+        self.min_words = min_words if min_words is not None else int(os.getenv("SPECULATION_MIN_WORDS", "3"))
+        self._previous: Optional[str] = None
+        self._taken = False
+        self._lock = asyncio.Lock()
+        self._starts: Set[asyncio.Task] = set()
+        self.reply: Optional[SpeculativeReply] = None
+
+    def feed(self, text: str, session_id: Optional[str], context: Dict):
+        """
+        Feed a partial transcript without waiting for the reply to start
+
+        Partials are delivered before the final transcript is returned, so
+        awaiting the sentiment pass and session lookup here would hold up
+        the turn.
+
+        Args:
+            text: Transcript so far
+            session_id: Consultation identifier
+            context: emotion/age/age_category expected for the turn
+        """
+        task = asyncio.create_task(self._start(text, session_id, context))
+        self._starts.add(task)
+        task.add_done_callback(self._starts.discard)
+
+    async def _start(self, text: str, session_id: Optional[str], context: Dict):
+        try:
+            await self.on_partial(text, session_id, context)
+        except Exception as e:
+            print(f"Speculative reply not started: {str(e)}")
+
+    async def on_partial(self, text: str, session_id: Optional[str], context: Dict):
+        """
+        Feed a partial transcript
+
+        Args:
+            text: Transcript so far
+            session_id: Consultation identifier
+            context: emotion/age/age_category expected for the turn
+        """
+        if self._taken:
+            return
+        key = normalize_transcript(text)
+        stable = key == self._previous
+        self._previous = key
+        if not stable or len(key.split()) < self.min_words:
+            return
+
+        async with self._lock:
+            if self._taken or (self.reply is not None and self.reply.key == key):
+                return
+
+            self._discard()
+            emotion_context = await self.emotion_analyzer.analyze_mismatch_async(
+                message=text,
+                detected_emotion=context["emotion"]
+            )
+            self.reply = await self.gemini_service.speculate(
+                message=text,
+                context=context,
+                emotion_context=emotion_context,
+                session_id=session_id
+            )
+            if self.reply is None:
+                return
+            if self._taken:
+                # The utterance ended while this was starting
+                self._discard()
+                return
+            print(f"🔮 Speculating on: {text[:60]}")
+
+    def take(self) -> Optional[SpeculativeReply]:
+        """Hand the current reply to the turn (the turn commits or cancels it)"""
+        self._taken = True
+        reply, self.reply = self.reply, None
+        return reply
+
+    def cancel(self):
+        """Discard any reply in progress, and any still starting"""
+        for task in self._starts:
+            task.cancel()
+        self._discard()
+
+    def _discard(self):
+        if self.reply is not None:
+            self.reply.cancel()
+            self.reply = None
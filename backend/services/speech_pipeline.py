@@ -0,0 +1,210 @@
+"""
+Speech pipeline - speaks a streamed Gemini reply sentence by sentence
+"""
+import os
+import re
+import time
+import asyncio
+from typing import AsyncIterator, Dict, List, Optional, Tuple, Union
+
+from services.frames import FRAME_AUDIO, FRAME_DONE, FRAME_ERROR, FRAME_TEXT_DELTA, FRAME_VISEMES
+from services.resilience import CircuitOpenError
+from services.viseme import mp3_duration_ms, shift_timeline
+
+
+# Sentence end: terminal punctuation (plus closing quotes/brackets) followed by whitespace
+SENTENCE_END = re.compile(r"[.!?]+[\"')\]]*\s+")
+
+# Words ending in a period that don't end a sentence
+ABBREVIATIONS = {"dr.", "mr.", "mrs.", "ms.", "vs.", "e.g.", "i.e.", "etc.", "approx.", "st."}
+
+
+class SentenceSplitter:
+    """Splits streamed text into sentences as soon as each one is complete"""
+
+    def __init__(self, min_chars: Optional[int] = None):
+        """
+        Initialize splitter
+
+        Args:
+            min_chars: Sentences shorter than this are merged with the next one
+                so very short fragments don't each cost a TTS request
+        """
+        self.min_chars = min_chars if min_chars is not None else int(os.getenv("SPEECH_MIN_SENTENCE_CHARS", "24"))
+        self._buffer = ""
+
+    def feed(self, text: str) -> List[str]:
+        """
+        Add streamed text
+
+        Args:
+            text: Next text delta
+
+        Returns:
+            Sentences completed by this delta
+        """
+        self._buffer += text
+        sentences = []
+        start = 0
+
+        for match in SENTENCE_END.finditer(self._buffer):
+            candidate = self._buffer[start:match.end()].strip()
+            last_word = candidate.split()[-1].lower() if candidate else ""
+            if last_word in ABBREVIATIONS or len(candidate) < self.min_chars:
+                continue  # Keep growing this sentence
+            sentences.append(candidate)
+            start = match.end()
+
+        self._buffer = self._buffer[start:]
+        return sentences
+
+    def flush(self) -> str:
+        """Return whatever text is left at the end of the stream"""
+        text, self._buffer = self._buffer.strip(), ""
+        return text
+
+
+class SpeechPipeline:
+    """
+    Overlaps Gemini generation with ElevenLabs synthesis
+
+    Each sentence is sent to TTS as soon as it is complete, while later
+    sentences are still being generated. Audio is emitted strictly in
+    sentence order; audio for later sentences is buffered until the earlier
+    ones have been sent. Each sentence's viseme timeline is shifted to its
+    position in the combined audio stream.
+
+    A sentence whose speech fails gets an error frame in its place, so the
+    client knows that part of the text has no audio. Once the TTS circuit
+    is open the rest of the reply is sent as text only: one error frame
+    says so and no further sentences are synthesized.
+    """
+
+    def __init__(self, tts_service, max_parallel: Optional[int] = None):
+        """
+        Initialize pipeline
+
+        Args:
+            tts_service: ElevenLabsService used for synthesis
+            max_parallel: Sentences synthesized at once per reply (SPEECH_PIPELINE_MAX_PARALLEL)
+        """
+        self.tts_service = tts_service
+        self.max_parallel = max_parallel if max_parallel is not None else int(os.getenv("SPEECH_PIPELINE_MAX_PARALLEL", "3"))
+
+    async def run(
+        self,
+        events: AsyncIterator[Dict],
+        voice_id: Optional[str] = None,
+        trace=None
+    ) -> AsyncIterator[Tuple[int, Union[bytes, Dict]]]:
+        """
+        Speak a streamed reply
+
+        Args:
+            events: Events from GeminiService.stream_response
+            voice_id: Optional ElevenLabs voice ID
+            trace: TurnTrace that gets tts_ttfb (first sentence to its first
+                audio) and tts_total (first sentence to the last audio sent)
+
+        Yields:
+            (frame_type, payload) tuples: text deltas as they arrive, the done
+            event once the text is complete, and audio chunks in order, each
+            sentence's audio preceded by its viseme timeline (or replaced by
+            an error frame {"detail", "text"} if its speech failed)
+        """
+        out: asyncio.Queue = asyncio.Queue()
+        sentence_queue: asyncio.Queue = asyncio.Queue()  # Per-sentence chunk queues, in order
+        slots = asyncio.Semaphore(self.max_parallel)
+        workers: List[asyncio.Task] = []
+        tts_started: Optional[float] = None
+        last_audio_at: Optional[float] = None
+        text_only = False  # TTS circuit opened - stop synthesizing this reply
+
+        async def synthesize(text: str, chunks: asyncio.Queue, first: bool):
+            nonlocal text_only
+            try:
+                async with slots:
+                    if text_only:
+                        return  # Queued behind the sentence that found the circuit open
+                    async for item in self.tts_service.stream_speech_with_visemes(text=text, voice_id=voice_id):
+                        if first and item[0] == FRAME_AUDIO and trace is not None:
+                            first = False
+                            trace.observe("tts_ttfb", time.perf_counter() - tts_started)
+                        await chunks.put(item)
+            except CircuitOpenError:
+                if not text_only:
+                    text_only = True
+                    print("Speech unavailable (circuit open) - rest of the reply is text only")
+                    await chunks.put((FRAME_ERROR, {"detail": "Speech unavailable - the rest of this reply is text only", "text": text}))
+            except Exception as e:
+                print(f"Sentence TTS failed, skipping \"{text[:40]}\": {str(e)}")
+                await chunks.put((FRAME_ERROR, {"detail": "Speech failed for this sentence", "text": text}))
+            finally:
+                await chunks.put(None)
+
+        def start_sentence(text: str):
+            nonlocal tts_started
+            if text_only:
+                return
+            if tts_started is None:
+                tts_started = time.perf_counter()
+            chunks: asyncio.Queue = asyncio.Queue()
+            workers.append(asyncio.create_task(synthesize(text, chunks, first=not workers)))
+            sentence_queue.put_nowait(chunks)
+
+        async def produce_text():
+            splitter = SentenceSplitter()
+            try:
+                async for event in events:
+                    if event["type"] == "delta":
+                        await out.put((FRAME_TEXT_DELTA, {"text": event["text"]}))
+                        for sentence in splitter.feed(event["text"]):
+                            start_sentence(sentence)
+                    elif event["type"] == "done":
+                        rest = splitter.flush()
+                        if rest:
+                            start_sentence(rest)
+                        await out.put((FRAME_DONE, event))
+            finally:
+                sentence_queue.put_nowait(None)
+
+        async def sequence_audio():
+            audio_bytes = 0  # Audio sent so far, to place each sentence's visemes
+            while True:
+                chunks = await sentence_queue.get()
+                if chunks is None:
+                    break
+                sentence_start_ms = mp3_duration_ms(audio_bytes)
+                while True:
+                    item = await chunks.get()
+                    if item is None:
+                        break
+                    frame_type, payload = item
+                    if frame_type == FRAME_VISEMES:
+                        payload = shift_timeline(payload, sentence_start_ms)
+                    elif frame_type == FRAME_AUDIO:
+                        audio_bytes += len(payload)
+                    await out.put((frame_type, payload))
+
+        async def close_when_finished():
+            await asyncio.gather(producer, sequencer, return_exceptions=True)
+            await out.put(None)
+
+        producer = asyncio.create_task(produce_text())
+        sequencer = asyncio.create_task(sequence_audio())
+        closer = asyncio.create_task(close_when_finished())
+
+        try:
+            while True:
+                item = await out.get()
+                if item is None:
+                    break
+                if item[0] == FRAME_AUDIO:
+                    last_audio_at = time.perf_counter()
+                yield item
+            if trace is not None and last_audio_at is not None:
+                trace.observe("tts_total", last_audio_at - tts_started)
+        finally:
+            # Client went away or we finished - stop any outstanding work
+            for task in [producer, sequencer, closer, *workers]:
+                task.cancel()
@@ -0,0 +1,155 @@
+"""
+Streaming STT - transcribes an utterance while it is still being recorded
+"""
+import os
+import time
+import asyncio
+from typing import Awaitable, Callable, List, Optional
+
+
+class StreamingTranscription:
+    """
+    One utterance of streamed microphone audio
+
+    MediaRecorder timeslice chunks are appended as they arrive. Because the
+    chunks of one recording concatenate into a valid webm file, the audio
+    received so far can be transcribed at any point. Partial transcripts are
+    produced in the background at most every STT_PARTIAL_INTERVAL_MS, and
+    the final transcript reuses the last partial when no audio arrived after
+    it, so end-of-speech usually costs no extra transcription at all.
+
+    Cost: the batch STT API has no incremental mode and only the first chunk
+    carries the webm header, so every partial uploads (and is billed for)
+    the whole utterance so far - total audio sent grows with the square of
+    its length. Partials therefore stop after STT_PARTIAL_MAX_POLLS per
+    utterance or once it passes STT_PARTIAL_MAX_BYTES (about 30 s of
+    speech), whichever comes first; the final transcript covers the rest.
+    A partial is also skipped while every STT slot is taken, so polling
+    never queues ahead of final transcripts (or holds TTS's slots).
+    """
+
+    def __init__(
+        self,
+        stt_service,
+        on_partial: Optional[Callable[[str], Awaitable[None]]] = None,
+        partial_interval_ms: Optional[int] = None,
+        min_partial_bytes: Optional[int] = None,
+        max_partial_bytes: Optional[int] = None,
+        max_partials: Optional[int] = None
+    ):
+        """
+        Initialize transcription
+
+        Args:
+            stt_service: ElevenLabsService used for transcription
+            on_partial: Coroutine called with each partial transcript (finish
+                waits for it, so it should only deliver the text)
+            partial_interval_ms: Minimum gap between partials (STT_PARTIAL_INTERVAL_MS, 0 disables)
+            min_partial_bytes: Audio needed before the first partial (STT_MIN_PARTIAL_BYTES)
+            max_partial_bytes: Longest audio sent for a partial (STT_PARTIAL_MAX_BYTES)
+            max_partials: Partials per utterance (STT_PARTIAL_MAX_POLLS)
+        """
+        self.stt_service = stt_service
+        self.on_partial = on_partial
+        self.partial_interval = (
+            partial_interval_ms if partial_interval_ms is not None
+            else int(os.getenv("STT_PARTIAL_INTERVAL_MS", "1200"))
+        ) / 1000
+        self.min_partial_bytes = (
+            min_partial_bytes if min_partial_bytes is not None
+            else int(os.getenv("STT_MIN_PARTIAL_BYTES", "16000"))
+        )
+        self.max_partial_bytes = (
+            max_partial_bytes if max_partial_bytes is not None
+            else int(os.getenv("STT_PARTIAL_MAX_BYTES", "480000"))
+        )
+        self.max_partials = (
+            max_partials if max_partials is not None
+            else int(os.getenv("STT_PARTIAL_MAX_POLLS", "8"))
+        )
+
+        self._chunks: List[bytes] = []
+        self._size = 0
+        self._last_partial_at = 0.0
+        self._partial_task: Optional[asyncio.Task] = None
+        self._partial_size = 0        # Audio bytes covered by the in-flight/latest partial
+        self._partial_text: Optional[str] = None
+        self._partial_count = 0
+
+    def add_chunk(self, chunk: bytes):
+        """
+        Add recorded audio and start a partial transcript if one is due
+
+        Args:
+            chunk: Next MediaRecorder chunk
+        """
+        if not chunk:
+            return
+        self._chunks.append(chunk)
+        self._size += len(chunk)
+
+        if (
+            self.partial_interval > 0
+            and self.min_partial_bytes <= self._size <= self.max_partial_bytes
+            and self._partial_count < self.max_partials
+            and (self._partial_task is None or self._partial_task.done())
+            and time.monotonic() - self._last_partial_at >= self.partial_interval
+            and not self.stt_service.stt_busy()
+        ):
+            self._last_partial_at = time.monotonic()
+            self._partial_count += 1
+            self._partial_task = asyncio.create_task(self._run_partial(self._snapshot(), self._size))
+
+    async def finish(self) -> str:
+        """
+        Transcribe the complete utterance
+
+        Returns:
+            Final transcript
+        """
+        try:
+            if self._partial_task is not None and not self._partial_task.done():
+                if self._partial_size == self._size:
+                    await self._partial_task  # Already transcribing exactly this audio
+                else:
+                    self._partial_task.cancel()
+
+            if self._partial_text is not None and self._partial_size == self._size:
+                return self._partial_text
+
+            if self._size == 0:
+                return ""
+            return await self.stt_service.speech_to_text(self._snapshot())
+        finally:
+            self.reset()
+
+    def reset(self):
+        """Drop buffered audio and any in-flight partial"""
+        if self._partial_task is not None and not self._partial_task.done():
+            self._partial_task.cancel()
+        self._partial_task = None
+        self._chunks = []
+        self._size = 0
+        self._partial_size = 0
+        self._partial_text = None
+        self._partial_count = 0
+        self._last_partial_at = 0.0
+
+    def _snapshot(self) -> bytes:
+        return b"".join(self._chunks)
+
+    async def _run_partial(self, audio: bytes, size: int):
+        self._partial_size = size
+        try:
+            text = await self.stt_service.speech_to_text(audio)
+        except Exception as e:
+            print(f"Partial transcription failed: {str(e)}")
+            self._partial_size = 0
+            return
+
+        self._partial_text = text
+        if self.on_partial and text:
+            try:
+                await self.on_partial(text)
+            except Exception as e:
+                print(f"Partial transcript not delivered: {str(e)}")
@@ -0,0 +1,208 @@
+"""
+TTS cache - content-addressed store for synthesized audio
+"""
+import os
+import json
+import time
+import hashlib
+import asyncio
+from collections import OrderedDict
+from typing import Dict, Optional
+
+
+class TTSCache:
+    """
+    Two-tier cache of synthesized audio and its viseme timelines
+
+    Entries are keyed on a hash of everything that affects the audio (text,
+    voice, model and voice settings). A bounded in-memory LRU tier serves hot
+    phrases; an optional disk tier (TTS_CACHE_DIR) keeps them across
+    restarts and can be pointed at a mounted object-store bucket.
+    """
+
+    def __init__(
+        self,
+        max_memory_bytes: Optional[int] = None,
+        cache_dir: Optional[str] = None
+    ):
+        """
+        Initialize TTS cache
+
+        Args:
+            max_memory_bytes: Memory tier budget (TTS_CACHE_MEMORY_MB, default 64 MB)
+            cache_dir: Directory for the disk tier (TTS_CACHE_DIR, disabled if unset)
+        """
+        if max_memory_bytes is None:
+            max_memory_bytes = int(float(os.getenv("TTS_CACHE_MEMORY_MB", "64")) * 1024 * 1024)
+        self.max_memory_bytes = max_memory_bytes
+        self.cache_dir = cache_dir if cache_dir is not None else os.getenv("TTS_CACHE_DIR")
+        if self.cache_dir:
+            os.makedirs(self.cache_dir, exist_ok=True)
+
+        self._entries: "OrderedDict[str, bytes]" = OrderedDict()
+        self._memory_bytes = 0
+        self.hits = 0
+        self.misses = 0
+
+    @staticmethod
+    def make_key(text: str, voice_id: str, model_id: str, voice_settings: Optional[Dict] = None) -> str:
+        """
+        Build the cache key for a synthesis request
+
+        Args:
+            text: Text to be spoken
+            voice_id: ElevenLabs voice ID
+            model_id: ElevenLabs model ID
+            voice_settings: Voice settings in effect
+
+        Returns:
+            Hex digest identifying the audio
+        """
+        material = json.dumps(
+            {
+                "text": text.strip(),
+                "voice_id": voice_id,
+                "model_id": model_id,
+                "voice_settings": voice_settings or {}
+            },
+            sort_keys=True
+        )
+        return hashlib.sha256(material.encode("utf-8")).hexdigest()
+
+    async def get(self, key: str, kind: str = "mp3") -> Optional[bytes]:
+        """
+        Look up an entry in memory, then on disk
+
+        Args:
+            key: Key from make_key
+            kind: Entry type, used as the file extension ("mp3" audio, "json" visemes)
+        """
+        audio = self._entries.get(key)
+        if audio is not None:
+            self._entries.move_to_end(key)
+            self.hits += 1
+            return audio
+
+        if self.cache_dir:
+            audio = await asyncio.to_thread(self._read_disk, key, kind)
+            if audio is not None:
+                self._put_memory(key, audio)
+                self.hits += 1
+                return audio
+
+        self.misses += 1
+        return None
+
+    async def put(self, key: str, audio: bytes, kind: str = "mp3"):
+        """Store an entry in both tiers (kind as for get)"""
+        if not audio:
+            return
+        self._put_memory(key, audio)
+        if self.cache_dir:
+            await asyncio.to_thread(self._write_disk, key, audio, kind)
+
+    async def contains(self, key: str, kind: str = "mp3") -> bool:
+        """Whether an entry is stored in either tier (not counted as a hit or miss)"""
+        if key in self._entries:
+            return True
+        if self.cache_dir:
+            return await asyncio.to_thread(os.path.exists, self._path(key, kind))
+        return False
+
+    def claim(self, job: str, stale_seconds: float) -> bool:
+        """
+        Claim a one-off job (e.g. prewarming) among processes sharing the disk tier
+
+        Args:
+            job: Job name, unique per job content
+            stale_seconds: Age after which another process's claim is taken over
+
+        Returns:
+            False if the job is done or running elsewhere; always True without a disk tier
+        """
+        if not self.cache_dir:
+            return True
+        done_path, lock_path = self._job_paths(job)
+        if os.path.exists(done_path):
+            return False
+        try:
+            os.close(os.open(lock_path, os.O_CREAT | os.O_EXCL | os.O_WRONLY))
+            return True
+        except FileExistsError:
+            pass
+        except OSError as e:
+            print(f"TTS cache lock failed: {str(e)}")
+            return True
+        try:
+            if time.time() - os.path.getmtime(lock_path) < stale_seconds:
+                return False
+            os.utime(lock_path)  # The process that held it died - take over
+            return True
+        except OSError:
+            return False
+
+    def release(self, job: str, done: bool):
+        """Give up a claim; with done=True no process claims the job again"""
+        if not self.cache_dir:
+            return
+        done_path, lock_path = self._job_paths(job)
+        try:
+            if done:
+                with open(done_path, "w") as f:
+                    f.write(str(time.time()))
+            os.remove(lock_path)
+        except OSError as e:
+            print(f"TTS cache unlock failed: {str(e)}")
+
+    def stats(self) -> Dict[str, int]:
+        """Cache counters for monitoring"""
+        return {
+            "entries": len(self._entries),
+            "memory_bytes": self._memory_bytes,
+            "hits": self.hits,
+            "misses": self.misses
+        }
+
+    def _put_memory(self, key: str, audio: bytes):
+        if len(audio) > self.max_memory_bytes:
+            return  # Never let one entry flush the whole tier
+
+        previous = self._entries.pop(key, None)
+        if previous is not None:
+            self._memory_bytes -= len(previous)
+
+        self._entries[key] = audio
+        self._memory_bytes += len(audio)
+
+        while self._memory_bytes > self.max_memory_bytes:
+            _, evicted = self._entries.popitem(last=False)
+            self._memory_bytes -= len(evicted)
+
+    def _path(self, key: str, kind: str) -> str:
+        # Two-level fan-out keeps directories small
+        return os.path.join(self.cache_dir, key[:2], f"{key}.{kind}")
+
+    def _job_paths(self, job: str):
+        return os.path.join(self.cache_dir, f"{job}.done"), os.path.join(self.cache_dir, f"{job}.lock")
+
+    def _read_disk(self, key: str, kind: str) -> Optional[bytes]:
+        try:
+            with open(self._path(key, kind), "rb") as f:
+                return f.read()
+        except FileNotFoundError:
+            return None
+        except OSError as e:
+            print(f"TTS cache read failed: {str(e)}")
+            return None
+
+    def _write_disk(self, key: str, audio: bytes, kind: str):
+        path = self._path(key, kind)
+        try:
+            os.makedirs(os.path.dirname(path), exist_ok=True)
+            # Write then rename so readers never see a partial file
+            tmp_path = f"{path}.{os.getpid()}.tmp"
+            with open(tmp_path, "wb") as f:
+                f.write(audio)
+            os.replace(tmp_path, path)
+        except OSError as e:
+            print(f"TTS cache write failed: {str(e)}")
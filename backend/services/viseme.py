@@ -0,0 +1,159 @@
+"""
+Viseme timeline - turns ElevenLabs character alignment into mouth shapes
+"""
+from typing import Dict, List, Optional, Sequence
+
+
+# Viseme IDs (frontend/lib/visemes.ts maps these to jaw openness)
+VISEME_SILENCE = 0
+VISEME_PP = 1   # p b m
+VISEME_FF = 2   # f v
+VISEME_TH = 3   # th
+VISEME_DD = 4   # t d n l
+VISEME_KK = 5   # k g c q x h
+VISEME_CH = 6   # j ch sh
+VISEME_SS = 7   # s z
+VISEME_RR = 8   # r
+VISEME_AA = 9   # a
+VISEME_E = 10   # e
+VISEME_I = 11   # i y
+VISEME_O = 12   # o
+VISEME_U = 13   # u w oo
+
+# Two-letter spellings that make a single mouth shape
+DIGRAPHS = {
+    "th": VISEME_TH,
+    "sh": VISEME_CH,
+    "ch": VISEME_CH,
+    "ph": VISEME_FF,
+    "oo": VISEME_U,
+    "ee": VISEME_I,
+}
+
+LETTERS = {
+    **{c: VISEME_PP for c in "pbm"},
+    **{c: VISEME_FF for c in "fv"},
+    **{c: VISEME_DD for c in "tdnl"},
+    **{c: VISEME_KK for c in "kgcqxh"},
+    **{c: VISEME_SS for c in "sz"},
+    "j": VISEME_CH,
+    "r": VISEME_RR,
+    "a": VISEME_AA,
+    "e": VISEME_E,
+    "i": VISEME_I,
+    "y": VISEME_I,
+    "o": VISEME_O,
+    "u": VISEME_U,
+    "w": VISEME_U,
+}
+
+# Gaps between words shorter than this don't close the mouth
+MIN_SILENCE_MS = 60
+
+# ElevenLabs output format used for all synthesis (constant bitrate)
+MP3_BITRATE = 128000
+
+
+def mp3_duration_ms(num_bytes: int, bitrate: int = MP3_BITRATE) -> float:
+    """Playback length of constant-bitrate MP3 audio"""
+    return num_bytes * 8 * 1000 / bitrate
+
+
+def alignment_to_visemes(
+    characters: Sequence[str],
+    start_times: Sequence[float],
+    end_times: Sequence[float],
+    offset_ms: float = 0.0
+) -> Dict[str, List[int]]:
+    """
+    Build a compact viseme timeline from character timestamps
+
+    Spelling is only an approximation of pronunciation, but at avatar scale
+    the jaw rhythm matters far more than the exact phoneme.
+
+    Args:
+        characters: Spoken characters, as returned by ElevenLabs alignment
+        start_times: Start of each character in seconds
+        end_times: End of each character in seconds
+        offset_ms: Added to every key (position of this audio in the stream)
+
+    Returns:
+        {"t": [start ms, ...], "v": [viseme id, ...]} with repeated visemes
+        merged and a closing silence key at the end
+    """
+    times: List[int] = []
+    visemes: List[int] = []
+
+    def push(time_s: float, viseme: int):
+        time_ms = int(round(time_s * 1000 + offset_ms))
+        if visemes and visemes[-1] == viseme:
+            return
+        if times and time_ms <= times[-1]:
+            # Same instant (e.g. zero-length characters) - newest shape wins
+            visemes[-1] = viseme
+            if len(visemes) > 1 and visemes[-2] == viseme:
+                times.pop()
+                visemes.pop()
+            return
+        times.append(time_ms)
+        visemes.append(viseme)
+
+    chars = [c.lower() for c in characters]
+    i = 0
+    while i < len(chars):
+        pair = "".join(chars[i:i + 2])
+        if pair in DIGRAPHS:
+            push(start_times[i], DIGRAPHS[pair])
+            i += 2
+            continue
+
+        viseme = LETTERS.get(chars[i])
+        if viseme is None:
+            # Spaces and punctuation: only close the mouth for real pauses
+            pause_ms = (end_times[i] - start_times[i]) * 1000
+            if pause_ms >= MIN_SILENCE_MS:
+                push(start_times[i], VISEME_SILENCE)
+        else:
+            push(start_times[i], viseme)
+        i += 1
+
+    if end_times:
+        push(end_times[-1], VISEME_SILENCE)
+
+    return {"t": times, "v": visemes}
+
+
+def extract_alignment(response) -> Optional[Dict[str, list]]:
+    """
+    Character alignment from an ElevenLabs timestamped response or stream chunk
+
+    Prefers the normalized alignment (numbers and abbreviations spelled out
+    the way they are spoken).
+
+    Returns:
+        alignment_to_visemes keyword arguments, or None if the response
+        carries no alignment
+    """
+    alignment = getattr(response, "normalized_alignment", None) or getattr(response, "alignment", None)
+    if not alignment or not alignment.characters:
+        return None
+    return {
+        "characters": list(alignment.characters),
+        "start_times": list(alignment.character_start_times_seconds),
+        "end_times": list(alignment.character_end_times_seconds),
+    }
+
+
+def merge_timelines(timelines: List[Dict[str, List[int]]]) -> Dict[str, List[int]]:
+    """Concatenate timelines that are already in stream order"""
+    merged = {"t": [], "v": []}
+    for timeline in timelines:
+        merged["t"].extend(timeline["t"])
+        merged["v"].extend(timeline["v"])
+    return merged
+
+
+def shift_timeline(timeline: Dict[str, List[int]], offset_ms: float) -> Dict[str, List[int]]:
+    """Move every key of a timeline later by offset_ms"""
+    offset = int(round(offset_ms))
+    return {"t": [t + offset for t in timeline["t"]], "v": list(timeline["v"])}
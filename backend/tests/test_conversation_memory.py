@@ -0,0 +1,120 @@
+"""
+Tests for services/conversation_memory.py
+"""
+import unittest
+from types import SimpleNamespace
+from unittest import mock
+
+from services.conversation_memory import (
+    DIGEST_ACKNOWLEDGEMENT,
+    DIGEST_MAX_CHARS,
+    ConversationMemory,
+    content_text,
+)
+
+
+def exchange(n: int, size: int = 40) -> list:
+    """One patient/doctor exchange as chat history dicts"""
+    return [
+        {"role": "user", "parts": [f'Patient says: "turn {n} ' + "x" * size + '"\nContext: neutral']},
+        {"role": "model", "parts": [f"Reply {n} " + "y" * size]},
+    ]
+
+
+def make_session(exchanges: int, size: int = 40, **fields) -> SimpleNamespace:
+    history = [content for n in range(exchanges) for content in exchange(n, size)]
+    session = SimpleNamespace(
+        session_id="s",
+        chat_session=SimpleNamespace(history=history),
+        history_digest=None,
+        summary=None,
+        summary_task=None,
+        unsummarized=[],
+    )
+    for key, value in fields.items():
+        setattr(session, key, value)
+    return session
+
+
+class CompactTest(unittest.TestCase):
+    def setUp(self):
+        patcher = mock.patch("builtins.print")
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+    def test_under_budget_is_left_alone(self):
+        session = make_session(3)
+        before = list(session.chat_session.history)
+
+        ConversationMemory(token_budget=1000, min_recent_exchanges=1).compact(session)
+
+        self.assertEqual(session.chat_session.history, before)
+        self.assertIsNone(session.history_digest)
+
+    def test_oldest_exchanges_fold_into_digest(self):
+        session = make_session(6)  # About 25 tokens per message
+        memory = ConversationMemory(token_budget=200, min_recent_exchanges=2)
+
+        memory.compact(session)
+
+        history = session.chat_session.history
+        self.assertEqual(history[1], {"role": "model", "parts": [DIGEST_ACKNOWLEDGEMENT]})
+        self.assertIn(session.history_digest, content_text(history[0]))
+        # Only the patient's first line of each dropped turn goes in the digest
+        self.assertIn('Patient says: "turn 0', session.history_digest)
+        self.assertNotIn("Reply 0", session.history_digest)
+        self.assertNotIn("Context:", session.history_digest)
+        # The newest exchanges stay verbatim, in order
+        self.assertEqual(history[-4:], exchange(4) + exchange(5))
+        self.assertLess(len(history), 12)
+
+    def test_keeps_min_recent_exchanges_over_budget(self):
+        session = make_session(3, size=400)
+
+        ConversationMemory(token_budget=10, min_recent_exchanges=2).compact(session)
+
+        history = session.chat_session.history
+        self.assertEqual(history[2:], exchange(1, 400) + exchange(2, 400))
+
+    def test_compacting_again_extends_previous_digest(self):
+        session = make_session(6)
+        memory = ConversationMemory(token_budget=200, min_recent_exchanges=2)
+        memory.compact(session)
+        first_digest = session.history_digest
+
+        session.chat_session.history += exchange(6) + exchange(7) + exchange(8)
+        memory.compact(session)
+
+        self.assertTrue(session.history_digest.startswith(first_digest))
+        self.assertEqual(session.chat_session.history[1]["parts"], [DIGEST_ACKNOWLEDGEMENT])
+        # Still one digest exchange at the front
+        self.assertEqual(sum(content_text(c).startswith("[Earlier") for c in session.chat_session.history), 1)
+
+    def test_uses_rolling_summary_when_it_covers_dropped_turns(self):
+        session = make_session(6, summary={"overview": "Fatigue for two weeks."})
+
+        ConversationMemory(token_budget=200, min_recent_exchanges=2).compact(session)
+
+        self.assertEqual(session.history_digest, "Fatigue for two weeks.")
+
+    def test_ignores_summary_still_refreshing(self):
+        task = mock.Mock()
+        task.done.return_value = False
+        session = make_session(6, summary={"overview": "Stale."}, summary_task=task)
+
+        ConversationMemory(token_budget=200, min_recent_exchanges=2).compact(session)
+
+        self.assertNotEqual(session.history_digest, "Stale.")
+        self.assertIn("Patient says", session.history_digest)
+
+    def test_digest_is_capped_to_most_recent_text(self):
+        session = make_session(4, size=2000)
+
+        ConversationMemory(token_budget=100, min_recent_exchanges=1).compact(session)
+
+        self.assertLessEqual(len(session.history_digest), DIGEST_MAX_CHARS + 3)
+        self.assertTrue(session.history_digest.startswith("..."))
+
+
+if __name__ == "__main__":
+    unittest.main()
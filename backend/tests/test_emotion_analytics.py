@@ -0,0 +1,126 @@
+"""
+Tests for services/emotion_analytics.py
+"""
+import unittest
+from datetime import datetime, timedelta, timezone
+
+from services.emotion_analytics import EmotionTable, analyze_table
+from services.emotion_telemetry import EMOTION_LABELS, EmotionAggregate
+
+START = datetime(2025, 11, 22, 10, 0, tzinfo=timezone.utc)
+
+
+def at(seconds: float) -> str:
+    return (START + timedelta(seconds=seconds)).isoformat().replace("+00:00", "Z")
+
+
+def by_label(**shares) -> list:
+    """Label-indexed list with the given values, zero elsewhere"""
+    return [shares.get(label, 0) for label in EMOTION_LABELS]
+
+
+class AnalyzeTableTest(unittest.TestCase):
+    def assertListAlmostEqual(self, actual, expected, places=4):
+        self.assertEqual(len(actual), len(expected))
+        for a, e in zip(actual, expected):
+            self.assertAlmostEqual(a, e, places=places)
+
+    def setUp(self):
+        table = EmotionTable()
+        table.add_labels(
+            "a",
+            ["neutral", "neutral", "sad", "sad", "happy"],
+            [at(0), at(10), at(20), at(70), at(80)],
+        )
+        table.add_labels("empty", ["bogus"], [at(0)])
+        self.result = analyze_table(table, window_seconds=60, shift_threshold=0.5)
+        self.a, self.empty = self.result["sessions"]
+
+    def test_distribution_and_totals(self):
+        self.assertEqual(self.a["total_samples"], 5)
+        self.assertListAlmostEqual(self.a["distribution"], by_label(neutral=0.4, sad=0.4, happy=0.2))
+
+    def test_transitions_between_consecutive_samples(self):
+        expected = [[0] * len(EMOTION_LABELS) for _ in EMOTION_LABELS]
+        neutral, happy, sad = (EMOTION_LABELS.index(label) for label in ("neutral", "happy", "sad"))
+        expected[neutral][neutral] = 1
+        expected[neutral][sad] = 1
+        expected[sad][sad] = 1
+        expected[sad][happy] = 1
+        self.assertEqual(self.a["transitions"], expected)
+
+    def test_dwell_runs_until_next_label(self):
+        # neutral 0-20 s, sad 20-80 s, happy ends the session
+        self.assertListAlmostEqual(self.a["mean_dwell_seconds"], by_label(neutral=20, sad=60))
+
+    def test_windows_and_significant_shift(self):
+        windows = self.a["windows"]
+        self.assertEqual([w["start_seconds"] for w in windows], [0.0, 60.0])
+        self.assertListAlmostEqual(windows[0]["distribution"], by_label(neutral=2 / 3, sad=1 / 3))
+        self.assertListAlmostEqual(windows[1]["distribution"], by_label(sad=0.5, happy=0.5))
+
+        [shift] = self.a["shifts"]
+        self.assertEqual(shift["at_seconds"], 60.0)
+        self.assertEqual(shift["from"], "neutral")
+        self.assertAlmostEqual(shift["distance"], 2 / 3, places=4)
+        self.assertAlmostEqual(shift["negative_rise"], 1 / 6, places=4)
+
+    def test_no_shift_below_threshold(self):
+        table = EmotionTable()
+        table.add_labels("a", ["neutral", "sad", "sad"], [at(0), at(20), at(70)])
+        [session] = analyze_table(table, window_seconds=60, shift_threshold=0.9)["sessions"]
+        self.assertEqual(session["shifts"], [])
+
+    def test_session_without_known_labels_is_empty(self):
+        self.assertEqual(self.empty["session_id"], "empty")
+        self.assertEqual(self.empty["total_samples"], 0)
+        self.assertEqual(self.empty["distribution"], [0.0] * len(EMOTION_LABELS))
+        self.assertEqual(self.empty["windows"], [])
+        self.assertEqual(self.empty["shifts"], [])
+
+    def test_overall_totals(self):
+        overall = self.result["overall"]
+        self.assertEqual(overall["sessions"], 2)
+        self.assertEqual(overall["total_samples"], 5)
+        self.assertEqual(overall["sessions_with_shifts"], 1)
+        self.assertEqual(overall["transitions"], self.a["transitions"])
+
+    def test_samples_are_sorted_by_time(self):
+        table = EmotionTable()
+        table.add_labels("a", ["sad", "neutral"], [at(30), at(0)])
+        [session] = analyze_table(table)["sessions"]
+
+        neutral, sad = EMOTION_LABELS.index("neutral"), EMOTION_LABELS.index("sad")
+        self.assertEqual(session["transitions"][neutral][sad], 1)
+        self.assertEqual(session["transitions"][sad][neutral], 0)
+
+    def test_labels_without_timestamps_keep_sample_order(self):
+        table = EmotionTable()
+        table.add_labels("a", ["happy", "sad"])
+        [session] = analyze_table(table)["sessions"]
+
+        happy, sad = EMOTION_LABELS.index("happy"), EMOTION_LABELS.index("sad")
+        self.assertEqual(session["transitions"][happy][sad], 1)
+
+    def test_aggregate_buckets_weighted_by_samples(self):
+        aggregate = EmotionAggregate()
+        aggregate.merge(
+            labels=EMOTION_LABELS,
+            buckets=[
+                {"t": 0, "n": 3, "p": by_label(happy=200, neutral=50)},
+                {"t": 5000, "n": 1, "p": by_label(sad=180, neutral=70)},
+            ],
+            counts=[0] * len(EMOTION_LABELS),
+            transitions=[[0] * len(EMOTION_LABELS) for _ in EMOTION_LABELS],
+        )
+        table = EmotionTable()
+        table.add_aggregate("live", aggregate)
+        [session] = analyze_table(table)["sessions"]
+
+        self.assertEqual(session["total_samples"], 4)
+        self.assertListAlmostEqual(session["distribution"], by_label(happy=0.75, sad=0.25))
+        self.assertListAlmostEqual(session["mean_dwell_seconds"], by_label(happy=5))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,91 @@
+"""
+Tests for services/emotion_telemetry.py
+"""
+import json
+import unittest
+
+from services.emotion_telemetry import EMOTION_LABELS, EmotionAggregate
+
+SIZE = len(EMOTION_LABELS)
+
+
+def batch(counts=None, transitions=None, buckets=(), labels=EMOTION_LABELS) -> dict:
+    """Client batch with zero deltas unless given"""
+    return {
+        "labels": list(labels),
+        "buckets": list(buckets),
+        "counts": counts if counts is not None else [0] * SIZE,
+        "transitions": transitions if transitions is not None else [[0] * SIZE for _ in range(SIZE)],
+    }
+
+
+def probabilities(label: str) -> list:
+    return [255 if name == label else 0 for name in EMOTION_LABELS]
+
+
+class MergeTest(unittest.TestCase):
+    def test_batches_add_up(self):
+        aggregate = EmotionAggregate()
+        transitions = [[0] * SIZE for _ in range(SIZE)]
+        transitions[0][2] = 1  # neutral -> sad
+
+        aggregate.merge(**batch(counts=[3, 0, 1, 0, 0, 0, 0], transitions=transitions))
+        aggregate.merge(**batch(counts=[1, 2, 0, 0, 0, 0, 0], transitions=transitions))
+
+        self.assertEqual(aggregate.total_samples, 7)
+        self.assertEqual(aggregate.count_map(), {"neutral": 4, "happy": 2, "sad": 1})
+        self.assertEqual(aggregate.transition_map(), {"neutral": {"sad": 2}})
+
+    def test_buckets_keep_order_and_drop_oldest(self):
+        aggregate = EmotionAggregate(max_buckets=2)
+        buckets = [{"t": t, "n": 5, "p": probabilities("happy")} for t in (0, 5000, 10000)]
+
+        aggregate.merge(**batch(buckets=buckets[:2]))
+        aggregate.merge(**batch(buckets=buckets[2:]))
+
+        self.assertEqual([bucket[0] for bucket in aggregate.buckets], [5000, 10000])
+        self.assertEqual(aggregate.buckets[-1], (10000, 5, tuple(probabilities("happy"))))
+
+    def test_state_round_trip(self):
+        aggregate = EmotionAggregate()
+        aggregate.merge(**batch(counts=[1] * SIZE, buckets=[{"t": 0, "n": 7, "p": probabilities("sad")}]))
+
+        restored = EmotionAggregate.from_state(json.loads(json.dumps(aggregate.to_state())))
+
+        self.assertEqual(restored.counts, aggregate.counts)
+        self.assertEqual(restored.transitions, aggregate.transitions)
+        self.assertEqual(list(restored.buckets), list(aggregate.buckets))
+
+
+class ValidationTest(unittest.TestCase):
+    def assertRejected(self, **fields):
+        aggregate = EmotionAggregate()
+        with self.assertRaises(ValueError):
+            aggregate.merge(**batch(**fields))
+        # Nothing of a rejected batch is kept
+        self.assertEqual(aggregate.total_samples, 0)
+        self.assertEqual(len(aggregate.buckets), 0)
+
+    def test_rejects_other_label_order(self):
+        self.assertRejected(labels=list(reversed(EMOTION_LABELS)), counts=[1] * SIZE)
+
+    def test_rejects_short_counts(self):
+        self.assertRejected(counts=[1] * (SIZE - 1))
+
+    def test_rejects_ragged_transitions(self):
+        transitions = [[0] * SIZE for _ in range(SIZE)]
+        transitions[3] = [0] * (SIZE + 1)
+        self.assertRejected(counts=[1] * SIZE, transitions=transitions)
+
+    def test_rejects_negative_counts(self):
+        self.assertRejected(counts=[2, -1, 0, 0, 0, 0, 0])
+
+    def test_rejects_out_of_range_probabilities(self):
+        self.assertRejected(counts=[1] * SIZE, buckets=[{"t": 0, "n": 1, "p": [256] + [0] * (SIZE - 1)}])
+
+    def test_rejects_probabilities_for_wrong_label_count(self):
+        self.assertRejected(counts=[1] * SIZE, buckets=[{"t": 0, "n": 1, "p": [255]}])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,42 @@
+"""
+Tests for EndConsultationDetector - the end tag in streamed Gemini text
+"""
+import unittest
+
+from services.gemini_service import END_CONSULTATION_TAG, EndConsultationDetector
+
+
+def run(chunks):
+    detector = EndConsultationDetector()
+    shown = "".join(detector.feed(chunk) for chunk in chunks) + detector.flush()
+    return shown, detector.detected
+
+
+class EndConsultationDetectorTest(unittest.TestCase):
+    def test_plain_text_passes_through(self):
+        self.assertEqual(run(["Take care ", "and rest."]), ("Take care and rest.", False))
+
+    def test_tag_in_one_chunk_is_removed(self):
+        shown, detected = run([f"Take care. {END_CONSULTATION_TAG}"])
+        self.assertEqual(shown, "Take care. ")
+        self.assertTrue(detected)
+
+    def test_tag_split_across_chunks_is_removed(self):
+        tag = END_CONSULTATION_TAG
+        shown, detected = run(["Goodbye! ", tag[:3], tag[3:9], tag[9:]])
+        self.assertEqual(shown, "Goodbye! ")
+        self.assertTrue(detected)
+
+    def test_possible_tag_start_is_held_back(self):
+        detector = EndConsultationDetector()
+        self.assertEqual(detector.feed("Use ["), "Use ")
+        # Not the tag after all - released with the next chunk
+        self.assertEqual(detector.feed("brand] cream"), "[brand] cream")
+        self.assertFalse(detector.detected)
+
+    def test_held_text_is_released_at_the_end(self):
+        self.assertEqual(run(["See you [E"]), ("See you [E", False))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,45 @@
+"""
+Tests for services/frames.py - the binary frame codec
+"""
+import json
+import struct
+import unittest
+
+from services.frames import FRAME_AUDIO, FRAME_ERROR, FRAME_TEXT_DELTA, encode_frame
+
+
+def decode_frames(data: bytes):
+    """Split a byte stream back into (type, payload) frames, as the frontend does"""
+    frames = []
+    offset = 0
+    while offset < len(data):
+        frame_type, length = struct.unpack_from(">BI", data, offset)
+        offset += 5
+        frames.append((frame_type, data[offset:offset + length]))
+        offset += length
+    return frames
+
+
+class EncodeFrameTest(unittest.TestCase):
+    def test_audio_payload_is_raw(self):
+        frame = encode_frame(FRAME_AUDIO, b"\xff\xfb\x90")
+        self.assertEqual(frame, b"\x02\x00\x00\x00\x03\xff\xfb\x90")
+
+    def test_dict_payload_is_utf8_json(self):
+        frame = encode_frame(FRAME_TEXT_DELTA, {"text": "Größe"})
+        ((frame_type, payload),) = decode_frames(frame)
+        self.assertEqual(frame_type, FRAME_TEXT_DELTA)
+        self.assertEqual(json.loads(payload.decode("utf-8")), {"text": "Größe"})
+        self.assertEqual(struct.unpack_from(">I", frame, 1)[0], len(payload))
+
+    def test_frames_concatenate(self):
+        stream = (
+            encode_frame(FRAME_TEXT_DELTA, {"text": "Hi"})
+            + encode_frame(FRAME_AUDIO, b"")
+            + encode_frame(FRAME_ERROR, {"detail": "x"})
+        )
+        self.assertEqual([frame_type for frame_type, _ in decode_frames(stream)], [FRAME_TEXT_DELTA, FRAME_AUDIO, FRAME_ERROR])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,322 @@
+"""
+Tests for services/resilience.py - breaker states, error classification and hedging
+"""
+import asyncio
+import unittest
+from unittest import mock
+
+from services.resilience import (
+    CircuitBreaker,
+    CircuitOpenError,
+    Upstream,
+    UpstreamTimeout,
+    is_upstream_failure,
+)
+
+
+class StatusError(Exception):
+    """SDK-style error carrying an HTTP status (like ElevenLabs' ApiError)"""
+
+    def __init__(self, status_code: int):
+        super().__init__(f"HTTP {status_code}")
+        self.status_code = status_code
+
+
+class CodeError(Exception):
+    """google-api-core style error with the status in .code"""
+
+    def __init__(self, code: int):
+        super().__init__(f"code {code}")
+        self.code = code
+
+
+class TransportError(Exception):
+    """Stands in for httpx.TransportError (matched by class name)"""
+
+
+class ConnectError(TransportError):
+    pass
+
+
+class Clock:
+    """Patchable time.monotonic"""
+
+    def __init__(self):
+        self.now = 1000.0
+
+    def __call__(self) -> float:
+        return self.now
+
+
+class CircuitBreakerTest(unittest.TestCase):
+    def setUp(self):
+        self.clock = Clock()
+        patcher = mock.patch("services.resilience.time.monotonic", self.clock)
+        patcher.start()
+        self.addCleanup(patcher.stop)
+        self.breaker = CircuitBreaker("test", failure_threshold=3, reset_seconds=30)
+
+    def trip(self):
+        for _ in range(self.breaker.failure_threshold):
+            self.breaker.record_failure()
+
+    def test_opens_after_consecutive_failures(self):
+        self.breaker.record_failure()
+        self.breaker.record_failure()
+        self.assertEqual(self.breaker.state, "closed")
+        self.assertTrue(self.breaker.allow())
+
+        self.breaker.record_failure()
+        self.assertEqual(self.breaker.state, "open")
+        self.assertTrue(self.breaker.is_open)
+        self.assertFalse(self.breaker.allow())
+        self.assertEqual(self.breaker.opened_count, 1)
+
+    def test_success_resets_failure_count(self):
+        self.breaker.record_failure()
+        self.breaker.record_failure()
+        self.breaker.record_success()
+        self.breaker.record_failure()
+        self.assertEqual(self.breaker.state, "closed")
+
+    def test_half_open_after_reset_lets_one_probe_through(self):
+        self.trip()
+        self.clock.now += 30
+        self.assertEqual(self.breaker.state, "half_open")
+
+        self.assertTrue(self.breaker.allow())
+        # The probe is in flight - everything else waits for the next window
+        self.assertEqual(self.breaker.state, "open")
+        self.assertFalse(self.breaker.allow())
+
+    def test_probe_success_closes(self):
+        self.trip()
+        self.clock.now += 30
+        self.assertTrue(self.breaker.allow())
+        self.breaker.record_success()
+        self.assertEqual(self.breaker.state, "closed")
+        self.assertEqual(self.breaker.failures, 0)
+
+    def test_probe_failure_reopens_for_another_window(self):
+        self.trip()
+        self.clock.now += 30
+        self.assertTrue(self.breaker.allow())
+        self.breaker.record_failure()
+        self.assertEqual(self.breaker.state, "open")
+        # Same outage - not counted as a new opening
+        self.assertEqual(self.breaker.opened_count, 1)
+
+        self.clock.now += 29
+        self.assertEqual(self.breaker.state, "open")
+        self.clock.now += 1
+        self.assertEqual(self.breaker.state, "half_open")
+
+
+class ErrorClassificationTest(unittest.TestCase):
+    def test_provider_failures(self):
+        for error in (
+            asyncio.TimeoutError(),
+            ConnectionResetError(),
+            StatusError(500),
+            StatusError(503),
+            StatusError(429),
+            CodeError(504),
+            ConnectError("connection refused"),
+        ):
+            with self.subTest(error=repr(error)):
+                self.assertTrue(is_upstream_failure(error))
+
+    def test_request_errors(self):
+        for error in (
+            StatusError(400),
+            StatusError(401),
+            StatusError(404),
+            StatusError(422),
+            CodeError(400),
+            ValueError("response blocked"),
+        ):
+            with self.subTest(error=repr(error)):
+                self.assertFalse(is_upstream_failure(error))
+
+    def test_status_on_response(self):
+        error = Exception("HTTP error")
+        error.response = mock.Mock(status_code=502)
+        self.assertTrue(is_upstream_failure(error))
+
+
+async def fail_with(error: BaseException):
+    raise error
+
+
+async def respond(value, delay: float = 0.0):
+    await asyncio.sleep(delay)
+    return value
+
+
+class UpstreamCallTest(unittest.IsolatedAsyncioTestCase):
+    def make_upstream(self, **kwargs) -> Upstream:
+        breaker = CircuitBreaker("test", failure_threshold=2, reset_seconds=60)
+        return Upstream("test.call", breaker, timeout_seconds=kwargs.pop("timeout_seconds", 1.0), **kwargs)
+
+    async def test_client_errors_do_not_trip_the_breaker(self):
+        upstream = self.make_upstream()
+        for _ in range(5):
+            with self.assertRaises(StatusError):
+                await upstream.call(lambda: fail_with(StatusError(400)))
+        self.assertEqual(upstream.breaker.state, "closed")
+        self.assertEqual(upstream.counters["client_errors"], 5)
+        self.assertEqual(upstream.counters["failures"], 0)
+
+    async def test_server_errors_trip_the_breaker(self):
+        upstream = self.make_upstream()
+        for _ in range(2):
+            with self.assertRaises(StatusError):
+                await upstream.call(lambda: fail_with(StatusError(503)))
+        self.assertEqual(upstream.breaker.state, "open")
+
+        with self.assertRaises(CircuitOpenError):
+            await upstream.call(lambda: respond("never sent"))
+        self.assertEqual(upstream.counters["rejected"], 1)
+
+    async def test_timeouts_trip_the_breaker(self):
+        upstream = self.make_upstream(timeout_seconds=0.01)
+        for _ in range(2):
+            with self.assertRaises(UpstreamTimeout):
+                await upstream.call(lambda: respond("late", delay=1))
+        self.assertEqual(upstream.counters["timeouts"], 2)
+        self.assertEqual(upstream.breaker.state, "open")
+
+    async def test_client_error_between_failures_resets_the_count(self):
+        upstream = self.make_upstream()
+        for status in (503, 400, 503):
+            with self.assertRaises(StatusError):
+                await upstream.call(lambda: fail_with(StatusError(status)))
+        self.assertEqual(upstream.breaker.state, "closed")
+
+
+class HedgeTest(unittest.IsolatedAsyncioTestCase):
+    def make_upstream(self, hedge_after: float = 0.02) -> Upstream:
+        breaker = CircuitBreaker("test", failure_threshold=5, reset_seconds=60)
+        return Upstream("test.hedge", breaker, timeout_seconds=1.0, hedge_after_seconds=hedge_after)
+
+    async def test_fast_primary_is_not_hedged(self):
+        upstream = self.make_upstream()
+        hedge = mock.AsyncMock(return_value="hedge")
+        result = await upstream.call(lambda: respond("primary"), hedge=hedge)
+        self.assertEqual(result, "primary")
+        hedge.assert_not_called()
+        self.assertEqual(upstream.counters["hedges"], 0)
+
+    async def test_hedge_wins_when_primary_is_slow(self):
+        upstream = self.make_upstream()
+        primary_cancelled = asyncio.Event()
+
+        async def slow_primary():
+            try:
+                await asyncio.sleep(1)
+            except asyncio.CancelledError:
+                primary_cancelled.set()
+                raise
+            return "primary"
+
+        result = await upstream.call(slow_primary, hedge=lambda: respond("hedge"))
+        self.assertEqual(result, "hedge")
+        self.assertEqual(upstream.counters["hedges"], 1)
+        self.assertEqual(upstream.counters["hedge_wins"], 1)
+        await asyncio.wait_for(primary_cancelled.wait(), 1)
+
+    async def test_primary_can_still_win_after_hedging(self):
+        upstream = self.make_upstream()
+        result = await upstream.call(
+            lambda: respond("primary", delay=0.05),
+            hedge=lambda: respond("hedge", delay=0.5)
+        )
+        self.assertEqual(result, "primary")
+        self.assertEqual(upstream.counters["hedges"], 1)
+        self.assertEqual(upstream.counters["hedge_wins"], 0)
+
+    async def test_hedge_starts_when_primary_fails(self):
+        upstream = self.make_upstream(hedge_after=None)
+        result = await upstream.call(
+            lambda: fail_with(StatusError(503)),
+            hedge=lambda: respond("hedge")
+        )
+        self.assertEqual(result, "hedge")
+        self.assertEqual(upstream.counters["hedge_wins"], 1)
+        self.assertEqual(upstream.breaker.state, "closed")
+
+    async def test_both_failing_reports_the_error(self):
+        upstream = self.make_upstream(hedge_after=None)
+        with self.assertRaises(StatusError):
+            await upstream.call(
+                lambda: fail_with(StatusError(400)),
+                hedge=lambda: fail_with(StatusError(400))
+            )
+        # The provider answered both - a bad request, not an outage
+        self.assertEqual(upstream.counters["client_errors"], 1)
+        self.assertEqual(upstream.breaker.failures, 0)
+
+    async def test_latency_window_records_the_primary(self):
+        upstream = self.make_upstream(hedge_after=0.02)
+        await upstream.call(lambda: respond("primary", delay=0.3), hedge=lambda: respond("hedge"))
+
+        # The hedge answered at ~20 ms, but the primary was still running
+        # then - only its (lower bound) time is recorded
+        self.assertEqual(len(upstream.latency), 1)
+        self.assertGreaterEqual(upstream.latency.percentile(50), 0.02)
+
+    async def test_failed_primary_is_left_out_of_the_window(self):
+        upstream = self.make_upstream(hedge_after=None)
+        await upstream.call(lambda: fail_with(StatusError(503)), hedge=lambda: respond("hedge"))
+        self.assertEqual(len(upstream.latency), 0)
+
+    async def test_hedge_delay_follows_recent_latency(self):
+        upstream = self.make_upstream(hedge_after=5.0)
+        upstream.hedge_min_samples = 10
+        self.assertEqual(upstream.hedge_delay(), 5.0)
+        for ms in range(1, 21):
+            upstream.latency.add(ms / 1000)
+        self.assertAlmostEqual(upstream.hedge_delay(), 0.02)
+
+
+class UpstreamStreamTest(unittest.IsolatedAsyncioTestCase):
+    def make_upstream(self, timeout: float = 1.0) -> Upstream:
+        return Upstream("test.stream", CircuitBreaker("test", failure_threshold=1), timeout_seconds=timeout)
+
+    async def test_relays_items(self):
+        async def items():
+            for i in range(3):
+                yield i
+
+        upstream = self.make_upstream()
+        self.assertEqual([item async for item in upstream.stream(items)], [0, 1, 2])
+        self.assertEqual(len(upstream.latency), 1)
+
+    async def test_stalled_stream_times_out(self):
+        async def stalls():
+            yield "first"
+            await asyncio.sleep(1)
+            yield "never"
+
+        upstream = self.make_upstream(timeout=0.02)
+        received = []
+        with self.assertRaises(UpstreamTimeout):
+            async for item in upstream.stream(stalls):
+                received.append(item)
+        self.assertEqual(received, ["first"])
+        self.assertEqual(upstream.breaker.state, "open")
+
+    async def test_client_error_mid_stream_leaves_breaker_closed(self):
+        async def rejected():
+            raise StatusError(422)
+            yield  # pragma: no cover
+
+        upstream = self.make_upstream()
+        with self.assertRaises(StatusError):
+            async for _ in upstream.stream(rejected):
+                pass
+        self.assertEqual(upstream.breaker.state, "closed")
+
+
+if __name__ == "__main__":
+    unittest.main()
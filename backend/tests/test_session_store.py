@@ -0,0 +1,289 @@
+"""
+Tests for services/session_store.py and the Redis check-and-set write
+"""
+import sys
+import json
+import unittest
+from types import ModuleType
+from unittest import mock
+
+from services.session_backend import RedisSessionBackend
+from services.session_store import SessionStore
+
+
+class FakeBackend:
+    """Dict-backed stand-in for RedisSessionBackend"""
+
+    def __init__(self):
+        self.hashes = {}
+        self.saves = 0
+        self.before_save = None  # Called before each save (another worker writing)
+
+    async def version(self, session_id):
+        fields = self.hashes.get(session_id)
+        return int(fields["version"]) if fields else None
+
+    async def load(self, session_id):
+        fields = self.hashes.get(session_id)
+        return dict(fields) if fields else None
+
+    async def save(self, session_id, sections, expected_version):
+        self.saves += 1
+        if self.before_save:
+            self.before_save()
+        fields = self.hashes.setdefault(session_id, {"version": "0"})
+        if int(fields["version"]) != expected_version:
+            return None
+        fields.update(sections)
+        fields["version"] = str(int(fields["version"]) + 1)
+        return int(fields["version"])
+
+    async def close(self):
+        pass
+
+
+def memory_store(**kwargs) -> SessionStore:
+    with mock.patch.dict("os.environ", {"SESSION_STORE": "memory"}):
+        return SessionStore(**kwargs)
+
+
+def backed_store(backend: FakeBackend) -> SessionStore:
+    store = memory_store()
+    store.backend = backend
+    store.write_behind_seconds = 0
+    return store
+
+
+class WriteBehindTest(unittest.IsolatedAsyncioTestCase):
+    async def test_conflict_merges_other_worker_sections_and_retries(self):
+        backend = FakeBackend()
+        store = backed_store(backend)
+        session = await store.get_or_create("a")
+        session.summary = {"overview": "ours"}
+
+        def other_worker():
+            # Another worker writes the emotions first, once
+            backend.before_save = None
+            fields = backend.hashes.setdefault("a", {"version": "0"})
+            fields["emotions"] = json.dumps({"timeline": [], "counts": {"sad": 2}})
+            fields["version"] = str(int(fields["version"]) + 1)
+
+        backend.before_save = other_worker
+        store.save(session, "summary")
+        await store.close()
+
+        stored = backend.hashes["a"]
+        self.assertEqual(backend.saves, 2)
+        self.assertEqual(stored["version"], "2")
+        self.assertEqual(json.loads(stored["summary"])["summary"], {"overview": "ours"})
+        self.assertEqual(json.loads(stored["emotions"])["counts"], {"sad": 2})
+        # The local copy took the other worker's section and kept its own
+        self.assertEqual(session.emotion_counts, {"sad": 2})
+        self.assertEqual(session.summary, {"overview": "ours"})
+        self.assertEqual(session.version, 2)
+        self.assertFalse(session.dirty)
+
+    async def test_merge_keeps_chat_while_a_turn_is_running(self):
+        backend = FakeBackend()
+        store = backed_store(backend)
+        session = await store.get_or_create("a")
+        session.add_to_history("user", "ours")
+        backend.hashes["a"] = {
+            "version": "3",
+            "chat": json.dumps({"history": [{"role": "user", "content": "theirs"}],
+                                "exchange_count": 1, "history_digest": None, "chat_history": []}),
+        }
+
+        async with session.lock:
+            await store._merge_stored(session, {"summary"})
+
+        self.assertEqual(session.history(), [{"role": "user", "content": "ours"}])
+        self.assertEqual(session.version, 3)
+
+    async def test_gives_up_after_write_attempts_and_keeps_changes(self):
+        backend = FakeBackend()
+        store = backed_store(backend)
+        session = await store.get_or_create("a")
+
+        def always_ahead():
+            fields = backend.hashes.setdefault("a", {"version": "0"})
+            fields["version"] = str(int(fields["version"]) + 1)
+
+        backend.before_save = always_ahead
+        with mock.patch("builtins.print"):
+            store.save(session, "summary")
+            await store.close()
+
+        self.assertEqual(backend.saves, store.write_attempts)
+        self.assertEqual(session.dirty, {"summary"})
+        self.assertNotIn("summary", backend.hashes["a"])
+
+
+class FakeWatchError(Exception):
+    pass
+
+
+class FakePipeline:
+    """Records a WATCH/MULTI transaction against a FakeRedis hash"""
+
+    def __init__(self, redis):
+        self.redis = redis
+        self.queued = []
+
+    async def __aenter__(self):
+        return self
+
+    async def __aexit__(self, *exc):
+        return False
+
+    async def watch(self, key):
+        self.watched = key
+        self.redis.watches += 1
+
+    async def hget(self, key, field):
+        return self.redis.hashes.get(key, {}).get(field)
+
+    def multi(self):
+        pass
+
+    def hset(self, key, mapping):
+        self.queued.append(("hset", key, mapping))
+
+    def hincrby(self, key, field, amount):
+        self.queued.append(("hincrby", key, field, amount))
+
+    def expire(self, key, seconds):
+        self.queued.append(("expire", key, seconds))
+
+    async def execute(self):
+        if self.redis.touch_on_execute:
+            self.redis.touch_on_execute = False
+            raise FakeWatchError()
+        results = []
+        for op in self.queued:
+            fields = self.redis.hashes.setdefault(op[1], {})
+            if op[0] == "hset":
+                fields.update(op[2])
+                results.append(len(op[2]))
+            elif op[0] == "hincrby":
+                fields[op[2]] = str(int(fields.get(op[2], 0)) + op[3])
+                results.append(int(fields[op[2]]))
+            else:
+                self.redis.expiry[op[1]] = op[2]
+                results.append(True)
+        return results
+
+
+class FakeRedis:
+    def __init__(self):
+        self.hashes = {}
+        self.expiry = {}
+        self.watches = 0
+        self.touch_on_execute = False  # Another client writes between WATCH and EXEC
+
+    def pipeline(self, transaction=True):
+        return FakePipeline(self)
+
+
+class RedisCheckAndSetTest(unittest.IsolatedAsyncioTestCase):
+    def setUp(self):
+        exceptions = ModuleType("redis.exceptions")
+        exceptions.WatchError = FakeWatchError
+        redis = ModuleType("redis")
+        redis.exceptions = exceptions
+        patcher = mock.patch.dict(sys.modules, {"redis": redis, "redis.exceptions": exceptions})
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+        self.redis = FakeRedis()
+        self.backend = RedisSessionBackend.__new__(RedisSessionBackend)
+        self.backend.client = self.redis
+        self.backend.ttl_seconds = 60
+        self.backend.prefix = "test:"
+
+    async def test_writes_and_bumps_version_when_expected(self):
+        version = await self.backend.save("a", {"summary": "{}"}, 0)
+
+        self.assertEqual(version, 1)
+        self.assertEqual(self.redis.hashes["test:a"], {"summary": "{}", "version": "1"})
+        self.assertEqual(self.redis.expiry["test:a"], 60)
+        self.assertEqual(self.redis.watches, 1)
+
+    async def test_refuses_outdated_version(self):
+        self.redis.hashes["test:a"] = {"version": "4"}
+
+        self.assertIsNone(await self.backend.save("a", {"summary": "{}"}, 3))
+        self.assertEqual(self.redis.hashes["test:a"], {"version": "4"})
+
+    async def test_write_between_watch_and_exec_is_a_conflict(self):
+        self.redis.touch_on_execute = True
+
+        self.assertIsNone(await self.backend.save("a", {"summary": "{}"}, 0))
+        self.assertNotIn("test:a", self.redis.hashes)
+
+
+class EvictionTest(unittest.IsolatedAsyncioTestCase):
+    async def test_idle_sessions_expire_after_ttl(self):
+        store = memory_store(ttl_seconds=10)
+        with mock.patch("services.session_store.time.monotonic", return_value=100.0):
+            await store.get_or_create("old")
+        with mock.patch("services.session_store.time.monotonic", return_value=105.0):
+            await store.get_or_create("new")
+
+        with mock.patch("services.session_store.time.monotonic", return_value=111.0), mock.patch("builtins.print"):
+            self.assertIsNone(await store.get("old"))
+            self.assertIsNotNone(await store.get("new"))
+
+    async def test_expiry_skips_session_with_turn_running(self):
+        store = memory_store(ttl_seconds=10)
+        with mock.patch("services.session_store.time.monotonic", return_value=100.0):
+            session = await store.get_or_create("busy")
+
+        async with session.lock:
+            with mock.patch("services.session_store.time.monotonic", return_value=200.0):
+                self.assertIs(await store.get("busy"), session)
+
+    async def test_capacity_drops_least_recently_used(self):
+        store = memory_store(max_sessions=2)
+        await store.get_or_create("a")
+        await store.get_or_create("b")
+        await store.get_or_create("a")  # b is now least recently used
+
+        with mock.patch("builtins.print"):
+            await store.get_or_create("c")
+
+        self.assertIsNotNone(await store.get("a"))
+        self.assertIsNone(await store.get("b"))
+        self.assertEqual(len(store), 2)
+
+    async def test_capacity_keeps_in_use_and_dirty_sessions(self):
+        store = memory_store(max_sessions=2)
+        busy = await store.get_or_create("busy")
+        dirty = await store.get_or_create("dirty")
+        dirty.dirty.add("chat")
+
+        async with busy.lock:
+            await store.get_or_create("c")
+
+        self.assertEqual(len(store), 3)  # Over the cap until they are idle
+        self.assertIs(await store.get("busy"), busy)
+        self.assertIs(await store.get("dirty"), dirty)
+
+        dirty.dirty.clear()
+        with mock.patch("builtins.print"):
+            await store.get_or_create("d")
+        self.assertIsNone(await store.get("busy"))
+        self.assertIsNone(await store.get("dirty"))
+        self.assertEqual(len(store), 2)
+
+    async def test_missing_session_id_starts_a_new_session(self):
+        store = memory_store()
+        first = await store.get_or_create(None)
+        second = await store.get_or_create(None)
+
+        self.assertNotEqual(first.session_id, second.session_id)
+        self.assertIsNone(await store.get(None))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,236 @@
+"""
+Tests for services/speculation.py
+"""
+import asyncio
+import unittest
+from types import SimpleNamespace
+from unittest import mock
+
+from services.speculation import PartialSpeculator, SpeculativeReply, normalize_transcript
+
+
+class FakeModel:
+    """Streams the given chunks; waits on `release` first if one is set"""
+
+    def __init__(self, chunks=("Where ", "does it hurt?"), error=None):
+        self.chunks = chunks
+        self.error = error
+        self.release = None
+        self.requests = []
+
+    async def generate_content_async(self, contents, stream=True):
+        self.requests.append(contents)
+
+        async def response():
+            if self.release is not None:
+                await self.release.wait()
+            for text in self.chunks:
+                yield SimpleNamespace(text=text)
+            if self.error is not None:
+                raise self.error
+
+        return response()
+
+
+class PassThroughUpstream:
+    async def stream(self, factory):
+        async for chunk in factory():
+            yield chunk
+
+
+def make_session():
+    history = [{"role": "user", "parts": ["hello"]}, {"role": "model", "parts": ["Hi!"]}]
+    return SimpleNamespace(chat_session=SimpleNamespace(history=list(history)), exchange_count=1)
+
+
+CONTEXT = {"emotion": "sad", "age": 40, "age_category": "Adult"}
+
+
+def start_reply(model, session, message="my knee hurts"):
+    return SpeculativeReply(
+        model, asyncio.Semaphore(1), PassThroughUpstream(), session, message, dict(CONTEXT), "CTX: " + message
+    )
+
+
+async def collect(reply) -> str:
+    return "".join([text async for text in reply.chunks()])
+
+
+class SpeculativeReplyTest(unittest.IsolatedAsyncioTestCase):
+    async def test_generates_from_history_snapshot(self):
+        model = FakeModel()
+        session = make_session()
+        reply = start_reply(model, session)
+
+        self.assertEqual(await collect(reply), "Where does it hurt?")
+        self.assertEqual(model.requests[0][-1], {"role": "user", "parts": ["CTX: my knee hurts"]})
+        # Nothing is recorded until commit
+        self.assertEqual(len(session.chat_session.history), 2)
+
+    async def test_commit_records_the_exchange(self):
+        session = make_session()
+        reply = start_reply(FakeModel(), session)
+        text = await collect(reply)
+
+        reply.commit(session, text)
+
+        self.assertTrue(reply.committed)
+        self.assertEqual(session.chat_session.history[2:], [
+            {"role": "user", "parts": ["CTX: my knee hurts"]},
+            {"role": "model", "parts": ["Where does it hurt?"]},
+        ])
+
+    async def test_matches_same_words_in_same_session_state(self):
+        session = make_session()
+        reply = start_reply(FakeModel(), session)
+
+        self.assertTrue(reply.matches(session, "My knee... hurts!"))
+        self.assertFalse(reply.matches(session, "my knee hurts badly"))
+
+        session.exchange_count += 1  # Another turn landed first
+        self.assertFalse(reply.matches(session, "my knee hurts"))
+        await collect(reply)
+
+    async def test_cancel_stops_generation_and_discards(self):
+        model = FakeModel()
+        model.release = asyncio.Event()
+        session = make_session()
+        reply = start_reply(model, session)
+        await asyncio.sleep(0)
+
+        reply.cancel()
+        await asyncio.sleep(0)
+
+        self.assertFalse(reply.matches(session, "my knee hurts"))
+        with self.assertRaises(RuntimeError):
+            await collect(reply)
+
+    async def test_failed_generation_no_longer_matches(self):
+        session = make_session()
+        reply = start_reply(FakeModel(error=ConnectionError("reset")), session)
+
+        with self.assertRaises(ConnectionError):
+            await collect(reply)
+        self.assertFalse(reply.matches(session, "my knee hurts"))
+
+
+class FakeReply:
+    def __init__(self, message):
+        self.key = normalize_transcript(message)
+        self.cancelled = False
+
+    def cancel(self):
+        self.cancelled = True
+
+
+class FakeGemini:
+    """Starts FakeReplies; waits on `release` first if one is set"""
+
+    def __init__(self):
+        self.started = []
+        self.release = None
+
+    async def speculate(self, message, context, emotion_context=None, session_id=None):
+        if self.release is not None:
+            await self.release.wait()
+        self.started.append(message)
+        return FakeReply(message)
+
+
+class PartialSpeculatorTest(unittest.IsolatedAsyncioTestCase):
+    def setUp(self):
+        analyzer = mock.Mock()
+        analyzer.analyze_mismatch_async = mock.AsyncMock(return_value=None)
+        self.gemini = FakeGemini()
+        self.speculator = PartialSpeculator(self.gemini, analyzer, min_words=3)
+        patcher = mock.patch("builtins.print")
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+    async def feed(self, *partials):
+        for text in partials:
+            await self.speculator.on_partial(text, "s", dict(CONTEXT))
+
+    async def test_starts_once_a_partial_is_stable(self):
+        await self.feed("my knee", "my knee hurts")
+        self.assertEqual(self.gemini.started, [])
+
+        await self.feed("My knee hurts.")
+        self.assertEqual(self.gemini.started, ["My knee hurts."])
+
+        await self.feed("my knee hurts")  # Same guess - not restarted
+        self.assertEqual(len(self.gemini.started), 1)
+
+    async def test_short_partials_are_ignored(self):
+        await self.feed("it hurts", "it hurts")
+        self.assertEqual(self.gemini.started, [])
+
+    async def test_new_stable_partial_replaces_the_guess(self):
+        await self.feed("my knee hurts", "my knee hurts")
+        first = self.speculator.reply
+        await self.feed("my knee hurts a lot", "my knee hurts a lot")
+
+        self.assertTrue(first.cancelled)
+        self.assertEqual(self.speculator.reply.key, "my knee hurts a lot")
+
+    async def test_take_hands_over_and_stops_speculating(self):
+        await self.feed("my knee hurts", "my knee hurts")
+        reply = self.speculator.take()
+
+        await self.feed("something else entirely", "something else entirely")
+
+        self.assertEqual(reply.key, "my knee hurts")
+        self.assertFalse(reply.cancelled)
+        self.assertIsNone(self.speculator.reply)
+        self.assertEqual(len(self.gemini.started), 1)
+
+    async def test_cancel_discards_the_guess(self):
+        await self.feed("my knee hurts", "my knee hurts")
+        reply = self.speculator.reply
+
+        self.speculator.cancel()
+
+        self.assertTrue(reply.cancelled)
+        self.assertIsNone(self.speculator.take())
+
+    async def test_feed_does_not_wait_for_the_start(self):
+        self.gemini.release = asyncio.Event()
+        await self.feed("my knee hurts")
+
+        self.speculator.feed("my knee hurts", "s", dict(CONTEXT))  # Returns while the start is pending
+        await asyncio.sleep(0)
+        self.assertIsNone(self.speculator.reply)
+
+        self.gemini.release.set()
+        await asyncio.sleep(0.01)
+        self.assertEqual(self.speculator.reply.key, "my knee hurts")
+
+    async def test_cancel_stops_a_pending_start(self):
+        self.gemini.release = asyncio.Event()
+        await self.feed("my knee hurts")
+        self.speculator.feed("my knee hurts", "s", dict(CONTEXT))
+        await asyncio.sleep(0)
+
+        self.speculator.cancel()
+        self.gemini.release.set()
+        await asyncio.sleep(0.01)
+
+        self.assertIsNone(self.speculator.reply)
+        self.assertEqual(self.gemini.started, [])
+
+    async def test_overlapping_starts_leave_one_guess(self):
+        self.gemini.release = asyncio.Event()
+        await self.feed("my knee hurts")
+        self.speculator.feed("my knee hurts", "s", dict(CONTEXT))
+        self.speculator.feed("my knee hurts", "s", dict(CONTEXT))
+        await asyncio.sleep(0)
+
+        self.gemini.release.set()
+        await asyncio.sleep(0.01)
+
+        # The second start saw the first one's reply and kept it
+        self.assertEqual(self.gemini.started, ["my knee hurts"])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,111 @@
+"""
+Tests for services/speech_pipeline.py - sentence splitting of streamed text
+and failed sentence speech
+"""
+import unittest
+from unittest import mock
+
+from services.frames import FRAME_AUDIO, FRAME_DONE, FRAME_ERROR, FRAME_TEXT_DELTA
+from services.resilience import CircuitOpenError
+from services.speech_pipeline import SentenceSplitter, SpeechPipeline
+
+
+def split(deltas, min_chars: int = 0):
+    splitter = SentenceSplitter(min_chars=min_chars)
+    sentences = []
+    for delta in deltas:
+        sentences.extend(splitter.feed(delta))
+    return sentences, splitter.flush()
+
+
+class SentenceSplitterTest(unittest.TestCase):
+    def test_sentences_complete_across_deltas(self):
+        sentences, rest = split(["I under", "stand. How long", " has it hurt? ", "Since"])
+        self.assertEqual(sentences, ["I understand.", "How long has it hurt?"])
+        self.assertEqual(rest, "Since")
+
+    def test_sentence_needs_following_whitespace(self):
+        sentences, rest = split(["That is 2.5 mg."])
+        self.assertEqual(sentences, [])
+        self.assertEqual(rest, "That is 2.5 mg.")
+
+    def test_abbreviations_do_not_end_sentences(self):
+        sentences, _ = split(["Please see Dr. Smith soon. ", "Thanks"])
+        self.assertEqual(sentences, ["Please see Dr. Smith soon."])
+
+    def test_short_sentences_merge_with_the_next(self):
+        sentences, rest = split(["Okay. I see. That sounds painful. "], min_chars=12)
+        self.assertEqual(sentences, ["Okay. I see.", "That sounds painful."])
+        self.assertEqual(rest, "")
+
+    def test_closing_quotes_stay_with_the_sentence(self):
+        sentences, _ = split(['You said "it burns." Does it spread? '])
+        self.assertEqual(sentences, ['You said "it burns."', "Does it spread?"])
+
+
+class FakeTTS:
+    """Speaks each sentence as its own bytes; fails sentences listed in `errors`"""
+
+    def __init__(self, errors=None):
+        self.errors = errors or {}
+        self.spoken = []
+
+    async def stream_speech_with_visemes(self, text, voice_id=None):
+        self.spoken.append(text)
+        if text in self.errors:
+            raise self.errors[text]
+        yield FRAME_AUDIO, text.encode()
+
+
+async def reply_events(*sentences):
+    text = " ".join(sentences)
+    for sentence in sentences:
+        yield {"type": "delta", "text": sentence + " "}
+    yield {"type": "done", "text": text}
+
+
+class FailedSentenceTest(unittest.IsolatedAsyncioTestCase):
+    SENTENCES = ("How long has this been going on?", "Does the pain spread anywhere?", "Have you taken anything for it?")
+
+    def setUp(self):
+        patcher = mock.patch("builtins.print")
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+    async def run_pipeline(self, tts):
+        pipeline = SpeechPipeline(tts, max_parallel=1)
+        return [item async for item in pipeline.run(reply_events(*self.SENTENCES))]
+
+    async def test_failed_sentence_gets_an_error_frame_in_its_place(self):
+        first, second, third = self.SENTENCES
+        tts = FakeTTS(errors={second: RuntimeError("TTS streaming failed")})
+
+        frames = await self.run_pipeline(tts)
+
+        speech = [(kind, payload) for kind, payload in frames if kind in (FRAME_AUDIO, FRAME_ERROR)]
+        self.assertEqual(speech, [
+            (FRAME_AUDIO, first.encode()),
+            (FRAME_ERROR, {"detail": "Speech failed for this sentence", "text": second}),
+            (FRAME_AUDIO, third.encode()),
+        ])
+        # The text itself is unaffected
+        self.assertEqual(sum(kind == FRAME_TEXT_DELTA for kind, _ in frames), 3)
+        self.assertEqual(sum(kind == FRAME_DONE for kind, _ in frames), 1)
+
+    async def test_open_circuit_turns_the_rest_of_the_reply_text_only(self):
+        first, second, third = self.SENTENCES
+        tts = FakeTTS(errors={second: CircuitOpenError("elevenlabs circuit open"),
+                              third: CircuitOpenError("elevenlabs circuit open")})
+
+        frames = await self.run_pipeline(tts)
+
+        speech = [(kind, payload) for kind, payload in frames if kind in (FRAME_AUDIO, FRAME_ERROR)]
+        self.assertEqual(speech, [
+            (FRAME_AUDIO, first.encode()),
+            (FRAME_ERROR, {"detail": "Speech unavailable - the rest of this reply is text only", "text": second}),
+        ])
+        self.assertNotIn(third, tts.spoken)
+
+
+if __name__ == "__main__":
+    unittest.main()
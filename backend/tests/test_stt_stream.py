@@ -0,0 +1,109 @@
+"""
+Tests for services/stt_stream.py partial transcript limits
+"""
+import asyncio
+import itertools
+import unittest
+from types import SimpleNamespace
+from unittest import mock
+
+from services.stt_stream import StreamingTranscription
+
+
+class FakeSTT:
+    """Transcribes audio as its length; counts calls and bytes sent"""
+
+    def __init__(self):
+        self.calls = []
+        self.busy = False
+
+    def stt_busy(self) -> bool:
+        return self.busy
+
+    async def speech_to_text(self, audio: bytes) -> str:
+        self.calls.append(len(audio))
+        await asyncio.sleep(0)
+        return f"heard {len(audio)}"
+
+
+class StreamingTranscriptionTest(unittest.IsolatedAsyncioTestCase):
+    def setUp(self):
+        # Every clock read is 10 s later, so the partial interval never holds a partial back
+        clock = itertools.count(100, 10)
+        patcher = mock.patch("services.stt_stream.time", SimpleNamespace(monotonic=lambda: next(clock)))
+        patcher.start()
+        self.addCleanup(patcher.stop)
+        self.stt = FakeSTT()
+        self.partials = []
+
+    def transcription(self, **limits) -> StreamingTranscription:
+        async def on_partial(text):
+            self.partials.append(text)
+
+        options = {"partial_interval_ms": 1000, "min_partial_bytes": 10, "max_partial_bytes": 1000, "max_partials": 8}
+        options.update(limits)
+        return StreamingTranscription(self.stt, on_partial, **options)
+
+    async def feed(self, stream: StreamingTranscription, chunks: int, size: int):
+        for _ in range(chunks):
+            stream.add_chunk(b"x" * size)
+            await asyncio.sleep(0.001)  # Let the partial finish before the next chunk
+
+    async def test_no_partial_below_min_bytes(self):
+        stream = self.transcription(min_partial_bytes=100)
+        await self.feed(stream, 3, 20)
+
+        self.assertEqual(self.stt.calls, [])
+        self.assertEqual(await stream.finish(), "heard 60")
+
+    async def test_partials_stop_after_max_polls(self):
+        stream = self.transcription(max_partials=3)
+        await self.feed(stream, 10, 20)
+
+        self.assertEqual(self.stt.calls, [20, 40, 60])
+        self.assertEqual(self.partials, ["heard 20", "heard 40", "heard 60"])
+        # The final transcript still covers the whole utterance
+        self.assertEqual(await stream.finish(), "heard 200")
+
+    async def test_partials_stop_past_max_bytes(self):
+        stream = self.transcription(max_partial_bytes=50)
+        await self.feed(stream, 5, 20)
+
+        self.assertEqual(self.stt.calls, [20, 40])
+        self.assertEqual(await stream.finish(), "heard 100")
+        self.assertEqual(self.stt.calls[-1], 100)
+
+    async def test_partial_skipped_while_stt_busy(self):
+        stream = self.transcription()
+        self.stt.busy = True
+        await self.feed(stream, 2, 20)
+        self.stt.busy = False
+        await self.feed(stream, 1, 20)
+
+        self.assertEqual(self.stt.calls, [60])
+
+    async def test_final_reuses_partial_of_the_same_audio(self):
+        stream = self.transcription()
+        await self.feed(stream, 2, 20)
+
+        self.assertEqual(await stream.finish(), "heard 40")
+        self.assertEqual(self.stt.calls, [20, 40])  # No extra transcription
+
+    async def test_interval_disabled_means_no_partials(self):
+        stream = self.transcription(partial_interval_ms=0)
+        await self.feed(stream, 3, 20)
+
+        self.assertEqual(await stream.finish(), "heard 60")
+        self.assertEqual(self.stt.calls, [60])
+
+    async def test_finish_resets_limits_for_next_utterance(self):
+        stream = self.transcription(max_partials=1)
+        await self.feed(stream, 2, 20)
+        await stream.finish()
+        await self.feed(stream, 1, 20)
+
+        self.assertEqual(self.stt.calls, [20, 40, 20])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,218 @@
+"""
+Tests for services/viseme.py and viseme offsets in streamed TTS
+"""
+import os
+import asyncio
+import base64
+import unittest
+from types import SimpleNamespace
+from unittest import mock
+
+from services.frames import FRAME_AUDIO, FRAME_VISEMES
+from services.viseme import (
+    VISEME_AA,
+    VISEME_DD,
+    VISEME_KK,
+    VISEME_I,
+    VISEME_SILENCE,
+    VISEME_TH,
+    alignment_to_visemes,
+    extract_alignment,
+    merge_timelines,
+    mp3_duration_ms,
+    shift_timeline,
+)
+
+
+def alignment(text: str, start: float = 0.0, step: float = 0.1) -> dict:
+    """Evenly spaced character timestamps for text"""
+    return {
+        "characters": list(text),
+        "start_times": [start + i * step for i in range(len(text))],
+        "end_times": [start + (i + 1) * step for i in range(len(text))],
+    }
+
+
+class AlignmentToVisemesTest(unittest.TestCase):
+    def test_characters_become_keys(self):
+        timeline = alignment_to_visemes(**alignment("hi"))
+        self.assertEqual(timeline, {"t": [0, 100, 200], "v": [VISEME_KK, VISEME_I, VISEME_SILENCE]})
+
+    def test_offset_moves_every_key(self):
+        plain = alignment_to_visemes(**alignment("hello there"))
+        shifted = alignment_to_visemes(**alignment("hello there"), offset_ms=1500)
+        self.assertEqual(shifted["v"], plain["v"])
+        self.assertEqual(shifted["t"], [t + 1500 for t in plain["t"]])
+
+    def test_digraphs_make_one_shape(self):
+        timeline = alignment_to_visemes(**alignment("the"))
+        self.assertEqual(timeline["v"][0], VISEME_TH)
+        self.assertEqual(timeline["t"][:2], [0, 200])
+
+    def test_repeated_visemes_are_merged(self):
+        timeline = alignment_to_visemes(**alignment("dt"))
+        self.assertEqual(timeline["v"], [VISEME_DD, VISEME_SILENCE])
+
+    def test_short_pauses_keep_the_mouth_open(self):
+        timeline = alignment_to_visemes(**alignment("a a", step=0.02))
+        self.assertEqual(timeline["v"], [VISEME_AA, VISEME_SILENCE])
+
+    def test_long_pauses_close_the_mouth(self):
+        timeline = alignment_to_visemes(**alignment("a a", step=0.1))
+        self.assertEqual(timeline["v"], [VISEME_AA, VISEME_SILENCE, VISEME_AA, VISEME_SILENCE])
+
+    def test_keys_stay_in_order(self):
+        timeline = alignment_to_visemes(
+            characters=list("abc"),
+            start_times=[0.0, 0.0, 0.1],
+            end_times=[0.0, 0.1, 0.2]
+        )
+        self.assertEqual(timeline["t"], sorted(set(timeline["t"])))
+
+    def test_empty_alignment(self):
+        self.assertEqual(alignment_to_visemes([], [], []), {"t": [], "v": []})
+
+
+class TimelineTest(unittest.TestCase):
+    def test_merge_concatenates_in_stream_order(self):
+        first = {"t": [0, 100], "v": [VISEME_AA, VISEME_SILENCE]}
+        second = {"t": [1000, 1100], "v": [VISEME_I, VISEME_SILENCE]}
+        self.assertEqual(merge_timelines([first, second]), {
+            "t": [0, 100, 1000, 1100],
+            "v": [VISEME_AA, VISEME_SILENCE, VISEME_I, VISEME_SILENCE],
+        })
+        self.assertEqual(merge_timelines([]), {"t": [], "v": []})
+
+    def test_shift_rounds_and_copies(self):
+        timeline = {"t": [0, 100], "v": [VISEME_AA, VISEME_SILENCE]}
+        shifted = shift_timeline(timeline, 249.6)
+        self.assertEqual(shifted, {"t": [250, 350], "v": [VISEME_AA, VISEME_SILENCE]})
+        self.assertEqual(timeline["t"], [0, 100])
+
+    def test_mp3_duration(self):
+        # 128 kbps: 16 KB per second
+        self.assertEqual(mp3_duration_ms(16000), 1000)
+        self.assertEqual(mp3_duration_ms(0), 0)
+
+    def test_extract_prefers_normalized_alignment(self):
+        raw = SimpleNamespace(characters=["1"], character_start_times_seconds=[0.0], character_end_times_seconds=[0.1])
+        spoken = SimpleNamespace(
+            characters=list("one"),
+            character_start_times_seconds=[0.0, 0.1, 0.2],
+            character_end_times_seconds=[0.1, 0.2, 0.3]
+        )
+        response = SimpleNamespace(alignment=raw, normalized_alignment=spoken)
+        self.assertEqual(extract_alignment(response)["characters"], ["o", "n", "e"])
+        self.assertIsNone(extract_alignment(SimpleNamespace(alignment=None, normalized_alignment=None)))
+
+
+def speech_chunk(audio: bytes, text: str, start: float) -> SimpleNamespace:
+    """A stream_with_timestamps chunk"""
+    timing = alignment(text, start=start)
+    return SimpleNamespace(
+        audio_base_64=base64.b64encode(audio).decode("ascii"),
+        alignment=SimpleNamespace(
+            characters=timing["characters"],
+            character_start_times_seconds=timing["start_times"],
+            character_end_times_seconds=timing["end_times"],
+        ),
+        normalized_alignment=None,
+    )
+
+
+class FakeTextToSpeech:
+    def __init__(self, chunks):
+        self.chunks = chunks
+        self.calls = 0
+
+    async def stream_with_timestamps(self, **kwargs):
+        self.calls += 1
+        for chunk in self.chunks:
+            yield chunk
+
+
+class StreamedVisemesTest(unittest.IsolatedAsyncioTestCase):
+    def make_service(self, chunks):
+        with mock.patch.dict(os.environ, {"ELEVENLABS_API_KEY": "test", "TTS_CACHE_DIR": ""}):
+            from services.elevenlabs_service import ElevenLabsService
+            service = ElevenLabsService()
+        service._sdk_voice_settings = {}  # Skip the SDK import
+        service._client = SimpleNamespace(text_to_speech=FakeTextToSpeech(chunks))
+        return service
+
+    async def collect(self, service, text: str):
+        return [item async for item in service.stream_speech_with_visemes(text)]
+
+    async def test_restarted_chunk_timestamps_follow_the_audio_sent(self):
+        # One second of audio per chunk; the second chunk's times restart at 0
+        service = self.make_service([
+            speech_chunk(b"\0" * 16000, "hi", start=0.0),
+            speech_chunk(b"\0" * 16000, "hi", start=0.0),
+        ])
+        frames = await self.collect(service, "hi hi")
+        timelines = [payload for kind, payload in frames if kind == FRAME_VISEMES]
+        self.assertEqual(timelines[0]["t"], [0, 100, 200])
+        self.assertEqual(timelines[1]["t"], [1000, 1100, 1200])
+
+    async def test_continuing_chunk_timestamps_are_kept(self):
+        service = self.make_service([
+            speech_chunk(b"\0" * 16000, "hi", start=0.0),
+            speech_chunk(b"\0" * 16000, "hi", start=0.5),
+        ])
+        frames = await self.collect(service, "hi hi")
+        timelines = [payload for kind, payload in frames if kind == FRAME_VISEMES]
+        self.assertEqual(timelines[1]["t"], [500, 600, 700])
+
+    async def test_cached_replay_has_the_merged_timeline(self):
+        service = self.make_service([
+            speech_chunk(b"\0" * 16000, "hi", start=0.0),
+            speech_chunk(b"\0" * 16000, "hi", start=0.0),
+        ])
+        await self.collect(service, "hi hi")
+        replay = await self.collect(service, "hi hi")
+
+        self.assertEqual(service.client.text_to_speech.calls, 1)
+        self.assertEqual(replay[0], (FRAME_VISEMES, {
+            "t": [0, 100, 200, 1000, 1100, 1200],
+            "v": [VISEME_KK, VISEME_I, VISEME_SILENCE] * 2,
+        }))
+        audio = b"".join(payload for kind, payload in replay if kind == FRAME_AUDIO)
+        self.assertEqual(len(audio), 32000)
+
+    async def test_slot_released_before_slow_consumer_finishes(self):
+        service = self.make_service([speech_chunk(b"\0" * 1600, "hi", start=0.0)] * 4)
+        service._limiter = asyncio.Semaphore(1)
+        stream = service.stream_speech_with_visemes("hi hi hi hi")
+
+        first = await stream.__anext__()
+        await asyncio.sleep(0.05)  # Upstream is read ahead while the consumer stalls
+
+        self.assertEqual(first[0], FRAME_VISEMES)
+        self.assertFalse(service._limiter.locked())
+        rest = [item async for item in stream]
+        self.assertEqual(sum(kind == FRAME_AUDIO for kind, _ in rest), 4)
+
+    async def test_upstream_error_reaches_consumer(self):
+        service = self.make_service([])
+
+        async def failing(**kwargs):
+            raise ConnectionError("reset")
+            yield
+
+        service.client.text_to_speech.stream_with_timestamps = failing
+        with self.assertRaises(Exception):
+            await self.collect(service, "hi")
+        self.assertFalse(service._limiter.locked())
+
+    async def test_audio_only_stream_fills_the_viseme_cache(self):
+        service = self.make_service([speech_chunk(b"\0" * 1600, "hi", start=0.0)])
+        audio = [chunk async for chunk in service.generate_speech_stream("hi")]
+        self.assertEqual(b"".join(audio), b"\0" * 1600)
+
+        _, visemes = await service.synthesize_with_visemes("hi")
+        self.assertEqual(visemes["v"], [VISEME_KK, VISEME_I, VISEME_SILENCE])
+        self.assertEqual(service.client.text_to_speech.calls, 1)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -18,6 +18,11 @@ export async function POST(request: NextRequest) {
       body: JSON.stringify(body),
     });
     
+    // Pass "session not found" through so the client can resend the transcript
+    if (response.status === 404) {
+      return NextResponse.json(await response.json(), { status: 404 });
+    }
+
     if (!response.ok) {
       throw new Error(`Backend responded with status: ${response.status}`);
     }
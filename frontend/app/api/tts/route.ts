@@ -9,11 +9,13 @@ const BACKEND_URL = process.env.BACKEND_URL || 'http://localhost:8000';
 export async function POST(request: NextRequest) {
   try {
     const body = await request.json();
+    const accept = request.headers.get('accept') || 'application/json';
     
     const response = await fetch(`${BACKEND_URL}/api/tts`, {
       method: 'POST',
       headers: {
         'Content-Type': 'application/json',
+        Accept: accept,
       },
       body: JSON.stringify(body),
     });
@@ -22,6 +24,14 @@ export async function POST(request: NextRequest) {
       throw new Error(`Backend responded with status: ${response.status}`);
     }
     
+    // Pass binary audio straight through without buffering it
+    const contentType = response.headers.get('content-type') || '';
+    if (contentType.startsWith('audio/')) {
+      return new Response(response.body, {
+        headers: { 'Content-Type': contentType },
+      });
+    }
+    
     const data = await response.json();
     return NextResponse.json(data);
   } catch (error) {
@@ -32,4 +42,3 @@ export async function POST(request: NextRequest) {
     );
   }
 }
-
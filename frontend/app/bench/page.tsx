@@ -0,0 +1,340 @@
+/**
+ * Benchmark page - face-detection inference and avatar/background frame times
+ *
+ * Open /bench on the reference machine. Face detection runs on the webcam
+ * (or ?video=<url> for a repeatable clip) at a fixed interval while the
+ * Avatar renders at full rate and LiquidEther runs its demo; after a
+ * warm-up, every detection pass and frame() call is timed.
+ *
+ * Query params: seconds (20), warmup (3), interval (200 ms), video, avatar,
+ * label (machine name for the report).
+ *
+ * The report is shown, downloadable, and set as window.__AURALIS_BENCH__
+ * (with document.body.dataset.bench = "done") for headless runs. Compare it
+ * with a baseline using backend/benchmarks/compare.py.
+ */
+"use client";
+
+import { useEffect, useRef, useState } from "react";
+import Avatar from "../components/Avatar";
+import LiquidEther from "../components/LiquidEther";
+import {
+  isWorkerDetectionSupported,
+  loadFaceDetectionModels,
+  startEmotionDetection,
+  warmUpFaceDetection,
+} from "../../lib/faceDetection";
+import { getRenderTelemetry, observeFrameTimes } from "../../lib/renderGovernor";
+
+const REPORT_VERSION = 1;
+const AVATAR_LOAD_TIMEOUT_MS = 30000;
+
+// Report step per governed render loop
+const LOOP_STEPS: Record<string, string> = {
+  avatar: "avatar_frame",
+  "liquid-ether": "liquid_ether_frame",
+};
+
+interface BenchConfig {
+  seconds: number;
+  warmupSeconds: number;
+  intervalMs: number;
+  video: string | null;
+  avatarId: string;
+  label: string | null;
+}
+
+interface StepStats {
+  count: number;
+  errors: number;
+  error_rate: number;
+  mean_ms: number | null;
+  p50_ms: number | null;
+  p95_ms: number | null;
+  p99_ms: number | null;
+  max_ms: number | null;
+  per_second: number;
+}
+
+interface BenchReport {
+  benchmark: "browser-render";
+  version: number;
+  started_at: string;
+  label: string | null;
+  duration_seconds: number;
+  config: BenchConfig;
+  environment: Record<string, string | number | boolean | null>;
+  load: Record<string, number | null>;
+  error_rate: number;
+  steps: Record<string, StepStats>;
+  skipped: Record<string, string>;
+  render_tiers: ReturnType<typeof getRenderTelemetry>;
+}
+
+declare global {
+  interface Window {
+    __AURALIS_BENCH__?: BenchReport;
+  }
+}
+
+function readConfig(): BenchConfig {
+  const params = new URLSearchParams(window.location.search);
+  const number = (name: string, fallback: number) => {
+    const value = Number(params.get(name));
+    return Number.isFinite(value) && value > 0 ? value : fallback;
+  };
+  return {
+    seconds: number("seconds", 20),
+    warmupSeconds: number("warmup", 3),
+    intervalMs: number("interval", 200),
+    video: params.get("video"),
+    avatarId: params.get("avatar") ?? "doctorm",
+    label: params.get("label"),
+  };
+}
+
+const round = (value: number | null) => (value === null ? null : Math.round(value * 100) / 100);
+
+/**
+ * Same shape as the load generator's steps, so one comparison covers both
+ */
+function summarize(samples: number[], seconds: number): StepStats {
+  const ordered = [...samples].sort((a, b) => a - b);
+  const percentile = (p: number) =>
+    ordered.length ? ordered[Math.min(ordered.length - 1, Math.max(0, Math.ceil((ordered.length * p) / 100) - 1))] : null;
+  return {
+    count: ordered.length,
+    errors: 0,
+    error_rate: 0,
+    mean_ms: ordered.length ? round(ordered.reduce((sum, ms) => sum + ms, 0) / ordered.length) : null,
+    p50_ms: round(percentile(50)),
+    p95_ms: round(percentile(95)),
+    p99_ms: round(percentile(99)),
+    max_ms: round(ordered.length ? ordered[ordered.length - 1] : null),
+    per_second: round(ordered.length / seconds) ?? 0,
+  };
+}
+
+function webglRenderer(): string | null {
+  const gl = document.createElement("canvas").getContext("webgl");
+  if (!gl) return null;
+  const info = gl.getExtension("WEBGL_debug_renderer_info");
+  return String(info ? gl.getParameter(info.UNMASKED_RENDERER_WEBGL) : gl.getParameter(gl.RENDERER));
+}
+
+function describeEnvironment(): BenchReport["environment"] {
+  return {
+    user_agent: navigator.userAgent,
+    hardware_concurrency: navigator.hardwareConcurrency ?? null,
+    device_memory_gb: (navigator as Navigator & { deviceMemory?: number }).deviceMemory ?? null,
+    device_pixel_ratio: window.devicePixelRatio,
+    viewport: `${window.innerWidth}x${window.innerHeight}`,
+    gpu: webglRenderer(),
+    worker_detection: isWorkerDetectionSupported(),
+  };
+}
+
+async function openVideo(video: HTMLVideoElement, src: string | null): Promise<void> {
+  video.muted = true;
+  video.playsInline = true;
+  if (src) {
+    video.src = src;
+    video.loop = true;
+  } else {
+    video.srcObject = await navigator.mediaDevices.getUserMedia({ video: { width: 640, height: 480 } });
+  }
+  await video.play();
+}
+
+const sleep = (ms: number) => new Promise<void>((resolve) => setTimeout(resolve, ms));
+
+function deferred() {
+  let resolve = () => {};
+  const promise = new Promise<void>((done) => {
+    resolve = done;
+  });
+  return { promise, resolve };
+}
+
+export default function BenchPage() {
+  const videoRef = useRef<HTMLVideoElement>(null);
+  const canvasRef = useRef<HTMLCanvasElement>(null);
+  const avatarReady = useRef(deferred());
+  const mountedAt = useRef(0);
+  const avatarLoadedAt = useRef<number | null>(null);
+  const [config, setConfig] = useState<BenchConfig | null>(null);
+  const [status, setStatus] = useState("Starting…");
+  const [measuring, setMeasuring] = useState(false);
+  const [report, setReport] = useState<BenchReport | null>(null);
+
+  useEffect(() => {
+    mountedAt.current = performance.now();
+    setConfig(readConfig());
+  }, []);
+
+  useEffect(() => {
+    if (!config) return;
+    const video = videoRef.current!;
+    let cancelled = false;
+    let stopDetection = () => {};
+    let stopObserving = () => {};
+
+    const run = async () => {
+      const startedAt = new Date().toISOString();
+      const load: BenchReport["load"] = {};
+      const skipped: BenchReport["skipped"] = {};
+
+      setStatus("Loading face detection models…");
+      const loadStartedAt = performance.now();
+      try {
+        await loadFaceDetectionModels();
+        await warmUpFaceDetection();
+        load.face_models_ms = round(performance.now() - loadStartedAt);
+        await openVideo(video, config.video);
+      } catch (error) {
+        skipped.face_detection = error instanceof Error ? error.message : String(error);
+      }
+
+      // The avatar loads alongside the models, from mount
+      setStatus("Loading avatar…");
+      await Promise.race([avatarReady.current.promise, sleep(AVATAR_LOAD_TIMEOUT_MS)]);
+      if (avatarLoadedAt.current === null) {
+        skipped.avatar_load = `Avatar did not load within ${AVATAR_LOAD_TIMEOUT_MS / 1000}s`;
+      }
+      load.avatar_ms = avatarLoadedAt.current === null ? null : round(avatarLoadedAt.current - mountedAt.current);
+      if (cancelled) return;
+
+      const inference: number[] = [];
+      const frames: Record<string, number[]> = {};
+      let recording = false;
+
+      // Speaking keeps the avatar loop at full rate
+      setMeasuring(true);
+      stopObserving = observeFrameTimes((name, ms) => {
+        if (recording) (frames[name] ??= []).push(ms);
+      });
+      if (!skipped.face_detection) {
+        stopDetection = startEmotionDetection(
+          video,
+          canvasRef.current,
+          () => {},
+          config.intervalMs,
+          () => true,
+          {
+            adaptive: false,
+            onInferenceTime: (ms) => {
+              if (recording) inference.push(ms);
+            },
+          }
+        );
+      }
+
+      setStatus(`Warming up (${config.warmupSeconds}s)…`);
+      await sleep(config.warmupSeconds * 1000);
+      recording = true;
+      setStatus(`Measuring (${config.seconds}s)…`);
+      await sleep(config.seconds * 1000);
+      recording = false;
+
+      const renderTiers = getRenderTelemetry();
+      stopDetection();
+      stopObserving();
+      setMeasuring(false);
+      if (cancelled) return;
+
+      const steps: BenchReport["steps"] = {};
+      if (!skipped.face_detection) {
+        steps.face_detection = summarize(inference, config.seconds);
+      }
+      Object.entries(LOOP_STEPS).forEach(([loop, step]) => {
+        if (frames[loop]) steps[step] = summarize(frames[loop], config.seconds);
+        else skipped[step] = "Render loop did not run";
+      });
+
+      const result: BenchReport = {
+        benchmark: "browser-render",
+        version: REPORT_VERSION,
+        started_at: startedAt,
+        label: config.label,
+        duration_seconds: config.seconds,
+        config,
+        environment: describeEnvironment(),
+        load,
+        error_rate: 0,
+        steps,
+        skipped,
+        render_tiers: renderTiers,
+      };
+      console.log("📊 Benchmark report:", result);
+      window.__AURALIS_BENCH__ = result;
+      document.body.dataset.bench = "done";
+      setReport(result);
+      setStatus("Done");
+    };
+
+    run().catch((error) => {
+      console.error("Benchmark failed:", error);
+      document.body.dataset.bench = "failed";
+      setStatus(`Failed: ${error instanceof Error ? error.message : String(error)}`);
+    });
+
+    return () => {
+      cancelled = true;
+      stopDetection();
+      stopObserving();
+      const stream = video.srcObject as MediaStream | null;
+      stream?.getTracks().forEach((track) => track.stop());
+    };
+  }, [config]);
+
+  const downloadReport = () => {
+    if (!report) return;
+    const url = URL.createObjectURL(new Blob([JSON.stringify(report, null, 2)], { type: "application/json" }));
+    const link = document.createElement("a");
+    link.href = url;
+    link.download = `auralis-bench-${report.label ?? "browser"}-${report.started_at.slice(0, 10)}.json`;
+    link.click();
+    URL.revokeObjectURL(url);
+  };
+
+  return (
+    <main className="min-h-screen bg-neutral-950 p-6 text-neutral-100">
+      <h1 className="text-2xl font-semibold">Render benchmark</h1>
+      <p className="mt-1 text-sm text-neutral-400">{status}</p>
+
+      <div className="mt-6 grid gap-4 md:grid-cols-3">
+        <div className="relative h-80 overflow-hidden rounded-lg bg-black">
+          <video ref={videoRef} className="h-full w-full object-cover" />
+          <canvas ref={canvasRef} className="absolute inset-0 h-full w-full" />
+        </div>
+        <div className="relative h-80 overflow-hidden rounded-lg">
+          <Avatar
+            avatarId={config?.avatarId}
+            isSpeaking={measuring}
+            onLoad={() => {
+              avatarLoadedAt.current = performance.now();
+              avatarReady.current.resolve();
+            }}
+          />
+        </div>
+        <div className="relative h-80 overflow-hidden rounded-lg bg-black">
+          <LiquidEther style={{ position: "absolute", inset: 0 }} />
+        </div>
+      </div>
+
+      {report && (
+        <section className="mt-6">
+          <button
+            onClick={downloadReport}
+            className="rounded-md bg-white px-4 py-2 text-sm font-medium text-neutral-900"
+          >
+            Download report
+          </button>
+          <pre className="mt-4 max-h-[32rem] overflow-auto rounded-lg bg-neutral-900 p-4 text-xs">
+            {JSON.stringify(report, null, 2)}
+          </pre>
+        </section>
+      )}
+    </main>
+  );
+}
@@ -6,35 +6,52 @@
 "use client";
 
 import { useState, useEffect, useRef } from "react";
-import { AudioRecorder, playAudio } from "@/lib/audioUtils";
-import { API_BASE_URL } from "../../lib/config";
+import type { SpeechPlayer } from "@/lib/audioUtils";
+import { getAudioEngine, QueuedPlayback } from "@/lib/audioEngine";
+import type { EmotionTelemetry } from "@/lib/emotionTelemetry";
+import { StreamingTranscriber } from "@/lib/sttStream";
+import { CallChannel } from "@/lib/callChannel";
+import { CALL_CHANNEL_ENABLED } from "@/lib/config";
+import { VoiceActivityDetector } from "@/lib/vad";
+import { streamSpokenChat } from "@/lib/chatStream";
+import type { ChatResult } from "@/lib/chatStream";
+import type { VisemeTimeline } from "@/lib/visemes";
+import { requestSpeech } from "@/lib/tts";
+import { TurnTrace } from "@/lib/turnMetrics";
+
+const MAX_UTTERANCE_MS = 60000; // Safety cap on one answer when VAD is running
+const FALLBACK_RECORDING_MS = 8000; // Fixed window when VAD is unavailable
 
 interface AudioControllerProps {
-  onTranscript?: (text: string) => void;
+  onTranscript?: (text: string, emotion: string) => void; // Final transcript and the patient's dominant emotion while saying it
+  onPartialTranscript?: (text: string) => void; // Transcript so far while the user speaks
   onSpeakingStateChange?: (isSpeaking: boolean) => void;
   onAssistantResponse?: (text: string) => void;
+  onAssistantDelta?: (textSoFar: string) => void; // Partial reply while it is generated
   autoStart?: boolean; // Auto-start listening when component mounts
   continuousMode?: boolean; // Automatically restart listening after AI speaks
   currentEmotion?: string; // Current emotion detected from webcam
-  emotionHistory?: string[]; // History of emotions detected during conversation
-  onClearEmotionHistory?: () => void; // Callback to clear emotion history after use
+  emotionTelemetry?: EmotionTelemetry | null; // Aggregated webcam emotion for this call
   currentAge?: number | null; // Current age detected from webcam
   ageCategory?: string | null; // Age category (e.g., "Young Adult")
   voiceId?: string; // Selected voice ID for TTS
+  sessionId: string; // Consultation session ID for the backend (one per call, never shared)
 }
 
 export default function AudioController({
   onTranscript,
+  onPartialTranscript,
   onSpeakingStateChange,
   onAssistantResponse,
+  onAssistantDelta,
   autoStart = false,
   continuousMode = false,
   currentEmotion = "neutral",
-  emotionHistory = [],
-  onClearEmotionHistory,
+  emotionTelemetry,
   currentAge = null,
   ageCategory = null,
   voiceId,
+  sessionId,
 }: AudioControllerProps) {
   const [isListening, setIsListening] = useState(false);
   const [isPlaying, setIsPlaying] = useState(false);
@@ -44,15 +61,36 @@ export default function AudioController({
   const [error, setError] = useState<string | null>(null);
   const [isProcessing, setIsProcessing] = useState(false); // New state for AI processing
 
-  const recorderRef = useRef<AudioRecorder | null>(null);
-  const audioRef = useRef<HTMLAudioElement | null>(null);
+  // Call channel (one socket for the whole turn) or STT socket plus REST chat
+  const recorderRef = useRef<CallChannel | StreamingTranscriber | null>(null);
   const silenceTimerRef = useRef<NodeJS.Timeout | null>(null);
   const shouldContinueListeningRef = useRef<boolean>(false);
-  const currentAudioRef = useRef<HTMLAudioElement | null>(null); // Track current playing audio
+  const currentPlayerRef = useRef<SpeechPlayer | null>(null); // Track current playing audio
+  const vadRef = useRef<VoiceActivityDetector | null>(null);
+  const vadReadyRef = useRef<boolean>(false);
+  const heardSpeechRef = useRef<boolean>(false); // Patient has spoken since recording started
+  const chatAbortRef = useRef<AbortController | null>(null); // Cancels the reply on barge-in
+  // Latest VAD handlers, so the detector never calls a stale render's closures
+  const vadHandlersRef = useRef({
+    onSpeechStart: (_duringPlayback: boolean) => {},
+    onSpeechEnd: () => {},
+  });
 
   useEffect(() => {
-    // Initialize audio recorder
-    recorderRef.current = new AudioRecorder();
+    // Initialize streaming transcriber (records and transcribes while speaking)
+    // on the call's microphone stream, which stays open between turns
+    const onPartial = (text: string) => {
+      setTranscript(text);
+      onPartialTranscript?.(text);
+    };
+    const getStream = () => getAudioEngine().acquireMicrophone();
+    if (CALL_CHANNEL_ENABLED) {
+      const channel = new CallChannel({ sessionId, voiceId }, onPartial, getStream);
+      channel.connect();
+      recorderRef.current = channel;
+    } else {
+      recorderRef.current = new StreamingTranscriber(onPartial, getStream);
+    }
 
     // Check microphone permission
     checkMicrophonePermission();
@@ -65,22 +103,14 @@ export default function AudioController({
       shouldContinueListeningRef.current = false;
 
       // Stop recording immediately
-      if (recorderRef.current && recorderRef.current.isRecording()) {
-        recorderRef.current.stopRecording().catch(() => {});
-      }
+      recorderRef.current?.close();
+      vadRef.current?.stop();
+      vadRef.current = null;
+      chatAbortRef.current?.abort();
 
       // Stop any playing audio
-      if (currentAudioRef.current) {
-        currentAudioRef.current.pause();
-        currentAudioRef.current.src = "";
-        currentAudioRef.current = null;
-      }
-
-      if (audioRef.current) {
-        audioRef.current.pause();
-        audioRef.current.src = "";
-        audioRef.current = null;
-      }
+      currentPlayerRef.current?.stop();
+      currentPlayerRef.current = null;
 
       // Clear timers
       if (silenceTimerRef.current) {
@@ -109,22 +139,11 @@ export default function AudioController({
       }
 
       // Stop and cleanup all audio
-      if (audioRef.current) {
-        audioRef.current.pause();
-        audioRef.current.src = "";
-        audioRef.current = null;
-      }
-
-      if (currentAudioRef.current) {
-        currentAudioRef.current.pause();
-        currentAudioRef.current.src = "";
-        currentAudioRef.current = null;
-      }
+      currentPlayerRef.current?.stop();
+      currentPlayerRef.current = null;
 
-      // Stop recording
-      if (recorderRef.current && recorderRef.current.isRecording()) {
-        recorderRef.current.stopRecording().catch(() => {});
-      }
+      // Stop recording and close the STT socket
+      recorderRef.current?.close();
     };
   }, []);
 
@@ -136,10 +155,40 @@ export default function AudioController({
     }
   }, [autoStart, hasPermission, isListening, isPlaying]);
 
+  // Voice activity detection - ends the turn when the patient stops talking
+  useEffect(() => {
+    if (!hasPermission || !continuousMode || !VoiceActivityDetector.isSupported()) {
+      return;
+    }
+
+    const vad = new VoiceActivityDetector({
+      onSpeechStart: (duringPlayback) => vadHandlersRef.current.onSpeechStart(duringPlayback),
+      onSpeechEnd: () => vadHandlersRef.current.onSpeechEnd(),
+    });
+    vadRef.current = vad;
+    vad
+      .start(getAudioEngine())
+      .then(() => {
+        vadReadyRef.current = true;
+        console.log("🎙️ Voice activity detection ready");
+      })
+      .catch((err) => {
+        console.warn("VAD unavailable - using fixed recording timer", err);
+        vad.stop();
+        if (vadRef.current === vad) vadRef.current = null;
+      });
+
+    return () => {
+      vad.stop();
+      vadReadyRef.current = false;
+      if (vadRef.current === vad) vadRef.current = null;
+    };
+  }, [hasPermission, continuousMode]);
+
   const checkMicrophonePermission = async () => {
     try {
-      const stream = await navigator.mediaDevices.getUserMedia({ audio: true });
-      stream.getTracks().forEach((track) => track.stop());
+      // Opens the call's microphone once; recording and VAD reuse it every turn
+      await getAudioEngine().acquireMicrophone();
       setHasPermission(true);
     } catch (err) {
       setHasPermission(false);
@@ -147,227 +196,272 @@ export default function AudioController({
     }
   };
 
-  const handleRecordingComplete = async (audioBlob: Blob) => {
+  const handleRecordingComplete = async (transcriber: CallChannel | StreamingTranscriber) => {
+    // Times this turn from end of speech to the doctor's audio starting
+    const trace = new TurnTrace();
     try {
       setError(null);
-      const formData = new FormData();
-      formData.append("audio", audioBlob, "recording.webm");
-
-      const response = await fetch(`${API_BASE_URL}/api/stt`, {
-        method: "POST",
-        body: formData,
-      });
-
-      if (!response.ok) {
-        throw new Error("STT request failed");
-      }
-
-      const data = await response.json();
-      if (data.text) {
-        setTranscript(data.text);
-        onTranscript?.(data.text);
-
-        // Mock chat response (replace with real API when Person 3 is ready)
-        await handleChatResponse(data.text);
+      // Dominant emotion while the patient was speaking (starts a new window)
+      const dominantEmotion = emotionTelemetry
+        ? emotionTelemetry.takeTurnDominant(currentEmotion)
+        : currentEmotion;
+      console.log("📊 Dominant emotion during speaking:", dominantEmotion);
+
+      // Audio was streamed while speaking - this only waits for the final transcript
+      // (over the call channel the server is already generating the reply)
+      const text =
+        transcriber instanceof CallChannel
+          ? await transcriber.finish(
+              {
+                emotion: dominantEmotion,
+                age: currentAge,
+                age_category: ageCategory,
+              },
+              trace
+            )
+          : await transcriber.finish(trace);
+      trace.mark("transcript");
+      if (text) {
+        setTranscript(text);
+        onTranscript?.(text, dominantEmotion);
+
+        await handleChatResponse(text, dominantEmotion, trace);
+      } else {
+        trace.finish();
       }
     } catch (err) {
       console.error("Transcription error:", err);
       setError("Failed to transcribe audio");
+      trace.finish();
     }
   };
 
-  const getDominantEmotion = (emotions: string[]): string => {
-    if (emotions.length === 0) return currentEmotion;
-
-    // Count occurrences of each emotion
-    const emotionCounts: Record<string, number> = {};
-    emotions.forEach((emotion) => {
-      emotionCounts[emotion] = (emotionCounts[emotion] || 0) + 1;
-    });
-
-    // Find the most frequent emotion
-    let dominantEmotion = currentEmotion;
-    let maxCount = 0;
-
-    Object.entries(emotionCounts).forEach(([emotion, count]) => {
-      if (count > maxCount) {
-        maxCount = count;
-        dominantEmotion = emotion;
-      }
-    });
-
-    console.log("📊 Emotion analysis during speaking:");
-    console.log("  - Emotion history:", emotions);
-    console.log("  - Emotion counts:", emotionCounts);
-    console.log(
-      "  - Dominant emotion:",
-      dominantEmotion,
-      `(${maxCount}/${emotions.length})`
-    );
-
-    return dominantEmotion;
-  };
-
-  const handleChatResponse = async (userMessage: string) => {
+  const handleChatResponse = async (userMessage: string, dominantEmotion: string, trace: TurnTrace) => {
     // Check if call has ended
     if (!shouldContinueListeningRef.current && continuousMode) {
       console.log("⛔ Call ended - not processing chat response");
+      trace.finish();
       return;
     }
 
+    let player: SpeechPlayer | null = null;
+    let replyText = "";
+    let replyDone = false;
+    const abortController = new AbortController();
+    chatAbortRef.current = abortController;
+
     try {
       setIsProcessing(true); // Show processing indicator
 
-      // Calculate dominant emotion from history during speaking
-      const dominantEmotion = getDominantEmotion(emotionHistory);
-
-      // Clear emotion history for next speaking session
-      onClearEmotionHistory?.();
-
-      // Call real Gemini chat API
-      const response = await fetch(`${API_BASE_URL}/api/chat`, {
-        method: "POST",
-        headers: {
-          "Content-Type": "application/json",
+      // Stop any currently playing audio first
+      stopCurrentAudio();
+
+      // Stream reply text and speech together - audio starts on the first sentence
+      // and later sentences are queued gaplessly on the call's audio engine
+      const streamingPlayer = getAudioEngine().createPlayback();
+      player = streamingPlayer;
+      const replyHandlers = {
+        onDelta: (_delta: string, textSoFar: string) => {
+          trace.mark("first_text");
+          replyText = textSoFar;
+          onAssistantDelta?.(textSoFar);
         },
-        body: JSON.stringify({
-          message: userMessage,
-          emotion: dominantEmotion, // Use dominant emotion from speaking period
-          age: currentAge,
-          age_category: ageCategory,
-        }),
-      });
-
-      if (!response.ok) {
-        throw new Error("Chat API request failed");
+        onAudio: (chunk: Uint8Array) => {
+          if (!shouldContinueListeningRef.current && continuousMode) return;
+          if (abortController.signal.aborted) return;
+          trace.mark("first_audio");
+          const isFirstChunk = !streamingPlayer.hasAudio();
+          streamingPlayer.append(chunk);
+          if (isFirstChunk) {
+            startStreamingPlayback(streamingPlayer, trace);
+          }
+        },
+        onVisemes: (timeline: VisemeTimeline) => streamingPlayer.visemes.append(timeline),
+        onDone: (result: ChatResult) => {
+          replyDone = true;
+          // Notify parent component of assistant response
+          onAssistantResponse?.(result.response);
+          setIsProcessing(false);
+        },
+      };
+      const channel = recorderRef.current;
+      const overCall = channel instanceof CallChannel && channel.hasPendingReply();
+      trace.transport = overCall ? "call" : "rest";
+      const data = overCall
+        ? await channel.reply(replyHandlers, abortController.signal)
+        : await streamSpokenChat(
+            {
+              message: userMessage,
+              emotion: dominantEmotion, // Use dominant emotion from speaking period
+              age: currentAge,
+              age_category: ageCategory,
+              session_id: sessionId,
+              voice_id: voiceId,
+            },
+            { signal: abortController.signal, turnId: trace.id, ...replyHandlers }
+          );
+      streamingPlayer.end();
+
+      // Check if AI suggests ending consultation
+      if (data.should_end_consultation) {
+        console.log("🏁 AI suggests ending consultation");
+        // Dispatch event to show end consultation prompt
+        window.dispatchEvent(new CustomEvent("suggestEndConsultation"));
       }
 
-      const data = await response.json();
-
-      if (data.response) {
-        // Notify parent component of assistant response
-        onAssistantResponse?.(data.response);
-
-        // Check if AI suggests ending consultation
-        if (data.should_end_consultation) {
-          console.log("🏁 AI suggests ending consultation");
-          // Dispatch event to show end consultation prompt
-          window.dispatchEvent(new CustomEvent("suggestEndConsultation"));
-        }
-
-        // Send to TTS
-        await speakText(data.response);
+      if (!streamingPlayer.hasAudio() && data.response) {
+        // Sentence speech failed - fall back to synthesizing the whole reply
+        player = null;
+        streamingPlayer.dispose();
+        await speakText(data.response, trace);
       }
     } catch (err) {
+      if (abortController.signal.aborted) {
+        // Patient interrupted - keep what the doctor had said so far
+        console.log("✋ Reply interrupted");
+        trace.finish();
+        player?.dispose();
+        if (!replyDone && replyText) {
+          onAssistantResponse?.(replyText);
+        }
+        return;
+      }
+
       console.error("Chat error:", err);
       setError("Failed to get response");
-      if (continuousMode && shouldContinueListeningRef.current) {
-        startListening(); // Restart listening even on error
+      if (player && player.hasAudio()) {
+        // Play what already arrived; playback end restarts listening
+        player.end();
+      } else {
+        trace.finish();
+        player?.dispose();
+        if (continuousMode && shouldContinueListeningRef.current) {
+          startListening(); // Restart listening even on error
+        }
       }
     } finally {
       setIsProcessing(false); // Hide processing indicator
+      if (chatAbortRef.current === abortController) {
+        chatAbortRef.current = null;
+      }
+    }
+  };
+
+  const stopCurrentAudio = () => {
+    // stop() detaches handlers so a deliberate stop isn't reported as an error or an end
+    currentPlayerRef.current?.stop();
+    currentPlayerRef.current = null;
+  };
+
+  const handlePlaybackStart = () => {
+    console.log("AudioController: Audio started playing");
+    setIsPlaying(true);
+    onSpeakingStateChange?.(true);
+    vadRef.current?.setPlaybackActive(true);
+  };
+
+  const handlePlaybackEnd = () => {
+    console.log("AudioController: Audio ended");
+    setIsPlaying(false);
+    onSpeakingStateChange?.(false);
+    vadRef.current?.setPlaybackActive(false);
+    window.dispatchEvent(new CustomEvent("audioPlaybackEnd"));
+    currentPlayerRef.current = null;
+
+    // Auto-restart listening in continuous mode (only if not stopped)
+    if (continuousMode && shouldContinueListeningRef.current) {
+      console.log("🔄 Auto-restarting listening in 500ms");
+      setTimeout(() => {
+        // Double-check before restarting
+        if (shouldContinueListeningRef.current) {
+          startListening();
+        } else {
+          console.log("⛔ Call ended during delay - not restarting");
+        }
+      }, 500); // Small delay before restarting
+    } else {
+      console.log(
+        "⛔ Not restarting - continuous mode disabled or call ended"
+      );
     }
   };
 
-  const speakText = async (text: string) => {
+  const handlePlaybackError = (error: string) => {
+    console.error("AudioController: Audio error:", error);
+    setError(error);
+    setIsPlaying(false);
+    onSpeakingStateChange?.(false);
+    vadRef.current?.setPlaybackActive(false);
+    currentPlayerRef.current = null;
+
+    // Still restart listening even on error (only if not stopped)
+    if (continuousMode && shouldContinueListeningRef.current) {
+      console.log("🔄 Restarting after audio error in 500ms");
+      setTimeout(() => {
+        if (shouldContinueListeningRef.current) {
+          startListening();
+        } else {
+          console.log(
+            "⛔ Call ended during error delay - not restarting"
+          );
+        }
+      }, 500);
+    }
+  };
+
+  const startStreamingPlayback = (player: SpeechPlayer, trace?: TurnTrace) => {
+    console.log("AudioController: Starting streamed TTS playback");
+
+    player.onplay = () => {
+      if (trace) {
+        if (player instanceof QueuedPlayback && player.firstDecodeMs !== null) {
+          trace.measure("decode", player.firstDecodeMs);
+        }
+        trace.mark("playback_start");
+        trace.finish();
+      }
+      handlePlaybackStart();
+    };
+    player.onended = () => {
+      player.dispose();
+      handlePlaybackEnd();
+    };
+    player.onerror = () => {
+      trace?.finish();
+      player.dispose();
+      handlePlaybackError("Failed to play audio");
+    };
+
+    // Emit event for avatar
+    window.dispatchEvent(new CustomEvent("audioPlaybackStart"));
+    currentPlayerRef.current = player;
+
+    player.play().catch(() => handlePlaybackError("Audio playback failed"));
+  };
+
+  const speakText = async (text: string, trace?: TurnTrace) => {
     // Check if call has ended
     if (!shouldContinueListeningRef.current && continuousMode) {
       console.log("⛔ Call ended - not speaking text");
+      trace?.finish();
       return;
     }
 
     try {
       setError(null);
-      const response = await fetch(`${API_BASE_URL}/api/tts`, {
-        method: "POST",
-        headers: {
-          "Content-Type": "application/json",
-        },
-        body: JSON.stringify({ text, voice_id: voiceId }),
-      });
 
-      if (!response.ok) {
-        throw new Error("TTS request failed");
-      }
+      // Binary audio stream - playback starts on the first bytes
+      const engine = getAudioEngine();
+      const player = await requestSpeech(text, voiceId, undefined, () => engine.createPlayback());
 
-      const data = await response.json();
-
-      if (data.audio_base64) {
-        // Convert base64 to playable URL
-        const audioUrl = `data:audio/mpeg;base64,${data.audio_base64}`;
-
-        // Stop any currently playing audio first
-        if (currentAudioRef.current) {
-          currentAudioRef.current.pause();
-          currentAudioRef.current.src = "";
-        }
+      // Stop any currently playing audio first
+      stopCurrentAudio();
 
-        console.log("AudioController: Starting TTS playback");
-
-        // Emit event for avatar
-        window.dispatchEvent(new CustomEvent("audioPlaybackStart"));
-
-        const audio = await playAudio(
-          audioUrl,
-          () => {
-            console.log("AudioController: Audio started playing");
-            setIsPlaying(true);
-            onSpeakingStateChange?.(true);
-          },
-          () => {
-            console.log("AudioController: Audio ended");
-            setIsPlaying(false);
-            onSpeakingStateChange?.(false);
-            window.dispatchEvent(new CustomEvent("audioPlaybackEnd"));
-            currentAudioRef.current = null;
-
-            // Auto-restart listening in continuous mode (only if not stopped)
-            if (continuousMode && shouldContinueListeningRef.current) {
-              console.log("🔄 Auto-restarting listening in 500ms");
-              setTimeout(() => {
-                // Double-check before restarting
-                if (shouldContinueListeningRef.current) {
-                  startListening();
-                } else {
-                  console.log("⛔ Call ended during delay - not restarting");
-                }
-              }, 500); // Small delay before restarting
-            } else {
-              console.log(
-                "⛔ Not restarting - continuous mode disabled or call ended"
-              );
-            }
-          },
-          (error) => {
-            console.error("AudioController: Audio error:", error);
-            setError(error);
-            setIsPlaying(false);
-            onSpeakingStateChange?.(false);
-            currentAudioRef.current = null;
-
-            // Still restart listening even on error (only if not stopped)
-            if (continuousMode && shouldContinueListeningRef.current) {
-              console.log("🔄 Restarting after audio error in 500ms");
-              setTimeout(() => {
-                if (shouldContinueListeningRef.current) {
-                  startListening();
-                } else {
-                  console.log(
-                    "⛔ Call ended during error delay - not restarting"
-                  );
-                }
-              }, 500);
-            }
-          }
-        );
-
-        // Track the current audio element
-        currentAudioRef.current = audio;
-        console.log("AudioController: Audio element created and tracked");
-      }
+      startStreamingPlayback(player, trace);
     } catch (err) {
       console.error("TTS error:", err);
       setError("Failed to generate speech");
+      trace?.finish();
     }
   };
 
@@ -383,13 +477,23 @@ export default function AudioController({
       return;
     }
 
+    // Already listening (e.g. barge-in beat the playback-end restart)
+    if (recorderRef.current?.isRecording()) {
+      return;
+    }
+
     try {
       setError(null);
       if (recorderRef.current) {
-        await recorderRef.current.startRecording();
+        heardSpeechRef.current = false;
+        await recorderRef.current.start();
         setIsListening(true);
+        if (!vadReadyRef.current) {
+          // No VAD to tell when speech starts - treat the whole recording as speech
+          window.dispatchEvent(new CustomEvent("userSpeechStart"));
+        }
 
-        // In continuous mode, auto-stop after silence (3 seconds)
+        // In continuous mode, auto-stop at end of speech (timer is a safety net)
         if (continuousMode) {
           startSilenceDetection();
         }
@@ -406,20 +510,26 @@ export default function AudioController({
       clearTimeout(silenceTimerRef.current);
     }
 
-    // Auto-stop recording after 8 seconds to allow for longer responses
-    // This gives users time to think and speak complete sentences
+    // With VAD the turn ends when the patient stops talking; this only caps
+    // very long answers. Without VAD, fall back to the fixed 8 second window.
+    const maxRecordingMs = vadReadyRef.current ? MAX_UTTERANCE_MS : FALLBACK_RECORDING_MS;
     silenceTimerRef.current = setTimeout(() => {
       if (recorderRef.current && recorderRef.current.isRecording()) {
         stopListening();
       }
-    }, 8000); // 8 seconds - much more reasonable for natural conversation
+    }, maxRecordingMs);
   };
 
   const stopListening = async () => {
+    if (silenceTimerRef.current) {
+      clearTimeout(silenceTimerRef.current);
+      silenceTimerRef.current = null;
+    }
+    window.dispatchEvent(new CustomEvent("userSpeechEnd"));
+
     try {
       if (recorderRef.current && recorderRef.current.isRecording()) {
-        const audioBlob = await recorderRef.current.stopRecording();
-        await handleRecordingComplete(audioBlob);
+        await handleRecordingComplete(recorderRef.current);
         setIsListening(false);
       }
     } catch (err) {
@@ -429,6 +539,43 @@ export default function AudioController({
     }
   };
 
+  // Patient started talking over the doctor - stop the reply and listen
+  const bargeIn = () => {
+    console.log("✋ Barge-in - stopping doctor playback");
+    window.dispatchEvent(new CustomEvent("bargeIn"));
+    chatAbortRef.current?.abort();
+    stopCurrentAudio();
+    setIsPlaying(false);
+    onSpeakingStateChange?.(false);
+    vadRef.current?.setPlaybackActive(false);
+    window.dispatchEvent(new CustomEvent("audioPlaybackEnd"));
+    window.dispatchEvent(new CustomEvent("userSpeechStart"));
+
+    startListening().then(() => {
+      heardSpeechRef.current = true; // They are already mid-sentence
+    });
+  };
+
+  vadHandlersRef.current = {
+    onSpeechStart: (duringPlayback) => {
+      if (!shouldContinueListeningRef.current) return;
+      if (duringPlayback && currentPlayerRef.current) {
+        bargeIn();
+      } else if (recorderRef.current?.isRecording()) {
+        heardSpeechRef.current = true;
+        window.dispatchEvent(new CustomEvent("userSpeechStart"));
+      }
+    },
+    onSpeechEnd: () => {
+      if (heardSpeechRef.current && recorderRef.current?.isRecording()) {
+        console.log("🤫 End of speech detected");
+        heardSpeechRef.current = false;
+        window.dispatchEvent(new CustomEvent("userSpeechEnd"));
+        stopListening();
+      }
+    },
+  };
+
   return (
     <div className="flex flex-col items-center space-y-4">
       {/* Visual indicator only (no button in continuous mode) */}
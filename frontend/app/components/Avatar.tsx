@@ -6,7 +6,12 @@
 
 import { useEffect, useRef, useState } from "react";
 import * as THREE from "three";
-import { GLTFLoader } from "three/examples/jsm/loaders/GLTFLoader.js";
+import { instantiateAvatar } from "@/lib/avatarAssets";
+import { acquireRenderer, releaseRenderer } from "@/lib/sharedRenderer";
+import { currentMouthOpen } from "@/lib/visemes";
+import { RenderGovernor, QUALITY_TIERS, preferredTier, pixelRatioFor } from "@/lib/renderGovernor";
+import { METRICS_BEACON_ENABLED } from "@/lib/config";
+import { sampleFrameTime } from "@/lib/turnMetrics";
 
 interface AvatarProps {
   isSpeaking?: boolean;
@@ -37,11 +42,14 @@ export default function Avatar({ isSpeaking = false, background, avatarId = "doc
   const jawInitialRotationRef = useRef<number | null>(null);
   const jawCloseOffsetRef = useRef<number>(0.005); // tweak to nudge jaw closed
   const isSpeakingRef = useRef<boolean>(false); // Track speaking state for animation loop
+  const governorRef = useRef<RenderGovernor | null>(null);
+  const resizeCleanupRef = useRef<(() => void) | null>(null);
   
   // Switch between talk and idle animations based on isSpeaking
   useEffect(() => {
     console.log("Avatar: isSpeaking changed to:", isSpeaking);
     isSpeakingRef.current = isSpeaking; // Update ref for animation loop
+    governorRef.current?.wake(); // Jump to full frame rate without waiting for the idle pace
     if (!mixerRef.current) return;
     
     if (isSpeaking && talkAnimationsRef.current.length > 0) {
@@ -171,20 +179,19 @@ export default function Avatar({ isSpeaking = false, background, avatarId = "doc
       }
       cameraRef.current = camera;
 
-      // Create renderer
-      const renderer = new THREE.WebGLRenderer({ 
-        antialias: true,
-        alpha: true 
-      });
+      // Take the shared renderer at the tier measured on previous visits
+      // (antialiasing can only be chosen when the context is created)
+      const tier = preferredTier("avatar");
+      const renderer = acquireRenderer({ antialias: QUALITY_TIERS[tier].antialias });
       renderer.setSize(
         containerRef.current.clientWidth,
         containerRef.current.clientHeight
       );
-      renderer.setPixelRatio(Math.min(window.devicePixelRatio, 1.5));
+      renderer.setPixelRatio(pixelRatioFor(tier));
       renderer.outputColorSpace = THREE.SRGBColorSpace;
       renderer.toneMapping = THREE.ACESFilmicToneMapping;
       renderer.toneMappingExposure = 1.1; // Slightly brighter for minimal look
-      renderer.shadowMap.enabled = false; // Disabled for softer appearance
+      renderer.shadowMap.enabled = QUALITY_TIERS[tier].shadows; // Off in every tier for softer appearance
       rendererRef.current = renderer;
       containerRef.current.appendChild(renderer.domElement);
 
@@ -209,28 +216,10 @@ export default function Avatar({ isSpeaking = false, background, avatarId = "doc
       rimLight.position.set(0, 3, -3);
       scene.add(rimLight);
 
-      // Load model with timeout and logging
-      const loader = new GLTFLoader();
-      // Map avatarId to model file
-      const modelMap: Record<string, string> = {
-        "doctorm": "/models/DoctorM.glb",
-        "doctorf": "/models/DoctorF.glb",
-        "baymax": "/models/Baymax.glb",
-        "joe": "/models/DoctorM.glb", // fallback
-        "mark": "/models/DoctorM.glb",
-        "sasha": "/models/DoctorF.glb"
-      };
-      const modelPath = modelMap[avatarId.toLowerCase()] || "/models/DoctorM.glb";
-      console.log("Avatar: starting model load", modelPath);
-      const timeoutMs = 15000; // 15s
-      const loadPromise = loader.loadAsync(modelPath);
-      const gltf = await Promise.race([
-        loadPromise,
-        new Promise((_, reject) =>
-          setTimeout(() => reject(new Error("Model load timeout")), timeoutMs)
-        ),
-      ]);
-      console.log("Avatar: model loaded", gltf);
+      // Shared model cache - usually already prefetched from the setup page
+      const gltf = await instantiateAvatar(avatarId);
+      if (rendererRef.current !== renderer) return; // Unmounted while loading - renderer already handed back
+      console.log("Avatar: model ready", avatarId);
       
       const model = gltf.scene;
       modelRef.current = model;
@@ -294,38 +283,11 @@ export default function Avatar({ isSpeaking = false, background, avatarId = "doc
         }
       }
 
-      // Configure materials for better appearance
+      // Shadow flags are per clone; materials are set up once in the cache
       model.traverse((child: THREE.Object3D) => {
         if (child instanceof THREE.Mesh) {
-          child.castShadow = true;
-          child.receiveShadow = true;
-          
-          if (child.material) {
-            // Ensure proper texture encoding
-            if (child.material.map) {
-              child.material.map.colorSpace = THREE.SRGBColorSpace;
-            }
-            
-            // Set material properties for nice rendering
-            if (child.material instanceof THREE.MeshStandardMaterial) {
-              child.material.roughness = 0.6;
-              child.material.metalness = 0.0;
-              
-              // Force opaque rendering - disable transparency
-              child.material.transparent = false;
-              child.material.opacity = 1.0;
-              child.material.alphaTest = 0;
-              child.material.depthWrite = true;
-              child.material.side = THREE.FrontSide;
-              
-              // If there's an alpha map, remove it
-              if (child.material.alphaMap) {
-                child.material.alphaMap = null;
-              }
-              
-              child.material.needsUpdate = true;
-            }
-          }
+          child.castShadow = renderer.shadowMap.enabled;
+          child.receiveShadow = renderer.shadowMap.enabled;
         }
       });
 
@@ -334,8 +296,25 @@ export default function Avatar({ isSpeaking = false, background, avatarId = "doc
       // Notify parent that avatar is loaded
       onLoad?.();
 
-      // Start animation loop
-      animate();
+      // Start animation loop - full rate while speaking, idle pace otherwise,
+      // paused while the tab is hidden
+      const governor = new RenderGovernor({
+        name: "avatar",
+        initialTier: tier,
+        activity: () => {
+          if (isSpeakingRef.current) return "active";
+          return mixerRef.current ? "ambient" : "static";
+        },
+        frame: renderFrame,
+        onTierChange: (nextTier) => {
+          renderer.setPixelRatio(pixelRatioFor(nextTier));
+        },
+        onFrameTime: METRICS_BEACON_ENABLED
+          ? (ms) => sampleFrameTime("avatar_frame", ms)
+          : undefined,
+      });
+      governorRef.current = governor;
+      governor.start();
 
       // Handle window resize
       const handleResize = () => {
@@ -347,12 +326,11 @@ export default function Avatar({ isSpeaking = false, background, avatarId = "doc
         camera.aspect = width / height;
         camera.updateProjectionMatrix();
         renderer.setSize(width, height);
+        governor.wake();
       };
       
       window.addEventListener("resize", handleResize);
-      
-      // Store cleanup function
-      return () => {
+      resizeCleanupRef.current = () => {
         window.removeEventListener("resize", handleResize);
       };
       
@@ -364,29 +342,35 @@ export default function Avatar({ isSpeaking = false, background, avatarId = "doc
     }
   };
 
-  const animate = () => {
+  const renderFrame = () => {
     if (!sceneRef.current || !cameraRef.current || !rendererRef.current) return;
 
-    requestAnimationFrame(animate);
-
-    // Update animation mixer
+    // Update animation mixer (delta spans skipped frames while idle)
+    const delta = clockRef.current.getDelta();
     if (mixerRef.current) {
-      const delta = clockRef.current.getDelta();
       mixerRef.current.update(delta);
     }
 
     // Apply jaw animation when speaking
     if (jawBoneRef.current) {
       if (isSpeakingRef.current) {
-        // Procedural animation for jaw movement - more natural and subtle
-        const elapsed = (Date.now() - jawStartTimeRef.current) / 1000;
-        const frequency = 2.2; // Slightly faster for more natural speech rhythm
         const baseAmplitude = 0.035; // Reduced from 0.08 for subtler movement
-        const modulator = 0.8 + 0.2 * Math.sin(elapsed * 0.9 * Math.PI * 2); // Less variation
-        const value = Math.sin(elapsed * frequency * Math.PI * 2);
-        const t = (value + 1) / 2;
-        const smoothed = t * t * (3 - 2 * t);
-        const openAmount = smoothed * baseAmplitude * modulator;
+        let openAmount: number;
+
+        // Viseme timeline from the TTS alignment, sampled at the audio's playback position
+        const visemeOpen = currentMouthOpen();
+        if (visemeOpen !== null) {
+          openAmount = visemeOpen * baseAmplitude;
+        } else {
+          // Procedural animation for jaw movement when no timeline is available
+          const elapsed = (Date.now() - jawStartTimeRef.current) / 1000;
+          const frequency = 2.2; // Slightly faster for more natural speech rhythm
+          const modulator = 0.8 + 0.2 * Math.sin(elapsed * 0.9 * Math.PI * 2); // Less variation
+          const value = Math.sin(elapsed * frequency * Math.PI * 2);
+          const t = (value + 1) / 2;
+          const smoothed = t * t * (3 - 2 * t);
+          openAmount = smoothed * baseAmplitude * modulator;
+        }
 
         const baseY = jawInitialYRef.current ?? 0;
         const baseRot = jawInitialRotationRef.current ?? 0;
@@ -416,32 +400,30 @@ export default function Avatar({ isSpeaking = false, background, avatarId = "doc
   };
 
   const cleanup = () => {
+    // Stop the render loop
+    governorRef.current?.stop();
+    governorRef.current = null;
+    resizeCleanupRef.current?.();
+    resizeCleanupRef.current = null;
+
     // Stop animations
     if (animationActionRef.current) {
       animationActionRef.current.stop();
     }
 
-    // Dispose renderer
+    // Hand the renderer back (the next view reuses the GL context)
     if (rendererRef.current) {
-      rendererRef.current.dispose();
-      if (containerRef.current && rendererRef.current.domElement) {
-        containerRef.current.removeChild(rendererRef.current.domElement);
-      }
+      releaseRenderer(rendererRef.current);
+      rendererRef.current = null;
     }
 
-    // Dispose geometries and materials
-    if (sceneRef.current) {
-      sceneRef.current.traverse((object: THREE.Object3D) => {
-        if (object instanceof THREE.Mesh) {
-          object.geometry?.dispose();
-          if (Array.isArray(object.material)) {
-            object.material.forEach((material: THREE.Material) => material.dispose());
-          } else {
-            object.material?.dispose();
-          }
-        }
-      });
-    }
+    // Geometries, materials and textures belong to the shared avatar cache
+    // and are reused by the next mount, so only this instance's state is dropped
+    mixerRef.current?.stopAllAction();
+    mixerRef.current = null;
+    modelRef.current = null;
+    jawBoneRef.current = null;
+    sceneRef.current = null;
   };
 
   return (
@@ -1,14 +1,21 @@
 "use client";
 
-import { useState, useEffect } from "react";
+import { useState, useEffect, useRef } from "react";
 import { motion } from "framer-motion";
-import { API_BASE_URL } from "../../lib/config";
+import { requestSpeech } from "../../lib/tts";
+import { closeAudioEngine, getAudioEngine } from "../../lib/audioEngine";
+import {
+  EmotionTelemetry,
+  endEmotionTelemetry,
+  startEmotionTelemetry,
+} from "../../lib/emotionTelemetry";
+import { createSessionId } from "../../lib/session";
 import Avatar from "./Avatar";
 import AudioController from "./AudioController";
 import VideoFeed from "./VideoFeed";
 
 interface CallInterfaceProps {
-  onEndCall: (messages: Message[]) => void;
+  onEndCall: (messages: Message[], sessionId: string) => void;
   selectedBg: string;
   avatarId: string;
   selectedAvatar?: string;
@@ -19,6 +26,8 @@ interface Message {
   role: "user" | "assistant";
   content: string;
   timestamp: Date;
+  emotion?: string; // Patient's dominant emotion during the message (user messages)
+  streaming?: boolean; // Assistant reply still being generated
 }
 
 const BG_OPTIONS = [
@@ -50,10 +59,12 @@ export default function CallInterface({
   const [isAvatarLoaded, setIsAvatarLoaded] = useState(false);
   const [currentEmotion, setCurrentEmotion] = useState<string>("neutral");
   const [confidence, setConfidence] = useState<number>(0);
-  const [emotionHistory, setEmotionHistory] = useState<string[]>([]); // Track emotions during speaking
+  const [emotionTelemetry, setEmotionTelemetry] = useState<EmotionTelemetry | null>(null); // Aggregated webcam emotion
+  const telemetryRef = useRef<EmotionTelemetry | null>(null); // Same object, for the detection callback
   const [showEndPrompt, setShowEndPrompt] = useState(false); // Show end consultation prompt
   const [currentAge, setCurrentAge] = useState<number | null>(null);
   const [ageCategory, setAgeCategory] = useState<string | null>(null);
+  const [sessionId] = useState<string>(() => createSessionId()); // One backend session per call
 
   // Get doctor name from avatar selection
   const doctorName = selectedAvatar === "doctorf" ? "Doctor F" : selectedAvatar === "baymax" ? "Baymax" : "Doctor M";
@@ -87,7 +98,10 @@ export default function CallInterface({
     setIsSpeaking(false);
 
     // End the call
-    onEndCall(messages);
+    // Post the last emotion batch now; the summary page waits for it
+    endEmotionTelemetry();
+
+    onEndCall(messages, sessionId);
   };
 
   useEffect(() => {
@@ -97,6 +111,22 @@ export default function CallInterface({
     return () => clearInterval(timer);
   }, []);
 
+  // Call lifetime: background effects (LiquidEther) suspend while the call is
+  // on screen, and emotion telemetry streams to the backend session
+  useEffect(() => {
+    window.dispatchEvent(new CustomEvent("callStart"));
+    const telemetry = startEmotionTelemetry(sessionId);
+    telemetryRef.current = telemetry;
+    setEmotionTelemetry(telemetry);
+    return () => {
+      telemetryRef.current = null;
+      endEmotionTelemetry();
+      window.dispatchEvent(new CustomEvent("callEnd"));
+      // Release the call's audio context and microphone
+      closeAudioEngine();
+    };
+  }, [sessionId]);
+
   // Listen for end consultation suggestion from AI
   useEffect(() => {
     const handleEndSuggestion = () => {
@@ -121,50 +151,37 @@ export default function CallInterface({
     const greeting = "Hello! I'm your AI Doctor. How are you feeling today?";
 
     try {
-      const response = await fetch(`${API_BASE_URL}/api/tts`, {
-        method: "POST",
-        headers: {
-          "Content-Type": "application/json",
-        },
-        body: JSON.stringify({ text: greeting, voice_id: selectedVoice }),
-      });
-
-      if (!response.ok) {
-        console.error("Failed to generate greeting TTS");
-        return;
-      }
-
-      const data = await response.json();
-
-      if (data.audio_base64) {
-        const audioUrl = `data:audio/mpeg;base64,${data.audio_base64}`;
-        const audio = new Audio(audioUrl);
-
-        audio.onplay = () => {
-          setIsSpeaking(true);
-          window.dispatchEvent(new CustomEvent("audioPlaybackStart"));
-        };
-
-        audio.onended = () => {
-          setIsSpeaking(false);
-          window.dispatchEvent(new CustomEvent("audioPlaybackEnd"));
-          // Enable listening after greeting finishes
-          setShouldStartListening(true);
-        };
-
-        audio.onerror = () => {
-          console.error("Failed to play greeting audio");
-          setIsSpeaking(false);
-        };
-
-        await audio.play();
-      }
+      const engine = getAudioEngine();
+      const player = await requestSpeech(greeting, selectedVoice, undefined, () =>
+        engine.createPlayback()
+      );
+
+      player.onplay = () => {
+        setIsSpeaking(true);
+        window.dispatchEvent(new CustomEvent("audioPlaybackStart"));
+      };
+
+      player.onended = () => {
+        player.dispose();
+        setIsSpeaking(false);
+        window.dispatchEvent(new CustomEvent("audioPlaybackEnd"));
+        // Enable listening after greeting finishes
+        setShouldStartListening(true);
+      };
+
+      player.onerror = () => {
+        console.error("Failed to play greeting audio");
+        player.dispose();
+        setIsSpeaking(false);
+      };
+
+      await player.play();
     } catch (err) {
       console.error("Error speaking greeting:", err);
     }
   };
 
-  const handleTranscript = (text: string) => {
+  const handleTranscript = (text: string, emotion: string) => {
     // Add user message to transcript
     setMessages((prev) => [
       ...prev,
@@ -172,6 +189,7 @@ export default function CallInterface({
         role: "user",
         content: text,
         timestamp: new Date(),
+        emotion,
       },
     ]);
   };
@@ -181,16 +199,33 @@ export default function CallInterface({
     setIsSpeaking(speaking);
   };
 
+  const upsertAssistantMessage = (text: string, streaming: boolean) => {
+    setMessages((prev) => {
+      const last = prev[prev.length - 1];
+      // Update the reply that is still streaming in place
+      if (last && last.role === "assistant" && last.streaming) {
+        return [...prev.slice(0, -1), { ...last, content: text, streaming }];
+      }
+      return [
+        ...prev,
+        {
+          role: "assistant",
+          content: text,
+          timestamp: new Date(),
+          streaming,
+        },
+      ];
+    });
+  };
+
+  const handleAssistantDelta = (textSoFar: string) => {
+    // Show partial reply while Gemini is still generating
+    upsertAssistantMessage(textSoFar, true);
+  };
+
   const handleAssistantResponse = (text: string) => {
-    // Add assistant message to transcript
-    setMessages((prev) => [
-      ...prev,
-      {
-        role: "assistant",
-        content: text,
-        timestamp: new Date(),
-      },
-    ]);
+    // Add (or finalize) assistant message in transcript
+    upsertAssistantMessage(text, false);
   };
 
   const formatTime = (seconds: number) => {
@@ -257,13 +292,11 @@ export default function CallInterface({
           {/* Webcam container - 300x225 (75% of 400x300) */}
           <div className="w-[300px] h-[225px] rounded-2xl overflow-hidden shadow-2xl border-2 border-white/40 backdrop-blur-md">
             <VideoFeed
+              onEmotionSample={(result) => telemetryRef.current?.add(result)}
               onEmotionDetected={(emotion, age, ageCat) => {
                 console.log("📤 CallInterface received emotion:", emotion);
                 setCurrentEmotion(emotion);
 
-                // Track emotion history (keep last 10 emotions)
-                setEmotionHistory((prev) => [...prev.slice(-9), emotion]);
-
                 // Update age when received
                 if (age !== undefined && ageCat) {
                   console.log("📤 CallInterface received age:", age, ageCat);
@@ -396,14 +429,15 @@ export default function CallInterface({
             onTranscript={handleTranscript}
             onSpeakingStateChange={handleSpeakingStateChange}
             onAssistantResponse={handleAssistantResponse}
+            onAssistantDelta={handleAssistantDelta}
             autoStart={shouldStartListening}
             continuousMode={true}
             currentEmotion={currentEmotion}
-            emotionHistory={emotionHistory}
-            onClearEmotionHistory={() => setEmotionHistory([])}
+            emotionTelemetry={emotionTelemetry}
             currentAge={currentAge}
             ageCategory={ageCategory}
             voiceId={selectedVoice}
+            sessionId={sessionId}
           />
         </div>
 
@@ -1,7 +1,22 @@
 import { useEffect, useRef } from 'react';
 import * as THREE from 'three';
+import { RenderGovernor, QualityTier, preferredTier, pixelRatioFor } from '@/lib/renderGovernor';
+import { acquireRenderer, releaseRenderer } from '@/lib/sharedRenderer';
 import './LiquidEther.css';
 
+const LOOP_NAME = 'liquid-ether';
+
+// Solver work per quality tier, relative to the props. Iterations dominate
+// the cost, so they are cut harder than the grid resolution.
+const FLUID_QUALITY: Record<QualityTier, { resolution: number; iterations: number; BFECC: boolean }> = {
+  high: { resolution: 1, iterations: 1, BFECC: true },
+  medium: { resolution: 0.75, iterations: 0.5, BFECC: true },
+  low: { resolution: 0.5, iterations: 0.25, BFECC: false }
+};
+
+// Background effect - give up quality before dropping under ~50fps
+const FRAME_BUDGET_MS = 20;
+
 interface LiquidEtherProps {
   mouseForce?: number;
   cursorSize?: number;
@@ -48,11 +63,26 @@ export default function LiquidEther({
   const mountRef = useRef<HTMLDivElement>(null);
   const webglRef = useRef<any>(null);
   const resizeObserverRef = useRef<ResizeObserver | null>(null);
-  const rafRef = useRef<number | null>(null);
   const intersectionObserverRef = useRef<IntersectionObserver | null>(null);
   const isVisibleRef = useRef(true);
   const resizeRafRef = useRef<number | null>(null);
 
+  const simOptions = (tier: QualityTier) => {
+    const quality = FLUID_QUALITY[tier];
+    return {
+      mouse_force: mouseForce,
+      cursor_size: cursorSize,
+      isViscous,
+      viscous,
+      iterations_viscous: Math.max(1, Math.round(iterationsViscous * quality.iterations)),
+      iterations_poisson: Math.max(1, Math.round(iterationsPoisson * quality.iterations)),
+      dt,
+      BFECC: BFECC && quality.BFECC,
+      resolution: resolution * quality.resolution,
+      isBounce
+    };
+  };
+
   useEffect(() => {
     if (!mountRef.current) return;
 
@@ -106,9 +136,10 @@ export default function LiquidEther({
 
       init(container: HTMLElement) {
         this.container = container;
-        this.pixelRatio = Math.min(window.devicePixelRatio || 1, 2);
+        // The sim runs below screen resolution anyway, so the tier's pixel ratio is plenty
+        this.pixelRatio = pixelRatioFor(preferredTier(LOOP_NAME));
         this.resize();
-        this.renderer = new THREE.WebGLRenderer({ antialias: true, alpha: true });
+        this.renderer = acquireRenderer(); // Fullscreen passes only - antialiasing doesn't matter
         this.renderer.autoClear = false;
         this.renderer.setClearColor(new THREE.Color(0x000000), 0);
         this.renderer.setPixelRatio(this.pixelRatio);
@@ -554,6 +585,13 @@ export default function LiquidEther({
             Common.renderer.setRenderTarget(null);
         }
       }
+      dispose() {
+        // The renderer may be shared, so GPU resources are freed per pass
+        this.scene?.traverse((obj: any) => {
+          obj.geometry?.dispose();
+          obj.material?.dispose();
+        });
+      }
     }
 
     class Advection extends ShaderPass {
@@ -897,6 +935,13 @@ export default function LiquidEther({
           this.fbos[key].setSize(this.fboSize.x, this.fboSize.y);
         }
       }
+      dispose() {
+        [this.advection, this.externalForce, this.viscous, this.divergence, this.poisson, this.pressure]
+          .forEach(pass => pass?.dispose());
+        for (let key in this.fbos) {
+          this.fbos[key]?.dispose();
+        }
+      }
       update() {
         if (this.options.isBounce) {
           this.boundarySpace.set(0, 0);
@@ -976,17 +1021,24 @@ export default function LiquidEther({
         this.simulation.update();
         this.render();
       }
+      dispose() {
+        this.simulation.dispose();
+        this.output.geometry.dispose();
+        (this.output.material as THREE.Material).dispose();
+      }
     }
 
     class WebGLManager {
       props: any;
       lastUserInteraction: number;
       autoDriver: AutoDriver;
-      running = false;
       output: Output | null = null;
-      _loop = this.loop.bind(this);
+      governor: RenderGovernor;
+      offscreen = false;
+      callActive = false;
       _resize = this.resize.bind(this);
-      _onVisibility: () => void;
+      _onCallStart = () => this.setCallActive(true);
+      _onCallEnd = () => this.setCallActive(false);
 
       constructor(props: any) {
         this.props = props;
@@ -1006,16 +1058,18 @@ export default function LiquidEther({
           rampDuration: props.autoRampDuration
         });
         this.init();
+        // Paces frames, pauses while the tab is hidden and trades solver
+        // work for frame time
+        this.governor = new RenderGovernor({
+          name: LOOP_NAME,
+          activity: () => 'active',
+          frame: () => this.render(),
+          onTierChange: tier => this.applyTier(tier),
+          frameBudgetMs: FRAME_BUDGET_MS
+        });
         window.addEventListener('resize', this._resize);
-        this._onVisibility = () => {
-          const hidden = document.hidden;
-          if (hidden) {
-            this.pause();
-          } else if (isVisibleRef.current) {
-            this.start();
-          }
-        };
-        document.addEventListener('visibilitychange', this._onVisibility);
+        window.addEventListener('callStart', this._onCallStart);
+        window.addEventListener('callEnd', this._onCallEnd);
       }
       init() {
         if (Common.renderer) this.props.$wrapper.prepend(Common.renderer.domElement);
@@ -1031,32 +1085,48 @@ export default function LiquidEther({
         Common.update();
         if (this.output) this.output.update();
       }
-      loop() {
-        if (!this.running) return; // safety
-        this.render();
-        rafRef.current = requestAnimationFrame(this._loop);
+      applyTier(tier: QualityTier) {
+        if (Common.renderer) Common.renderer.setPixelRatio(pixelRatioFor(tier));
+        const sim = this.output?.simulation;
+        if (!sim) return;
+        const prevRes = sim.options.resolution;
+        Object.assign(sim.options, simOptions(tier));
+        if (sim.options.resolution !== prevRes) sim.resize();
+      }
+      setOffscreen(offscreen: boolean) {
+        this.offscreen = offscreen;
+        this.updateSuspension();
+      }
+      setCallActive(active: boolean) {
+        this.callActive = active;
+        this.updateSuspension();
+      }
+      updateSuspension() {
+        // Nobody sees the background during a call; keep the GPU for the avatar
+        if (this.offscreen || this.callActive) {
+          this.pause();
+        } else {
+          this.start();
+        }
       }
       start() {
-        if (this.running) return;
-        this.running = true;
-        this._loop();
+        this.governor.start();
+        this.governor.resume();
       }
       pause() {
-        this.running = false;
-        if (rafRef.current) {
-          cancelAnimationFrame(rafRef.current);
-          rafRef.current = null;
-        }
+        this.governor.pause();
       }
       dispose() {
         try {
+          this.governor.stop();
           window.removeEventListener('resize', this._resize);
-          document.removeEventListener('visibilitychange', this._onVisibility);
+          window.removeEventListener('callStart', this._onCallStart);
+          window.removeEventListener('callEnd', this._onCallEnd);
           Mouse.dispose();
+          if (this.output) this.output.dispose();
           if (Common.renderer) {
-            const canvas = Common.renderer.domElement;
-            if (canvas && canvas.parentNode) canvas.parentNode.removeChild(canvas);
-            Common.renderer.dispose();
+            releaseRenderer(Common.renderer);
+            Common.renderer = null;
           }
         } catch (e) {
           void 0;
@@ -1084,19 +1154,8 @@ export default function LiquidEther({
       const sim = webglRef.current.output?.simulation;
       if (!sim) return;
       const prevRes = sim.options.resolution;
-      Object.assign(sim.options, {
-        mouse_force: mouseForce,
-        cursor_size: cursorSize,
-        isViscous,
-        viscous,
-        iterations_viscous: iterationsViscous,
-        iterations_poisson: iterationsPoisson,
-        dt,
-        BFECC,
-        resolution,
-        isBounce
-      });
-      if (resolution !== prevRes) {
+      Object.assign(sim.options, simOptions(webglRef.current.governor.tier));
+      if (sim.options.resolution !== prevRes) {
         sim.resize();
       }
     };
@@ -1111,11 +1170,7 @@ export default function LiquidEther({
         const isVisible = entry.isIntersecting && entry.intersectionRatio > 0;
         isVisibleRef.current = isVisible;
         if (!webglRef.current) return;
-        if (isVisible && !document.hidden) {
-          webglRef.current.start();
-        } else {
-          webglRef.current.pause();
-        }
+        webglRef.current.setOffscreen(!isVisible);
       },
       { threshold: [0, 0.01, 0.1] }
     );
@@ -1134,7 +1189,6 @@ export default function LiquidEther({
     resizeObserverRef.current = ro;
 
     return () => {
-      if (rafRef.current) cancelAnimationFrame(rafRef.current);
       if (resizeObserverRef.current) {
         try {
           resizeObserverRef.current.disconnect();
@@ -1152,6 +1206,7 @@ export default function LiquidEther({
       if (webglRef.current) {
         webglRef.current.dispose();
       }
+      paletteTex.dispose();
       webglRef.current = null;
     };
   }, [
@@ -1180,18 +1235,7 @@ export default function LiquidEther({
     const sim = webgl.output?.simulation;
     if (!sim) return;
     const prevRes = sim.options.resolution;
-    Object.assign(sim.options, {
-      mouse_force: mouseForce,
-      cursor_size: cursorSize,
-      isViscous,
-      viscous,
-      iterations_viscous: iterationsViscous,
-      iterations_poisson: iterationsPoisson,
-      dt,
-      BFECC,
-      resolution,
-      isBounce
-    });
+    Object.assign(sim.options, simOptions(webgl.governor.tier));
     if (webgl.autoDriver) {
       webgl.autoDriver.enabled = autoDemo;
       webgl.autoDriver.speed = autoSpeed;
@@ -1202,7 +1246,7 @@ export default function LiquidEther({
         webgl.autoDriver.mouse.takeoverDuration = takeoverDuration;
       }
     }
-    if (resolution !== prevRes) {
+    if (sim.options.resolution !== prevRes) {
       sim.resize();
     }
   }, [
@@ -2,7 +2,9 @@
 
 import { useState, useEffect, useRef } from "react";
 import { motion } from "framer-motion";
-import { API_BASE_URL } from "../../lib/config";
+import { requestSpeech } from "../../lib/tts";
+import { warmUpFaceDetection } from "../../lib/faceDetection";
+import { prefetchAvatar } from "../../lib/avatarAssets";
 import Avatar from "./Avatar";
 import Image from "next/image";
 import doctormImg from "../avatar_images/doctorm.png";
@@ -83,24 +85,12 @@ export default function SetupPage({
 
   const playVoicePreview = async (voiceId: string) => {
     try {
-      const response = await fetch(`${API_BASE_URL}/api/tts`, {
-        method: "POST",
-        headers: {
-          "Content-Type": "application/json",
-        },
-        body: JSON.stringify({
-          text: "Hey! I am your personalized AI Doctor",
-          voice_id: voiceId,
-        }),
-      });
-
-      if (!response.ok) throw new Error("Failed to generate preview");
-
-      const data = await response.json();
-      if (data.audio_base64) {
-        const audio = new Audio(`data:audio/mpeg;base64,${data.audio_base64}`);
-        await audio.play();
-      }
+      const player = await requestSpeech(
+        "Hey! I am your personalized AI Doctor",
+        voiceId
+      );
+      player.onended = () => player.dispose();
+      await player.play();
     } catch (error) {
       console.error("Error playing voice preview:", error);
     }
@@ -114,6 +104,18 @@ export default function SetupPage({
     }
   }, [selectedVoice]);
 
+  // Load and warm up the face models while the user picks a doctor, so
+  // emotion detection is ready as soon as the call starts
+  useEffect(() => {
+    warmUpFaceDetection();
+  }, []);
+
+  // Download the picked doctor right away so the call screen renders it
+  // from the shared cache instead of loading it again
+  useEffect(() => {
+    prefetchAvatar(selectedAvatar);
+  }, [selectedAvatar]);
+
   return (
     <div className="min-h-screen bg-gray-50 flex items-center justify-center p-4 md:p-8 relative overflow-hidden">
       {/* Grid Background */}
@@ -4,16 +4,22 @@ import { useState, useEffect, useRef } from "react";
 import { motion } from "framer-motion";
 import { generatePDF } from "../utils/pdfGenerator";
 import { API_BASE_URL } from "../../lib/config";
+import {
+  emotionTelemetrySettled,
+  emotionTelemetrySnapshot,
+} from "../../lib/emotionTelemetry";
 
 interface Message {
   role: "user" | "assistant";
   content: string;
   timestamp: Date;
+  emotion?: string; // Patient's dominant emotion during the message (user messages)
 }
 
 interface SummaryPageProps {
   onBackToMain: () => void;
   conversationData: Message[];
+  sessionId?: string; // Backend keeps a rolling summary for this session during the call
 }
 
 interface SummaryData {
@@ -24,6 +30,7 @@ interface SummaryData {
 export default function SummaryPage({
   onBackToMain,
   conversationData,
+  sessionId,
 }: SummaryPageProps) {
   const [summary, setSummary] = useState<SummaryData>({
     overview: "",
@@ -47,31 +54,24 @@ export default function SummaryPage({
       setIsLoading(true);
       setError(null);
 
-      // Format conversation data for API
-      const formattedConversation = conversationData.map((msg) => ({
-        role: msg.role,
-        content: msg.content,
-        timestamp: msg.timestamp.toISOString(),
-        emotion: "neutral", // TODO: Add real emotion tracking
-      }));
-
-      // For now, use neutral emotions (Person 2 will add real emotion detection)
-      const emotions = conversationData.map(() => "neutral");
-      const timestamps = conversationData.map((msg) =>
-        msg.timestamp.toISOString()
-      );
-
-      const response = await fetch(`${API_BASE_URL}/api/insights`, {
-        method: "POST",
-        headers: {
-          "Content-Type": "application/json",
-        },
-        body: JSON.stringify({
-          conversation: formattedConversation,
-          emotions: emotions,
-          timestamps: timestamps,
-        }),
-      });
+      const postInsights = (body: object) =>
+        fetch(`${API_BASE_URL}/api/insights`, {
+          method: "POST",
+          headers: {
+            "Content-Type": "application/json",
+          },
+          body: JSON.stringify(body),
+        });
+
+      // The backend summarized the call as it went - just ask for the result
+      // (once the call's last emotion batch has landed)
+      await emotionTelemetrySettled();
+      let response = sessionId ? await postInsights({ session_id: sessionId }) : null;
+
+      // Session expired or unknown to this server: send the transcript instead
+      if (!response || response.status === 404) {
+        response = await postInsights(buildInsightsRequest());
+      }
 
       if (!response.ok) {
         throw new Error("Failed to fetch insights");
@@ -90,6 +90,29 @@ export default function SummaryPage({
     }
   };
 
+  const buildInsightsRequest = () => {
+    // Format conversation data for API
+    const formattedConversation = conversationData.map((msg) => ({
+      role: msg.role,
+      content: msg.content,
+      timestamp: msg.timestamp.toISOString(),
+      emotion: msg.emotion ?? null,
+    }));
+
+    // Emotion per patient turn, for when no webcam telemetry was collected
+    const tagged = conversationData.filter((msg) => msg.emotion);
+    const emotions = tagged.map((msg) => msg.emotion as string);
+    const timestamps = tagged.map((msg) => msg.timestamp.toISOString());
+
+    return {
+      conversation: formattedConversation,
+      emotions: emotions,
+      timestamps: timestamps,
+      // Webcam emotion for the whole call, aggregated on this device
+      emotion_telemetry: emotionTelemetrySnapshot(),
+    };
+  };
+
   const generateBasicSummary = (): SummaryData => {
     if (conversationData.length === 0) {
       return {
@@ -18,11 +18,16 @@ interface VideoFeedProps {
     ageCategory?: string
   ) => void;
   onConfidenceUpdate?: (confidence: number) => void;
+  onEmotionSample?: (result: EmotionResult) => void; // Every detection, with probabilities
 }
 
 type WebcamPhase = "analyzing" | "connected" | "emotion";
 
-export default function VideoFeed({ onEmotionDetected, onConfidenceUpdate }: VideoFeedProps) {
+export default function VideoFeed({
+  onEmotionDetected,
+  onConfidenceUpdate,
+  onEmotionSample,
+}: VideoFeedProps) {
   const videoRef = useRef<HTMLVideoElement>(null);
   const canvasRef = useRef<HTMLCanvasElement>(null);
   const streamRef = useRef<MediaStream | null>(null);
@@ -76,8 +81,8 @@ export default function VideoFeed({ onEmotionDetected, onConfidenceUpdate }: Vid
       setIsLoading(true);
       setError(null);
 
-      // Load face detection models from CDN
-      console.log("📦 Loading face detection models from CDN...");
+      // Load face detection models (usually already warm from the setup page)
+      console.log("📦 Loading face detection models...");
       await loadFaceDetectionModels();
       modelsLoadedRef.current = true; // Set ref immediately
       setModelsLoaded(true); // Also set state for UI
@@ -191,6 +196,7 @@ export default function VideoFeed({ onEmotionDetected, onConfidenceUpdate }: Vid
           `(${(result.confidence * 100).toFixed(1)}% confidence)`
         );
         console.log("  - All emotions:", result.allEmotions);
+        onEmotionSample?.(result);
 
         // Collect age samples for the first few detections
         if (!ageLocked.current && result.age !== undefined) {
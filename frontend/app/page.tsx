@@ -19,6 +19,7 @@ export default function Home() {
   const [selectedAvatar, setSelectedAvatar] = useState("doctorm");
   const [selectedVoice, setSelectedVoice] = useState("Sq93GQT4X1lKDXsQcixO"); // Default to Felix (Doctor M)
   const [conversationData, setConversationData] = useState<any[]>([]); // Store conversation for summary
+  const [sessionId, setSessionId] = useState<string | undefined>(); // Backend session that holds the precomputed summary
 
   const renderView = () => {
     switch (currentView) {
@@ -40,8 +41,9 @@ export default function Home() {
       case "call":
         return (
           <CallInterface
-            onEndCall={(messages) => {
+            onEndCall={(messages, callSessionId) => {
               setConversationData(messages);
+              setSessionId(callSessionId);
               setCurrentView("summary");
             }}
             selectedBg={selectedBg}
@@ -55,6 +57,7 @@ export default function Home() {
           <SummaryPage
             onBackToMain={() => setCurrentView("landing")}
             conversationData={conversationData}
+            sessionId={sessionId}
           />
         );
       default:
@@ -0,0 +1,463 @@
+/**
+ * Audio engine - one long-lived audio graph per call
+ *
+ * A single AudioContext, microphone stream and output analyser serve doctor
+ * playback, voice activity detection and recording for the whole call, so
+ * no turn pays for getUserMedia or AudioContext setup. Streamed TTS is
+ * decoded into AudioBuffers as it arrives and scheduled back to back, so
+ * sentences play without gaps.
+ */
+
+import { VisemeTrack, setLipSyncSource, clearLipSyncSource } from './visemes';
+import type { SpeechPlayer } from './audioUtils';
+
+// Decode this many MP3 frames at a time (~210ms at 44.1kHz)
+const SEGMENT_FRAMES = 8;
+// Frames re-decoded ahead of each segment so the bit reservoir and MDCT
+// overlap are primed; their samples are dropped again
+const OVERLAP_FRAMES = 3;
+// Scheduling lead so the first buffer (or one after an underrun) isn't late
+const SCHEDULE_LEAD_S = 0.03;
+
+export class AudioEngine {
+  readonly context: AudioContext;
+  readonly output: GainNode; // Playback bus: output -> analyser -> speakers
+  private analyser: AnalyserNode;
+  private levelData: Uint8Array;
+  private microphone: Promise<MediaStream> | null = null;
+  private worklets = new Map<string, Promise<void>>();
+
+  constructor() {
+    const AudioContextClass = window.AudioContext || (window as any).webkitAudioContext;
+    this.context = new AudioContextClass({ latencyHint: 'interactive' });
+    this.output = this.context.createGain();
+    this.analyser = this.context.createAnalyser();
+    this.analyser.fftSize = 256;
+    this.levelData = new Uint8Array(this.analyser.fftSize);
+    this.output.connect(this.analyser);
+    this.analyser.connect(this.context.destination);
+  }
+
+  /**
+   * Resume the context (browsers start it suspended without a user gesture)
+   */
+  async resume(): Promise<void> {
+    if (this.context.state === 'suspended') {
+      await this.context.resume().catch(() => {});
+    }
+  }
+
+  /**
+   * The call's microphone stream, opened on first use
+   */
+  acquireMicrophone(): Promise<MediaStream> {
+    if (!this.microphone) {
+      // Echo cancellation keeps the doctor's voice out of VAD and STT
+      this.microphone = navigator.mediaDevices.getUserMedia({
+        audio: { echoCancellation: true, noiseSuppression: true },
+      });
+      this.microphone.catch(() => {
+        this.microphone = null; // Ask again next time after a denial
+      });
+    }
+    return this.microphone;
+  }
+
+  /**
+   * Load an AudioWorklet module once per context
+   */
+  loadWorklet(url: string): Promise<void> {
+    let pending = this.worklets.get(url);
+    if (!pending) {
+      pending = this.context.audioWorklet.addModule(url);
+      pending.catch(() => this.worklets.delete(url));
+      this.worklets.set(url, pending);
+    }
+    return pending;
+  }
+
+  /**
+   * New gapless player for one streamed reply
+   */
+  createPlayback(): QueuedPlayback {
+    return new QueuedPlayback(this);
+  }
+
+  /**
+   * Current playback volume (0-1)
+   */
+  getOutputLevel(): number {
+    this.analyser.getByteTimeDomainData(this.levelData as any);
+    let sumSquares = 0;
+    for (let i = 0; i < this.levelData.length; i++) {
+      const sample = (this.levelData[i] - 128) / 128; // normalize -1..1
+      sumSquares += sample * sample;
+    }
+    const rms = Math.sqrt(sumSquares / this.levelData.length);
+    return Math.min(1, rms * 4); // boost to make speech movement visible
+  }
+
+  /**
+   * Release the microphone and the context
+   */
+  close(): void {
+    this.microphone
+      ?.then((stream) => stream.getTracks().forEach((track) => track.stop()))
+      .catch(() => {});
+    this.microphone = null;
+    this.context.close().catch(() => {});
+  }
+}
+
+let engine: AudioEngine | null = null;
+
+/**
+ * Audio engine for the current call (created on first use)
+ */
+export function getAudioEngine(): AudioEngine {
+  if (!engine || engine.context.state === 'closed') {
+    engine = new AudioEngine();
+  }
+  return engine;
+}
+
+/**
+ * Tear down the current call's engine
+ */
+export function closeAudioEngine(): void {
+  engine?.close();
+  engine = null;
+}
+
+interface FrameInfo {
+  length: number; // Bytes, including the header
+  samples: number; // PCM samples per channel
+  sampleRate: number;
+}
+
+const BITRATES_V1_L3 = [0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320];
+const BITRATES_V2_L3 = [0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160];
+const SAMPLE_RATES: Record<number, number[]> = {
+  3: [44100, 48000, 32000], // MPEG-1
+  2: [22050, 24000, 16000], // MPEG-2
+  0: [11025, 12000, 8000], // MPEG-2.5
+};
+
+/**
+ * Parse the MP3 (Layer III) frame header at offset, if there is one
+ */
+function readFrameHeader(bytes: Uint8Array, offset: number): FrameInfo | null {
+  if (offset + 4 > bytes.length) return null;
+  const b1 = bytes[offset + 1];
+  const b2 = bytes[offset + 2];
+  if (bytes[offset] !== 0xff || (b1 & 0xe0) !== 0xe0) return null;
+
+  const version = (b1 >> 3) & 0x03;
+  const layer = (b1 >> 1) & 0x03;
+  const bitrateIndex = b2 >> 4;
+  const rateIndex = (b2 >> 2) & 0x03;
+  if (version === 1 || layer !== 1 || bitrateIndex === 0 || bitrateIndex === 15 || rateIndex === 3) {
+    return null;
+  }
+
+  const mpeg1 = version === 3;
+  const bitrate = (mpeg1 ? BITRATES_V1_L3 : BITRATES_V2_L3)[bitrateIndex] * 1000;
+  const sampleRate = SAMPLE_RATES[version][rateIndex];
+  const padding = (b2 >> 1) & 0x01;
+  return {
+    length: Math.floor(((mpeg1 ? 144 : 72) * bitrate) / sampleRate) + padding,
+    samples: mpeg1 ? 1152 : 576,
+    sampleRate,
+  };
+}
+
+function concatBytes(a: Uint8Array, b: Uint8Array): Uint8Array {
+  if (a.length === 0) return b;
+  const merged = new Uint8Array(a.length + b.length);
+  merged.set(a);
+  merged.set(b, a.length);
+  return merged;
+}
+
+/**
+ * Plays one streamed MP3 reply through the engine without gaps
+ *
+ * Incoming bytes are cut on frame boundaries and decoded a few hundred ms
+ * at a time; each decoded buffer is scheduled to start exactly when the
+ * previous one ends.
+ */
+export class QueuedPlayback implements SpeechPlayer {
+  readonly visemes = new VisemeTrack();
+  onplay: (() => void) | null = null;
+  onended: (() => void) | null = null;
+  onerror: (() => void) | null = null;
+  firstDecodeMs: number | null = null; // Time to decode the first segment, for turn metrics
+
+  private pending = new Uint8Array(0); // Bytes not yet decoded
+  private carry = new Uint8Array(0); // Last OVERLAP_FRAMES frames already decoded
+  private carryFrames = 0;
+  private frameFormat: FrameInfo | null = null;
+  private firstFrame = true;
+  private decodeChain: Promise<void> = Promise.resolve();
+  private decoding = 0;
+  private ready: AudioBuffer[] = []; // Decoded, waiting for play()
+  private sources = new Set<AudioBufferSourceNode>();
+  private segments: { at: number; offset: number; duration: number }[] = [];
+  private nextStart = 0;
+  private streamOffset = 0;
+  private started = false;
+  private playing = false;
+  private scheduledAny = false;
+  private ended = false;
+  private finished = false;
+
+  constructor(private engine: AudioEngine) {}
+
+  hasAudio(): boolean {
+    return this.started;
+  }
+
+  /**
+   * Playback position in the reply (seconds), for lip sync
+   */
+  get currentTime(): number {
+    const now = this.engine.context.currentTime;
+    let position = 0;
+    for (const segment of this.segments) {
+      if (segment.at > now) break;
+      position = segment.offset + Math.min(now - segment.at, segment.duration);
+    }
+    return position;
+  }
+
+  get paused(): boolean {
+    return !this.playing || this.finished;
+  }
+
+  append(chunk: Uint8Array): void {
+    if (this.ended || this.finished || chunk.length === 0) return;
+    this.started = true;
+    this.pending = concatBytes(this.pending, chunk);
+    this.cutSegments(false);
+  }
+
+  end(): void {
+    if (this.ended) return;
+    this.ended = true;
+    this.cutSegments(true);
+    this.decodeChain.then(() => this.checkFinished());
+  }
+
+  async play(): Promise<void> {
+    if (this.playing || this.finished) return;
+    this.playing = true;
+    await this.engine.resume();
+    const queued = this.ready;
+    this.ready = [];
+    queued.forEach((buffer) => this.schedule(buffer));
+    this.checkFinished();
+  }
+
+  /**
+   * Stop without reporting an end or an error
+   */
+  stop(): void {
+    this.onended = null;
+    this.onerror = null;
+    this.dispose();
+  }
+
+  dispose(): void {
+    this.finished = true;
+    clearLipSyncSource(this);
+    this.sources.forEach((source) => {
+      source.onended = null;
+      try {
+        source.stop();
+      } catch (error) {
+        // Not started yet
+      }
+      source.disconnect();
+    });
+    this.sources.clear();
+    this.ready = [];
+    this.pending = new Uint8Array(0);
+    this.carry = new Uint8Array(0);
+  }
+
+  /**
+   * Split complete frames off the pending bytes and queue them for decoding
+   */
+  private cutSegments(flush: boolean): void {
+    let offset = 0;
+    let frames = 0;
+    let cutAt = 0;
+    const bytes = this.pending;
+
+    // ID3v2 tag in front of the first frame
+    if (this.firstFrame && bytes.length >= 10 && bytes[0] === 0x49 && bytes[1] === 0x44 && bytes[2] === 0x33) {
+      const size = ((bytes[6] & 0x7f) << 21) | ((bytes[7] & 0x7f) << 14) | ((bytes[8] & 0x7f) << 7) | (bytes[9] & 0x7f);
+      if (bytes.length < 10 + size) return; // Wait for the whole tag
+      offset = 10 + size;
+      cutAt = offset;
+    }
+
+    while (offset < bytes.length) {
+      const frame = readFrameHeader(bytes, offset);
+      if (!frame) {
+        if (offset + 4 > bytes.length) break; // Header not complete yet
+        offset++; // Resync on garbage
+        if (frames === 0) cutAt = offset; // Garbage inside a segment is left to the decoder
+        continue;
+      }
+      if (offset + frame.length > bytes.length) break;
+
+      if (this.firstFrame) {
+        this.firstFrame = false;
+        this.frameFormat = frame;
+        if (isInfoFrame(bytes, offset, frame.length)) {
+          // Xing/Info header: decoders would trim encoder delay from this
+          // segment only, so drop it to keep every segment aligned the same way
+          offset += frame.length;
+          cutAt = offset;
+          continue;
+        }
+      }
+
+      offset += frame.length;
+      frames++;
+
+      if (frames >= SEGMENT_FRAMES) {
+        this.queueDecode(bytes.subarray(cutAt, offset), frames);
+        cutAt = offset;
+        frames = 0;
+      }
+    }
+
+    if (flush && frames > 0) {
+      this.queueDecode(bytes.subarray(cutAt, offset), frames);
+      cutAt = offset;
+    }
+    this.pending = bytes.slice(cutAt);
+  }
+
+  private queueDecode(segment: Uint8Array, frames: number): void {
+    const data = concatBytes(this.carry, segment);
+    const trimFrames = this.carryFrames;
+    const format = this.frameFormat!;
+
+    // Keep the tail of this segment to prime the next decode
+    this.carry = lastFrames(data, OVERLAP_FRAMES);
+    this.carryFrames = Math.min(OVERLAP_FRAMES, trimFrames + frames);
+
+    this.decoding++;
+    this.decodeChain = this.decodeChain.then(async () => {
+      try {
+        if (this.finished) return;
+        // decodeAudioData detaches its input, so hand it a copy
+        const decodeStartedAt = performance.now();
+        const decoded = await this.engine.context.decodeAudioData(data.slice().buffer);
+        this.firstDecodeMs ??= performance.now() - decodeStartedAt;
+        if (this.finished) return;
+        const trim = Math.round(trimFrames * format.samples * (decoded.sampleRate / format.sampleRate));
+        const buffer = trimBuffer(this.engine.context, decoded, trim);
+        if (!buffer) return;
+        if (this.playing) {
+          this.schedule(buffer);
+        } else {
+          this.ready.push(buffer);
+        }
+      } catch (error) {
+        console.warn('QueuedPlayback: failed to decode audio segment', error);
+      } finally {
+        this.decoding--;
+      }
+    });
+  }
+
+  private schedule(buffer: AudioBuffer): void {
+    const context = this.engine.context;
+    const earliest = context.currentTime + SCHEDULE_LEAD_S;
+    if (this.nextStart < earliest) this.nextStart = earliest; // First buffer or underrun
+
+    const source = context.createBufferSource();
+    source.buffer = buffer;
+    source.connect(this.engine.output);
+    source.onended = () => {
+      this.sources.delete(source);
+      source.disconnect();
+      this.checkFinished();
+    };
+    source.start(this.nextStart);
+    this.sources.add(source);
+
+    this.segments.push({ at: this.nextStart, offset: this.streamOffset, duration: buffer.duration });
+    this.streamOffset += buffer.duration;
+    this.nextStart += buffer.duration;
+
+    if (!this.scheduledAny) {
+      this.scheduledAny = true;
+      setLipSyncSource(this, this.visemes);
+      this.onplay?.();
+    }
+  }
+
+  private checkFinished(): void {
+    if (this.finished || !this.ended || !this.playing) return;
+    if (this.decoding > 0 || this.sources.size > 0 || this.ready.length > 0) return;
+
+    this.finished = true;
+    clearLipSyncSource(this);
+    if (this.scheduledAny) {
+      this.onended?.();
+    } else {
+      this.onerror?.(); // Nothing could be decoded
+    }
+  }
+}
+
+/**
+ * Whether the frame at offset is a Xing/Info metadata frame
+ */
+function isInfoFrame(bytes: Uint8Array, offset: number, length: number): boolean {
+  const end = Math.min(offset + length, bytes.length) - 4;
+  for (let i = offset + 4; i <= end; i++) {
+    const tag = String.fromCharCode(bytes[i], bytes[i + 1], bytes[i + 2], bytes[i + 3]);
+    if (tag === 'Xing' || tag === 'Info') return true;
+  }
+  return false;
+}
+
+/**
+ * Bytes of the last `count` complete frames in data
+ */
+function lastFrames(data: Uint8Array, count: number): Uint8Array {
+  const starts: number[] = [];
+  let offset = 0;
+  while (offset < data.length) {
+    const frame = readFrameHeader(data, offset);
+    if (!frame) {
+      offset++;
+      continue;
+    }
+    starts.push(offset);
+    offset += frame.length;
+  }
+  if (starts.length === 0) return new Uint8Array(0);
+  return data.slice(starts[Math.max(0, starts.length - count)]);
+}
+
+/**
+ * Drop the first `trim` samples of a buffer
+ */
+function trimBuffer(context: AudioContext, buffer: AudioBuffer, trim: number): AudioBuffer | null {
+  if (trim <= 0) return buffer;
+  const length = buffer.length - trim;
+  if (length <= 0) return null;
+
+  const trimmed = context.createBuffer(buffer.numberOfChannels, length, buffer.sampleRate);
+  for (let channel = 0; channel < buffer.numberOfChannels; channel++) {
+    trimmed.copyToChannel(buffer.getChannelData(channel).subarray(trim), channel);
+  }
+  return trimmed;
+}
@@ -2,6 +2,8 @@
  * Audio utilities for recording and playback (ElevenLabs STT/TTS via backend)
  */
 
+import { VisemeTrack, setLipSyncSource, clearLipSyncSource } from './visemes';
+
 /**
  * Audio recorder class for capturing microphone input
  */
@@ -10,22 +12,34 @@ export class AudioRecorder {
   private audioChunks: Blob[] = [];
   private stream: MediaStream | null = null;
 
+  /**
+   * @param getStream Shared microphone stream (e.g. the call's AudioEngine);
+   *   kept open between recordings. Without it each recording opens its own.
+   */
+  constructor(private getStream?: () => Promise<MediaStream>) {}
+
   /**
    * Start recording audio from microphone
+   *
+   * With a timeslice, onChunk receives each chunk as soon as it is captured;
+   * the chunks concatenate into the same webm returned by stopRecording.
    */
-  async startRecording(): Promise<void> {
+  async startRecording(onChunk?: (chunk: Blob) => void, timeslice?: number): Promise<void> {
     try {
-      this.stream = await navigator.mediaDevices.getUserMedia({ audio: true });
+      this.stream = this.getStream
+        ? await this.getStream()
+        : await navigator.mediaDevices.getUserMedia({ audio: true });
       this.mediaRecorder = new MediaRecorder(this.stream);
       this.audioChunks = [];
 
       this.mediaRecorder.ondataavailable = (event) => {
         if (event.data.size > 0) {
           this.audioChunks.push(event.data);
+          onChunk?.(event.data);
         }
       };
 
-      this.mediaRecorder.start();
+      this.mediaRecorder.start(timeslice);
     } catch (error) {
       throw new Error('Failed to start recording: ' + (error instanceof Error ? error.message : String(error)));
     }
@@ -56,7 +70,9 @@ export class AudioRecorder {
    */
   private cleanup(): void {
     if (this.stream) {
-      this.stream.getTracks().forEach(track => track.stop());
+      if (!this.getStream) {
+        this.stream.getTracks().forEach(track => track.stop());
+      }
       this.stream = null;
     }
     this.mediaRecorder = null;
@@ -72,116 +88,185 @@ export class AudioRecorder {
 }
 
 /**
- * Play audio from URL or base64
+ * Streamed speech playback, shared by StreamingAudioPlayer (audio element)
+ * and QueuedPlayback (the call's AudioEngine)
  */
-export async function playAudio(
-  audioSource: string,
-  onStart?: () => void,
-  onEnd?: () => void,
-  onError?: (error: string) => void
-): Promise<HTMLAudioElement> {
-  const audio = new Audio();
-  
-  audio.onplay = () => onStart?.();
-  audio.onended = () => onEnd?.();
-  audio.onerror = () => onError?.('Failed to play audio');
-  
-  // Check if base64 or URL
-  if (audioSource.startsWith('data:')) {
-    audio.src = audioSource;
-  } else {
-    audio.src = audioSource;
-  }
-  
-  try {
-    await audio.play();
-    return audio;
-  } catch (error) {
-    onError?.('Audio playback failed');
-    throw error;
-  }
+export interface SpeechPlayer {
+  readonly visemes: VisemeTrack;
+  onplay: (() => void) | null;
+  onended: (() => void) | null;
+  onerror: (() => void) | null;
+  hasAudio(): boolean;
+  append(chunk: Uint8Array): void;
+  end(): void;
+  play(): Promise<void>;
+  stop(): void; // Stop without firing onended/onerror
+  dispose(): void;
 }
 
-// ...
-
-export class AudioAnalyzer {
-  private audioContext: AudioContext | null = null;
-  private analyser: AnalyserNode | null = null;
-  private freqData: Uint8Array;
-  private timeDomainData: Uint8Array;
-  private source: MediaElementAudioSourceNode | null = null;
-  
-  constructor() {
-    if (typeof window === 'undefined') {
-      this.freqData = new Uint8Array(0);
-      this.timeDomainData = new Uint8Array(0);
-      return;
+/**
+ * Plays audio/mpeg that arrives in chunks, starting before the last chunk
+ *
+ * Uses MediaSource when the browser supports MP3 in it; otherwise chunks are
+ * collected and played from a Blob URL once the stream ends.
+ */
+export class StreamingAudioPlayer implements SpeechPlayer {
+  readonly audio: HTMLAudioElement;
+  readonly visemes = new VisemeTrack(); // Lip-sync keys for this stream, if the backend sends them
+  private mediaSource: MediaSource | null = null;
+  private sourceBuffer: SourceBuffer | null = null;
+  private pending: Uint8Array[] = [];
+  private collected: Uint8Array[] = [];
+  private objectUrl: string | null = null;
+  private ended = false;
+  private started = false;
+  private playWhenReady = false;
+
+  constructor(private mimeType: string = 'audio/mpeg') {
+    this.audio = new Audio();
+
+    // The avatar follows whichever player is audibly playing
+    this.audio.addEventListener('playing', () => setLipSyncSource(this.audio, this.visemes));
+    this.audio.addEventListener('ended', () => clearLipSyncSource(this.audio));
+
+    if (StreamingAudioPlayer.isStreamingSupported(mimeType)) {
+      this.mediaSource = new MediaSource();
+      this.objectUrl = URL.createObjectURL(this.mediaSource);
+      this.audio.src = this.objectUrl;
+      this.mediaSource.addEventListener('sourceopen', () => {
+        if (!this.mediaSource) return;
+        this.sourceBuffer = this.mediaSource.addSourceBuffer(this.mimeType);
+        this.sourceBuffer.mode = 'sequence'; // Segments play back to back
+        this.sourceBuffer.addEventListener('updateend', () => this.pump());
+        this.pump();
+      }, { once: true });
     }
+  }
+
+  /**
+   * Check whether chunks can be played as they arrive
+   */
+  static isStreamingSupported(mimeType: string = 'audio/mpeg'): boolean {
+    return typeof window !== 'undefined' &&
+      'MediaSource' in window &&
+      MediaSource.isTypeSupported(mimeType);
+  }
+
+  get onplay(): (() => void) | null {
+    return this.audio.onplay as (() => void) | null;
+  }
+  set onplay(handler: (() => void) | null) {
+    this.audio.onplay = handler;
+  }
+  get onended(): (() => void) | null {
+    return this.audio.onended as (() => void) | null;
+  }
+  set onended(handler: (() => void) | null) {
+    this.audio.onended = handler;
+  }
+  get onerror(): (() => void) | null {
+    return this.audio.onerror as (() => void) | null;
+  }
+  set onerror(handler: (() => void) | null) {
+    this.audio.onerror = handler;
+  }
 
-    const AudioContextClass = window.AudioContext || (window as any).webkitAudioContext;
-    this.audioContext = new AudioContextClass();
-    this.analyser = this.audioContext.createAnalyser();
-    this.analyser.fftSize = 256;
-    const bufferLength = this.analyser.frequencyBinCount;
-    this.freqData = new Uint8Array(bufferLength);
-    this.timeDomainData = new Uint8Array(this.analyser.fftSize);
+  /**
+   * Whether any audio has been appended yet
+   */
+  hasAudio(): boolean {
+    return this.started;
   }
-  
+
   /**
-   * Connect audio element to analyzer
+   * Add the next chunk of audio
    */
-  connectAudio(audioElement: HTMLAudioElement): void {
-    if (!this.audioContext || !this.analyser) return;
+  append(chunk: Uint8Array): void {
+    if (this.ended || chunk.length === 0) return;
+    this.started = true;
 
-    if (this.source) {
-      this.source.disconnect();
+    if (this.mediaSource) {
+      this.pending.push(chunk);
+      this.pump();
+    } else {
+      this.collected.push(chunk);
     }
-    this.source = this.audioContext.createMediaElementSource(audioElement);
-    this.source.connect(this.analyser);
-    this.analyser.connect(this.audioContext.destination);
   }
 
-  disconnect(): void {
-    if (this.source) {
-      try {
-        this.source.disconnect();
-      } catch (error) {
-        console.warn('AudioAnalyzer disconnect error', error);
+  /**
+   * Mark the stream as complete
+   */
+  end(): void {
+    if (this.ended) return;
+    this.ended = true;
+
+    if (this.mediaSource) {
+      this.pump();
+    } else if (this.collected.length > 0) {
+      const blob = new Blob(this.collected as BlobPart[], { type: this.mimeType });
+      this.collected = [];
+      this.objectUrl = URL.createObjectURL(blob);
+      this.audio.src = this.objectUrl;
+      if (this.playWhenReady) {
+        this.audio.play().catch((error) => {
+          console.error('StreamingAudioPlayer: playback failed', error);
+          this.audio.dispatchEvent(new Event('error'));
+        });
       }
-      this.source = null;
-    }
-    try {
-      this.analyser?.disconnect();
-    } catch (error) {
-      console.warn('Analyser disconnect error', error);
     }
-    this.audioContext?.close();
   }
-  
+
   /**
-   * Get current audio volume (0-1)
+   * Start playback
+   *
+   * With MediaSource this starts as soon as the first chunk is buffered;
+   * otherwise playback starts when the stream ends.
    */
-  getVolume(): number {
-    if (!this.analyser) return 0;
-
-    this.analyser.getByteTimeDomainData(this.timeDomainData as any);
-    let sumSquares = 0;
-    for (let i = 0; i < this.timeDomainData.length; i++) {
-      const sample = (this.timeDomainData[i] - 128) / 128; // normalize -1..1
-      sumSquares += sample * sample;
+  async play(): Promise<void> {
+    if (!this.mediaSource && !this.ended) {
+      this.playWhenReady = true;
+      return;
     }
-    const rms = Math.sqrt(sumSquares / this.timeDomainData.length);
-    return Math.min(1, rms * 4); // boost to make speech movement visible
+    await this.audio.play();
   }
-  
+
   /**
-   * Get frequency data for visualization
+   * Stop without reporting an end or an error
    */
-  getFrequencyData(): Uint8Array {
-    if (!this.analyser) return new Uint8Array(0);
+  stop(): void {
+    this.audio.onended = null;
+    this.audio.onerror = null;
+    this.dispose();
+  }
 
-    this.analyser.getByteFrequencyData(this.freqData as any);
-    return this.freqData;
+  /**
+   * Stop playback and release the object URL
+   */
+  dispose(): void {
+    clearLipSyncSource(this.audio);
+    this.audio.pause();
+    this.audio.removeAttribute('src');
+    this.audio.load();
+    if (this.objectUrl) {
+      URL.revokeObjectURL(this.objectUrl);
+      this.objectUrl = null;
+    }
+    this.mediaSource = null;
+    this.sourceBuffer = null;
+    this.pending = [];
+    this.collected = [];
+  }
+
+  private pump(): void {
+    const sourceBuffer = this.sourceBuffer;
+    if (!sourceBuffer || sourceBuffer.updating || !this.mediaSource) return;
+
+    const next = this.pending.shift();
+    if (next) {
+      sourceBuffer.appendBuffer(next as BufferSource);
+    } else if (this.ended && this.mediaSource.readyState === 'open') {
+      this.mediaSource.endOfStream();
+    }
   }
 }
 
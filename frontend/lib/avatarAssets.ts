@@ -0,0 +1,155 @@
+/**
+ * Avatar assets - one shared GLTF cache for every Avatar instance
+ *
+ * Each doctor model is downloaded and parsed once per page load. Avatars
+ * get a SkeletonUtils clone, so geometry, textures and animation clips are
+ * shared between the setup preview and the call screen instead of being
+ * uploaded to the GPU twice.
+ *
+ * Optimized (meshopt + WebP, textures capped at 1024px) copies are built
+ * into /models/avatars/ by `npm run models:avatars`; the original GLBs in
+ * /models/ are used until that bundle is deployed.
+ */
+
+import * as THREE from 'three';
+import { GLTFLoader, GLTF } from 'three/examples/jsm/loaders/GLTFLoader.js';
+import { MeshoptDecoder } from 'three/examples/jsm/libs/meshopt_decoder.module.js';
+import * as SkeletonUtils from 'three/examples/jsm/utils/SkeletonUtils.js';
+
+// Map avatarId to model file
+const MODEL_FILES: Record<string, string> = {
+  doctorm: 'DoctorM.glb',
+  doctorf: 'DoctorF.glb',
+  baymax: 'Baymax.glb',
+  joe: 'DoctorM.glb', // fallback
+  mark: 'DoctorM.glb',
+  sasha: 'DoctorF.glb',
+};
+const DEFAULT_MODEL_FILE = 'DoctorM.glb';
+
+const ORIGINAL_MODEL_DIR = '/models/';
+const OPTIMIZED_MODEL_DIR = '/models/avatars/';
+const LOAD_TIMEOUT_MS = 15000;
+
+let loader: GLTFLoader | null = null;
+let optimizedAvailable: Promise<boolean> | null = null;
+const gltfCache = new Map<string, Promise<GLTF>>();
+
+function getLoader(): GLTFLoader {
+  if (!loader) {
+    loader = new GLTFLoader();
+    loader.setMeshoptDecoder(MeshoptDecoder);
+  }
+  return loader;
+}
+
+/**
+ * Check once whether the optimized bundle is deployed
+ */
+function hasOptimizedModels(): Promise<boolean> {
+  optimizedAvailable = optimizedAvailable ?? fetch(`${OPTIMIZED_MODEL_DIR}manifest.json`)
+    .then((response) => response.ok)
+    .catch(() => false);
+  return optimizedAvailable;
+}
+
+/**
+ * Model URL for an avatar
+ */
+export async function resolveAvatarUrl(avatarId: string): Promise<string> {
+  const file = MODEL_FILES[avatarId.toLowerCase()] || DEFAULT_MODEL_FILE;
+  const dir = (await hasOptimizedModels()) ? OPTIMIZED_MODEL_DIR : ORIGINAL_MODEL_DIR;
+  return dir + file;
+}
+
+/**
+ * Configure the model's materials for the call screen (opaque, matte)
+ *
+ * Runs once per cached GLTF - the materials are shared by every clone.
+ */
+function prepareMaterials(scene: THREE.Group): void {
+  scene.traverse((child: THREE.Object3D) => {
+    if (!(child instanceof THREE.Mesh) || !child.material) return;
+
+    // Ensure proper texture encoding
+    if (child.material.map) {
+      child.material.map.colorSpace = THREE.SRGBColorSpace;
+    }
+
+    if (child.material instanceof THREE.MeshStandardMaterial) {
+      child.material.roughness = 0.6;
+      child.material.metalness = 0.0;
+
+      // Force opaque rendering - disable transparency
+      child.material.transparent = false;
+      child.material.opacity = 1.0;
+      child.material.alphaTest = 0;
+      child.material.depthWrite = true;
+      child.material.side = THREE.FrontSide;
+      child.material.alphaMap = null;
+
+      child.material.needsUpdate = true;
+    }
+  });
+}
+
+/**
+ * Load (or reuse) the parsed GLTF for an avatar
+ *
+ * Failed loads are evicted so the next mount retries.
+ */
+export function loadAvatarGLTF(avatarId: string): Promise<GLTF> {
+  const key = (MODEL_FILES[avatarId.toLowerCase()] || DEFAULT_MODEL_FILE);
+  let pending = gltfCache.get(key);
+
+  if (!pending) {
+    pending = (async () => {
+      const url = await resolveAvatarUrl(avatarId);
+      console.log("Avatar: starting model load", url);
+      let timer: ReturnType<typeof setTimeout> | undefined;
+      try {
+        const gltf = await Promise.race([
+          getLoader().loadAsync(url),
+          new Promise<never>((_, reject) => {
+            timer = setTimeout(() => reject(new Error("Model load timeout")), LOAD_TIMEOUT_MS);
+          }),
+        ]);
+        prepareMaterials(gltf.scene);
+        return gltf;
+      } finally {
+        clearTimeout(timer);
+      }
+    })();
+    pending.catch(() => gltfCache.delete(key));
+    gltfCache.set(key, pending);
+  }
+
+  return pending;
+}
+
+/**
+ * Start downloading an avatar in the background (e.g. as soon as it is picked)
+ */
+export function prefetchAvatar(avatarId: string): void {
+  loadAvatarGLTF(avatarId).catch((error) => {
+    console.warn("Avatar prefetch failed:", error);
+  });
+}
+
+/**
+ * Get a scene graph for one Avatar instance
+ *
+ * The clone has its own bones and transforms (so each instance animates
+ * independently) but shares geometry, materials and textures with the
+ * cache. Callers must not dispose those - they outlive the component.
+ */
+export async function instantiateAvatar(avatarId: string): Promise<{
+  scene: THREE.Group;
+  animations: THREE.AnimationClip[];
+}> {
+  const gltf = await loadAvatarGLTF(avatarId);
+  return {
+    scene: SkeletonUtils.clone(gltf.scene) as THREE.Group,
+    animations: gltf.animations,
+  };
+}
@@ -0,0 +1,348 @@
+/**
+ * Call channel - the whole consultation over one WebSocket (/api/call)
+ *
+ * Microphone chunks go up while the patient speaks; the transcript, reply
+ * text, audio, visemes and control events come back as typed binary frames
+ * on the same socket. The server feeds the final transcript straight into
+ * Gemini and TTS, so a turn costs no extra HTTP requests. Same recording
+ * interface as StreamingTranscriber, and falls back to REST (upload, then
+ * /api/chat/speech) whenever the socket is unavailable.
+ */
+
+import { WS_BASE_URL } from './config';
+import { AudioRecorder } from './audioUtils';
+import { uploadRecording } from './sttStream';
+import type { ChatResult } from './chatStream';
+import type { VisemeTimeline } from './visemes';
+import type { TurnTrace } from './turnMetrics';
+import {
+  decodeFrame,
+  decodeJsonPayload,
+  FRAME_AUDIO,
+  FRAME_CONTROL,
+  FRAME_DONE,
+  FRAME_ERROR,
+  FRAME_TEXT_DELTA,
+  FRAME_TRANSCRIPT,
+  FRAME_VISEMES,
+} from './frames';
+
+const CHUNK_MS = 250; // MediaRecorder timeslice
+const FINAL_TIMEOUT_MS = 15000;
+
+export interface CallTurnContext {
+  emotion: string;
+  age?: number | null;
+  age_category?: string | null;
+}
+
+export interface CallReplyHandlers {
+  onDelta?: (delta: string, textSoFar: string) => void;
+  onAudio?: (chunk: Uint8Array) => void;
+  onVisemes?: (timeline: VisemeTimeline) => void;
+  onDone?: (result: ChatResult) => void; // Reply text complete (audio may still follow)
+}
+
+interface PendingFinal {
+  resolve: (text: string) => void;
+  reject: (error: Error) => void;
+}
+
+/**
+ * Reply frames for one turn, queued until reply() attaches handlers
+ */
+class CallTurn {
+  private queued: Array<[number, Uint8Array]> = [];
+  private handlers: CallReplyHandlers | null = null;
+  private textSoFar = '';
+  private result: ChatResult | null = null;
+  private outcome: { error: Error | null } | null = null;
+  private settle: { resolve: () => void; reject: (error: Error) => void } | null = null;
+
+  deliver(type: number, payload: Uint8Array): void {
+    if (this.handlers) {
+      this.dispatch(type, payload);
+    } else {
+      this.queued.push([type, payload]);
+    }
+  }
+
+  attach(handlers: CallReplyHandlers): Promise<ChatResult> {
+    this.handlers = handlers;
+    this.queued.forEach(([type, payload]) => this.dispatch(type, payload));
+    this.queued = [];
+
+    return new Promise<ChatResult>((resolve, reject) => {
+      this.settle = { resolve: () => resolve(this.result!), reject };
+      if (this.outcome) this.end(this.outcome.error);
+    });
+  }
+
+  end(error: Error | null = null): void {
+    if (!error && !this.result) error = new Error('Call turn ended without a response');
+    this.outcome = { error };
+    if (!this.settle) return; // Settled once reply() attaches
+    if (error) this.settle.reject(error);
+    else this.settle.resolve();
+    this.settle = null;
+  }
+
+  private dispatch(type: number, payload: Uint8Array): void {
+    const handlers = this.handlers!;
+    if (type === FRAME_TEXT_DELTA) {
+      const { text } = decodeJsonPayload<{ text: string }>(payload);
+      this.textSoFar += text;
+      handlers.onDelta?.(text, this.textSoFar);
+    } else if (type === FRAME_AUDIO) {
+      handlers.onAudio?.(payload);
+    } else if (type === FRAME_VISEMES) {
+      handlers.onVisemes?.(decodeJsonPayload<VisemeTimeline>(payload));
+    } else if (type === FRAME_DONE) {
+      this.result = decodeJsonPayload<ChatResult>(payload);
+      handlers.onDone?.(this.result);
+    } else if (type === FRAME_ERROR) {
+      // A sentence without speech (its text was still sent) or a failed reply
+      const error = decodeJsonPayload<{ detail: string; text?: string }>(payload);
+      if (error.text) console.warn(`${error.detail}: "${error.text}"`);
+      else console.error('Call turn error:', error);
+    }
+  }
+}
+
+export class CallChannel {
+  private recorder: AudioRecorder;
+  private socket: WebSocket | null = null;
+  private socketReady: Promise<boolean> | null = null;
+  private queued: Blob[] = [];
+  private pendingFinal: PendingFinal | null = null;
+  private turn: CallTurn | null = null;
+  private discarding = false; // Barge-in sent; drop frames until "interrupted"
+
+  /**
+   * @param call Consultation the socket belongs to
+   * @param onPartial Called with the transcript so far while the user speaks
+   * @param getStream Shared microphone stream, kept open between utterances
+   */
+  constructor(
+    private call: { sessionId: string; voiceId?: string },
+    private onPartial?: (text: string) => void,
+    getStream?: () => Promise<MediaStream>
+  ) {
+    this.recorder = new AudioRecorder(getStream);
+  }
+
+  /**
+   * Open the socket ahead of the first utterance
+   */
+  connect(): void {
+    this.ensureSocket();
+  }
+
+  /**
+   * Start recording and streaming a new utterance
+   */
+  async start(): Promise<void> {
+    this.queued = [];
+    this.ensureSocket();
+    await this.recorder.startRecording((chunk) => this.send(chunk), CHUNK_MS);
+  }
+
+  /**
+   * Check if currently recording
+   */
+  isRecording(): boolean {
+    return this.recorder.isRecording();
+  }
+
+  /**
+   * Stop recording and return the final transcript
+   *
+   * Over the socket the server starts answering right away; collect the
+   * reply with reply(). After a REST fallback hasPendingReply() is false.
+   *
+   * @param trace Turn being timed (marks recording_end; its id goes to the server)
+   */
+  async finish(context: CallTurnContext, trace?: TurnTrace): Promise<string> {
+    const audioBlob = await this.recorder.stopRecording();
+    trace?.mark('recording_end');
+    this.turn = null;
+
+    const connected = this.socketReady ? await this.socketReady : false;
+    if (connected && this.socket?.readyState === WebSocket.OPEN) {
+      try {
+        return await this.requestFinal(context, trace?.id);
+      } catch (error) {
+        console.warn('Call channel turn failed, using REST instead', error);
+        this.bargeIn(); // Don't let a late server reply double the turn
+      }
+    }
+    return uploadRecording(audioBlob, trace?.id);
+  }
+
+  /**
+   * Whether the doctor's reply to the last utterance is coming over the socket
+   */
+  hasPendingReply(): boolean {
+    return this.turn !== null;
+  }
+
+  /**
+   * Receive the reply to the last utterance
+   *
+   * Resolves once all of its audio has arrived. Aborting the signal stops
+   * the reply on the server (barge-in).
+   */
+  reply(handlers: CallReplyHandlers, signal?: AbortSignal): Promise<ChatResult> {
+    const turn = this.turn;
+    if (!turn) return Promise.reject(new Error('No reply pending'));
+
+    signal?.addEventListener('abort', () => {
+      if (this.turn === turn) this.bargeIn();
+    });
+    return turn.attach(handlers);
+  }
+
+  /**
+   * Stop the reply in progress
+   */
+  bargeIn(): void {
+    this.turn?.end(new DOMException('Reply interrupted', 'AbortError'));
+    this.turn = null;
+    if (this.socket?.readyState === WebSocket.OPEN) {
+      this.discarding = true;
+      this.socket.send(JSON.stringify({ type: 'barge_in' }));
+    }
+  }
+
+  /**
+   * Discard the current utterance
+   */
+  cancel(): void {
+    if (this.recorder.isRecording()) {
+      this.recorder.stopRecording().catch(() => {});
+    }
+    this.queued = [];
+    if (this.socket?.readyState === WebSocket.OPEN) {
+      this.socket.send(JSON.stringify({ type: 'cancel' }));
+    }
+  }
+
+  /**
+   * Stop recording and close the socket
+   */
+  close(): void {
+    this.cancel();
+    this.bargeIn();
+    this.pendingFinal?.reject(new Error('Call channel closed'));
+    this.pendingFinal = null;
+    this.socket?.close();
+    this.socket = null;
+    this.socketReady = null;
+  }
+
+  private ensureSocket(): void {
+    const state = this.socket?.readyState;
+    if (state === WebSocket.OPEN || state === WebSocket.CONNECTING) return;
+
+    const socket = new WebSocket(`${WS_BASE_URL}/api/call`);
+    socket.binaryType = 'arraybuffer';
+    this.socket = socket;
+    this.discarding = false;
+
+    this.socketReady = new Promise<boolean>((resolve) => {
+      socket.onopen = () => {
+        socket.send(JSON.stringify({
+          type: 'start',
+          session_id: this.call.sessionId,
+          voice_id: this.call.voiceId,
+        }));
+        // Chunks captured while connecting
+        this.queued.forEach((chunk) => socket.send(chunk));
+        this.queued = [];
+        resolve(true);
+      };
+      socket.onerror = () => resolve(false);
+      socket.onclose = () => {
+        resolve(false);
+        this.pendingFinal?.reject(new Error('Call socket closed'));
+        this.pendingFinal = null;
+        this.turn?.end(new Error('Call socket closed'));
+        this.turn = null;
+        if (this.socket === socket) {
+          this.socket = null;
+        }
+      };
+    });
+
+    socket.onmessage = (event) => {
+      if (!(event.data instanceof ArrayBuffer)) return;
+      const { type, payload } = decodeFrame(event.data);
+      this.handleFrame(type, payload);
+    };
+  }
+
+  private handleFrame(type: number, payload: Uint8Array): void {
+    if (type === FRAME_CONTROL) {
+      const control = decodeJsonPayload<{ type: string }>(payload);
+      if (control.type === 'interrupted') {
+        this.discarding = false;
+      } else if (control.type === 'turn_end' && !this.discarding) {
+        this.turn?.end();
+        this.turn = null;
+      }
+      // "end_consultation" is also flagged in the done frame, which the caller reads
+      return;
+    }
+    if (this.discarding) return;
+
+    if (type === FRAME_TRANSCRIPT) {
+      const { text, final } = decodeJsonPayload<{ text: string; final: boolean }>(payload);
+      if (!final) {
+        this.onPartial?.(text);
+      } else if (this.pendingFinal) {
+        if (text.trim()) this.turn = new CallTurn();
+        this.pendingFinal.resolve(text);
+        this.pendingFinal = null;
+      }
+      return;
+    }
+
+    if (type === FRAME_ERROR && this.pendingFinal) {
+      const { detail } = decodeJsonPayload<{ detail: string }>(payload);
+      this.pendingFinal.reject(new Error(detail || 'Transcription failed'));
+      this.pendingFinal = null;
+      return;
+    }
+
+    this.turn?.deliver(type, payload);
+  }
+
+  private send(chunk: Blob): void {
+    if (this.socket?.readyState === WebSocket.OPEN) {
+      this.socket.send(chunk);
+    } else {
+      this.queued.push(chunk);
+    }
+  }
+
+  private requestFinal(context: CallTurnContext, turnId?: string): Promise<string> {
+    return new Promise<string>((resolve, reject) => {
+      const timer = setTimeout(() => {
+        this.pendingFinal = null;
+        reject(new Error('Timed out waiting for transcript'));
+      }, FINAL_TIMEOUT_MS);
+
+      this.pendingFinal = {
+        resolve: (text) => {
+          clearTimeout(timer);
+          resolve(text);
+        },
+        reject: (error) => {
+          clearTimeout(timer);
+          reject(error);
+        },
+      };
+      this.socket!.send(JSON.stringify({ type: 'end', ...context, turn_id: turnId }));
+    });
+  }
+}
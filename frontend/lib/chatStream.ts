@@ -0,0 +1,181 @@
+/**
+ * Streaming chat clients for /api/chat/stream (Server-Sent Events) and
+ * /api/chat/speech (binary frames with text and audio)
+ */
+
+import { API_BASE_URL } from './config';
+import {
+  readFrames,
+  decodeJsonPayload,
+  FRAME_TEXT_DELTA,
+  FRAME_AUDIO,
+  FRAME_DONE,
+  FRAME_VISEMES,
+  FRAME_ERROR,
+} from './frames';
+import type { VisemeTimeline } from './visemes';
+
+export interface ChatRequestBody {
+  message: string;
+  emotion: string;
+  age?: number | null;
+  age_category?: string | null;
+  session_id: string; // Required so turns never land in another patient's session
+}
+
+export interface ChatResult {
+  response: string;
+  followup_needed: boolean;
+  should_end_consultation: boolean;
+  session_id?: string;
+}
+
+interface StreamChatOptions {
+  onDelta?: (delta: string, textSoFar: string) => void;
+  signal?: AbortSignal;
+  turnId?: string; // Sent as X-Turn-Id for backend latency tracing
+}
+
+/**
+ * Send a chat message and receive the doctor's reply as it is generated
+ *
+ * Resolves with the final response once the "done" event arrives.
+ */
+export async function streamChat(
+  body: ChatRequestBody,
+  { onDelta, signal, turnId }: StreamChatOptions = {}
+): Promise<ChatResult> {
+  const response = await fetch(`${API_BASE_URL}/api/chat/stream`, {
+    method: 'POST',
+    headers: {
+      'Content-Type': 'application/json',
+      Accept: 'text/event-stream',
+      ...(turnId ? { 'X-Turn-Id': turnId } : {}),
+    },
+    body: JSON.stringify(body),
+    signal,
+  });
+
+  if (!response.ok || !response.body) {
+    throw new Error('Chat stream request failed');
+  }
+
+  const reader = response.body.getReader();
+  const decoder = new TextDecoder();
+  let buffer = '';
+  let textSoFar = '';
+  let result: ChatResult | null = null;
+
+  while (true) {
+    const { value, done } = await reader.read();
+    if (done) break;
+    buffer += decoder.decode(value, { stream: true });
+
+    // Events are separated by a blank line
+    let boundary = buffer.indexOf('\n\n');
+    while (boundary !== -1) {
+      const rawEvent = buffer.slice(0, boundary);
+      buffer = buffer.slice(boundary + 2);
+      boundary = buffer.indexOf('\n\n');
+
+      const event = parseEvent(rawEvent);
+      if (!event) continue;
+
+      if (event.type === 'delta') {
+        textSoFar += event.data.text;
+        onDelta?.(event.data.text, textSoFar);
+      } else if (event.type === 'done') {
+        result = event.data as ChatResult;
+      }
+    }
+  }
+
+  if (!result) {
+    throw new Error('Chat stream ended without a response');
+  }
+  return result;
+}
+
+/**
+ * Parse a single SSE event block into its type and JSON data
+ */
+function parseEvent(rawEvent: string): { type: string; data: any } | null {
+  let type = 'message';
+  const dataLines: string[] = [];
+
+  for (const line of rawEvent.split('\n')) {
+    if (line.startsWith('event:')) {
+      type = line.slice(6).trim();
+    } else if (line.startsWith('data:')) {
+      dataLines.push(line.slice(5).trim());
+    }
+  }
+
+  if (dataLines.length === 0) return null;
+
+  try {
+    return { type, data: JSON.parse(dataLines.join('\n')) };
+  } catch (error) {
+    console.warn('Malformed chat stream event', error);
+    return null;
+  }
+}
+
+interface StreamSpokenChatOptions extends StreamChatOptions {
+  onAudio?: (chunk: Uint8Array) => void;
+  onVisemes?: (timeline: VisemeTimeline) => void; // Lip-sync keys for the audio stream
+  onDone?: (result: ChatResult) => void; // Reply text complete (audio may still follow)
+}
+
+/**
+ * Send a chat message and receive the reply text and its speech together
+ *
+ * Audio chunks arrive in playback order while the reply is still being
+ * generated. Resolves once the stream (including all audio) has ended.
+ */
+export async function streamSpokenChat(
+  body: ChatRequestBody & { voice_id?: string },
+  { onDelta, onAudio, onVisemes, onDone, signal, turnId }: StreamSpokenChatOptions = {}
+): Promise<ChatResult> {
+  const response = await fetch(`${API_BASE_URL}/api/chat/speech`, {
+    method: 'POST',
+    headers: {
+      'Content-Type': 'application/json',
+      ...(turnId ? { 'X-Turn-Id': turnId } : {}),
+    },
+    body: JSON.stringify(body),
+    signal,
+  });
+
+  if (!response.ok || !response.body) {
+    throw new Error('Spoken chat request failed');
+  }
+
+  let textSoFar = '';
+  let result = null as ChatResult | null; // Assigned inside the frame callback
+
+  await readFrames(response.body, (type, payload) => {
+    if (type === FRAME_TEXT_DELTA) {
+      const { text } = decodeJsonPayload<{ text: string }>(payload);
+      textSoFar += text;
+      onDelta?.(text, textSoFar);
+    } else if (type === FRAME_AUDIO) {
+      onAudio?.(payload);
+    } else if (type === FRAME_VISEMES) {
+      onVisemes?.(decodeJsonPayload<VisemeTimeline>(payload));
+    } else if (type === FRAME_DONE) {
+      result = decodeJsonPayload<ChatResult>(payload);
+      onDone?.(result);
+    } else if (type === FRAME_ERROR) {
+      // A sentence without speech (its text was still sent) or a failed reply
+      const error = decodeJsonPayload<{ detail: string; text?: string }>(payload);
+      if (error.text) console.warn(`${error.detail}: "${error.text}"`);
+      else console.error('Spoken chat stream error:', error);
+    }
+  });
+
+  if (!result) {
+    throw new Error('Spoken chat stream ended without a response');
+  }
+  return result;
+}
@@ -1 +1,6 @@
 export const API_BASE_URL = process.env.NEXT_PUBLIC_API_URL || 'http://localhost:8000';
+export const WS_BASE_URL = process.env.NEXT_PUBLIC_WS_URL || API_BASE_URL.replace(/^http/, 'ws');
+// One WebSocket per consultation (/api/call) instead of per-turn requests
+export const CALL_CHANNEL_ENABLED = process.env.NEXT_PUBLIC_CALL_CHANNEL !== 'false';
+// Post per-turn client latency to /api/metrics/client
+export const METRICS_BEACON_ENABLED = process.env.NEXT_PUBLIC_METRICS_BEACON === 'true';
@@ -0,0 +1,81 @@
+/**
+ * Decides how often emotion detection should run
+ *
+ * Emotions matter most while the patient is talking (they feed
+ * emotionHistory for the next reply), little while the doctor is speaking,
+ * and not at all while the tab is hidden. Activity comes from the window
+ * events AudioController already dispatches.
+ */
+
+export type DetectionActivity = 'userSpeaking' | 'idle' | 'doctorSpeaking' | 'hidden';
+
+// Multipliers applied to the base interval
+const INTERVAL_SCALE: Record<Exclude<DetectionActivity, 'hidden'>, number> = {
+  userSpeaking: 0.4,
+  idle: 1,
+  doctorSpeaking: 3,
+};
+
+export class DetectionScheduler {
+  private userSpeaking = false;
+  private doctorSpeaking = false;
+  private hidden = false;
+  private listeners: [Window | Document, string, EventListener][] = [];
+  private onChange: (() => void) | null = null;
+
+  constructor(private baseIntervalMs: number = 1000) {}
+
+  /**
+   * Start following call activity
+   *
+   * @param onChange Called whenever the activity (and so the interval) changes
+   */
+  start(onChange?: () => void): void {
+    this.onChange = onChange ?? null;
+    this.hidden = document.hidden;
+
+    this.listen(window, 'userSpeechStart', () => this.update(() => { this.userSpeaking = true; }));
+    this.listen(window, 'userSpeechEnd', () => this.update(() => { this.userSpeaking = false; }));
+    this.listen(window, 'audioPlaybackStart', () => this.update(() => { this.doctorSpeaking = true; }));
+    this.listen(window, 'audioPlaybackEnd', () => this.update(() => { this.doctorSpeaking = false; }));
+    this.listen(document, 'visibilitychange', () => this.update(() => { this.hidden = document.hidden; }));
+  }
+
+  /**
+   * Stop following call activity
+   */
+  stop(): void {
+    this.listeners.forEach(([target, type, listener]) => target.removeEventListener(type, listener));
+    this.listeners = [];
+    this.onChange = null;
+  }
+
+  activity(): DetectionActivity {
+    if (this.hidden) return 'hidden';
+    if (this.userSpeaking) return 'userSpeaking';
+    if (this.doctorSpeaking) return 'doctorSpeaking';
+    return 'idle';
+  }
+
+  /**
+   * Delay until the next detection, or null to pause until activity changes
+   */
+  nextDelay(): number | null {
+    const activity = this.activity();
+    if (activity === 'hidden') return null;
+    return Math.round(this.baseIntervalMs * INTERVAL_SCALE[activity]);
+  }
+
+  private listen(target: Window | Document, type: string, listener: EventListener): void {
+    target.addEventListener(type, listener);
+    this.listeners.push([target, type, listener]);
+  }
+
+  private update(apply: () => void): void {
+    const before = this.activity();
+    apply();
+    if (this.activity() !== before) {
+      this.onChange?.();
+    }
+  }
+}
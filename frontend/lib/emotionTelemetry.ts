@@ -0,0 +1,292 @@
+/**
+ * Emotion telemetry - compact, pre-aggregated facial emotion for insights
+ *
+ * Every detection is folded in O(1): running counts, a transition matrix
+ * between consecutive labels, and time buckets holding the mean
+ * probability vector quantized to bytes in a fixed-size ring. Batches of
+ * closed buckets plus count/transition deltas are posted to the backend
+ * during the call, so insights never re-upload raw per-sample arrays.
+ */
+
+import { API_BASE_URL } from './config';
+import type { EmotionResult } from './faceExpressions';
+
+// face-api.js expression labels; the order is the wire format (backend checks it)
+export const EMOTION_LABELS = [
+  'neutral', 'happy', 'sad', 'angry', 'fearful', 'disgusted', 'surprised',
+] as const;
+
+const LABEL_COUNT = EMOTION_LABELS.length;
+const LABEL_INDEX: Record<string, number> = Object.fromEntries(
+  EMOTION_LABELS.map((label, i) => [label, i])
+);
+
+const BUCKET_MS = 5000;
+const RING_CAPACITY = 240; // 20 minutes of buckets
+const FLUSH_INTERVAL_MS = 15000;
+
+export interface EmotionBucket {
+  t: number; // Bucket start, epoch ms
+  n: number; // Samples in the bucket
+  p: number[]; // Mean probability per label, 0-255
+}
+
+export interface EmotionTelemetryBatch {
+  session_id: string;
+  labels: string[];
+  buckets: EmotionBucket[];
+  counts: number[]; // Samples per label since the last batch
+  transitions: number[][]; // [from][to] since the last batch
+}
+
+// Whole call in the batch format (insights request when the session is gone)
+export type EmotionTelemetrySnapshot = Omit<EmotionTelemetryBatch, 'session_id'>;
+
+export class EmotionTelemetry {
+  private readonly sessionId: string;
+
+  // Closed buckets, oldest overwritten first
+  private readonly ringStart = new Float64Array(RING_CAPACITY);
+  private readonly ringCount = new Uint16Array(RING_CAPACITY);
+  private readonly ringProbs = new Uint8Array(RING_CAPACITY * LABEL_COUNT);
+  private ringHead = 0; // Next slot to write
+  private ringSize = 0;
+  private unsent = 0; // Newest closed buckets not yet posted
+
+  // Bucket being filled
+  private bucketStart = -1;
+  private bucketCount = 0;
+  private readonly bucketSums = new Float32Array(LABEL_COUNT);
+
+  // Whole-call aggregates and the part of them not yet posted
+  readonly counts = new Uint32Array(LABEL_COUNT);
+  private readonly transitions = new Uint32Array(LABEL_COUNT * LABEL_COUNT);
+  private readonly pendingCounts = new Uint32Array(LABEL_COUNT);
+  private readonly pendingTransitions = new Uint32Array(LABEL_COUNT * LABEL_COUNT);
+  private previous = -1;
+
+  // Samples since the patient's last turn (dominant emotion for the reply)
+  private readonly turnCounts = new Uint16Array(LABEL_COUNT);
+
+  private flushTimer: ReturnType<typeof setInterval> | null = null;
+  private inFlight: Promise<void> = Promise.resolve();
+
+  constructor(sessionId: string) {
+    this.sessionId = sessionId;
+  }
+
+  /**
+   * Fold one detection in
+   */
+  add(result: Pick<EmotionResult, 'emotion' | 'allEmotions'>, at: number = Date.now()): void {
+    const index = LABEL_INDEX[result.emotion];
+    if (index === undefined) return;
+
+    this.counts[index]++;
+    this.pendingCounts[index]++;
+    this.turnCounts[index]++;
+    if (this.previous >= 0) {
+      this.transitions[this.previous * LABEL_COUNT + index]++;
+      this.pendingTransitions[this.previous * LABEL_COUNT + index]++;
+    }
+    this.previous = index;
+
+    if (this.bucketStart >= 0 && at - this.bucketStart >= BUCKET_MS) this.closeBucket();
+    if (this.bucketStart < 0) this.bucketStart = at - (at % BUCKET_MS);
+
+    const probs = result.allEmotions;
+    for (let i = 0; i < LABEL_COUNT; i++) {
+      this.bucketSums[i] += probs[EMOTION_LABELS[i]] ?? (i === index ? 1 : 0);
+    }
+    this.bucketCount++;
+  }
+
+  /**
+   * Most frequent emotion since the last call, then start a new turn window
+   */
+  takeTurnDominant(fallback: string): string {
+    let best = -1;
+    let bestCount = 0;
+    for (let i = 0; i < LABEL_COUNT; i++) {
+      if (this.turnCounts[i] > bestCount) {
+        best = i;
+        bestCount = this.turnCounts[i];
+      }
+    }
+    this.turnCounts.fill(0);
+    return best >= 0 ? EMOTION_LABELS[best] : fallback;
+  }
+
+  /**
+   * Post batches every FLUSH_INTERVAL_MS until stop()
+   */
+  start(): void {
+    if (this.flushTimer) return;
+    this.flushTimer = setInterval(() => void this.flush(), FLUSH_INTERVAL_MS);
+  }
+
+  /**
+   * Stop the interval and post everything, including the open bucket
+   */
+  stop(): Promise<void> {
+    if (this.flushTimer) clearInterval(this.flushTimer);
+    this.flushTimer = null;
+    if (this.bucketCount > 0) this.closeBucket();
+    return this.flush();
+  }
+
+  /**
+   * Post closed buckets and aggregate deltas (one request at a time)
+   */
+  flush(): Promise<void> {
+    this.inFlight = this.inFlight.then(() => this.send());
+    return this.inFlight;
+  }
+
+  private async send(): Promise<void> {
+    const batch = this.buildBatch();
+    if (!batch) return;
+
+    const sentBuckets = batch.buckets.length;
+    const sentCounts = this.pendingCounts.slice();
+    const sentTransitions = this.pendingTransitions.slice();
+
+    try {
+      const response = await fetch(`${API_BASE_URL}/api/insights/emotions`, {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json' },
+        body: JSON.stringify(batch),
+        keepalive: true, // The final batch is sent as the call view unmounts
+      });
+      if (!response.ok) throw new Error(`status ${response.status}`);
+    } catch (error) {
+      // Deltas stay pending and go out with the next batch
+      console.warn('Emotion telemetry batch failed:', error);
+      return;
+    }
+
+    this.unsent = Math.max(0, this.unsent - sentBuckets);
+    for (let i = 0; i < sentCounts.length; i++) this.pendingCounts[i] -= sentCounts[i];
+    for (let i = 0; i < sentTransitions.length; i++) this.pendingTransitions[i] -= sentTransitions[i];
+  }
+
+  /**
+   * The whole call so far: every retained bucket and the total counts
+   */
+  snapshot(): EmotionTelemetrySnapshot {
+    const buckets: EmotionBucket[] = [];
+    for (let k = this.ringSize; k > 0; k--) {
+      const slot = (this.ringHead - k + RING_CAPACITY) % RING_CAPACITY;
+      const offset = slot * LABEL_COUNT;
+      buckets.push({
+        t: this.ringStart[slot],
+        n: this.ringCount[slot],
+        p: Array.from(this.ringProbs.subarray(offset, offset + LABEL_COUNT)),
+      });
+    }
+
+    const transitions: number[][] = [];
+    for (let from = 0; from < LABEL_COUNT; from++) {
+      transitions.push(Array.from(this.transitions.subarray(from * LABEL_COUNT, (from + 1) * LABEL_COUNT)));
+    }
+
+    return {
+      labels: [...EMOTION_LABELS],
+      buckets,
+      counts: Array.from(this.counts),
+      transitions,
+    };
+  }
+
+  private buildBatch(): EmotionTelemetryBatch | null {
+    const unsent = Math.min(this.unsent, this.ringSize);
+    const hasCounts = this.pendingCounts.some((count) => count > 0);
+    if (unsent === 0 && !hasCounts) return null;
+
+    const buckets: EmotionBucket[] = [];
+    for (let k = unsent; k > 0; k--) {
+      const slot = (this.ringHead - k + RING_CAPACITY) % RING_CAPACITY;
+      const offset = slot * LABEL_COUNT;
+      buckets.push({
+        t: this.ringStart[slot],
+        n: this.ringCount[slot],
+        p: Array.from(this.ringProbs.subarray(offset, offset + LABEL_COUNT)),
+      });
+    }
+
+    const transitions: number[][] = [];
+    for (let from = 0; from < LABEL_COUNT; from++) {
+      const row = this.pendingTransitions.subarray(from * LABEL_COUNT, (from + 1) * LABEL_COUNT);
+      transitions.push(Array.from(row));
+    }
+
+    return {
+      session_id: this.sessionId,
+      labels: [...EMOTION_LABELS],
+      buckets,
+      counts: Array.from(this.pendingCounts),
+      transitions,
+    };
+  }
+
+  private closeBucket(): void {
+    const slot = this.ringHead;
+    const offset = slot * LABEL_COUNT;
+    this.ringStart[slot] = this.bucketStart;
+    this.ringCount[slot] = Math.min(this.bucketCount, 0xffff);
+    for (let i = 0; i < LABEL_COUNT; i++) {
+      const mean = this.bucketSums[i] / this.bucketCount;
+      this.ringProbs[offset + i] = Math.round(Math.min(1, Math.max(0, mean)) * 255);
+    }
+
+    this.ringHead = (slot + 1) % RING_CAPACITY;
+    this.ringSize = Math.min(this.ringSize + 1, RING_CAPACITY);
+    this.unsent = Math.min(this.unsent + 1, RING_CAPACITY);
+
+    this.bucketStart = -1;
+    this.bucketCount = 0;
+    this.bucketSums.fill(0);
+  }
+}
+
+let active: EmotionTelemetry | null = null;
+
+/**
+ * Telemetry for the call in progress (replaces any previous call's)
+ */
+export function startEmotionTelemetry(sessionId: string): EmotionTelemetry {
+  active?.stop();
+  active = new EmotionTelemetry(sessionId);
+  active.start();
+  return active;
+}
+
+let lastFinish: Promise<void> = Promise.resolve();
+let lastEnded: EmotionTelemetry | null = null;
+
+/**
+ * Send the rest of the call's telemetry and stop collecting
+ */
+export function endEmotionTelemetry(): void {
+  const telemetry = active;
+  active = null;
+  if (telemetry) {
+    lastEnded = telemetry;
+    lastFinish = telemetry.stop();
+  }
+}
+
+/**
+ * Whole-call aggregate of the call in progress, or else the last ended one
+ */
+export function emotionTelemetrySnapshot(): EmotionTelemetrySnapshot | null {
+  const telemetry = active ?? lastEnded;
+  return telemetry ? telemetry.snapshot() : null;
+}
+
+/**
+ * Resolves once the ended call's final batch has been posted (or failed)
+ */
+export function emotionTelemetrySettled(): Promise<void> {
+  return lastFinish;
+}
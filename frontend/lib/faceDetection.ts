@@ -3,40 +3,151 @@
  */
 
 import * as faceapi from 'face-api.js';
+import { toEmotionResult, EmotionResult } from './faceExpressions';
+import { ensureNets, releaseNets, runDetection, warmUp, PRIMARY_NETS, DEFERRED_NETS, DetectOptions, Detection, FaceNet } from './faceInference';
+import { resolveModelUrl, cachedFetch } from './faceModels';
+import { DetectionScheduler } from './detectionScheduler';
+import { sampleFrameTime } from './turnMetrics';
+import type { FaceWorkerRequest, FaceWorkerResponse } from './faceDetection.worker';
 
-export interface EmotionResult {
-  emotion: string;
-  confidence: number;
-  allEmotions: Record<string, number>;
-  age?: number;  // Raw age estimate (e.g., 34.5)
-  ageCategory?: string;  // Categorized age (e.g., "Young Adult")
-}
+export type { EmotionResult } from './faceExpressions';
+
+// Worker running face-api.js off the main thread (null = main-thread fallback)
+let faceWorker: Worker | null = null;
+let workerLoad: Promise<void> | null = null;
+let warmUpRun: Promise<void> | null = null;
+let workerUnavailable = false; // Worker failed once - stay on the main thread
+let nextRequestId = 0;
+const pendingRequests = new Map<number, {
+  resolve: (response: FaceWorkerResponse) => void;
+  reject: (error: Error) => void;
+}>();
 
-// Use CDN for models - no manual download needed
-const MODEL_URL = 'https://cdn.jsdelivr.net/npm/@vladmandic/face-api/model/';
+/**
+ * Check whether detection can run in a worker
+ */
+export function isWorkerDetectionSupported(): boolean {
+  return typeof window !== 'undefined' &&
+    typeof Worker !== 'undefined' &&
+    typeof OffscreenCanvas !== 'undefined' &&
+    typeof createImageBitmap !== 'undefined';
+}
 
 /**
- * Load face-api.js models from CDN
+ * Load face-api.js models (self-hosted bundle, or CDN if not deployed)
+ *
+ * Models are loaded into the detection worker when the browser supports
+ * it, falling back to the main thread otherwise. Resolves once the
+ * detector and expression nets are ready; the age net follows in the
+ * background. Safe to call repeatedly.
  */
-export async function loadFaceDetectionModels(modelPath: string = MODEL_URL): Promise<void> {
+export async function loadFaceDetectionModels(modelPath?: string): Promise<void> {
+  modelPath = modelPath ?? await resolveModelUrl(window.location.origin);
+
+  if (isWorkerDetectionSupported() && !workerUnavailable) {
+    try {
+      workerLoad = workerLoad ?? loadModelsInWorker(modelPath);
+      await workerLoad;
+      return;
+    } catch (error) {
+      console.warn('Face detection worker failed, running on main thread:', error);
+      workerLoad = null;
+      workerUnavailable = true;
+      faceWorker?.terminate();
+      faceWorker = null;
+    }
+  }
+
   try {
-    console.log('Loading face detection models from CDN...');
+    console.log('Loading face detection models from', modelPath);
+    faceapi.env.monkeyPatch({ fetch: cachedFetch as any });
     
-    // Load required models for face detection, emotion recognition, and age detection
-    await Promise.all([
-      faceapi.nets.tinyFaceDetector.loadFromUri(modelPath),
-      faceapi.nets.faceExpressionNet.loadFromUri(modelPath),
-      faceapi.nets.faceLandmark68Net.loadFromUri(modelPath),
-      faceapi.nets.ageGenderNet.loadFromUri(modelPath),
-    ]);
+    // Detector and expressions first; age loads in the background and
+    // landmarks only if the landmark overlay is enabled
+    await ensureNets(PRIMARY_NETS, modelPath);
+    ensureNets(DEFERRED_NETS).catch((error) => console.warn('Age model failed to load:', error));
     
-    console.log('✓ Face detection models loaded successfully (including age detection)');
+    console.log('✓ Face detection models loaded successfully');
   } catch (error) {
     console.error('Failed to load face detection models:', error);
     throw error;
   }
 }
 
+async function loadModelsInWorker(modelPath: string): Promise<void> {
+  console.log('Loading face detection models in worker...');
+  const worker = new Worker(new URL('./faceDetection.worker.ts', import.meta.url), { type: 'module' });
+
+  worker.onmessage = (event: MessageEvent<FaceWorkerResponse>) => {
+    const pending = pendingRequests.get(event.data.id);
+    if (!pending) return;
+    pendingRequests.delete(event.data.id);
+    if (event.data.type === 'error') {
+      pending.reject(new Error(event.data.error));
+    } else {
+      pending.resolve(event.data);
+    }
+  };
+  worker.onerror = (event) => {
+    // Worker crashed - fail everything waiting on it
+    pendingRequests.forEach(({ reject }) => reject(new Error(event.message || 'Face detection worker error')));
+    pendingRequests.clear();
+  };
+
+  faceWorker = worker;
+  const response = await requestWorker({ type: 'load', modelPath });
+  if (response.type === 'loaded') {
+    console.log(`✓ Face detection models loaded in worker (${response.backend} backend)`);
+  }
+}
+
+/**
+ * Load the models and run one throwaway inference to compile shaders
+ *
+ * Call while the user is still on the setup page so the first real
+ * detection during the call is fast. Failures are logged, not thrown.
+ */
+export function warmUpFaceDetection(): Promise<void> {
+  warmUpRun = warmUpRun ?? (async () => {
+    try {
+      await loadFaceDetectionModels();
+      if (faceWorker) {
+        await requestWorker({ type: 'warmup' });
+      } else {
+        await warmUp((width, height) => {
+          const canvas = document.createElement('canvas');
+          canvas.width = width;
+          canvas.height = height;
+          return canvas;
+        });
+      }
+    } catch (error) {
+      console.warn('Face detection warm-up failed:', error);
+      warmUpRun = null;
+    }
+  })();
+  return warmUpRun;
+}
+
+// Omit that keeps each member of a union separate
+type WithoutId<T> = T extends unknown ? Omit<T, 'id'> : never;
+
+function requestWorker(
+  message: WithoutId<FaceWorkerRequest>,
+  transfer: Transferable[] = []
+): Promise<FaceWorkerResponse> {
+  const worker = faceWorker;
+  if (!worker) {
+    return Promise.reject(new Error('Face detection worker not running'));
+  }
+
+  const id = ++nextRequestId;
+  return new Promise((resolve, reject) => {
+    pendingRequests.set(id, { resolve, reject });
+    worker.postMessage({ ...message, id }, transfer);
+  });
+}
+
 /**
  * Detect emotions from video element
  */
@@ -53,55 +164,13 @@ export async function detectEmotions(
       return null; // No face detected
     }
     
-    const expressions = detections.expressions;
-    const dominantEmotion = getDominantEmotion(expressions);
-    
-    return {
-      emotion: dominantEmotion.emotion,
-      confidence: dominantEmotion.confidence,
-      allEmotions: expressions.asSortedArray().reduce((acc, expr) => {
-        acc[expr.expression] = expr.probability;
-        return acc;
-      }, {} as Record<string, number>)
-    };
+    return toEmotionResult(detections, false);
   } catch (error) {
     console.error('Error detecting emotions:', error);
     return null;
   }
 }
 
-/**
- * Get dominant emotion from expressions
- */
-function getDominantEmotion(expressions: faceapi.FaceExpressions): {
-  emotion: string;
-  confidence: number;
-} {
-  const sorted = expressions.asSortedArray();
-  
-  if (sorted.length === 0) {
-    return { emotion: 'neutral', confidence: 0 };
-  }
-  
-  // Return the emotion with highest probability
-  return {
-    emotion: sorted[0].expression,
-    confidence: sorted[0].probability
-  };
-}
-
-/**
- * Categorize age into defined ranges
- */
-function categorizeAge(age: number): string {
-  if (age < 12) return "Child";
-  if (age < 18) return "Teenager";
-  if (age < 36) return "Young Adult";
-  if (age < 56) return "Middle-Aged";
-  if (age < 71) return "Senior";
-  return "Elderly";
-}
-
 /**
  * Draw face detection overlay on canvas
  */
@@ -137,95 +206,280 @@ export function drawDetections(
   // faceapi.draw.drawFaceLandmarks(canvas, resizedDetections);
 }
 
+// Tiny face detector input sizes: full frame, and the crop around the last face
+const FULL_INPUT_SIZE = 320;
+const CROP_INPUT_SIZE = 160;
+const CROP_MARGIN = 0.6; // Added around the last box on each side, as a fraction of its size
+const FULL_DETECTION_EVERY = 5; // Re-scan the whole frame every N detections
+
+interface Region {
+  x: number;
+  y: number;
+  width: number;
+  height: number;
+}
+
+interface FrameDetection extends Detection {
+  frameWidth: number;
+  frameHeight: number;
+}
+
+export interface EmotionDetectionOptions {
+  adaptive?: boolean; // Follow call activity instead of a fixed interval (default true)
+  drawLandmarks?: boolean; // Draw the 68-point landmarks; loads faceLandmark68Net (default false)
+  onInferenceTime?: (ms: number) => void; // Time of each detection pass, e.g. for the benchmark page
+}
+
+/**
+ * Run one detection in the worker; the frame is transferred, not copied
+ */
+async function detectInWorker(
+  videoElement: HTMLVideoElement,
+  region: Region | null,
+  options: DetectOptions
+): Promise<FrameDetection | null> {
+  const frame = region
+    ? await createImageBitmap(videoElement, region.x, region.y, region.width, region.height)
+    : await createImageBitmap(videoElement);
+  const response = await requestWorker({ type: 'detect', frame, options }, [frame]);
+  if (response.type !== 'result' || !response.detection) {
+    return null;
+  }
+  return { ...response.detection, frameWidth: response.frameWidth, frameHeight: response.frameHeight };
+}
+
+let cropCanvas: HTMLCanvasElement | null = null;
+
+/**
+ * Run one detection on the main thread (browsers without OffscreenCanvas)
+ */
+async function detectOnMainThread(
+  videoElement: HTMLVideoElement,
+  region: Region | null,
+  options: DetectOptions
+): Promise<FrameDetection | null> {
+  let input: HTMLVideoElement | HTMLCanvasElement = videoElement;
+  if (region) {
+    cropCanvas = cropCanvas ?? document.createElement('canvas');
+    cropCanvas.width = region.width;
+    cropCanvas.height = region.height;
+    cropCanvas.getContext('2d')!.drawImage(
+      videoElement,
+      region.x, region.y, region.width, region.height,
+      0, 0, region.width, region.height
+    );
+    input = cropCanvas;
+  }
+
+  const detection = await runDetection(input, options);
+  if (!detection) {
+    return null;
+  }
+  return {
+    ...detection,
+    frameWidth: region ? region.width : videoElement.videoWidth,
+    frameHeight: region ? region.height : videoElement.videoHeight,
+  };
+}
+
+/**
+ * Move a detection made on a crop back into video coordinates
+ */
+function toVideoCoordinates(detection: FrameDetection, region: Region | null, videoElement: HTMLVideoElement): FrameDetection {
+  // Worker frames are captured at video size, so frame pixels are video pixels
+  if (!region) return detection;
+  const shift = (p: { x: number; y: number }) => ({ x: p.x + region.x, y: p.y + region.y });
+  return {
+    ...detection,
+    box: { ...detection.box, ...shift(detection.box) },
+    landmarks: detection.landmarks?.map(shift),
+    frameWidth: videoElement.videoWidth,
+    frameHeight: videoElement.videoHeight,
+  };
+}
+
+/**
+ * Region around the last face, clamped to the video
+ */
+function cropAround(box: Detection['box'], videoElement: HTMLVideoElement): Region {
+  const marginX = box.width * CROP_MARGIN;
+  const marginY = box.height * CROP_MARGIN;
+  const x = Math.max(0, Math.floor(box.x - marginX));
+  const y = Math.max(0, Math.floor(box.y - marginY));
+  return {
+    x,
+    y,
+    width: Math.min(videoElement.videoWidth - x, Math.ceil(box.width + marginX * 2)),
+    height: Math.min(videoElement.videoHeight - y, Math.ceil(box.height + marginY * 2)),
+  };
+}
+
+/**
+ * Tell whichever side runs inference to free nets
+ */
+function releaseDetectionNets(nets: FaceNet[]): void {
+  if (faceWorker) {
+    requestWorker({ type: 'release', nets }).catch(() => {});
+  } else {
+    releaseNets(nets);
+  }
+}
+
+/**
+ * Draw the face box (and landmarks, if detected) over the video
+ */
+function drawFaceBox(
+  canvas: HTMLCanvasElement,
+  detection: FrameDetection,
+  videoElement: HTMLVideoElement
+): void {
+  const displaySize = {
+    width: videoElement.videoWidth,
+    height: videoElement.videoHeight
+  };
+  faceapi.matchDimensions(canvas, displaySize);
+
+  const scaleX = displaySize.width / detection.frameWidth;
+  const scaleY = displaySize.height / detection.frameHeight;
+  const box = new faceapi.Box({
+    x: detection.box.x * scaleX,
+    y: detection.box.y * scaleY,
+    width: detection.box.width * scaleX,
+    height: detection.box.height * scaleY,
+  });
+
+  const ctx = canvas.getContext('2d');
+  if (ctx) {
+    ctx.clearRect(0, 0, canvas.width, canvas.height);
+  }
+  faceapi.draw.drawDetections(canvas, [box]);
+
+  if (ctx && detection.landmarks) {
+    ctx.fillStyle = 'rgba(255, 255, 255, 0.8)';
+    detection.landmarks.forEach((point) => {
+      ctx.fillRect(point.x * scaleX - 1, point.y * scaleY - 1, 2, 2);
+    });
+  }
+}
+
 /**
  * Start continuous emotion detection
+ *
+ * Inference runs in the detection worker when available, so the avatar and
+ * background animations keep their frame rate while it runs. With adaptive
+ * scheduling the interval shrinks while the patient speaks, grows while the
+ * doctor speaks, and detection pauses while the tab is hidden. Between full
+ * scans only the area around the last face is analysed.
  */
 export function startEmotionDetection(
   videoElement: HTMLVideoElement,
   canvasElement: HTMLCanvasElement | null,
   onEmotionDetected: (result: EmotionResult) => void,
   intervalMs: number = 1000,
-  detectAge: () => boolean = () => true // Callback to check if age detection should run
+  detectAge: () => boolean = () => true, // Callback to check if age detection should run
+  { adaptive = true, drawLandmarks = false, onInferenceTime }: EmotionDetectionOptions = {}
 ): () => void {
   let isRunning = true;
+  let inFlight = false;
+  let timer: ReturnType<typeof setTimeout> | null = null;
+  let lastRunAt = 0;
+  let lastBox: Detection['box'] | null = null;
+  let sinceFullScan = 0;
+  // The age net is loaded with the others (DEFERRED_NETS), so it counts as
+  // active until a frame doesn't need it - even if age is locked from the start
+  let ageWasActive = true;
+
+  const detectFrame = faceWorker ? detectInWorker : detectOnMainThread;
+  const scheduler = adaptive ? new DetectionScheduler(intervalMs) : null;
+  console.log(`🧠 Emotion detection running ${faceWorker ? 'in worker' : 'on main thread'}`);
+
+  const schedule = () => {
+    if (!isRunning || inFlight) return;
+    if (timer) clearTimeout(timer);
+    timer = null;
+
+    const delay = scheduler ? scheduler.nextDelay() : intervalMs;
+    if (delay === null) {
+      return; // Paused (tab hidden) - the scheduler calls back when that changes
+    }
+    timer = setTimeout(detectLoop, Math.max(0, lastRunAt + delay - Date.now()));
+  };
   
   const detectLoop = async () => {
     if (!isRunning) return;
+    timer = null;
     
     try {
       // Check if video is ready
       if (videoElement.readyState !== 4) {
         console.log("⏳ Video not ready yet, readyState:", videoElement.readyState);
-        setTimeout(detectLoop, intervalMs);
+        lastRunAt = Date.now();
+        schedule();
         return;
       }
       
-      // Build detection chain conditionally
+      inFlight = true;
+      lastRunAt = Date.now();
+
       const shouldDetectAge = detectAge();
-      
-      let detections;
-      if (shouldDetectAge) {
-        // Detect with age
-        detections = await faceapi
-          .detectSingleFace(videoElement, new faceapi.TinyFaceDetectorOptions())
-          .withFaceLandmarks()
-          .withFaceExpressions()
-          .withAgeAndGender();
-      } else {
-        // Detect without age (faster)
-        detections = await faceapi
-          .detectSingleFace(videoElement, new faceapi.TinyFaceDetectorOptions())
-          .withFaceLandmarks()
-          .withFaceExpressions();
+      if (ageWasActive && !shouldDetectAge) {
+        releaseDetectionNets(['ageGenderNet']); // Age is locked - free its weights
       }
+      ageWasActive = shouldDetectAge;
+
+      // Full scan periodically or when the face was lost; otherwise crop to it
+      const fullScan = !lastBox || sinceFullScan >= FULL_DETECTION_EVERY - 1;
+      const region = fullScan || !lastBox ? null : cropAround(lastBox, videoElement);
+      const options: DetectOptions = {
+        withAge: shouldDetectAge,
+        withLandmarks: drawLandmarks,
+        inputSize: region ? CROP_INPUT_SIZE : FULL_INPUT_SIZE,
+      };
+
+      const detectStartedAt = performance.now();
+      const raw = await detectFrame(videoElement, region, options);
+      const inferenceMs = performance.now() - detectStartedAt;
+      sampleFrameTime('face_detection', inferenceMs);
+      onInferenceTime?.(inferenceMs);
+      const detection = raw ? toVideoCoordinates(raw, region, videoElement) : null;
+      sinceFullScan = fullScan ? 0 : sinceFullScan + 1;
+      lastBox = detection ? detection.box : null;
       
-      if (detections) {
-        const expressions = (detections as any).expressions;
-        const dominantEmotion = getDominantEmotion(expressions);
-        
-        const result: EmotionResult = {
-          emotion: dominantEmotion.emotion,
-          confidence: dominantEmotion.confidence,
-          allEmotions: expressions.asSortedArray().reduce((acc: Record<string, number>, expr: { expression: string; probability: number }) => {
-            acc[expr.expression] = expr.probability;
-            return acc;
-          }, {} as Record<string, number>)
-        };
-        
-        // Only process age if it was detected
-        if (shouldDetectAge && (detections as any).age !== undefined) {
-          const age = Math.round((detections as any).age);
-          const ageCategory = categorizeAge(age);
-          result.age = age;
-          result.ageCategory = ageCategory;
-          console.log(`👤 AGE DETECTED: ${age} years old (${ageCategory})`);
+      if (!isRunning) return; // Stopped while inference was running
+      
+      if (detection) {
+        const { result } = detection;
+        if (result.age !== undefined) {
+          console.log(`👤 AGE DETECTED: ${result.age} years old (${result.ageCategory})`);
         }
         
         onEmotionDetected(result);
         
         // Draw detections on canvas if provided
         if (canvasElement) {
-          drawDetections(canvasElement, detections as any, videoElement);
+          drawFaceBox(canvasElement, detection, videoElement);
         }
-      } else {
+      } else if (fullScan) {
         console.log("⚠️  No face detected in frame");
       }
     } catch (error) {
       console.error('❌ Error in emotion detection loop:', error);
+    } finally {
+      inFlight = false;
     }
     
     // Schedule next detection
-    if (isRunning) {
-      setTimeout(detectLoop, intervalMs);
-    }
+    schedule();
   };
   
   // Start the loop
+  scheduler?.start(schedule);
   detectLoop();
   
   // Return cleanup function
   return () => {
     isRunning = false;
+    scheduler?.stop();
+    if (timer) clearTimeout(timer);
   };
 }
-
@@ -0,0 +1,118 @@
+/**
+ * Face detection worker - runs face-api.js off the main thread
+ *
+ * Frames arrive as transferred ImageBitmaps and are drawn onto an
+ * OffscreenCanvas for inference, so the avatar render loop never waits on
+ * TensorFlow.js.
+ */
+
+import * as faceapi from 'face-api.js';
+import { ensureNets, releaseNets, runDetection, warmUp, PRIMARY_NETS, DEFERRED_NETS, DetectOptions, Detection, FaceNet } from './faceInference';
+import { cachedFetch } from './faceModels';
+
+export type FaceWorkerRequest =
+  | { id: number; type: 'load'; modelPath: string }
+  | { id: number; type: 'detect'; frame: ImageBitmap; options: DetectOptions }
+  | { id: number; type: 'release'; nets: FaceNet[] }
+  | { id: number; type: 'warmup' };
+
+export type FaceWorkerResponse =
+  | { id: number; type: 'loaded'; backend: string }
+  | { id: number; type: 'result'; detection: Detection | null; frameWidth: number; frameHeight: number }
+  | { id: number; type: 'released' }
+  | { id: number; type: 'warmedUp' }
+  | { id: number; type: 'error'; error: string };
+
+// Typed view of the worker global (the project compiles against the DOM lib)
+const workerScope = self as unknown as {
+  postMessage: (message: FaceWorkerResponse) => void;
+  onmessage: ((event: MessageEvent<FaceWorkerRequest>) => void) | null;
+};
+
+let canvas: OffscreenCanvas | null = null;
+
+/**
+ * face-api.js only knows browser and Node environments; point it at
+ * OffscreenCanvas so it can run inside a worker
+ */
+function setupEnvironment(): void {
+  const unsupported = () => {
+    throw new Error('Not available in face detection worker');
+  };
+
+  faceapi.env.setEnv({
+    Canvas: OffscreenCanvas as any,
+    CanvasRenderingContext2D: OffscreenCanvasRenderingContext2D as any,
+    Image: class {} as any, // Frames are always drawn to a canvas first
+    ImageData,
+    Video: class {} as any,
+    createCanvasElement: () => new OffscreenCanvas(1, 1) as any,
+    createImageElement: unsupported as any,
+    fetch: cachedFetch as any, // Weights come from the versioned Cache API store
+    readFile: unsupported as any,
+  });
+}
+
+async function loadModels(modelPath: string): Promise<string> {
+  setupEnvironment();
+
+  try {
+    await faceapi.tf.setBackend('webgl');
+  } catch (error) {
+    console.warn('Face worker: WebGL unavailable, using CPU backend', error);
+    await faceapi.tf.setBackend('cpu');
+  }
+  await faceapi.tf.ready();
+
+  await ensureNets(PRIMARY_NETS, modelPath);
+  // Age is only needed for the first few detections - don't wait for it
+  ensureNets(DEFERRED_NETS).catch((error) => console.warn('Face worker: deferred model failed', error));
+
+  return faceapi.tf.getBackend();
+}
+
+async function detect(frame: ImageBitmap, options: DetectOptions) {
+  if (!canvas) {
+    canvas = new OffscreenCanvas(frame.width, frame.height);
+  } else if (canvas.width !== frame.width || canvas.height !== frame.height) {
+    // Cropped frames change size; resizing keeps the same canvas
+    canvas.width = frame.width;
+    canvas.height = frame.height;
+  }
+  canvas.getContext('2d')!.drawImage(frame, 0, 0);
+  const frameWidth = frame.width;
+  const frameHeight = frame.height;
+  frame.close();
+
+  const detection = await runDetection(canvas as unknown as faceapi.TNetInput, options);
+  return { detection, frameWidth, frameHeight };
+}
+
+workerScope.onmessage = async (event) => {
+  const message = event.data;
+
+  try {
+    if (message.type === 'load') {
+      const backend = await loadModels(message.modelPath);
+      workerScope.postMessage({ id: message.id, type: 'loaded', backend });
+    } else if (message.type === 'detect') {
+      const detection = await detect(message.frame, message.options);
+      workerScope.postMessage({ id: message.id, type: 'result', ...detection });
+    } else if (message.type === 'warmup') {
+      await warmUp((width, height) => new OffscreenCanvas(width, height) as unknown as faceapi.TNetInput);
+      workerScope.postMessage({ id: message.id, type: 'warmedUp' });
+    } else if (message.type === 'release') {
+      releaseNets(message.nets);
+      workerScope.postMessage({ id: message.id, type: 'released' });
+    }
+  } catch (error) {
+    if (message.type === 'detect') {
+      message.frame.close();
+    }
+    workerScope.postMessage({
+      id: message.id,
+      type: 'error',
+      error: error instanceof Error ? error.message : String(error),
+    });
+  }
+};
@@ -0,0 +1,84 @@
+/**
+ * Turns face-api.js detections into EmotionResult objects
+ *
+ * Shared by the main thread and the face detection worker, so it must not
+ * touch the DOM.
+ */
+
+import type * as faceapi from 'face-api.js';
+
+export interface EmotionResult {
+  emotion: string;
+  confidence: number;
+  allEmotions: Record<string, number>;
+  age?: number;  // Raw age estimate (e.g., 34.5)
+  ageCategory?: string;  // Categorized age (e.g., "Young Adult")
+}
+
+/**
+ * Face box in frame pixels, used to draw the overlay
+ */
+export interface FaceBox {
+  x: number;
+  y: number;
+  width: number;
+  height: number;
+}
+
+/**
+ * Get dominant emotion from expressions
+ */
+export function getDominantEmotion(expressions: faceapi.FaceExpressions): {
+  emotion: string;
+  confidence: number;
+} {
+  const sorted = expressions.asSortedArray();
+
+  if (sorted.length === 0) {
+    return { emotion: 'neutral', confidence: 0 };
+  }
+
+  // Return the emotion with highest probability
+  return {
+    emotion: sorted[0].expression,
+    confidence: sorted[0].probability
+  };
+}
+
+/**
+ * Categorize age into defined ranges
+ */
+export function categorizeAge(age: number): string {
+  if (age < 12) return "Child";
+  if (age < 18) return "Teenager";
+  if (age < 36) return "Young Adult";
+  if (age < 56) return "Middle-Aged";
+  if (age < 71) return "Senior";
+  return "Elderly";
+}
+
+/**
+ * Build an EmotionResult from a detection with expressions (and optionally age)
+ */
+export function toEmotionResult(detections: any, withAge: boolean): EmotionResult {
+  const expressions = detections.expressions as faceapi.FaceExpressions;
+  const dominantEmotion = getDominantEmotion(expressions);
+
+  const result: EmotionResult = {
+    emotion: dominantEmotion.emotion,
+    confidence: dominantEmotion.confidence,
+    allEmotions: expressions.asSortedArray().reduce((acc: Record<string, number>, expr: { expression: string; probability: number }) => {
+      acc[expr.expression] = expr.probability;
+      return acc;
+    }, {} as Record<string, number>)
+  };
+
+  // Only process age if it was detected
+  if (withAge && detections.age !== undefined) {
+    const age = Math.round(detections.age);
+    result.age = age;
+    result.ageCategory = categorizeAge(age);
+  }
+
+  return result;
+}
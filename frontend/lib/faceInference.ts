@@ -0,0 +1,144 @@
+/**
+ * face-api.js model management and detection
+ *
+ * Used by the detection worker, and by the main thread when workers are
+ * unavailable. Nets are loaded on first use and can be released when no
+ * longer needed (e.g. ageGenderNet once the age is locked).
+ */
+
+import * as faceapi from 'face-api.js';
+import { toEmotionResult, EmotionResult, FaceBox } from './faceExpressions';
+
+export type FaceNet = 'tinyFaceDetector' | 'faceExpressionNet' | 'faceLandmark68Net' | 'ageGenderNet';
+
+// Needed before the first detection
+export const PRIMARY_NETS: FaceNet[] = ['tinyFaceDetector', 'faceExpressionNet'];
+// Loaded in the background afterwards; landmarks only load if the landmark overlay is on
+export const DEFERRED_NETS: FaceNet[] = ['ageGenderNet'];
+
+export interface DetectOptions {
+  withAge: boolean;
+  withLandmarks: boolean;
+  inputSize: number; // Tiny face detector input size (multiple of 32)
+}
+
+export interface Detection {
+  result: EmotionResult;
+  box: FaceBox;
+  landmarks?: { x: number; y: number }[];
+}
+
+let modelPath: string | null = null;
+const loading = new Map<FaceNet, Promise<void>>();
+
+/**
+ * Load nets that are not loaded yet
+ */
+export async function ensureNets(nets: FaceNet[], path?: string): Promise<void> {
+  if (path) modelPath = path;
+  if (!modelPath) throw new Error('Face model path not set');
+  const fromPath = modelPath;
+
+  await Promise.all(nets.map((name) => {
+    const net = faceapi.nets[name];
+    if (net.isLoaded) return Promise.resolve();
+
+    let pending = loading.get(name);
+    if (!pending) {
+      pending = net.loadFromUri(fromPath).finally(() => loading.delete(name));
+      loading.set(name, pending);
+    }
+    return pending;
+  }));
+}
+
+/**
+ * Free the weights of nets that are no longer needed
+ */
+export function releaseNets(nets: FaceNet[]): void {
+  nets.forEach((name) => {
+    const pending = loading.get(name);
+    if (pending) {
+      // Still downloading (e.g. the deferred age net) - free it once it lands
+      pending.then(() => releaseNets([name]), () => {});
+      return;
+    }
+    const net = faceapi.nets[name];
+    if (net.isLoaded) {
+      net.dispose();
+      console.log(`🧹 Released ${name}`);
+    }
+  });
+}
+
+/**
+ * Run a single-face detection with only the nets the options need
+ */
+export async function runDetection(
+  input: faceapi.TNetInput,
+  options: DetectOptions
+): Promise<Detection | null> {
+  // Age is optional per frame - don't hold up detection while its net downloads
+  const withAge = options.withAge && faceapi.nets.ageGenderNet.isLoaded;
+  if (options.withAge && !withAge) {
+    ensureNets(['ageGenderNet']).catch((error) => console.warn('Age model failed to load:', error));
+  }
+
+  const nets: FaceNet[] = [...PRIMARY_NETS];
+  if (options.withLandmarks) nets.push('faceLandmark68Net');
+  await ensureNets(nets);
+
+  const detectorOptions = new faceapi.TinyFaceDetectorOptions({ inputSize: options.inputSize });
+  const single = faceapi.detectSingleFace(input, detectorOptions);
+
+  let detections: any;
+  if (options.withLandmarks) {
+    const task = single.withFaceLandmarks().withFaceExpressions();
+    detections = withAge ? await task.withAgeAndGender() : await task;
+  } else {
+    // Expressions don't need landmarks - the detector box is enough
+    const task = single.withFaceExpressions();
+    detections = withAge ? await task.withAgeAndGender() : await task;
+  }
+
+  if (!detections) {
+    return null;
+  }
+
+  const { x, y, width, height } = detections.detection.box;
+  return {
+    result: toEmotionResult(detections, withAge),
+    box: { x, y, width, height },
+    landmarks: options.withLandmarks
+      ? detections.landmarks.positions.map((p: faceapi.Point) => ({ x: p.x, y: p.y }))
+      : undefined,
+  };
+}
+
+/**
+ * Run every loaded net once on a blank input
+ *
+ * The first inference compiles the WebGL shaders for each input shape,
+ * which takes far longer than a normal detection. Doing it ahead of time
+ * (while on the setup page) keeps that cost out of the call.
+ */
+export async function warmUp(createCanvas: (width: number, height: number) => faceapi.TNetInput): Promise<void> {
+  const started = Date.now();
+
+  // One pass per detector input size used by startEmotionDetection
+  for (const inputSize of [320, 160]) {
+    await faceapi.nets.tinyFaceDetector.locateFaces(
+      createCanvas(inputSize, inputSize),
+      new faceapi.TinyFaceDetectorOptions({ inputSize })
+    );
+  }
+
+  // Face crops are resized to 112x112 by these nets
+  const face = createCanvas(112, 112);
+  await faceapi.nets.faceExpressionNet.predictExpressions(face);
+  if (faceapi.nets.ageGenderNet.isLoaded) {
+    await faceapi.nets.ageGenderNet.predictAgeAndGender(face);
+  }
+
+  console.log(`🔥 Face models warmed up in ${Date.now() - started}ms`);
+}
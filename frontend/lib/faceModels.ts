@@ -0,0 +1,90 @@
+/**
+ * Face model bundle - where the face-api.js weights come from and how they
+ * are cached
+ *
+ * Weights are self-hosted under /models/face/v<version>/ (populated by
+ * `npm run models:face`) with the jsDelivr CDN as a fallback. Every weight
+ * file is kept in the Cache API under the bundle version, so repeat visits
+ * load the models without touching the network. Safe to use in workers.
+ */
+
+// Bump together with FACE_MODEL_VERSION in scripts/fetch-face-models.mjs
+export const FACE_MODEL_VERSION = '1';
+
+export const LOCAL_MODEL_URL = `/models/face/v${FACE_MODEL_VERSION}/`;
+export const CDN_MODEL_URL = 'https://cdn.jsdelivr.net/npm/@vladmandic/face-api@1.7.14/model/';
+
+const CACHE_PREFIX = 'auralis-face-models-';
+const CACHE_NAME = `${CACHE_PREFIX}v${FACE_MODEL_VERSION}`;
+
+let resolvedModelUrl: Promise<string> | null = null;
+let staleCachesCleared = false;
+
+/**
+ * Pick the model location: the self-hosted bundle if it is deployed,
+ * otherwise the CDN
+ *
+ * @param origin Base URL for relative paths (needed inside workers)
+ */
+export function resolveModelUrl(origin: string = self.location.origin): Promise<string> {
+  resolvedModelUrl = resolvedModelUrl ?? (async () => {
+    const localUrl = new URL(LOCAL_MODEL_URL, origin).href;
+    try {
+      const response = await cachedFetch(`${localUrl}manifest.json`);
+      if (response.ok) {
+        return localUrl;
+      }
+    } catch (error) {
+      // Not deployed - fall through to the CDN
+    }
+    console.warn('Self-hosted face models not found, using CDN');
+    return CDN_MODEL_URL;
+  })();
+  return resolvedModelUrl;
+}
+
+/**
+ * fetch() that serves model files from the versioned Cache API store
+ *
+ * Only successful responses are cached. Falls back to a plain fetch where
+ * the Cache API is unavailable (e.g. insecure origins).
+ */
+export async function cachedFetch(input: RequestInfo | URL, init?: RequestInit): Promise<Response> {
+  if (typeof caches === 'undefined') {
+    return fetch(input, init);
+  }
+
+  try {
+    clearStaleCaches();
+    const cache = await caches.open(CACHE_NAME);
+    const request = new Request(input, init);
+
+    const cached = await cache.match(request);
+    if (cached) {
+      return cached;
+    }
+
+    const response = await fetch(request);
+    if (response.ok) {
+      await cache.put(request, response.clone());
+    }
+    return response;
+  } catch (error) {
+    console.warn('Face model cache unavailable:', error);
+    return fetch(input, init);
+  }
+}
+
+/**
+ * Delete caches from previous bundle versions (once per page load)
+ */
+function clearStaleCaches(): void {
+  if (staleCachesCleared) return;
+  staleCachesCleared = true;
+
+  caches.keys().then((names) => {
+    names
+      .filter((name) => name.startsWith(CACHE_PREFIX) && name !== CACHE_NAME)
+      .forEach((name) => caches.delete(name));
+  }).catch(() => {});
+}
@@ -0,0 +1,73 @@
+/**
+ * Decoder for the backend's typed binary frames (see backend/services/frames.py)
+ *
+ * Each frame is a 1-byte type, a 4-byte big-endian payload length, then the
+ * payload. Audio frames carry raw audio bytes; every other frame is UTF-8 JSON.
+ */
+
+export const FRAME_MEDIA_TYPE = 'application/x-auralis-frames';
+
+export const FRAME_TEXT_DELTA = 0x01;
+export const FRAME_AUDIO = 0x02;
+export const FRAME_DONE = 0x03;
+export const FRAME_VISEMES = 0x04;
+export const FRAME_TRANSCRIPT = 0x05;
+export const FRAME_CONTROL = 0x06;
+export const FRAME_ERROR = 0x7f;
+
+const HEADER_SIZE = 5;
+
+const textDecoder = new TextDecoder();
+
+/**
+ * Decode a JSON frame payload
+ */
+export function decodeJsonPayload<T = any>(payload: Uint8Array): T {
+  return JSON.parse(textDecoder.decode(payload)) as T;
+}
+
+/**
+ * Decode one whole frame (a WebSocket message carries exactly one)
+ */
+export function decodeFrame(data: ArrayBuffer): { type: number; payload: Uint8Array } {
+  const bytes = new Uint8Array(data);
+  const view = new DataView(data, 0, HEADER_SIZE);
+  const length = view.getUint32(1);
+  return { type: view.getUint8(0), payload: bytes.subarray(HEADER_SIZE, HEADER_SIZE + length) };
+}
+
+/**
+ * Read frames from a streamed response body, calling onFrame for each one
+ */
+export async function readFrames(
+  body: ReadableStream<Uint8Array>,
+  onFrame: (type: number, payload: Uint8Array) => void
+): Promise<void> {
+  const reader = body.getReader();
+  let buffer = new Uint8Array(0);
+
+  while (true) {
+    const { value, done } = await reader.read();
+    if (done) break;
+    if (!value || value.length === 0) continue;
+
+    // Append new bytes to whatever partial frame is left over
+    const merged = new Uint8Array(buffer.length + value.length);
+    merged.set(buffer);
+    merged.set(value, buffer.length);
+    buffer = merged;
+
+    let offset = 0;
+    while (buffer.length - offset >= HEADER_SIZE) {
+      const view = new DataView(buffer.buffer, buffer.byteOffset + offset, HEADER_SIZE);
+      const type = view.getUint8(0);
+      const length = view.getUint32(1);
+      if (buffer.length - offset < HEADER_SIZE + length) break;
+
+      const start = offset + HEADER_SIZE;
+      onFrame(type, buffer.slice(start, start + length));
+      offset = start + length;
+    }
+    buffer = buffer.slice(offset);
+  }
+}
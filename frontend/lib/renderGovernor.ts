@@ -0,0 +1,310 @@
+/**
+ * Render governor - frame pacing and quality tiers for WebGL render loops
+ *
+ * Renders at full rate only while something is visibly moving, paces
+ * background animation lower, and stops entirely while the tab is hidden.
+ * Frame intervals measured during full-rate rendering pick a quality tier
+ * (pixel ratio, antialiasing); the tier is remembered per loop for a day
+ * so the next mount starts at the right quality. A dropped tier is retried
+ * after a cooldown that doubles each time the retry drops again, so a busy
+ * moment doesn't cost quality for good and a slow device doesn't flap.
+ */
+
+export type QualityTier = 'high' | 'medium' | 'low';
+
+export interface TierSettings {
+  maxPixelRatio: number;
+  antialias: boolean; // Only applies when a renderer is created
+  shadows: boolean;
+}
+
+export const QUALITY_TIERS: Record<QualityTier, TierSettings> = {
+  high: { maxPixelRatio: 1.5, antialias: true, shadows: false },
+  medium: { maxPixelRatio: 1, antialias: true, shadows: false },
+  low: { maxPixelRatio: 0.75, antialias: false, shadows: false },
+};
+
+const TIER_ORDER: QualityTier[] = ['high', 'medium', 'low'];
+
+/**
+ * How much a loop needs to render right now
+ * - active: visible motion driven by the call (e.g. doctor speaking)
+ * - ambient: background motion (idle animation, fluid drift)
+ * - static: nothing changes between frames
+ */
+export type RenderActivity = 'active' | 'ambient' | 'static';
+
+const ACTIVITY_FPS: Record<RenderActivity, number> = {
+  active: 60,
+  ambient: 30,
+  static: 2,
+};
+
+// Tier adaptation, measured over frames rendered at full rate
+const SLOW_FRAME_MS = 1000 / 45;
+const FAST_FRAME_MS = 1000 / 57;
+const DOWNGRADE_SAMPLES = 90;
+const UPGRADE_SAMPLES = 600;
+const UPGRADE_COOLDOWN_MS = 60_000;
+const MAX_UPGRADE_COOLDOWN_MS = 30 * 60_000;
+
+const STORAGE_PREFIX = 'auralis-render-tier-';
+const STORED_TIER_MAX_AGE_MS = 24 * 60 * 60_000;
+
+interface StoredTier {
+  tier: QualityTier;
+  at: number; // Date.now() when the tier was measured
+}
+
+export interface RenderTelemetry {
+  tier: QualityTier;
+  activity: RenderActivity;
+  fps: number; // Frames actually rendered over the last second
+  paused: boolean;
+}
+
+const telemetry = new Map<string, RenderTelemetry>();
+
+type FrameTimeObserver = (name: string, ms: number) => void;
+
+const frameTimeObservers = new Set<FrameTimeObserver>();
+
+/**
+ * Current tier and frame rate of every governed loop, keyed by loop name
+ */
+export function getRenderTelemetry(): Record<string, RenderTelemetry> {
+  return Object.fromEntries(telemetry);
+}
+
+/**
+ * Receive the frame() time of every governed loop (used by the benchmark page)
+ *
+ * @returns Stops observing
+ */
+export function observeFrameTimes(observer: FrameTimeObserver): () => void {
+  frameTimeObservers.add(observer);
+  return () => {
+    frameTimeObservers.delete(observer);
+  };
+}
+
+/**
+ * Tier a loop should start at (tier measured in the last day, or high)
+ */
+export function preferredTier(name: string): QualityTier {
+  try {
+    const stored = JSON.parse(window.localStorage.getItem(STORAGE_PREFIX + name) ?? 'null') as StoredTier | null;
+    if (
+      stored && stored.tier in QUALITY_TIERS
+      && Date.now() - stored.at < STORED_TIER_MAX_AGE_MS
+    ) {
+      return stored.tier;
+    }
+  } catch (error) {
+    // Storage unavailable (private mode) or an old entry - use the default
+  }
+  return 'high';
+}
+
+/**
+ * Pixel ratio for a tier on this device
+ */
+export function pixelRatioFor(tier: QualityTier): number {
+  return Math.min(window.devicePixelRatio || 1, QUALITY_TIERS[tier].maxPixelRatio);
+}
+
+interface RenderGovernorOptions {
+  name: string; // Used for telemetry and the remembered tier
+  activity: () => RenderActivity;
+  frame: (deltaSeconds: number) => void; // Update and render one frame
+  onTierChange?: (tier: QualityTier, settings: TierSettings) => void;
+  initialTier?: QualityTier;
+  frameBudgetMs?: number; // Average full-rate frame time that triggers a downgrade
+  onFrameTime?: (ms: number) => void; // Time spent in frame(), e.g. for turn metrics
+}
+
+export class RenderGovernor {
+  tier: QualityTier;
+  private frameId: number | null = null;
+  private running = false;
+  private paused = false;
+  private lastFrameAt = 0;
+  private samples: number[] = [];
+  private upgradeAllowedAt = 0; // performance.now() before which a dropped tier isn't retried
+  private upgradeCooldownMs = UPGRADE_COOLDOWN_MS;
+  private upgradedSinceDrop = false;
+  private framesThisSecond = 0;
+  private secondStartedAt = 0;
+  private fps = 0;
+  private lastActivity: RenderActivity = 'static';
+
+  constructor(private options: RenderGovernorOptions) {
+    this.tier = options.initialTier ?? preferredTier(options.name);
+  }
+
+  /**
+   * Start the loop (renders the first frame immediately)
+   */
+  start(): void {
+    if (this.running) return;
+    this.running = true;
+    document.addEventListener('visibilitychange', this.handleVisibility);
+    this.lastFrameAt = 0;
+    this.schedule();
+  }
+
+  /**
+   * Stop the loop for good
+   */
+  stop(): void {
+    this.running = false;
+    document.removeEventListener('visibilitychange', this.handleVisibility);
+    this.cancel();
+    telemetry.delete(this.options.name);
+  }
+
+  /**
+   * Suspend rendering without tearing the loop down (e.g. off-screen)
+   */
+  pause(): void {
+    if (this.paused) return;
+    this.paused = true;
+    this.cancel();
+    this.report(true);
+  }
+
+  resume(): void {
+    if (!this.paused) return;
+    this.paused = false;
+    this.samples = [];
+    this.wake();
+  }
+
+  /**
+   * Render on the next animation frame regardless of pacing (e.g. after a
+   * resize or state change)
+   */
+  wake(): void {
+    this.lastFrameAt = 0;
+    if (this.running && !this.paused && this.frameId === null && !document.hidden) {
+      this.schedule();
+    }
+  }
+
+  private handleVisibility = () => {
+    if (document.hidden) {
+      this.cancel();
+      this.report(true);
+    } else {
+      this.samples = []; // Frame times across a hidden period are meaningless
+      this.wake();
+    }
+  };
+
+  private schedule(): void {
+    this.frameId = requestAnimationFrame(this.tick);
+  }
+
+  private cancel(): void {
+    if (this.frameId !== null) {
+      cancelAnimationFrame(this.frameId);
+      this.frameId = null;
+    }
+  }
+
+  private tick = (now: number) => {
+    this.frameId = null;
+    if (!this.running || this.paused || document.hidden) return;
+
+    const activity = this.options.activity();
+    const minInterval = 1000 / ACTIVITY_FPS[activity];
+    const sinceLast = now - this.lastFrameAt;
+
+    // Allow a little early so 60 Hz displays don't skip alternate frames
+    if (this.lastFrameAt === 0 || sinceLast >= minInterval - 2) {
+      const delta = this.lastFrameAt === 0 ? 0 : sinceLast / 1000;
+      if (activity === 'active' && this.lastActivity === 'active' && this.lastFrameAt !== 0) {
+        this.measure(sinceLast);
+      }
+      this.lastActivity = activity;
+      this.lastFrameAt = now;
+      if (this.options.onFrameTime || frameTimeObservers.size > 0) {
+        const frameStartedAt = performance.now();
+        this.options.frame(delta);
+        const frameMs = performance.now() - frameStartedAt;
+        this.options.onFrameTime?.(frameMs);
+        frameTimeObservers.forEach((observer) => observer(this.options.name, frameMs));
+      } else {
+        this.options.frame(delta);
+      }
+      this.countFrame(now);
+    }
+
+    this.schedule();
+  };
+
+  private measure(frameMs: number): void {
+    this.samples.push(frameMs);
+    const average = this.samples.reduce((sum, value) => sum + value, 0) / this.samples.length;
+
+    const budget = this.options.frameBudgetMs ?? SLOW_FRAME_MS;
+
+    if (this.samples.length >= DOWNGRADE_SAMPLES && average > budget) {
+      this.shiftTier(1);
+    } else if (this.samples.length >= UPGRADE_SAMPLES) {
+      if (average < FAST_FRAME_MS && performance.now() >= this.upgradeAllowedAt) {
+        this.shiftTier(-1);
+      }
+      this.samples = [];
+    }
+  }
+
+  private shiftTier(step: 1 | -1): void {
+    this.samples = [];
+    const index = TIER_ORDER.indexOf(this.tier) + step;
+    if (index < 0 || index >= TIER_ORDER.length) return;
+
+    this.tier = TIER_ORDER[index];
+    if (step > 0) {
+      // Dropping again right after a retry means the retry was premature
+      if (this.upgradedSinceDrop) {
+        this.upgradeCooldownMs = Math.min(this.upgradeCooldownMs * 2, MAX_UPGRADE_COOLDOWN_MS);
+      }
+      this.upgradeAllowedAt = performance.now() + this.upgradeCooldownMs;
+      this.upgradedSinceDrop = false;
+    } else {
+      this.upgradedSinceDrop = true;
+    }
+    console.log(`🎚️ ${this.options.name}: render tier → ${this.tier}`);
+
+    try {
+      const stored: StoredTier = { tier: this.tier, at: Date.now() };
+      window.localStorage.setItem(STORAGE_PREFIX + this.options.name, JSON.stringify(stored));
+    } catch (error) {
+      // Storage unavailable - the tier still applies for this session
+    }
+    this.options.onTierChange?.(this.tier, QUALITY_TIERS[this.tier]);
+    window.dispatchEvent(new CustomEvent('renderTierChange', {
+      detail: { name: this.options.name, tier: this.tier },
+    }));
+  }
+
+  private countFrame(now: number): void {
+    this.framesThisSecond++;
+    if (now - this.secondStartedAt >= 1000) {
+      this.fps = this.framesThisSecond;
+      this.framesThisSecond = 0;
+      this.secondStartedAt = now;
+      this.report(false);
+    }
+  }
+
+  private report(paused: boolean): void {
+    telemetry.set(this.options.name, {
+      tier: this.tier,
+      activity: this.lastActivity,
+      fps: paused ? 0 : this.fps,
+      paused,
+    });
+  }
+}
@@ -0,0 +1,14 @@
+/**
+ * Consultation session helpers
+ */
+
+/**
+ * Create a unique ID for a consultation session
+ */
+export function createSessionId(): string {
+  if (typeof crypto !== 'undefined' && typeof crypto.randomUUID === 'function') {
+    return crypto.randomUUID();
+  }
+  // Fallback for non-secure contexts where randomUUID is unavailable
+  return `${Date.now().toString(36)}-${Math.random().toString(36).slice(2, 12)}`;
+}
@@ -0,0 +1,111 @@
+/**
+ * Shared WebGL renderer - one GL context handed between 3D components
+ *
+ * Views are mounted one at a time (landing -> setup -> call), so the fluid
+ * background and the avatar can take turns on the same WebGLRenderer
+ * instead of each creating and tearing down a context. A released renderer
+ * is kept for a few seconds so the next view picks it up; if it is still
+ * held when another component asks, that component gets a private one.
+ */
+
+import * as THREE from 'three';
+
+const RELEASE_GRACE_MS = 5000;
+
+interface SharedSlot {
+  renderer: THREE.WebGLRenderer;
+  antialias: boolean;
+  inUse: boolean;
+  disposeTimer: ReturnType<typeof setTimeout> | null;
+}
+
+let shared: SharedSlot | null = null;
+const privateRenderers = new WeakSet<THREE.WebGLRenderer>();
+
+interface AcquireOptions {
+  antialias?: boolean; // Omit if the caller doesn't care (fullscreen passes)
+}
+
+function createRenderer(antialias: boolean): THREE.WebGLRenderer {
+  return new THREE.WebGLRenderer({ antialias, alpha: true });
+}
+
+/**
+ * Put a renderer back into its default state for the next owner
+ */
+function resetRenderer(renderer: THREE.WebGLRenderer): void {
+  renderer.setRenderTarget(null);
+  renderer.autoClear = true;
+  renderer.setClearColor(0x000000, 0);
+  renderer.clear();
+  renderer.outputColorSpace = THREE.SRGBColorSpace;
+  renderer.toneMapping = THREE.NoToneMapping;
+  renderer.toneMappingExposure = 1;
+  renderer.shadowMap.enabled = false;
+  renderer.setPixelRatio(1);
+  renderer.domElement.removeAttribute('style');
+}
+
+/**
+ * Take the shared renderer, or a private one if it is busy
+ *
+ * Antialiasing is fixed when a context is created, so an idle shared
+ * renderer with the wrong setting is replaced rather than reused.
+ */
+export function acquireRenderer(options: AcquireOptions = {}): THREE.WebGLRenderer {
+  if (shared && !shared.inUse) {
+    if (options.antialias === undefined || options.antialias === shared.antialias) {
+      if (shared.disposeTimer) clearTimeout(shared.disposeTimer);
+      shared.disposeTimer = null;
+      shared.inUse = true;
+      resetRenderer(shared.renderer);
+      return shared.renderer;
+    }
+    disposeShared();
+  }
+
+  const antialias = options.antialias ?? true;
+
+  if (shared) {
+    console.log('🎨 Shared renderer busy - creating a private context');
+    const renderer = createRenderer(antialias);
+    privateRenderers.add(renderer);
+    return renderer;
+  }
+
+  shared = {
+    renderer: createRenderer(antialias),
+    antialias,
+    inUse: true,
+    disposeTimer: null,
+  };
+  return shared.renderer;
+}
+
+/**
+ * Hand a renderer back (detaches its canvas)
+ *
+ * Callers dispose their own scenes, materials and render targets; the
+ * context itself is only destroyed once nobody reclaims it.
+ */
+export function releaseRenderer(renderer: THREE.WebGLRenderer): void {
+  const canvas = renderer.domElement;
+  if (canvas.parentNode) canvas.parentNode.removeChild(canvas);
+
+  if (privateRenderers.has(renderer) || !shared || shared.renderer !== renderer) {
+    privateRenderers.delete(renderer);
+    renderer.dispose();
+    return;
+  }
+
+  renderer.setRenderTarget(null);
+  shared.inUse = false;
+  shared.disposeTimer = setTimeout(disposeShared, RELEASE_GRACE_MS);
+}
+
+function disposeShared(): void {
+  if (!shared) return;
+  if (shared.disposeTimer) clearTimeout(shared.disposeTimer);
+  shared.renderer.dispose();
+  shared = null;
+}
@@ -0,0 +1,195 @@
+/**
+ * Streaming speech-to-text over /api/stt/stream (WebSocket)
+ *
+ * Microphone chunks are sent while the user is still speaking, so the
+ * transcript is ready almost as soon as they stop. Falls back to uploading
+ * the whole recording to /api/stt if the socket is unavailable.
+ */
+
+import { API_BASE_URL, WS_BASE_URL } from './config';
+import { AudioRecorder } from './audioUtils';
+import type { TurnTrace } from './turnMetrics';
+
+const CHUNK_MS = 250; // MediaRecorder timeslice
+const FINAL_TIMEOUT_MS = 15000;
+
+interface PendingFinal {
+  resolve: (text: string) => void;
+  reject: (error: Error) => void;
+}
+
+export class StreamingTranscriber {
+  private recorder: AudioRecorder;
+  private socket: WebSocket | null = null;
+  private socketReady: Promise<boolean> | null = null;
+  private queued: Blob[] = [];
+  private pendingFinal: PendingFinal | null = null;
+
+  /**
+   * @param onPartial Called with the transcript so far while the user speaks
+   * @param getStream Shared microphone stream, kept open between utterances
+   */
+  constructor(private onPartial?: (text: string) => void, getStream?: () => Promise<MediaStream>) {
+    this.recorder = new AudioRecorder(getStream);
+  }
+
+  /**
+   * Start recording and streaming a new utterance
+   */
+  async start(): Promise<void> {
+    this.queued = [];
+    this.ensureSocket();
+    await this.recorder.startRecording((chunk) => this.send(chunk), CHUNK_MS);
+  }
+
+  /**
+   * Check if currently recording
+   */
+  isRecording(): boolean {
+    return this.recorder.isRecording();
+  }
+
+  /**
+   * Stop recording and return the final transcript
+   *
+   * @param trace Turn being timed (marks recording_end; its id goes to the backend)
+   */
+  async finish(trace?: TurnTrace): Promise<string> {
+    // Resolves after the last chunk has been handed to send()
+    const audioBlob = await this.recorder.stopRecording();
+    trace?.mark('recording_end');
+
+    const connected = this.socketReady ? await this.socketReady : false;
+    if (connected && this.socket?.readyState === WebSocket.OPEN) {
+      try {
+        return await this.requestFinal(trace?.id);
+      } catch (error) {
+        console.warn('Streaming STT failed, uploading recording instead', error);
+      }
+    }
+    return uploadRecording(audioBlob, trace?.id);
+  }
+
+  /**
+   * Discard the current utterance
+   */
+  cancel(): void {
+    if (this.recorder.isRecording()) {
+      this.recorder.stopRecording().catch(() => {});
+    }
+    this.queued = [];
+    if (this.socket?.readyState === WebSocket.OPEN) {
+      this.socket.send(JSON.stringify({ type: 'cancel' }));
+    }
+  }
+
+  /**
+   * Stop recording and close the socket
+   */
+  close(): void {
+    this.cancel();
+    this.pendingFinal?.reject(new Error('Transcriber closed'));
+    this.pendingFinal = null;
+    this.socket?.close();
+    this.socket = null;
+    this.socketReady = null;
+  }
+
+  private ensureSocket(): void {
+    const state = this.socket?.readyState;
+    if (state === WebSocket.OPEN || state === WebSocket.CONNECTING) return;
+
+    const socket = new WebSocket(`${WS_BASE_URL}/api/stt/stream`);
+    this.socket = socket;
+
+    this.socketReady = new Promise<boolean>((resolve) => {
+      socket.onopen = () => {
+        // Chunks captured while connecting
+        this.queued.forEach((chunk) => socket.send(chunk));
+        this.queued = [];
+        resolve(true);
+      };
+      socket.onerror = () => resolve(false);
+      socket.onclose = () => {
+        resolve(false);
+        this.pendingFinal?.reject(new Error('STT socket closed'));
+        this.pendingFinal = null;
+        if (this.socket === socket) {
+          this.socket = null;
+        }
+      };
+    });
+
+    socket.onmessage = (event) => {
+      let message: { type: string; text?: string; detail?: string };
+      try {
+        message = JSON.parse(event.data);
+      } catch (error) {
+        console.warn('Malformed STT message', error);
+        return;
+      }
+
+      if (message.type === 'partial') {
+        this.onPartial?.(message.text || '');
+      } else if (message.type === 'final') {
+        this.pendingFinal?.resolve(message.text || '');
+        this.pendingFinal = null;
+      } else if (message.type === 'error') {
+        this.pendingFinal?.reject(new Error(message.detail || 'Transcription failed'));
+        this.pendingFinal = null;
+      }
+    };
+  }
+
+  private send(chunk: Blob): void {
+    if (this.socket?.readyState === WebSocket.OPEN) {
+      this.socket.send(chunk);
+    } else {
+      this.queued.push(chunk);
+    }
+  }
+
+  private requestFinal(turnId?: string): Promise<string> {
+    return new Promise<string>((resolve, reject) => {
+      const timer = setTimeout(() => {
+        this.pendingFinal = null;
+        reject(new Error('Timed out waiting for transcript'));
+      }, FINAL_TIMEOUT_MS);
+
+      this.pendingFinal = {
+        resolve: (text) => {
+          clearTimeout(timer);
+          resolve(text);
+        },
+        reject: (error) => {
+          clearTimeout(timer);
+          reject(error);
+        },
+      };
+      this.socket!.send(JSON.stringify({ type: 'end', turn_id: turnId }));
+    });
+  }
+}
+
+/**
+ * Transcribe a complete recording with a single upload
+ *
+ * @param turnId Turn id for backend latency tracing (X-Turn-Id)
+ */
+export async function uploadRecording(audioBlob: Blob, turnId?: string): Promise<string> {
+  const formData = new FormData();
+  formData.append('audio', audioBlob, 'recording.webm');
+
+  const response = await fetch(`${API_BASE_URL}/api/stt`, {
+    method: 'POST',
+    headers: turnId ? { 'X-Turn-Id': turnId } : undefined,
+    body: formData,
+  });
+
+  if (!response.ok) {
+    throw new Error('STT request failed');
+  }
+
+  const data = await response.json();
+  return data.text || '';
+}
@@ -0,0 +1,113 @@
+/**
+ * Text-to-speech client for the backend /api/tts endpoint
+ */
+
+import { API_BASE_URL } from './config';
+import { StreamingAudioPlayer, SpeechPlayer } from './audioUtils';
+import { readFrames, decodeJsonPayload, FRAME_MEDIA_TYPE, FRAME_AUDIO, FRAME_VISEMES } from './frames';
+import type { VisemeTimeline } from './visemes';
+
+/**
+ * Request speech for text and return a player fed as the audio arrives
+ *
+ * During a call pass the engine's player (getAudioEngine().createPlayback)
+ * so playback goes through the call's audio graph; otherwise an audio
+ * element player is used.
+ *
+ * Asks for viseme + audio frames so the avatar can lip-sync (the timeline
+ * lands on player.visemes), then binary audio/mpeg; either way playback can
+ * start on the first bytes. A backend that only speaks the legacy JSON
+ * format is still handled.
+ */
+export async function requestSpeech(
+  text: string,
+  voiceId?: string,
+  signal?: AbortSignal,
+  createPlayer: () => SpeechPlayer = () => new StreamingAudioPlayer()
+): Promise<SpeechPlayer> {
+  const response = await fetch(`${API_BASE_URL}/api/tts`, {
+    method: 'POST',
+    headers: {
+      'Content-Type': 'application/json',
+      Accept: `${FRAME_MEDIA_TYPE}, audio/mpeg;q=0.9, application/json;q=0.5`,
+    },
+    body: JSON.stringify({ text, voice_id: voiceId }),
+    signal,
+  });
+
+  if (!response.ok) {
+    throw new Error('TTS request failed');
+  }
+
+  const player = createPlayer();
+  const contentType = response.headers.get('content-type') || '';
+
+  if (contentType.startsWith(FRAME_MEDIA_TYPE) && response.body) {
+    pipeFramesToPlayer(response.body, player);
+  } else if (contentType.startsWith('audio/') && response.body) {
+    pipeToPlayer(response.body, player);
+  } else {
+    // Legacy base64 JSON body
+    const data = await response.json();
+    if (!data.audio_base64) {
+      player.dispose();
+      throw new Error('TTS response had no audio');
+    }
+    player.append(base64ToBytes(data.audio_base64));
+    player.end();
+  }
+
+  return player;
+}
+
+/**
+ * Feed a streamed response body into a player in the background
+ */
+async function pipeToPlayer(
+  body: ReadableStream<Uint8Array>,
+  player: SpeechPlayer
+): Promise<void> {
+  const reader = body.getReader();
+  try {
+    while (true) {
+      const { value, done } = await reader.read();
+      if (done) break;
+      if (value) player.append(value);
+    }
+  } catch (error) {
+    console.error('TTS stream interrupted:', error);
+  } finally {
+    player.end();
+  }
+}
+
+/**
+ * Feed a frames response (visemes + audio) into a player in the background
+ */
+async function pipeFramesToPlayer(
+  body: ReadableStream<Uint8Array>,
+  player: SpeechPlayer
+): Promise<void> {
+  try {
+    await readFrames(body, (type, payload) => {
+      if (type === FRAME_AUDIO) {
+        player.append(payload);
+      } else if (type === FRAME_VISEMES) {
+        player.visemes.append(decodeJsonPayload<VisemeTimeline>(payload));
+      }
+    });
+  } catch (error) {
+    console.error('TTS stream interrupted:', error);
+  } finally {
+    player.end();
+  }
+}
+
+function base64ToBytes(base64: string): Uint8Array {
+  const binary = atob(base64);
+  const bytes = new Uint8Array(binary.length);
+  for (let i = 0; i < binary.length; i++) {
+    bytes[i] = binary.charCodeAt(i);
+  }
+  return bytes;
+}
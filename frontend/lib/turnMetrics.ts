@@ -0,0 +1,117 @@
+/**
+ * Turn metrics - client-side latency of each conversation turn
+ *
+ * A TurnTrace starts when the patient stops speaking and marks each
+ * milestone up to the doctor's audio starting. Its id goes to the backend
+ * (X-Turn-Id header, or turn_id on the sockets) so both sides of a slow
+ * turn can be matched. With NEXT_PUBLIC_METRICS_BEACON the timings, plus
+ * face-detection and avatar frame-time samples, are posted to
+ * /api/metrics/client and exported by the backend's /metrics.
+ */
+
+import { API_BASE_URL, METRICS_BEACON_ENABLED } from './config';
+import { createSessionId } from './session';
+
+// Milestones, in ms from end of speech ("decode" is the first audio segment's decode time)
+export type TurnStage =
+  | 'recording_end'
+  | 'transcript'
+  | 'first_text'
+  | 'first_audio'
+  | 'decode'
+  | 'playback_start';
+
+export type FrameSampleKind = 'face_detection' | 'avatar_frame';
+
+const MAX_SAMPLES = 200; // Per kind between beacons
+
+const frameSamples: Record<FrameSampleKind, number[]> = {
+  face_detection: [],
+  avatar_frame: [],
+};
+const frameSeen: Record<FrameSampleKind, number> = {
+  face_detection: 0,
+  avatar_frame: 0,
+};
+
+/**
+ * Record a face-detection or avatar frame time (no-op without the beacon)
+ *
+ * Keeps a uniform random sample of at most MAX_SAMPLES per beacon.
+ */
+export function sampleFrameTime(kind: FrameSampleKind, ms: number): void {
+  if (!METRICS_BEACON_ENABLED) return;
+  const samples = frameSamples[kind];
+  const seen = ++frameSeen[kind];
+  if (samples.length < MAX_SAMPLES) {
+    samples.push(ms);
+  } else {
+    const slot = Math.floor(Math.random() * seen);
+    if (slot < MAX_SAMPLES) samples[slot] = ms;
+  }
+}
+
+function takeFrameSamples(): Record<FrameSampleKind, number[]> {
+  const taken = { face_detection: frameSamples.face_detection, avatar_frame: frameSamples.avatar_frame };
+  frameSamples.face_detection = [];
+  frameSamples.avatar_frame = [];
+  frameSeen.face_detection = 0;
+  frameSeen.avatar_frame = 0;
+  return taken;
+}
+
+export class TurnTrace {
+  readonly id = createSessionId();
+  private readonly startedAt = performance.now();
+  private stages: Partial<Record<TurnStage, number>> = {};
+  private finished = false;
+
+  /**
+   * @param transport "call" when the reply comes over the call channel, "rest" otherwise
+   */
+  constructor(public transport: 'rest' | 'call' = 'rest') {}
+
+  /**
+   * Record a milestone now (only its first occurrence counts)
+   */
+  mark(stage: TurnStage): void {
+    if (!(stage in this.stages)) {
+      this.stages[stage] = performance.now() - this.startedAt;
+    }
+  }
+
+  /**
+   * Record a stage measured elsewhere
+   */
+  measure(stage: TurnStage, ms: number): void {
+    if (!(stage in this.stages)) {
+      this.stages[stage] = ms;
+    }
+  }
+
+  /**
+   * Log the turn and send the beacon (once)
+   */
+  finish(): void {
+    if (this.finished) return;
+    this.finished = true;
+
+    const breakdown = Object.entries(this.stages)
+      .map(([stage, ms]) => `${stage} ${Math.round(ms!)}ms`)
+      .join(', ');
+    console.log(`⏱️ Turn ${this.id} (${this.transport}): ${breakdown}`);
+
+    if (!METRICS_BEACON_ENABLED) return;
+    fetch(`${API_BASE_URL}/api/metrics/client`, {
+      method: 'POST',
+      headers: { 'Content-Type': 'application/json' },
+      body: JSON.stringify({
+        turn_id: this.id,
+        transport: this.transport,
+        stages: this.stages,
+        samples: takeFrameSamples(),
+      }),
+      keepalive: true, // Survives the call view unmounting
+    }).catch(() => {}); // Metrics are best effort
+  }
+}
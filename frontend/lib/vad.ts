@@ -0,0 +1,147 @@
+/**
+ * Voice activity detection for end-of-utterance and barge-in
+ *
+ * Level analysis runs in an AudioWorklet (public/worklets/vad-processor.js)
+ * so it keeps working while the main thread is busy rendering the avatar.
+ */
+
+import type { AudioEngine } from './audioEngine';
+
+export interface VadOptions {
+  threshold?: number; // Minimum level counted as speech (0-1, same scale as AudioEngine.getOutputLevel)
+  minSpeechMs?: number; // Speech needed before it counts as an utterance
+  hangoverMs?: number; // Silence needed before the utterance is over
+  bargeInThreshold?: number; // Threshold while the doctor is speaking (speaker echo is louder)
+  bargeInMinSpeechMs?: number; // Speech needed to interrupt the doctor
+}
+
+interface VadCallbacks {
+  onSpeechStart?: (duringPlayback: boolean) => void;
+  onSpeechEnd?: (durationMs: number) => void;
+}
+
+const DEFAULT_OPTIONS: Required<VadOptions> = {
+  threshold: 0.08,
+  minSpeechMs: 250,
+  hangoverMs: 900,
+  bargeInThreshold: 0.2,
+  bargeInMinSpeechMs: 400,
+};
+
+const WORKLET_URL = '/worklets/vad-processor.js';
+
+export class VoiceActivityDetector {
+  private options: Required<VadOptions>;
+  private audioContext: AudioContext | null = null;
+  private stream: MediaStream | null = null;
+  private source: MediaStreamAudioSourceNode | null = null;
+  private ownsAudio = true; // False when running on a shared AudioEngine
+  private node: AudioWorkletNode | null = null;
+  private playbackActive = false;
+
+  constructor(private callbacks: VadCallbacks = {}, options: VadOptions = {}) {
+    this.options = { ...DEFAULT_OPTIONS, ...options };
+  }
+
+  /**
+   * Check whether the browser can run the VAD worklet
+   */
+  static isSupported(): boolean {
+    return typeof window !== 'undefined' &&
+      typeof AudioWorkletNode !== 'undefined' &&
+      !!navigator.mediaDevices?.getUserMedia;
+  }
+
+  /**
+   * Start detecting speech
+   *
+   * With an engine, the call's context and microphone are reused and left
+   * open on stop(); otherwise the detector opens (and closes) its own.
+   */
+  async start(engine?: AudioEngine): Promise<void> {
+    if (this.node) return;
+
+    if (engine) {
+      this.ownsAudio = false;
+      this.stream = await engine.acquireMicrophone();
+      this.audioContext = engine.context;
+      await engine.loadWorklet(WORKLET_URL);
+    } else {
+      // Echo cancellation keeps the doctor's own voice from triggering barge-in
+      this.stream = await navigator.mediaDevices.getUserMedia({
+        audio: { echoCancellation: true, noiseSuppression: true },
+      });
+
+      const AudioContextClass = window.AudioContext || (window as any).webkitAudioContext;
+      this.audioContext = new AudioContextClass();
+      await this.audioContext.audioWorklet.addModule(WORKLET_URL);
+    }
+
+    // No outputs: the node is a sink and nothing reaches the speakers
+    this.node = new AudioWorkletNode(this.audioContext, 'vad-processor', {
+      numberOfInputs: 1,
+      numberOfOutputs: 0,
+      processorOptions: this.workletOptions(),
+    });
+    this.node.port.onmessage = (event) => this.handleMessage(event.data);
+
+    this.source = this.audioContext.createMediaStreamSource(this.stream);
+    this.source.connect(this.node);
+    if (this.audioContext.state === 'suspended') {
+      await this.audioContext.resume().catch(() => {});
+    }
+  }
+
+  /**
+   * Switch to barge-in thresholds while the doctor is speaking
+   */
+  setPlaybackActive(active: boolean): void {
+    if (this.playbackActive === active) return;
+    this.playbackActive = active;
+    this.node?.port.postMessage({ type: 'configure', options: this.workletOptions() });
+    this.node?.port.postMessage({ type: 'reset' });
+  }
+
+  /**
+   * Update thresholds
+   */
+  configure(options: VadOptions): void {
+    this.options = { ...this.options, ...options };
+    this.node?.port.postMessage({ type: 'configure', options: this.workletOptions() });
+  }
+
+  /**
+   * Stop detection (and release the microphone unless it is shared)
+   */
+  stop(): void {
+    if (this.node) {
+      this.node.port.onmessage = null;
+      this.node.disconnect();
+      this.node = null;
+    }
+    this.source?.disconnect();
+    this.source = null;
+    if (this.ownsAudio) {
+      this.stream?.getTracks().forEach((track) => track.stop());
+      this.audioContext?.close().catch(() => {});
+    }
+    this.stream = null;
+    this.audioContext = null;
+  }
+
+  private workletOptions() {
+    return {
+      threshold: this.playbackActive ? this.options.bargeInThreshold : this.options.threshold,
+      minSpeechMs: this.playbackActive ? this.options.bargeInMinSpeechMs : this.options.minSpeechMs,
+      hangoverMs: this.options.hangoverMs,
+    };
+  }
+
+  private handleMessage(message: { type: string; durationMs?: number }): void {
+    if (message.type === 'speechStart') {
+      this.callbacks.onSpeechStart?.(this.playbackActive);
+    } else if (message.type === 'speechEnd') {
+      this.callbacks.onSpeechEnd?.(message.durationMs || 0);
+    }
+  }
+}
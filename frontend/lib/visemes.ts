@@ -0,0 +1,120 @@
+/**
+ * Viseme lip sync - plays backend viseme timelines against audio.currentTime
+ *
+ * The backend turns ElevenLabs character timestamps into mouth-shape keys
+ * (see backend/services/viseme.py) and sends them alongside the audio. The
+ * avatar samples the active timeline once per rendered frame, so lip sync
+ * needs no audio analysis and never touches React state.
+ */
+
+export interface VisemeTimeline {
+  t: number[]; // Key times, ms from the start of the audio stream
+  v: number[]; // Viseme IDs
+}
+
+// Jaw openness (0-1) per viseme ID, indexed as in backend/services/viseme.py
+const VISEME_OPENNESS = [
+  0,    // silence
+  0,    // PP - lips closed
+  0.15, // FF
+  0.2,  // TH
+  0.3,  // DD
+  0.35, // kk
+  0.3,  // CH
+  0.2,  // SS
+  0.35, // RR
+  1,    // aa
+  0.7,  // E
+  0.5,  // I
+  0.8,  // O
+  0.45, // U
+];
+
+// Blend into each key over this long, so the jaw moves instead of snapping
+const BLEND_MS = 70;
+
+/**
+ * Viseme keys for one audio stream, appended as frames arrive
+ */
+export class VisemeTrack {
+  private times: number[] = [];
+  private openness: number[] = [];
+
+  append(timeline: VisemeTimeline): void {
+    for (let i = 0; i < timeline.t.length; i++) {
+      const time = timeline.t[i];
+      const open = VISEME_OPENNESS[timeline.v[i]] ?? 0.3;
+      // Keys normally arrive in order; drop any that would go backwards
+      if (this.times.length > 0 && time < this.times[this.times.length - 1]) continue;
+      this.times.push(time);
+      this.openness.push(open);
+    }
+  }
+
+  isEmpty(): boolean {
+    return this.times.length === 0;
+  }
+
+  /**
+   * Jaw openness at a playback position, or null if there are no keys yet
+   *
+   * Past the last key the mouth holds its final (closing) shape.
+   */
+  openAt(ms: number): number | null {
+    const times = this.times;
+    if (times.length === 0) return null;
+    if (ms < times[0]) return 0;
+
+    // Last key at or before ms
+    let low = 0;
+    let high = times.length - 1;
+    while (low < high) {
+      const mid = (low + high + 1) >> 1;
+      if (times[mid] <= ms) low = mid;
+      else high = mid - 1;
+    }
+
+    const previous = low > 0 ? this.openness[low - 1] : 0;
+    const blend = Math.min(1, (ms - times[low]) / BLEND_MS);
+    return previous + (this.openness[low] - previous) * blend;
+  }
+}
+
+/**
+ * Anything with a playback position - an audio element or an engine playback
+ */
+export interface PlaybackClock {
+  readonly currentTime: number; // Seconds
+  readonly paused: boolean;
+}
+
+let activeAudio: PlaybackClock | null = null;
+let activeTrack: VisemeTrack | null = null;
+
+/**
+ * Make this audio the one the avatar lip-syncs to
+ */
+export function setLipSyncSource(audio: PlaybackClock, track: VisemeTrack): void {
+  activeAudio = audio;
+  activeTrack = track;
+}
+
+/**
+ * Stop lip-syncing to this audio (no-op if another source took over)
+ */
+export function clearLipSyncSource(audio: PlaybackClock): void {
+  if (activeAudio !== audio) return;
+  activeAudio = null;
+  activeTrack = null;
+}
+
+/**
+ * Jaw openness (0-1) for the audio playing now
+ *
+ * Returns null when nothing with a timeline is playing, so the caller can
+ * fall back to its own animation.
+ */
+export function currentMouthOpen(): number | null {
+  if (!activeAudio || !activeTrack || activeAudio.paused) return null;
+  return activeTrack.openAt(activeAudio.currentTime * 1000);
+}
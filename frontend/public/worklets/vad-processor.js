@@ -0,0 +1,105 @@
+/**
+ * Voice activity detection AudioWorklet
+ *
+ * Runs on the audio rendering thread. Microphone samples are grouped into
+ * short frames and each frame's level is computed with the same RMS + boost
+ * as AudioEngine.getOutputLevel, so thresholds read the same as playback levels.
+ * Posts {type: "speechStart"} once speech has lasted minSpeechMs and
+ * {type: "speechEnd"} after hangoverMs of silence.
+ */
+
+const DEFAULTS = {
+  frameMs: 20,
+  threshold: 0.08, // Minimum level counted as speech (0-1)
+  noiseRatio: 2.5, // Speech must also be this many times the noise floor
+  minSpeechMs: 250,
+  hangoverMs: 900,
+};
+
+class VadProcessor extends AudioWorkletProcessor {
+  constructor(options) {
+    super();
+    this.options = { ...DEFAULTS };
+    this.configure((options && options.processorOptions) || {});
+    this.reset();
+
+    this.port.onmessage = (event) => {
+      const message = event.data || {};
+      if (message.type === "configure") {
+        this.configure(message.options || {});
+      } else if (message.type === "reset") {
+        this.reset();
+      }
+    };
+  }
+
+  configure(options) {
+    for (const key of Object.keys(DEFAULTS)) {
+      if (typeof options[key] === "number") {
+        this.options[key] = options[key];
+      }
+    }
+    this.frameSamples = Math.max(1, Math.round((sampleRate * this.options.frameMs) / 1000));
+  }
+
+  reset() {
+    this.sumSquares = 0;
+    this.sampleCount = 0;
+    this.noiseFloor = 0;
+    this.speaking = false;
+    this.voicedMs = 0;
+    this.silentMs = 0;
+    this.speechMs = 0;
+  }
+
+  process(inputs) {
+    const channel = inputs[0] && inputs[0][0];
+    if (!channel) return true;
+
+    for (let i = 0; i < channel.length; i++) {
+      this.sumSquares += channel[i] * channel[i];
+      this.sampleCount++;
+      if (this.sampleCount >= this.frameSamples) {
+        const rms = Math.sqrt(this.sumSquares / this.sampleCount);
+        this.handleFrame(Math.min(1, rms * 4)); // Same boost as AudioEngine.getOutputLevel
+        this.sumSquares = 0;
+        this.sampleCount = 0;
+      }
+    }
+    return true;
+  }
+
+  handleFrame(level) {
+    const { frameMs, threshold, noiseRatio, minSpeechMs, hangoverMs } = this.options;
+    const voiced = level >= Math.max(threshold, this.noiseFloor * noiseRatio);
+
+    if (!voiced) {
+      // Track background noise slowly so a fan or hum doesn't count as speech
+      this.noiseFloor = this.noiseFloor === 0 ? level : this.noiseFloor * 0.95 + level * 0.05;
+    }
+
+    if (!this.speaking) {
+      // Short gaps between syllables don't reset the onset counter outright
+      this.voicedMs = voiced ? this.voicedMs + frameMs : Math.max(0, this.voicedMs - frameMs);
+      if (this.voicedMs >= minSpeechMs) {
+        this.speaking = true;
+        this.silentMs = 0;
+        this.speechMs = this.voicedMs;
+        this.port.postMessage({ type: "speechStart", level });
+      }
+      return;
+    }
+
+    this.speechMs += frameMs;
+    this.silentMs = voiced ? 0 : this.silentMs + frameMs;
+    if (this.silentMs >= hangoverMs) {
+      this.port.postMessage({ type: "speechEnd", durationMs: this.speechMs - this.silentMs });
+      this.speaking = false;
+      this.voicedMs = 0;
+      this.silentMs = 0;
+      this.speechMs = 0;
+    }
+  }
+}
+
+registerProcessor("vad-processor", VadProcessor);
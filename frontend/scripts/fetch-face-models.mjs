@@ -0,0 +1,67 @@
+/**
+ * Download the face-api.js model bundle into public/models/face/v<version>/
+ *
+ * Usage: npm run models:face
+ *
+ * The @vladmandic/face-api weights are already quantized (uint8/float16),
+ * so they are copied as-is. Commit the output so the app never depends on
+ * the CDN at runtime; bump FACE_MODEL_VERSION here and in lib/faceModels.ts
+ * whenever the bundle changes so browser caches are refreshed.
+ */
+
+import { mkdir, writeFile } from 'node:fs/promises';
+import path from 'node:path';
+import { fileURLToPath } from 'node:url';
+
+const FACE_MODEL_VERSION = '1';
+const SOURCE = 'https://cdn.jsdelivr.net/npm/@vladmandic/face-api@1.7.14/model/';
+const MODELS = [
+  'tiny_face_detector_model',
+  'face_expression_model',
+  'age_gender_model',
+  'face_landmark_68_model',
+];
+
+const root = path.dirname(path.dirname(fileURLToPath(import.meta.url)));
+const outDir = path.join(root, 'public', 'models', 'face', `v${FACE_MODEL_VERSION}`);
+
+async function download(file) {
+  const response = await fetch(SOURCE + file);
+  if (!response.ok) {
+    throw new Error(`${file}: HTTP ${response.status}`);
+  }
+  const data = Buffer.from(await response.arrayBuffer());
+  await writeFile(path.join(outDir, file), data);
+  console.log(`✓ ${file} (${(data.length / 1024).toFixed(0)} KB)`);
+  return data;
+}
+
+async function main() {
+  await mkdir(outDir, { recursive: true });
+  const files = [];
+
+  for (const model of MODELS) {
+    const manifestFile = `${model}-weights_manifest.json`;
+    const manifest = JSON.parse((await download(manifestFile)).toString('utf8'));
+    files.push(manifestFile);
+
+    for (const group of manifest) {
+      for (const shard of group.paths) {
+        await download(shard);
+        files.push(shard);
+      }
+    }
+  }
+
+  // lib/faceModels.ts checks for this file to decide the bundle is deployed
+  await writeFile(
+    path.join(outDir, 'manifest.json'),
+    JSON.stringify({ version: FACE_MODEL_VERSION, source: SOURCE, files }, null, 2) + '\n'
+  );
+  console.log(`✓ Face model bundle v${FACE_MODEL_VERSION} written to ${path.relative(root, outDir)}`);
+}
+
+main().catch((error) => {
+  console.error('Failed to fetch face models:', error);
+  process.exit(1);
+});
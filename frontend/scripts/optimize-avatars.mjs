@@ -0,0 +1,56 @@
+/**
+ * Build optimized avatar GLBs into public/models/avatars/
+ *
+ * Usage: npm run models:avatars
+ *
+ * Meshes are meshopt-compressed and textures re-encoded as WebP at most
+ * 1024px (the avatar never fills more than ~1000 device pixels), which
+ * cuts both download size and GPU texture memory. Geometry is not
+ * simplified - the faces are too dense in the jaw for that to look right.
+ * lib/avatarAssets.ts switches to these files once manifest.json exists.
+ */
+
+import { execFileSync } from 'node:child_process';
+import { mkdir, stat, writeFile } from 'node:fs/promises';
+import path from 'node:path';
+import { fileURLToPath } from 'node:url';
+
+const MODELS = ['DoctorM.glb', 'DoctorF.glb', 'Baymax.glb'];
+const GLTF_TRANSFORM = '@gltf-transform/cli@4';
+
+const root = path.dirname(path.dirname(fileURLToPath(import.meta.url)));
+const sourceDir = path.join(root, 'public', 'models');
+const outDir = path.join(sourceDir, 'avatars');
+
+async function main() {
+  await mkdir(outDir, { recursive: true });
+  const files = [];
+
+  for (const model of MODELS) {
+    const input = path.join(sourceDir, model);
+    const output = path.join(outDir, model);
+
+    execFileSync('npx', [
+      '--yes', GLTF_TRANSFORM, 'optimize', input, output,
+      '--compress', 'meshopt',
+      '--texture-compress', 'webp',
+      '--texture-size', '1024',
+      '--simplify', 'false',
+    ], { stdio: 'inherit' });
+
+    const before = (await stat(input)).size;
+    const after = (await stat(output)).size;
+    console.log(`✓ ${model}: ${(before / 1024).toFixed(0)} KB → ${(after / 1024).toFixed(0)} KB`);
+    files.push(model);
+  }
+
+  await writeFile(
+    path.join(outDir, 'manifest.json'),
+    JSON.stringify({ files, compression: 'meshopt', textures: 'webp@1024' }, null, 2) + '\n'
+  );
+}
+
+main().catch((error) => {
+  console.error('Failed to optimize avatars:', error);
+  process.exit(1);
+});